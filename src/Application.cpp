@@ -17,11 +17,13 @@ Application::Application(int& argc, char** argv) :
     searchService = std::make_unique<SearchService>(sessionService.get());
     exportService = std::make_unique<ExportService>(sessionService.get());
     timelineService = std::make_unique<TimelineService>(sessionService.get());
+    statisticsService = std::make_unique<StatisticsService>(sessionService.get());
 
     sessionService->moveToThread(serviceThread.get());
     searchService->moveToThread(serviceThread.get());
     exportService->moveToThread(serviceThread.get());
     timelineService->moveToThread(serviceThread.get());
+    statisticsService->moveToThread(serviceThread.get());
 
     setApplicationName(APPLICATION_NAME);
     setApplicationVersion(APPLICATION_VERSION);
@@ -65,3 +67,8 @@ TimelineService* Application::getTimelineService()
 {
     return timelineService.get();
 }
+
+StatisticsService* Application::getStatisticsService()
+{
+    return statisticsService.get();
+}
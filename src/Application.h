@@ -5,6 +5,7 @@
 #include "services/SearchService.h"
 #include "services/ExportService.h"
 #include "services/TimelineService.h"
+#include "services/StatisticsService.h"
 
 #include <QApplication>
 #include <QThread>
@@ -23,6 +24,7 @@ public:
     SearchService* getSearchService();
     ExportService* getExportService();
     TimelineService* getTimelineService();
+    StatisticsService* getStatisticsService();
 
 private:
     FormatManager formatManager;
@@ -32,4 +34,5 @@ private:
     std::unique_ptr<SearchService> searchService;
     std::unique_ptr<ExportService> exportService;
     std::unique_ptr<TimelineService> timelineService;
+    std::unique_ptr<StatisticsService> statisticsService;
 };
@@ -13,6 +13,7 @@ ExportSettingsDialog::ExportSettingsDialog(QWidget *parent) :
     Settings settings;
     ui->cbFilters->setChecked(settings.value("export/useFilters", false).toBool());
     ui->cbCsv->setChecked(settings.value("export/csvFormat", false).toBool());
+    ui->cbCompress->setChecked(settings.value("export/compress", false).toBool());
 }
 
 ExportSettingsDialog::~ExportSettingsDialog()
@@ -20,6 +21,7 @@ ExportSettingsDialog::~ExportSettingsDialog()
     Settings settings;
     settings.setValue("export/useFilters", ui->cbFilters->isChecked());
     settings.setValue("export/csvFormat", ui->cbCsv->isChecked());
+    settings.setValue("export/compress", ui->cbCompress->isChecked());
 
     delete ui;
 }
@@ -33,3 +35,8 @@ bool ExportSettingsDialog::csvFormat() const
 {
     return ui->cbCsv->isChecked();
 }
+
+bool ExportSettingsDialog::compress() const
+{
+    return ui->cbCompress->isChecked();
+}
@@ -16,6 +16,7 @@ public:
 
     bool useFilters() const;
     bool csvFormat() const;
+    bool compress() const;
 
 private:
     Ui::ExportSettingsDialog *ui;
@@ -0,0 +1,56 @@
+#include "FieldStatisticsDialog.h"
+
+#include <QHeaderView>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+
+FieldStatisticsDialog::FieldStatisticsDialog(const Statistics::FieldStatisticsResult& result, QWidget* parent) : QDialog(parent)
+{
+    setWindowTitle(tr("Field statistics"));
+
+    auto layout = new QVBoxLayout(this);
+    setLayout(layout);
+
+    auto table = new QTableWidget(this);
+    table->setColumnCount(9);
+    table->setHorizontalHeaderLabels({ tr("Field"), tr("Module"), tr("Count"), tr("Min"), tr("p50"), tr("p90"), tr("p99"), tr("p99.9"), tr("Max") });
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->verticalHeader()->setVisible(false);
+    layout->addWidget(table);
+
+    for (const auto& total : result.getTotals())
+    {
+        addRow(table, total, tr("All"));
+        if (!result.spec.perModule)
+            continue;
+
+        for (const auto& summary : result.summaries)
+        {
+            if (summary.field == total.field)
+                addRow(table, summary, summary.module);
+        }
+    }
+
+    table->resizeColumnsToContents();
+    resize(table->horizontalHeader()->length() + 40, 400);
+}
+
+void FieldStatisticsDialog::addRow(QTableWidget* table, const Statistics::FieldSummary& summary, const QString& module)
+{
+    int row = table->rowCount();
+    table->insertRow(row);
+
+    auto count = summary.histogram.getCount() + summary.histogram.getRejectedCount();
+    QStringList values{ summary.field, module, QString::number(count) };
+    if (count > 0)
+    {
+        values << QString::number(summary.sketch.getMin());
+        for (double q : { 0.5, 0.9, 0.99, 0.999 })
+            values << QString::number(summary.sketch.quantile(q));
+        values << QString::number(summary.sketch.getMax());
+    }
+
+    for (int column = 0; column < values.size(); ++column)
+        table->setItem(row, column, new QTableWidgetItem(values[column]));
+}
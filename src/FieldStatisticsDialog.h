@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QDialog>
+
+#include "Statistics/FieldStatistics.h"
+
+class QTableWidget;
+
+class FieldStatisticsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit FieldStatisticsDialog(const Statistics::FieldStatisticsResult& result, QWidget* parent = nullptr);
+
+private:
+    void addRow(QTableWidget* table, const Statistics::FieldSummary& summary, const QString& module);
+};
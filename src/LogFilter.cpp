@@ -1,5 +1,256 @@
 #include "LogFilter.h"
 
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+
+namespace
+{
+
+template<typename Function>
+bool withStringValue(const QVariant& value, Function&& function)
+{
+    if (value.metaType().id() == QMetaType::QString)
+        return function(*static_cast<const QString*>(value.constData()));
+    return function(value.toString());
+}
+
+}
+
+bool CompiledLogFilter::isEmpty() const
+{
+    return predicates.empty() && !query;
+}
+
+bool CompiledLogFilter::check(const LogEntry& entry) const
+{
+    for (const auto& predicate : predicates)
+    {
+        if (match(predicate, entry) != predicate.whitelist)
+            return false;
+    }
+    return !query || query->check(entry);
+}
+
+void CompiledLogFilter::filter(std::vector<LogEntry>& entries) const
+{
+    std::erase_if(entries, [this](const LogEntry& entry) {
+        for (const auto& predicate : predicates)
+        {
+            if (match(predicate, entry) != predicate.whitelist)
+                return true;
+        }
+        return false;
+    });
+
+    if (!query || entries.empty())
+        return;
+
+    std::vector<const LogEntry*> batch;
+    batch.reserve(entries.size());
+    for (const auto& entry : entries)
+        batch.push_back(&entry);
+
+    auto accepted = query->evaluate(batch);
+    size_t i = 0;
+    std::erase_if(entries, [&accepted, &i](const LogEntry&) { return !accepted[i++]; });
+}
+
+double CompiledLogFilter::takeCountedPredicates(const std::function<std::vector<HeavyHitters::Counter>(const QString&)>& getCounters)
+{
+    double selectivity = 1.0;
+    std::erase_if(predicates, [&getCounters, &selectivity](const Predicate& predicate) {
+        if (predicate.type != PredicateType::Value && predicate.type != PredicateType::Variant)
+            return false;
+
+        std::uint64_t total = 0;
+        std::uint64_t matched = 0;
+        for (const auto& counter : getCounters(predicate.field))
+        {
+            total += counter.count;
+            if (matchValue(predicate, counter.value.toString()))
+                matched += counter.count;
+        }
+        if (total == 0)
+            return false;
+
+        // Smoothed the same way as the sample estimate, so a value not counted yet does not look free
+        auto passed = predicate.whitelist ? matched : total - matched;
+        if (passed < total)
+            selectivity *= (passed + 1.0) / (total + 2.0);
+        return true;
+    });
+    return selectivity;
+}
+
+bool CompiledLogFilter::acceptsModule(const QString& module) const
+{
+    for (const auto& predicate : predicates)
+    {
+        if (predicate.type == PredicateType::Module)
+            return predicate.values->contains(module) == predicate.whitelist;
+    }
+    return true;
+}
+
+LogEntryPreFilter CompiledLogFilter::createPreFilter() const
+{
+    std::vector<Predicate> rawPredicates;
+    for (const auto& predicate : predicates)
+    {
+        if (predicate.type != PredicateType::Module && predicate.whitelist)
+            rawPredicates.push_back(predicate);
+    }
+
+    if (rawPredicates.empty())
+        return LogEntryPreFilter();
+
+    typedef std::vector<std::pair<int, const Format::Field*>> PartIndexes;
+    auto partIndexes = std::make_shared<std::unordered_map<const Format*, PartIndexes>>();
+
+    return [rawPredicates = std::move(rawPredicates), partIndexes](const RawLogEntry& entry, const std::shared_ptr<Format>& format) {
+        auto it = partIndexes->find(format.get());
+        if (it == partIndexes->end())
+        {
+            PartIndexes indexes;
+            for (const auto& predicate : rawPredicates)
+            {
+                int partIndex = getFieldPartIndex(format, predicate.field);
+                indexes.emplace_back(partIndex, partIndex >= 0 ? &format->fields[partIndex] : nullptr);
+            }
+            it = partIndexes->emplace(format.get(), std::move(indexes)).first;
+        }
+
+        for (size_t i = 0; i < rawPredicates.size(); ++i)
+        {
+            const auto& [partIndex, field] = it->second[i];
+            if (partIndex < 0 || partIndex >= entry.parts.size())
+                continue;
+
+            if (!matchValue(rawPredicates[i], getFieldText(entry.parts[partIndex], *field, format)))
+                return false;
+        }
+        return true;
+    };
+}
+
+LogIndex::BlockPredicates CompiledLogFilter::createBlockPredicates() const
+{
+    LogIndex::BlockPredicates result;
+    for (const auto& predicate : predicates)
+    {
+        if (predicate.type == PredicateType::Module)
+            continue;
+
+        result.emplace_back(getKey(predicate), [predicate](const QStringList& parts, const std::shared_ptr<Format>& format) {
+            int partIndex = getFieldPartIndex(format, predicate.field);
+            if (partIndex < 0 || partIndex >= parts.size())
+                return true;
+
+            const auto& field = format->fields[partIndex];
+            if (field.isOptional)
+                return true;
+
+            return matchValue(predicate, getFieldText(parts[partIndex], field, format)) == predicate.whitelist;
+        });
+    }
+    return result;
+}
+
+bool CompiledLogFilter::checkZoneMaps(const Snapshot::BlockInfo& block) const
+{
+    for (const auto& predicate : predicates)
+    {
+        if (predicate.type == PredicateType::Module || !predicate.whitelist)
+            continue;
+
+        const auto* zoneMap = block.findZoneMap(predicate.field);
+        if (!zoneMap)
+            continue;
+
+        if (zoneMap->values)
+        {
+            bool matches = std::any_of(zoneMap->values->begin(), zoneMap->values->end(), [&predicate](const QString& value) {
+                return matchValue(predicate, value);
+            });
+            if (!matches)
+                return false;
+        }
+        else if (zoneMap->range && predicate.type == PredicateType::Value)
+        {
+            bool isNumber = false;
+            double value = predicate.value.toDouble(&isNumber);
+            if (isNumber && (value < zoneMap->range->first || value > zoneMap->range->second))
+                return false;
+        }
+    }
+    return true;
+}
+
+std::vector<bool> CompiledLogFilter::selectBlocks(const SnapshotLog& snapshot) const
+{
+    const auto& blocks = snapshot.getBlocks();
+
+    std::vector<bool> result(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i)
+        result[i] = checkZoneMaps(blocks[i]);
+    return result;
+}
+
+QString CompiledLogFilter::getKey(const Predicate& predicate)
+{
+    QStringList key{ QString::number(static_cast<int>(predicate.type)), predicate.whitelist ? "+" : "-", predicate.field };
+    switch (predicate.type)
+    {
+    case PredicateType::Value:
+        key.append(predicate.value);
+        break;
+    case PredicateType::Variant:
+    {
+        QStringList values{ predicate.values->begin(), predicate.values->end() };
+        values.sort();
+        key.append(values);
+        break;
+    }
+    case PredicateType::Regex:
+        key.append(predicate.regex.pattern());
+        key.append(QString::number(predicate.regex.patternOptions().toInt()));
+        break;
+    default:
+        break;
+    }
+    return key.join(QChar(0x1F));
+}
+
+bool CompiledLogFilter::match(const Predicate& predicate, const LogEntry& entry)
+{
+    if (predicate.type == PredicateType::Module)
+        return predicate.values->contains(entry.module);
+
+    auto it = entry.values.find(predicate.field);
+    if (it == entry.values.end())
+        return false;
+
+    return withStringValue(it->second, [&predicate](const QString& value) { return matchValue(predicate, value); });
+}
+
+bool CompiledLogFilter::matchValue(const Predicate& predicate, const QString& value)
+{
+    switch (predicate.type)
+    {
+    case PredicateType::Module:
+        return predicate.values->contains(value);
+    case PredicateType::Value:
+        return value == predicate.value;
+    case PredicateType::Variant:
+        return predicate.values->contains(value);
+    case PredicateType::Regex:
+        return predicate.regex.match(value).hasMatch();
+    default:
+        return false;
+    }
+}
 
 LogFilter::LogFilter(const std::unordered_map<int, RegexFilter>& columnFilters,
                      const std::unordered_map<int, VariantFilter>& variants,
@@ -15,7 +266,7 @@ LogFilter::LogFilter(const std::unordered_map<int, RegexFilter>& columnFilters,
 
 bool LogFilter::isEmpty() const
 {
-    return columnFilters.empty() && variants.empty() && modules.empty();
+    return columnFilters.empty() && variants.empty() && modules.empty() && !query;
 }
 
 bool LogFilter::check(const LogEntry& entry) const
@@ -54,7 +305,141 @@ bool LogFilter::check(const LogEntry& entry) const
             return false;
     }
 
-    return true;
+    return !query || query->check(entry);
+}
+
+const std::shared_ptr<const LogQuery>& LogFilter::getQuery() const
+{
+    return query;
+}
+
+void LogFilter::setQuery(const std::shared_ptr<const LogQuery>& query)
+{
+    this->query = query;
+}
+
+CompiledLogFilter LogFilter::compile() const
+{
+    CompiledLogFilter result;
+    result.query = query;
+
+    auto getField = [this](int column) {
+        return column >= 0 && column < fields.size() ? fields[column] : QString();
+    };
+
+    if (!modules.empty())
+    {
+        CompiledLogFilter::Predicate predicate;
+        predicate.type = CompiledLogFilter::PredicateType::Module;
+        predicate.whitelist = modulesType == FilterType::Whitelist;
+        predicate.values = std::make_shared<const std::unordered_set<QString>>(modules);
+        result.predicates.push_back(std::move(predicate));
+    }
+
+    for (const auto& filter : variants)
+    {
+        CompiledLogFilter::Predicate predicate;
+        predicate.whitelist = filter.second.type == FilterType::Whitelist;
+        predicate.field = getField(filter.first);
+        if (filter.second.values.size() == 1)
+        {
+            predicate.type = CompiledLogFilter::PredicateType::Value;
+            predicate.value = *filter.second.values.begin();
+        }
+        else
+        {
+            predicate.type = CompiledLogFilter::PredicateType::Variant;
+            predicate.values = std::make_shared<const std::unordered_set<QString>>(filter.second.values);
+        }
+        result.predicates.push_back(std::move(predicate));
+    }
+
+    for (const auto& filter : columnFilters)
+    {
+        if (filter.second.regex.pattern().isEmpty())
+            continue;
+
+        CompiledLogFilter::Predicate predicate;
+        predicate.type = CompiledLogFilter::PredicateType::Regex;
+        predicate.whitelist = filter.second.type == FilterType::Whitelist;
+        predicate.field = getField(filter.first);
+        predicate.regex = filter.second.regex;
+        predicate.regex.optimize();
+        result.predicates.push_back(std::move(predicate));
+    }
+
+    auto getSelectivity = [](const CompiledLogFilter::Predicate& predicate) -> size_t {
+        if (!predicate.whitelist)
+            return std::numeric_limits<size_t>::max();
+        return predicate.values ? predicate.values->size() : 1;
+    };
+
+    std::stable_sort(result.predicates.begin(), result.predicates.end(), [&getSelectivity](const auto& l, const auto& r) {
+        if (l.type != r.type)
+            return l.type < r.type;
+        return getSelectivity(l) < getSelectivity(r);
+    });
+
+    return result;
+}
+
+LogBlockFilter LogFilter::createBlockFilter() const
+{
+    bool hasRequiredValues = std::any_of(variants.begin(), variants.end(), [this](const auto& filter) {
+        return filter.second.type == FilterType::Whitelist && filter.first < fields.size();
+    });
+
+    auto compiled = compile();
+    auto predicates = compiled.createBlockPredicates();
+    if (!hasRequiredValues && predicates.empty())
+        return LogBlockFilter();
+
+    auto indexFilter = LogIndex::createBlockFilter([filter = *this](const LogIndex& index) {
+        return filter.selectBlocks(index);
+    }, predicates);
+
+    // The filter is copied into iterators that may run on different threads
+    struct Candidates
+    {
+        std::mutex mutex;
+        std::unordered_map<const SnapshotLog*, std::shared_ptr<const std::vector<bool>>> blocks;
+    };
+
+    auto candidates = std::make_shared<Candidates>();
+    return [indexFilter, candidates, compiled = std::move(compiled)](const LogMetadata& metadata, qint64 pos, bool forward) -> std::optional<qint64> {
+        if (!metadata.snapshot)
+            return indexFilter(metadata, pos, forward);
+
+        std::shared_ptr<const std::vector<bool>> selected;
+        {
+            std::lock_guard lock(candidates->mutex);
+            auto it = candidates->blocks.find(metadata.snapshot.get());
+            if (it == candidates->blocks.end())
+                it = candidates->blocks.emplace(metadata.snapshot.get(), std::make_shared<const std::vector<bool>>(compiled.selectBlocks(*metadata.snapshot))).first;
+            selected = it->second;
+        }
+        return metadata.snapshot->findNextRow(*selected, pos, forward);
+    };
+}
+
+std::vector<bool> LogFilter::selectBlocks(const LogIndex& index) const
+{
+    std::vector<bool> blocks(index.getBlockCount(), true);
+    for (const auto& filter : variants)
+    {
+        if (filter.second.type != FilterType::Whitelist || filter.first >= fields.size())
+            continue;
+
+        auto fieldBlocks = index.findBlocks(fields[filter.first], filter.second.values);
+        for (size_t i = 0; i < blocks.size(); ++i)
+            blocks[i] = blocks[i] && fieldBlocks[i];
+    }
+    return blocks;
+}
+
+std::vector<bool> LogFilter::selectBlocks(const SnapshotLog& snapshot) const
+{
+    return compile().selectBlocks(snapshot);
 }
 
 void LogFilter::apply(const LogFilter& other)
@@ -76,4 +461,7 @@ void LogFilter::apply(const LogFilter& other)
         modules = other.modules;
         modulesType = other.modulesType;
     }
+
+    if (other.query)
+        query = other.query;
 }
@@ -1,10 +1,17 @@
 #pragma once
 
 #include "LogManagement/LogEntry.h"
+#include "LogManagement/LogEntryIterator.h"
+#include "LogManagement/LogIndex.h"
+#include "LogManagement/SnapshotLog.h"
+#include "LogQuery.h"
 
 #include <QRegularExpression>
 
+#include <functional>
+#include <memory>
 #include <unordered_set>
+#include <vector>
 
 
 enum class FilterType
@@ -26,6 +33,58 @@ struct VariantFilter
     FilterType type = FilterType::Whitelist;
 };
 
+class CompiledLogFilter
+{
+public:
+    CompiledLogFilter() = default;
+
+    bool isEmpty() const;
+
+    bool check(const LogEntry& entry) const;
+    void filter(std::vector<LogEntry>& entries) const;
+
+    // Removes the value predicates on fields with counted values and returns the fraction of entries
+    // passing them by those counts. The remaining predicates are left for the sampled entries.
+    double takeCountedPredicates(const std::function<std::vector<HeavyHitters::Counter>(const QString&)>& getCounters);
+
+    bool acceptsModule(const QString& module) const;
+    LogEntryPreFilter createPreFilter() const;
+    LogIndex::BlockPredicates createBlockPredicates() const;
+    // False when the zone maps of a snapshot block show that no entry in it passes
+    bool checkZoneMaps(const Snapshot::BlockInfo& block) const;
+    std::vector<bool> selectBlocks(const SnapshotLog& snapshot) const;
+
+private:
+    friend class LogFilter;
+
+    enum class PredicateType
+    {
+        Module,
+        Value,
+        Variant,
+        Regex
+    };
+
+    struct Predicate
+    {
+        PredicateType type = PredicateType::Variant;
+        bool whitelist = true;
+        QString field;
+        QString value;
+        std::shared_ptr<const std::unordered_set<QString>> values;
+        QRegularExpression regex;
+    };
+
+    static bool match(const Predicate& predicate, const LogEntry& entry);
+    static bool matchValue(const Predicate& predicate, const QString& value);
+
+    static QString getKey(const Predicate& predicate);
+
+private:
+    std::vector<Predicate> predicates;
+    std::shared_ptr<const LogQuery> query;
+};
+
 class LogFilter
 {
 public:
@@ -40,6 +99,15 @@ public:
 
     bool check(const LogEntry& entry) const;
 
+    const std::shared_ptr<const LogQuery>& getQuery() const;
+    void setQuery(const std::shared_ptr<const LogQuery>& query);
+
+    CompiledLogFilter compile() const;
+
+    LogBlockFilter createBlockFilter() const;
+    std::vector<bool> selectBlocks(const LogIndex& index) const;
+    std::vector<bool> selectBlocks(const SnapshotLog& snapshot) const;
+
     void apply(const LogFilter& other);
 
 private:
@@ -48,6 +116,7 @@ private:
     QStringList fields;
     std::unordered_set<QString> modules;
     FilterType modulesType = FilterType::Whitelist;
+    std::shared_ptr<const LogQuery> query;
 };
 
 Q_DECLARE_METATYPE(LogFilter);
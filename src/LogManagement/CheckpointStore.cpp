@@ -0,0 +1,174 @@
+#include "CheckpointStore.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+
+
+namespace
+{
+    const quint32 CheckpointMagic = 0x4C47434B;
+    const quint32 CheckpointVersion = 1;
+
+    struct FileStamp
+    {
+        QString filename;
+        qint64 size = 0;
+        qint64 modified = 0;
+
+        bool operator==(const FileStamp& other) const = default;
+    };
+
+    std::vector<FileStamp> getStamps(const std::vector<LogMetadata>& files)
+    {
+        std::vector<FileStamp> stamps;
+        stamps.reserve(files.size());
+        for (const auto& file : files)
+        {
+            QFileInfo info(file.filename);
+            stamps.push_back({ file.filename, info.size(), info.lastModified().toMSecsSinceEpoch() });
+        }
+        std::sort(stamps.begin(), stamps.end(), [](const FileStamp& lhs, const FileStamp& rhs) { return lhs.filename < rhs.filename; });
+        return stamps;
+    }
+
+    qint64 toNanoseconds(const std::chrono::system_clock::time_point& time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    std::chrono::system_clock::time_point fromNanoseconds(qint64 value)
+    {
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(value)));
+    }
+}
+
+void CheckpointStore::add(const MergeHeapCache& checkpoint)
+{
+    if (checkpoint.heap.empty())
+        return;
+
+    std::lock_guard lock(mutex);
+    checkpoints.insert_or_assign(checkpoint.time, checkpoint);
+
+    if (checkpoints.size() > MaxCheckpoints)
+    {
+        // Thin out evenly so the remaining checkpoints still cover the whole session
+        bool erase = false;
+        for (auto it = checkpoints.begin(); it != checkpoints.end();)
+        {
+            if (erase)
+                it = checkpoints.erase(it);
+            else
+                ++it;
+            erase = !erase;
+        }
+    }
+}
+
+std::optional<MergeHeapCache> CheckpointStore::findBefore(const std::chrono::system_clock::time_point& time) const
+{
+    std::lock_guard lock(mutex);
+    auto it = checkpoints.upper_bound(time);
+    if (it == checkpoints.begin())
+        return std::nullopt;
+    return std::prev(it)->second;
+}
+
+size_t CheckpointStore::size() const
+{
+    std::lock_guard lock(mutex);
+    return checkpoints.size();
+}
+
+bool CheckpointStore::load(const QString& path, const std::vector<LogMetadata>& files)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0, fileCount = 0;
+    stream >> magic >> version >> fileCount;
+    if (magic != CheckpointMagic || version != CheckpointVersion)
+        return false;
+
+    std::vector<FileStamp> stamps(fileCount);
+    for (auto& stamp : stamps)
+        stream >> stamp.filename >> stamp.size >> stamp.modified;
+    if (stream.status() != QDataStream::Ok || stamps != getStamps(files))
+        return false;
+
+    quint32 count = 0;
+    stream >> count;
+
+    std::map<std::chrono::system_clock::time_point, MergeHeapCache> loaded;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        qint64 time = 0;
+        quint32 heapSize = 0;
+        stream >> time >> heapSize;
+
+        MergeHeapCache checkpoint;
+        checkpoint.time = fromNanoseconds(time);
+        checkpoint.heap.resize(heapSize);
+        for (auto& item : checkpoint.heap)
+        {
+            qint64 itemTime = 0, pos = 0;
+            stream >> item.module >> itemTime >> pos;
+            item.time = fromNanoseconds(itemTime);
+            item.pos = static_cast<int>(pos);
+        }
+        loaded.emplace(checkpoint.time, std::move(checkpoint));
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        qWarning() << "Checkpoint file" << path << "is corrupted";
+        return false;
+    }
+
+    std::lock_guard lock(mutex);
+    loaded.merge(checkpoints);
+    checkpoints = std::move(loaded);
+    return true;
+}
+
+bool CheckpointStore::save(const QString& path, const std::vector<LogMetadata>& files) const
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Failed to save checkpoints" << path << ":" << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    auto stamps = getStamps(files);
+    stream << CheckpointMagic << CheckpointVersion << static_cast<quint32>(stamps.size());
+    for (const auto& stamp : stamps)
+        stream << stamp.filename << stamp.size << stamp.modified;
+
+    std::lock_guard lock(mutex);
+    stream << static_cast<quint32>(checkpoints.size());
+    for (const auto& [time, checkpoint] : checkpoints)
+    {
+        stream << toNanoseconds(time) << static_cast<quint32>(checkpoint.heap.size());
+        for (const auto& item : checkpoint.heap)
+            stream << item.module << toNanoseconds(item.time) << static_cast<qint64>(item.pos);
+    }
+
+    return file.commit();
+}
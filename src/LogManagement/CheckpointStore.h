@@ -0,0 +1,30 @@
+#pragma once
+
+#include "LogEntryIterator.h"
+#include "LogMetadata.h"
+
+#include <QString>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+
+class CheckpointStore
+{
+public:
+    static constexpr size_t MaxCheckpoints = 4096;
+
+    void add(const MergeHeapCache& checkpoint);
+    std::optional<MergeHeapCache> findBefore(const std::chrono::system_clock::time_point& time) const;
+    size_t size() const;
+
+    bool load(const QString& path, const std::vector<LogMetadata>& files);
+    bool save(const QString& path, const std::vector<LogMetadata>& files) const;
+
+private:
+    mutable std::mutex mutex;
+    std::map<std::chrono::system_clock::time_point, MergeHeapCache> checkpoints;
+};
@@ -8,9 +8,11 @@ template<bool straight = true>
 class FilteredLogIterator
 {
 public:
-    FilteredLogIterator(const std::shared_ptr<LogEntryIterator<straight>>& baseIterator, const LogFilter& logFilter) :
+    // The base iterator is expected to be created with the module, pre- and block filters of the
+    // same filter, this only drops the entries they let through. A null filter passes every entry.
+    FilteredLogIterator(const std::shared_ptr<LogEntryIterator<straight>>& baseIterator, const std::shared_ptr<const CompiledLogFilter>& compiledFilter) :
         iterator(baseIterator),
-        filter(logFilter)
+        filter(compiledFilter)
     {
         if (!iterator)
             throw std::invalid_argument("Base iterator cannot be null");
@@ -28,7 +30,7 @@ public:
 
         while (auto entry = iterator->next())
         {
-            if (filter.check(*entry))
+            if (!filter || filter->check(*entry))
                 return entry;
         }
 
@@ -50,8 +52,18 @@ public:
         return iterator->getCache();
     }
 
+    void flushEnumValues()
+    {
+        iterator->flushEnumValues();
+    }
+
+    const std::shared_ptr<LogEntryIterator<straight>>& getBase() const
+    {
+        return iterator;
+    }
+
 private:
     std::shared_ptr<LogEntryIterator<straight>> iterator;
-    LogFilter filter;
+    std::shared_ptr<const CompiledLogFilter> filter;
 };
 
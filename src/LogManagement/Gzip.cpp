@@ -0,0 +1,79 @@
+#include "Gzip.h"
+
+#include <zlib.h>
+
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+    // Adding 16 to the window bits selects the gzip wrapper, adding 32 detects it when reading
+    constexpr int GzipWindowBits = 15 + 16;
+    constexpr int DetectWindowBits = 15 + 32;
+    constexpr qsizetype InflateChunkSize = 256 * 1024;
+}
+
+QByteArray compressGzip(const QByteArray& data, int level)
+{
+    z_stream stream{};
+    if (deflateInit2(&stream, level, Z_DEFLATED, GzipWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw std::runtime_error("cannot initialize deflate");
+
+    QByteArray result;
+    result.resize(static_cast<qsizetype>(deflateBound(&stream, static_cast<uLong>(data.size()))));
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    stream.avail_out = static_cast<uInt>(result.size());
+
+    int status = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END)
+        throw std::runtime_error("deflate failed with code " + std::to_string(status));
+
+    result.resize(static_cast<qsizetype>(stream.total_out));
+    return result;
+}
+
+QByteArray decompressGzip(const QByteArray& data)
+{
+    if (data.isEmpty())
+        return {};
+
+    z_stream stream{};
+    if (inflateInit2(&stream, DetectWindowBits) != Z_OK)
+        throw std::runtime_error("cannot initialize inflate");
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    QByteArray result;
+    while (true)
+    {
+        qsizetype offset = result.size();
+        result.resize(offset + InflateChunkSize);
+        stream.next_out = reinterpret_cast<Bytef*>(result.data() + offset);
+        stream.avail_out = static_cast<uInt>(InflateChunkSize);
+
+        int status = inflate(&stream, Z_NO_FLUSH);
+        result.resize(result.size() - stream.avail_out);
+
+        if (status == Z_STREAM_END)
+        {
+            // The next member starts right after the end of this one
+            if (stream.avail_in == 0)
+                break;
+            inflateReset(&stream);
+        }
+        else if (status != Z_OK && !(status == Z_BUF_ERROR && stream.avail_out == 0))
+        {
+            inflateEnd(&stream);
+            throw std::runtime_error("gzip data is corrupted, inflate failed with code " + std::to_string(status));
+        }
+    }
+
+    inflateEnd(&stream);
+    return result;
+}
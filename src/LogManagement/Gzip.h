@@ -0,0 +1,10 @@
+#pragma once
+
+#include <QByteArray>
+
+
+// Compresses data into one complete gzip member. Members can be concatenated,
+// the result is still a valid gzip file.
+QByteArray compressGzip(const QByteArray& data, int level = -1);
+// Decompresses every member of a gzip file
+QByteArray decompressGzip(const QByteArray& data);
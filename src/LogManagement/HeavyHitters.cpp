@@ -0,0 +1,104 @@
+#include "HeavyHitters.h"
+
+#include <algorithm>
+
+
+HeavyHitters::HeavyHitters(size_t capacity) :
+    capacity(std::max<size_t>(capacity, 1))
+{}
+
+void HeavyHitters::add(const QVariant& value, std::uint64_t count)
+{
+    total += count;
+
+    auto it = positions.find(value);
+    if (it != positions.end())
+    {
+        counters[it->second].count += count;
+        siftDown(it->second);
+        return;
+    }
+
+    if (counters.size() < capacity)
+    {
+        positions.emplace(value, counters.size());
+        counters.push_back({ value, count, 0 });
+        siftUp(counters.size() - 1);
+        return;
+    }
+
+    // The new value takes over the smallest counter and inherits its count as the error
+    auto& smallest = counters.front();
+    positions.erase(smallest.value);
+    smallest.error = smallest.count;
+    smallest.count += count;
+    smallest.value = value;
+    positions.emplace(value, 0);
+    siftDown(0);
+}
+
+void HeavyHitters::merge(const std::vector<Counter>& other)
+{
+    for (const auto& counter : other)
+    {
+        add(counter.value, counter.count);
+        counters[positions.at(counter.value)].error += counter.error;
+    }
+}
+
+std::vector<HeavyHitters::Counter> HeavyHitters::getTop(size_t count) const
+{
+    std::vector<Counter> result = counters;
+    std::sort(result.begin(), result.end(), [](const Counter& lhs, const Counter& rhs) {
+        return lhs.count > rhs.count;
+    });
+    if (result.size() > count)
+        result.resize(count);
+    return result;
+}
+
+size_t HeavyHitters::size() const
+{
+    return counters.size();
+}
+
+std::uint64_t HeavyHitters::getTotal() const
+{
+    return total;
+}
+
+void HeavyHitters::siftUp(size_t pos)
+{
+    while (pos > 0)
+    {
+        size_t parent = (pos - 1) / 2;
+        if (counters[parent].count <= counters[pos].count)
+            break;
+        swapCounters(parent, pos);
+        pos = parent;
+    }
+}
+
+void HeavyHitters::siftDown(size_t pos)
+{
+    while (true)
+    {
+        size_t smallest = pos;
+        for (size_t child = pos * 2 + 1; child <= pos * 2 + 2 && child < counters.size(); ++child)
+        {
+            if (counters[child].count < counters[smallest].count)
+                smallest = child;
+        }
+        if (smallest == pos)
+            break;
+        swapCounters(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void HeavyHitters::swapCounters(size_t lhs, size_t rhs)
+{
+    std::swap(counters[lhs], counters[rhs]);
+    positions[counters[lhs].value] = lhs;
+    positions[counters[rhs].value] = rhs;
+}
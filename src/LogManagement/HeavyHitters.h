@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Format.h"
+
+#include <QVariant>
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+
+// Space-Saving sketch: tracks the most frequent values of a field in bounded memory.
+// Every tracked count overestimates the real one by at most its error, values seen
+// fewer times than the smallest tracked count may be missing.
+class HeavyHitters
+{
+public:
+    static constexpr size_t DefaultCapacity = 256;
+
+    struct Counter
+    {
+        QVariant value;
+        std::uint64_t count = 0;
+        std::uint64_t error = 0;
+    };
+
+    explicit HeavyHitters(size_t capacity = DefaultCapacity);
+
+    void add(const QVariant& value, std::uint64_t count = 1);
+    // Adds the counters of another sketch, their errors carry over
+    void merge(const std::vector<Counter>& other);
+
+    // Most frequent first
+    std::vector<Counter> getTop(size_t count = std::numeric_limits<size_t>::max()) const;
+
+    size_t size() const;
+    std::uint64_t getTotal() const;
+
+private:
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+    void swapCounters(size_t lhs, size_t rhs);
+
+private:
+    size_t capacity;
+    std::uint64_t total = 0;
+    // Min-heap by count, so the least frequent value is the one to evict
+    std::vector<Counter> counters;
+    std::unordered_map<QVariant, size_t, VariantHash> positions;
+};
@@ -2,6 +2,8 @@
 
 #include "LogUtils.h"
 
+#include <cstring>
+
 
 Log::Log(std::unique_ptr<QIODevice>&& _file, const std::optional<QStringConverter::Encoding>& _encoding, const std::shared_ptr<std::vector<Format::Comment>>& _comments) :
     file(std::move(_file)),
@@ -21,6 +23,10 @@ Log::Log(std::unique_ptr<QIODevice>&& _file, const std::optional<QStringConverte
 
     decoder = QStringDecoder(encoding);
     fileStart = file->pos();
+
+    QStringEncoder encoder(encoding);
+    lineFeed = encoder.encode(QStringLiteral("\n"));
+    carriageReturn = encoder.encode(QStringLiteral("\r"));
 }
 
 Log::Log(std::unique_ptr<QIODevice>&& _file, qint64 pos, const std::optional<QStringConverter::Encoding>& encoding, const std::shared_ptr<std::vector<Format::Comment>>& _comment) :
@@ -31,38 +37,27 @@ Log::Log(std::unique_ptr<QIODevice>&& _file, qint64 pos, const std::optional<QSt
 
 std::optional<QString> Log::prevLine()
 {
-    QString line;
     std::optional<Format::Comment> comment;
-    decoder.resetState();
-    while (file->pos() != fileStart)
+    qint64 pos = getFilePosition();
+    buffer.clear();
+    while (pos > fileStart)
     {
-        QByteArray charData(encodingWidth, '\0');
+        while (pos > fileStart && isLineBreak(pos - encodingWidth))
+            pos -= encodingWidth;
 
-        int prevPos = file->pos();
-        while (prevPos > fileStart)
-        {
-            prevPos -= encodingWidth;
-            file->seek(prevPos);
-            if (file->read(charData.data(), encodingWidth) != encodingWidth)
-                return std::nullopt;
-
-            QString ch = decoder.decode(QByteArrayView(charData));
-            decoder.resetState();
-            if (ch != "\n" && ch != "\r")
-            {
-                line.prepend(ch);
-            }
-            else if (!line.isEmpty())
-            {
-                break;
-            }
-        }
+        qint64 lineEnd = pos;
+        while (pos > fileStart && !isLineBreak(pos - encodingWidth))
+            pos -= encodingWidth;
 
-        file->seek(prevPos);
+        file->seek(pos);
 
-        if (line.isEmpty())
+        if (pos == lineEnd)
             continue;
 
+        decoder.resetState();
+        QString line = decoder.decode(readBackward(pos, lineEnd));
+        decoder.resetState();
+
         if (comment)
         {
             if (line.startsWith(comment.value().start))
@@ -180,6 +175,7 @@ void Log::seek(qint64 pos)
         file->seek(0);
     }
     buffer.clear();
+    reverseBuffer.clear();
 }
 
 void Log::goToEnd()
@@ -251,6 +247,35 @@ bool Log::getToNextLine(qint64& pos, QString& line)
     return false;
 }
 
+bool Log::isLineBreak(qint64 pos)
+{
+    if (pos < reverseBufferStart || pos + encodingWidth > reverseBufferStart + reverseBuffer.size())
+    {
+        qint64 end = pos + encodingWidth;
+        reverseBufferStart = std::max(fileStart, end - ReverseChunkSize);
+        if (!file->seek(reverseBufferStart))
+            throw std::runtime_error("cannot seek to position " + std::to_string(reverseBufferStart) + " in log file: " + file->errorString().toStdString());
+        reverseBuffer = file->read(end - reverseBufferStart);
+        if (reverseBuffer.size() != end - reverseBufferStart)
+            throw std::runtime_error("cannot read log file: " + file->errorString().toStdString());
+    }
+
+    const char* ch = reverseBuffer.constData() + (pos - reverseBufferStart);
+    return (lineFeed.size() == encodingWidth && std::memcmp(ch, lineFeed.constData(), encodingWidth) == 0)
+        || (carriageReturn.size() == encodingWidth && std::memcmp(ch, carriageReturn.constData(), encodingWidth) == 0);
+}
+
+QByteArray Log::readBackward(qint64 from, qint64 to)
+{
+    if (from >= reverseBufferStart && to <= reverseBufferStart + reverseBuffer.size())
+        return reverseBuffer.mid(from - reverseBufferStart, to - from);
+
+    file->seek(from);
+    QByteArray data = file->read(to - from);
+    file->seek(from);
+    return data;
+}
+
 bool Log::isCommentEnd(const Format::Comment& comment, const QString& line) const
 {
     return comment.finish && line.endsWith(comment.finish.value());
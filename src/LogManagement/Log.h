@@ -4,6 +4,7 @@
 
 #include <QIODevice>
 #include <QStringDecoder>
+#include <QStringEncoder>
 
 #include <optional>
 #include <memory>
@@ -28,6 +29,9 @@ private:
 
     bool getToNextLine(qint64& pos, QString& line);
 
+    bool isLineBreak(qint64 pos);
+    QByteArray readBackward(qint64 from, qint64 to);
+
     bool isCommentEnd(const Format::Comment& comment, const QString& line) const;
 
 private:
@@ -37,4 +41,11 @@ private:
     qint64 fileStart = 0;
     QByteArray buffer;
     qsizetype encodingWidth = 1;
+
+    QByteArray lineFeed;
+    QByteArray carriageReturn;
+    QByteArray reverseBuffer;
+    qint64 reverseBufferStart = 0;
+
+    static constexpr qint64 ReverseChunkSize = 4096;
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QVariant>
+#include <QStringList>
 
 #include <chrono>
 #include <unordered_map>
@@ -16,3 +17,12 @@ struct LogEntry
     std::unordered_map<QString, QVariant> values;
     QString additionalLines;
 };
+
+struct RawLogEntry
+{
+    QString module;
+
+    QString line;
+    QStringList parts;
+    QString additionalLines;
+};
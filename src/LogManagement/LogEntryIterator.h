@@ -3,6 +3,7 @@
 #include "LogStorage.h"
 #include "LogEntry.h"
 #include "LogUtils.h"
+#include "SnapshotLog.h"
 
 #include <QDebug>
 #include <exception>
@@ -23,6 +24,9 @@ struct MergeHeapCache
     std::vector<HeapItemCache> heap;
 };
 
+typedef std::function<bool(const RawLogEntry&, const std::shared_ptr<Format>&)> LogEntryPreFilter;
+typedef std::function<bool(const QString&)> LogModuleFilter;
+
 
 template<bool straight = true>
 class LogEntryIterator
@@ -36,6 +40,10 @@ public:
         QString module;
         std::shared_ptr<Log> log;
 
+        std::shared_ptr<SnapshotLog> snapshot;
+        std::shared_ptr<const Snapshot::Block> block;
+        qint64 row = 0;
+
         LogEntry entry;
 
         QString line;
@@ -44,9 +52,6 @@ public:
         qint64 entryPos = 0;
 
         HeapItem() = default;
-        HeapItem(const LogStorage::LogMetaEntry* metadata, QString&& module, std::shared_ptr<Log>&& log, LogEntry&& entry, QString&& line, qint64 lineStart, qint64 entryPos) :
-            metadata(metadata), module(std::move(module)), log(std::move(log)), entry(std::move(entry)), line(std::move(line)), lineStart(lineStart), entryPos(entryPos)
-        {}
 
         bool operator<(const HeapItem& other) const
         {
@@ -63,8 +68,16 @@ public:
             const auto& md = logStorage->findLog(cache.module, cache.time);
             metadata = &md;
             module = cache.module;
+            snapshot = metadata->second.snapshot;
+            if (snapshot)
+            {
+                row = cache.pos;
+                return;
+            }
+
             log = metadata->second.fileBuilder(metadata->second.filename, metadata->second.format);
             log->seek(cache.pos);
+            lineStart = cache.pos;
         }
 
         HeapItemCache getCache() const
@@ -78,31 +91,49 @@ public:
     };
 
 public:
-    LogEntryIterator(const std::shared_ptr<LogStorage>& logStorage, const std::chrono::system_clock::time_point& _startTime, const std::chrono::system_clock::time_point& _endTime) :
+    LogEntryIterator(const std::shared_ptr<LogStorage>& logStorage,
+                     const std::chrono::system_clock::time_point& _startTime,
+                     const std::chrono::system_clock::time_point& _endTime,
+                     const LogEntryPreFilter& _preFilter = LogEntryPreFilter(),
+                     const LogBlockFilter& _blockFilter = LogBlockFilter(),
+                     const LogModuleFilter& moduleFilter = LogModuleFilter()) :
         logStorage(logStorage),
         startTime(_startTime),
-        endTime(_endTime)
+        endTime(_endTime),
+        preFilter(_preFilter),
+        blockFilter(_blockFilter),
+        enumCounter(createEnumCounter(logStorage, _preFilter, _blockFilter))
     {
         ++endTime;
         for (const auto& module : logStorage->getModules())
         {
+            // Rejected modules are never opened, their files are not touched at all
+            if (moduleFilter && !moduleFilter(module))
+                continue;
+
             const auto& metadata = logStorage->findLog(module, straight ? startTime : endTime);
             if (metadata.second.fileBuilder)
             {
                 HeapItem heapItem;
                 heapItem.metadata = &metadata;
                 heapItem.module = module;
-                heapItem.log = metadata.second.fileBuilder(metadata.second.filename, metadata.second.format);
-                if (!straight)
-                    heapItem.log->goToEnd();
+                openLogFile(heapItem);
+                if (heapItem.snapshot)
+                {
+                    heapItem.row = straight ? heapItem.snapshot->lowerBound(startTime) : heapItem.snapshot->upperBound(endTime);
+                }
+                else
+                {
+                    if (!straight)
+                        heapItem.log->goToEnd();
 
-                heapItem.line = heapItem.log->nextLine().value_or(QString());
+                    heapItem.line = heapItem.log->nextLine().value_or(QString());
+                }
 
                 while (auto entry = getEntry(heapItem))
                 {
                     if (entry->time >= startTime && entry->time <= endTime)
                     {
-                        prepareEntry(entry.value());
                         heapItem.entry = std::move(*entry);
                         mergeHeap.emplace(std::move(heapItem));
                         break;
@@ -115,21 +146,29 @@ public:
     LogEntryIterator(const MergeHeapCache& heapCache,
                      const std::shared_ptr<LogStorage>& logStorage,
                      const std::chrono::system_clock::time_point& _startTime,
-                     const std::chrono::system_clock::time_point& _endTime) :
+                     const std::chrono::system_clock::time_point& _endTime,
+                     const LogEntryPreFilter& _preFilter = LogEntryPreFilter(),
+                     const LogBlockFilter& _blockFilter = LogBlockFilter(),
+                     const LogModuleFilter& moduleFilter = LogModuleFilter()) :
         logStorage(logStorage),
         startTime(_startTime),
-        endTime(_endTime)
+        endTime(_endTime),
+        preFilter(_preFilter),
+        blockFilter(_blockFilter),
+        enumCounter(createEnumCounter(logStorage, _preFilter, _blockFilter))
     {
         auto leftModules = logStorage->getModules();
         for (const auto& heapItem : heapCache.heap)
         {
             leftModules.erase(heapItem.module);
+            if (moduleFilter && !moduleFilter(heapItem.module))
+                continue;
 
             HeapItem item(heapItem, logStorage);
-            if constexpr (straight)
+            if (straight && item.log)
                 item.line = item.log->nextLine().value_or(QString());
 
-            auto entry = getPreparedEntry(item);
+            auto entry = getEntry(item);
             if (entry)
             {
                 item.entry = entry.value();
@@ -141,24 +180,33 @@ public:
         {
             for (const auto& module : leftModules)
             {
+                if (moduleFilter && !moduleFilter(module))
+                    continue;
+
                 const auto& metadata = logStorage->findLog(module, heapCache.time);
                 if (metadata.second.fileBuilder)
                 {
                     HeapItem heapItem;
                     heapItem.metadata = &metadata;
                     heapItem.module = module;
-                    heapItem.log = metadata.second.fileBuilder(metadata.second.filename, metadata.second.format);
-                    if (metadata.first < heapCache.time)
-                        heapItem.log->goToEnd();
+                    openLogFile(heapItem);
+                    if (heapItem.snapshot)
+                    {
+                        heapItem.row = straight ? heapItem.snapshot->lowerBound(heapCache.time) : heapItem.snapshot->upperBound(heapCache.time);
+                    }
+                    else
+                    {
+                        if (metadata.first < heapCache.time)
+                            heapItem.log->goToEnd();
 
-                    if constexpr (straight)
-                        heapItem.line = heapItem.log->nextLine().value_or(QString());
+                        if constexpr (straight)
+                            heapItem.line = heapItem.log->nextLine().value_or(QString());
+                    }
 
                     while (auto entry = getEntry(heapItem))
                     {
                         if (entry->time >= startTime && entry->time <= endTime)
                         {
-                            prepareEntry(entry.value());
                             heapItem.entry = std::move(*entry);
                             mergeHeap.emplace(std::move(heapItem));
                             break;
@@ -207,14 +255,27 @@ public:
         HeapItem top = mergeHeap.top();
         mergeHeap.pop();
 
-        auto nextEntry = getPreparedEntry(top);
+        LogEntry entry = std::move(top.entry);
+        auto nextEntry = getEntry(top);
         if (nextEntry && nextEntry->time >= startTime && nextEntry->time <= endTime)
-            mergeHeap.emplace(std::move(top.metadata), std::move(top.module), std::move(top.log), std::move(*nextEntry), std::move(top.line), top.lineStart, top.entryPos);
+        {
+            top.entry = std::move(*nextEntry);
+            mergeHeap.emplace(std::move(top));
+        }
 
         if constexpr (!straight)
-            endTime = top.entry.time;
+            endTime = entry.time;
 
-        return std::move(top.entry);
+        return entry;
+    }
+
+    void skipUntil(const std::chrono::system_clock::time_point& time)
+    {
+        if constexpr (straight)
+        {
+            while (hasLogs() && mergeHeap.top().entry.time < time)
+                next();
+        }
     }
 
     MergeHeapCache getCache() const
@@ -230,40 +291,126 @@ public:
         return cache;
     }
 
+    // Hands the enum values counted so far to the storage, they are also handed over every few thousand entries
+    void flushEnumValues()
+    {
+        enumCounter.flush();
+    }
+
 private:
-    std::optional<LogEntry> getPreparedEntry(HeapItem& heapItem)
+    // Only iterators reading every entry count values: a skipped entry inside a counted range would never be counted
+    static EnumValueCounter createEnumCounter(const std::shared_ptr<LogStorage>& logStorage, const LogEntryPreFilter& preFilter, const LogBlockFilter& blockFilter)
     {
-        auto res = getEntry(heapItem);
-        if (res)
-            prepareEntry(res.value());
-        return res;
+        if (preFilter || blockFilter)
+            return EnumValueCounter();
+        return EnumValueCounter(logStorage);
     }
 
     std::optional<LogEntry> getEntry(HeapItem& heapItem)
     {
-        LogEntry entry;
-        entry.module = heapItem.module;
-
-        const auto& format = heapItem.metadata->second.format;
-
-        std::optional<QString> line;
-        if constexpr (straight)
+        while (heapItem.log || heapItem.snapshot)
         {
-            if (!heapItem.line.isEmpty())
+            if (heapItem.snapshot)
             {
-                line = heapItem.line;
-                heapItem.line.clear();
+                if (auto entry = readSnapshotEntry(heapItem))
+                    return entry;
+                if (!switchToNextLog(heapItem))
+                    return std::nullopt;
+                continue;
             }
-            else
+
+            if (!skipBlocks(heapItem))
+            {
+                if (!switchToNextLog(heapItem))
+                    return std::nullopt;
+                continue;
+            }
+
+            RawLogEntry rawEntry;
+            rawEntry.module = heapItem.module;
+            if (!readRawEntry(heapItem, rawEntry))
             {
-                line = heapItem.log->nextLine();
+                if (!switchToNextLog(heapItem))
+                    return std::nullopt;
+                continue;
             }
+
+            if (preFilter && !preFilter(rawEntry, heapItem.metadata->second.format))
+                continue;
+
+            auto entry = parseEntry(heapItem, std::move(rawEntry));
+            if (entry)
+                return entry;
+        }
+        return std::nullopt;
+    }
+
+    // Snapshot entries come parsed, so the raw pre-filter does not apply to them. Callers check
+    // the entries they get anyway, the pre-filter only saves parsing.
+    std::optional<LogEntry> readSnapshotEntry(HeapItem& heapItem)
+    {
+        const auto& snapshot = heapItem.snapshot;
+        if (blockFilter)
+        {
+            auto next = blockFilter(heapItem.metadata->second, heapItem.row, straight);
+            if (!next)
+                return std::nullopt;
+            heapItem.row = next.value();
+        }
+
+        if (straight ? heapItem.row >= snapshot->size() : heapItem.row <= 0)
+            return std::nullopt;
+
+        heapItem.entryPos = straight ? heapItem.row++ : --heapItem.row;
+        return snapshot->getEntry(heapItem.entryPos, heapItem.block);
+    }
+
+    bool skipBlocks(HeapItem& heapItem)
+    {
+        if (!blockFilter)
+            return true;
+
+        qint64 pos = 0;
+        if constexpr (straight)
+        {
+            pos = heapItem.line.isEmpty() ? heapItem.log->getFilePosition() : heapItem.lineStart;
         }
         else
         {
-            line = heapItem.log->prevLine();
+            if (!heapItem.line.isEmpty())
+                return true;
+            pos = heapItem.log->getFilePosition();
+        }
+
+        auto next = blockFilter(heapItem.metadata->second, pos, straight);
+        if (!next)
+            return false;
+
+        if (next.value() != pos)
+        {
+            heapItem.log->seek(next.value());
+            heapItem.line.clear();
+            heapItem.lineStart = next.value();
+        }
+        return true;
+    }
+
+    std::optional<QString> readLine(HeapItem& heapItem)
+    {
+        if (!heapItem.line.isEmpty())
+        {
+            std::optional<QString> line = std::move(heapItem.line);
+            heapItem.line.clear();
+            return line;
         }
+        return (heapItem.log.get()->*(straight ? &Log::nextLine : &Log::prevLine))();
+    }
+
+    bool readRawEntry(HeapItem& heapItem, RawLogEntry& rawEntry)
+    {
+        const auto& format = heapItem.metadata->second.format;
 
+        std::optional<QString> line = readLine(heapItem);
         while (line.has_value())
         {
             QStringList parts;
@@ -276,7 +423,7 @@ private:
                 qWarning() << "Failed to split line in" << heapItem.metadata->second.filename
                            << "at" << heapItem.log->getFilePosition() << ":" << line.value() << ':'
                            << ex.what();
-                line = (heapItem.log.get()->*(straight ? &Log::nextLine : &Log::prevLine))();
+                line = readLine(heapItem);
                 continue;
             }
 
@@ -284,115 +431,124 @@ private:
             {
                 if constexpr (straight)
                 {
-                    if (!entry.line.isEmpty())
+                    if (!rawEntry.line.isEmpty())
                     {
-                        entry.line += '\n' + line.value();
-                        if (!entry.additionalLines.isEmpty())
-                            entry.additionalLines += '\n';
-                        entry.additionalLines += line.value();
+                        rawEntry.line += '\n' + line.value();
+                        if (!rawEntry.additionalLines.isEmpty())
+                            rawEntry.additionalLines += '\n';
+                        rawEntry.additionalLines += line.value();
                     }
                     heapItem.lineStart = heapItem.log->getFilePosition();
                 }
                 else
                 {
-                    entry.line.prepend('\n' + line.value());
-                    entry.additionalLines.prepend(line.value());
+                    rawEntry.line.prepend('\n' + line.value());
+                    if (!rawEntry.additionalLines.isEmpty())
+                        rawEntry.additionalLines.prepend('\n');
+                    rawEntry.additionalLines.prepend(line.value());
                 }
 
-                line = (heapItem.log.get()->*(straight ? &Log::nextLine : &Log::prevLine))();
+                line = readLine(heapItem);
                 continue;
             }
 
             if constexpr (straight)
             {
-                if (!entry.line.isEmpty())
+                if (!rawEntry.line.isEmpty())
                 {
-                    heapItem.line = line.value();
-                    return entry;
+                    heapItem.line = std::move(line.value());
+                    break;
                 }
-                entry.line = line.value();
+                rawEntry.line = line.value();
+                rawEntry.parts = std::move(parts);
                 heapItem.entryPos = heapItem.lineStart;
+                heapItem.lineStart = heapItem.log->getFilePosition();
             }
             else
             {
-                entry.line.prepend(line.value());
+                rawEntry.line.prepend(line.value());
+                rawEntry.parts = std::move(parts);
+                heapItem.entryPos = heapItem.log->getFilePosition();
+                break;
             }
 
-            try
-            {
-                entry.time = parseTime(parts[format->timeFieldIndex], format);
-            }
-            catch (const std::exception& ex)
-            {
-                qWarning() << "Failed to parse time in" << heapItem.metadata->second.filename
-                           << "at" << heapItem.log->getFilePosition() << ':' << line.value() << ':'
-                           << ex.what();
-                if constexpr (straight)
-                    heapItem.lineStart = heapItem.log->getFilePosition();
-                line = (heapItem.log.get()->*(straight ? &Log::nextLine : &Log::prevLine))();
-                continue;
-            }
-            for (size_t i = 0, fieldCount = 0; i < format->fields.size(); ++i)
-            {
-                const auto& field = format->fields[i];
+            line = readLine(heapItem);
+        }
 
-                QRegularExpressionMatch match = field.regex.match(parts[fieldCount]);
-                if (match.hasMatch())
-                {
-                    auto fieldValue = getValue(match.captured(0), field, format);
-                    if (field.isEnum)
-                    {
-                        if (!field.values.empty() && !field.values.contains(fieldValue))
-                        {
-                            if (!field.isOptional)
-                                qWarning() << "Enum value for field" << field.name << "is not defined in the format:" << fieldValue;
-                            continue;
-                        }
+        if (rawEntry.parts.isEmpty())
+            return false;
 
-                        if (field.values.empty())
-                            logStorage->addEnumValue(field.name, fieldValue);
-                    }
+        prepareEntry(rawEntry.additionalLines);
+        return true;
+    }
 
-                    entry.values[field.name] = fieldValue;
-                    ++fieldCount;
-                }
-                else
+    std::optional<LogEntry> parseEntry(HeapItem& heapItem, RawLogEntry&& rawEntry)
+    {
+        const auto& format = heapItem.metadata->second.format;
+        const auto& parts = rawEntry.parts;
+
+        LogEntry entry;
+        entry.module = heapItem.module;
+
+        try
+        {
+            entry.time = parseTime(parts[format->timeFieldIndex], format);
+        }
+        catch (const std::exception& ex)
+        {
+            qWarning() << "Failed to parse time in" << heapItem.metadata->second.filename
+                       << "at" << heapItem.entryPos << ':' << rawEntry.line << ':'
+                       << ex.what();
+            return std::nullopt;
+        }
+
+        for (size_t i = 0, fieldCount = 0; i < format->fields.size() && fieldCount < parts.size(); ++i)
+        {
+            const auto& field = format->fields[i];
+
+            QRegularExpressionMatch match = field.regex.match(parts[fieldCount]);
+            if (match.hasMatch())
+            {
+                auto fieldValue = getValue(match.captured(0), field, format);
+                if (field.isEnum && !field.values.empty() && !field.values.contains(fieldValue))
                 {
                     if (!field.isOptional)
-                    {
-                        qCritical() << "Failed to match field" << field.name << "in line:" << line.value();
-                    }
-                    else if (parts[fieldCount].isEmpty())
-                    {
-                        ++fieldCount;
-                    }
+                        qWarning() << "Enum value for field" << field.name << "is not defined in the format:" << fieldValue;
+                    continue;
                 }
-            }
 
-            if constexpr(!straight)
+                if (field.isEnum && field.values.empty())
+                    enumCounter.add(heapItem.metadata->second.filename, heapItem.entryPos, field.name, fieldValue);
+
+                entry.values[field.name] = fieldValue;
+                ++fieldCount;
+            }
+            else
             {
-                heapItem.entryPos = heapItem.log->getFilePosition();
-                return entry;
+                if (!field.isOptional)
+                {
+                    qCritical() << "Failed to match field" << field.name << "in line:" << rawEntry.line;
+                }
+                else if (parts[fieldCount].isEmpty())
+                {
+                    ++fieldCount;
+                }
             }
-
-            if constexpr (straight)
-                heapItem.lineStart = heapItem.log->getFilePosition();
-            line = (heapItem.log.get()->*(straight ? &Log::nextLine : &Log::prevLine))();
         }
 
-        if (!entry.line.isEmpty())
-            return entry;
-
-        switchToNextLog(heapItem);
+        enumCounter.countEntry();
 
-        if (!heapItem.line.isEmpty())
-            return getEntry(heapItem);
-        return std::nullopt;
+        entry.line = std::move(rawEntry.line);
+        entry.additionalLines = std::move(rawEntry.additionalLines);
+        return entry;
     }
 
-    void prepareEntry(LogEntry& entry)
+    void prepareEntry(QString& additionalLines)
     {
-        auto lines = entry.additionalLines.split('\n');
+        if (additionalLines.isEmpty())
+            return;
+
+        auto lines = additionalLines.split('\n');
 
         size_t minSpaces = std::numeric_limits<size_t>::max();
         for (auto& line : lines)
@@ -408,38 +564,53 @@ private:
         {
             for (auto& line : lines)
                 line.remove(0, minSpaces);
-            entry.additionalLines = lines.join('\n');
+            additionalLines = lines.join('\n');
         }
     }
 
-    void switchToNextLog(HeapItem& heapItem)
+    bool switchToNextLog(HeapItem& heapItem)
     {
         while (true)
         {
             const auto& log = (logStorage.get()->*(straight ? &LogStorage::findNextLog : &LogStorage::findPrevLog))(heapItem.module, heapItem.metadata->first);
-            if (!log.second.fileBuilder)
+            if (!log.second.fileBuilder || (straight && log.first > endTime))
             {
                 heapItem.line.clear();
-                return;
+                return false;
             }
 
             heapItem.metadata = &log;
             openLogFile(heapItem);
-            if constexpr (!straight)
+            if (heapItem.snapshot)
+            {
+                heapItem.row = straight ? 0 : heapItem.snapshot->size();
+                heapItem.line.clear();
+                return true;
+            }
+
+            if constexpr (straight)
+                heapItem.lineStart = heapItem.log->getFilePosition();
+            else
                 heapItem.log->goToEnd();
 
             std::optional<QString> line = (heapItem.log.get()->*(straight ? &Log::nextLine : &Log::prevLine))();
             if (line)
             {
                 heapItem.line = line.value();
-                return;
+                return true;
             }
         }
     }
 
     void openLogFile(HeapItem& heapItem)
     {
-        heapItem.log = heapItem.metadata->second.fileBuilder(heapItem.metadata->second.filename, heapItem.metadata->second.format);
+        const auto& metadata = heapItem.metadata->second;
+        heapItem.snapshot = metadata.snapshot;
+        heapItem.block.reset();
+        if (heapItem.snapshot)
+            heapItem.log.reset();
+        else
+            heapItem.log = metadata.fileBuilder(metadata.filename, metadata.format);
     }
 
 private:
@@ -452,4 +623,9 @@ private:
 
     std::chrono::system_clock::time_point startTime;
     std::chrono::system_clock::time_point endTime;
+
+    LogEntryPreFilter preFilter;
+    LogBlockFilter blockFilter;
+
+    EnumValueCounter enumCounter;
 };
@@ -0,0 +1,632 @@
+#include "LogIndex.h"
+#include "LogMetadata.h"
+#include "LogUtils.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+
+
+namespace
+{
+    const quint32 IndexMagic = 0x4C474958;
+    const quint32 IndexVersion = 3;
+}
+
+bool LogIndex::isReady() const
+{
+    return ready;
+}
+
+bool LogIndex::build(const LogMetadata& metadata, const std::atomic<bool>& stop, bool withTrigrams)
+{
+    const auto& format = metadata.format;
+    auto log = metadata.fileBuilder(metadata.filename, format);
+
+    blockStarts.clear();
+    postings.clear();
+    blooms.clear();
+    indexedFields.clear();
+    frequentValues.clear();
+    hasTrigrams = withTrigrams;
+
+    std::vector<std::pair<int, const Format::Field*>> enumFields;
+    for (const auto& field : format->fields)
+    {
+        if (!field.isEnum)
+            continue;
+
+        int partIndex = getFieldPartIndex(format, field.name);
+        if (partIndex < 0)
+            continue;
+
+        enumFields.emplace_back(partIndex, &field);
+        indexedFields.insert(field.name);
+    }
+
+    std::unordered_set<Trigram> trigrams;
+    qint64 blockStart = log->getFilePosition();
+    qint64 lineStart = blockStart;
+    blooms.resize(BloomWords);
+    while (auto line = log->nextLine())
+    {
+        if (stop)
+            return false;
+
+        bool blockFull = lineStart - blockStart >= BlockSize;
+        if (blockFull || !enumFields.empty())
+        {
+            QStringList parts;
+            bool header = false;
+            try
+            {
+                parts = splitLine(line.value(), format);
+                header = parts.size() > format->timeFieldIndex && checkFormat(parts, format);
+            }
+            catch (const std::exception&)
+            {}
+
+            if (header)
+            {
+                if (blockFull)
+                {
+                    addBlock(blockStart, trigrams);
+                    blockStart = lineStart;
+                    blooms.resize(blooms.size() + BloomWords);
+                }
+
+                for (const auto& [partIndex, field] : enumFields)
+                {
+                    if (partIndex >= parts.size())
+                        continue;
+
+                    QString text = getFieldText(parts[partIndex], *field, format);
+                    addToBloom(getValueKey(field->name, text));
+                    if (field->values.empty() && !text.isEmpty())
+                        frequentValues[field->name].add(getValue(text, *field, format));
+                }
+            }
+        }
+
+        QString text = line->toLower();
+        if (withTrigrams)
+            addTrigrams(text, trigrams);
+        addTokens(text);
+
+        lineStart = log->getFilePosition();
+    }
+
+    addBlock(blockStart, trigrams);
+    indexedEnd = lineStart;
+    ready = true;
+    return true;
+}
+
+bool LogIndex::load(const QString& path, const QString& source, bool withTrigrams)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QFileInfo sourceInfo(source);
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    QString storedSource;
+    qint64 sourceSize = 0, sourceModified = 0, blockSize = 0;
+    quint64 bloomBits = 0;
+    stream >> magic >> version >> storedSource >> sourceSize >> sourceModified >> blockSize >> bloomBits;
+    if (magic != IndexMagic || version != IndexVersion || blockSize != BlockSize || bloomBits != BloomBits)
+        return false;
+
+    if (storedSource != source || sourceSize != sourceInfo.size() || sourceModified != sourceInfo.lastModified().toMSecsSinceEpoch())
+        return false;
+
+    stream >> hasTrigrams;
+    if (withTrigrams && !hasTrigrams)
+        return false;
+
+    quint32 blockCount = 0;
+    stream >> blockCount;
+    blockStarts.resize(blockCount);
+    for (auto& start : blockStarts)
+        stream >> start;
+    stream >> indexedEnd;
+
+    quint32 fieldCount = 0;
+    stream >> fieldCount;
+    indexedFields.clear();
+    for (quint32 i = 0; i < fieldCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString field;
+        stream >> field;
+        indexedFields.insert(field);
+    }
+
+    blooms.resize(static_cast<size_t>(blockCount) * BloomWords);
+    for (auto& word : blooms)
+        stream >> word;
+
+    quint32 postingCount = 0;
+    stream >> postingCount;
+    postings.clear();
+    postings.reserve(postingCount);
+    for (quint32 i = 0; i < postingCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        Trigram trigram = 0;
+        quint32 count = 0;
+        stream >> trigram >> count;
+
+        auto& blocks = postings[trigram];
+        blocks.resize(count);
+        for (auto& block : blocks)
+            stream >> block;
+    }
+
+    quint32 valueFieldCount = 0;
+    stream >> valueFieldCount;
+    frequentValues.clear();
+    for (quint32 i = 0; i < valueFieldCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString field;
+        quint32 valueCount = 0;
+        stream >> field >> valueCount;
+
+        std::vector<HeavyHitters::Counter> counters(valueCount);
+        for (auto& counter : counters)
+        {
+            quint64 count = 0, error = 0;
+            stream >> counter.value >> count >> error;
+            counter.count = count;
+            counter.error = error;
+        }
+        frequentValues[field].merge(counters);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        qWarning() << "Search index" << path << "is corrupted";
+        blockStarts.clear();
+        postings.clear();
+        blooms.clear();
+        frequentValues.clear();
+        return false;
+    }
+
+    ready = true;
+    return true;
+}
+
+bool LogIndex::save(const QString& path, const QString& source) const
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Failed to save search index" << path << ":" << file.errorString();
+        return false;
+    }
+
+    QFileInfo sourceInfo(source);
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << IndexMagic << IndexVersion << source << static_cast<qint64>(sourceInfo.size()) << static_cast<qint64>(sourceInfo.lastModified().toMSecsSinceEpoch())
+           << static_cast<qint64>(BlockSize) << static_cast<quint64>(BloomBits);
+
+    stream << hasTrigrams;
+
+    stream << static_cast<quint32>(blockStarts.size());
+    for (const auto& start : blockStarts)
+        stream << start;
+    stream << indexedEnd;
+
+    stream << static_cast<quint32>(indexedFields.size());
+    for (const auto& field : indexedFields)
+        stream << field;
+
+    for (const auto& word : blooms)
+        stream << word;
+
+    stream << static_cast<quint32>(postings.size());
+    for (const auto& [trigram, blocks] : postings)
+    {
+        stream << trigram << static_cast<quint32>(blocks.size());
+        for (const auto& block : blocks)
+            stream << block;
+    }
+
+    stream << static_cast<quint32>(frequentValues.size());
+    for (const auto& [field, values] : frequentValues)
+    {
+        auto top = values.getTop();
+        stream << field << static_cast<quint32>(top.size());
+        for (const auto& counter : top)
+            stream << counter.value << static_cast<quint64>(counter.count) << static_cast<quint64>(counter.error);
+    }
+
+    return file.commit();
+}
+
+size_t LogIndex::getBlockCount() const
+{
+    return blockStarts.size();
+}
+
+qint64 LogIndex::getBlockStart(size_t block) const
+{
+    return blockStarts[block];
+}
+
+bool LogIndex::isFieldIndexed(const QString& field) const
+{
+    return indexedFields.contains(field);
+}
+
+const HeavyHitters* LogIndex::getFrequentValues(const QString& field) const
+{
+    if (!ready)
+        return nullptr;
+
+    auto it = frequentValues.find(field);
+    return it != frequentValues.end() ? &it->second : nullptr;
+}
+
+std::vector<bool> LogIndex::findBlocks(const QStringList& literals) const
+{
+    std::vector<bool> blocks(blockStarts.size(), true);
+    for (const auto& literal : literals)
+    {
+        if (hasTrigrams)
+        {
+            std::unordered_set<Trigram> trigrams;
+            addTrigrams(literal.toLower(), trigrams);
+            for (const auto& trigram : trigrams)
+            {
+                std::vector<bool> found(blockStarts.size(), false);
+                auto it = postings.find(trigram);
+                if (it != postings.end())
+                {
+                    for (auto block : it->second)
+                        found[block] = true;
+                }
+
+                for (size_t i = 0; i < blocks.size(); ++i)
+                    blocks[i] = blocks[i] && found[i];
+            }
+        }
+
+        for (const auto& token : getCompleteTokens(literal))
+        {
+            for (size_t i = 0; i < blocks.size(); ++i)
+                blocks[i] = blocks[i] && checkBloom(i, token);
+        }
+    }
+    return blocks;
+}
+
+std::vector<bool> LogIndex::findBlocks(const QString& field, const std::unordered_set<QString>& values) const
+{
+    if (!indexedFields.contains(field))
+        return std::vector<bool>(blockStarts.size(), true);
+
+    std::vector<bool> blocks(blockStarts.size(), false);
+    for (const auto& value : values)
+    {
+        QString key = getValueKey(field, value);
+        for (size_t i = 0; i < blocks.size(); ++i)
+            blocks[i] = blocks[i] || checkBloom(i, key);
+    }
+    return blocks;
+}
+
+std::optional<qint64> LogIndex::findNextBlock(const std::vector<bool>& blocks, qint64 pos, bool forward) const
+{
+    if (blocks.size() != blockStarts.size())
+        return pos;
+
+    return findNextBlock([&blocks](size_t block) { return blocks[block]; }, pos, forward);
+}
+
+std::optional<qint64> LogIndex::findNextBlock(const std::function<bool(size_t)>& isCandidate, qint64 pos, bool forward) const
+{
+    if (blockStarts.empty())
+        return pos;
+
+    if (forward)
+    {
+        if (pos >= indexedEnd)
+            return pos;
+
+        size_t block = std::upper_bound(blockStarts.begin(), blockStarts.end(), pos) - blockStarts.begin();
+        if (block > 0)
+            --block;
+
+        if (isCandidate(block))
+            return pos;
+
+        for (size_t i = block + 1; i < blockStarts.size(); ++i)
+        {
+            if (isCandidate(i))
+                return blockStarts[i];
+        }
+        return indexedEnd;
+    }
+    else
+    {
+        if (pos > indexedEnd || pos <= blockStarts.front())
+            return pos;
+
+        size_t block = std::upper_bound(blockStarts.begin(), blockStarts.end(), pos - 1) - blockStarts.begin() - 1;
+        if (isCandidate(block))
+            return pos;
+
+        for (size_t i = block; i > 0; --i)
+        {
+            if (isCandidate(i - 1))
+                return blockStarts[i];
+        }
+        return std::nullopt;
+    }
+}
+
+LogIndex::PredicateStates LogIndex::getPredicateStates(const QString& source, const BlockPredicates& predicates) const
+{
+    QFileInfo info(source);
+    qint64 size = info.exists() ? info.size() : -1;
+    qint64 time = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+
+    std::lock_guard lock(predicateMutex);
+    if (size != predicateSourceSize || time != predicateSourceTime)
+    {
+        predicateBlocks.clear();
+        predicateSourceSize = size;
+        predicateSourceTime = time;
+    }
+
+    PredicateStates states;
+    for (const auto& predicate : predicates)
+    {
+        auto& blockStates = predicateBlocks[predicate.first];
+        if (!blockStates)
+        {
+            blockStates = std::make_shared<BlockStates>(blockStarts.size());
+            for (auto& state : *blockStates)
+                state.store(-1, std::memory_order_relaxed);
+        }
+        states.push_back(blockStates);
+    }
+    return states;
+}
+
+bool LogIndex::checkBlock(const LogMetadata& metadata, size_t block, const BlockPredicates& predicates, const PredicateStates& states) const
+{
+    std::vector<size_t> unknown;
+    for (size_t i = 0; i < predicates.size(); ++i)
+    {
+        qint8 state = (*states[i])[block].load(std::memory_order_relaxed);
+        if (state == 0)
+            return false;
+        if (state < 0)
+            unknown.push_back(i);
+    }
+
+    if (unknown.empty())
+        return true;
+
+    // Threads racing on the same block compute the same result, so the store needs no lock
+    auto found = scanBlock(metadata, block, predicates, unknown);
+    bool result = true;
+    for (size_t i = 0; i < unknown.size(); ++i)
+    {
+        (*states[unknown[i]])[block].store(found[i] ? 1 : 0, std::memory_order_relaxed);
+        result = result && found[i];
+    }
+    return result;
+}
+
+// Opens the file once and evaluates the selected predicates together, until each has matched or the block ends
+std::vector<bool> LogIndex::scanBlock(const LogMetadata& metadata, size_t block, const BlockPredicates& predicates, const std::vector<size_t>& selected) const
+{
+    const auto& format = metadata.format;
+    auto log = metadata.fileBuilder(metadata.filename, format);
+    log->seek(blockStarts[block]);
+
+    std::vector<bool> found(selected.size(), false);
+    size_t left = selected.size();
+
+    qint64 end = block + 1 < blockStarts.size() ? blockStarts[block + 1] : indexedEnd;
+    while (left > 0 && log->getFilePosition() < end)
+    {
+        auto line = log->nextLine();
+        if (!line)
+            break;
+
+        try
+        {
+            auto parts = splitLine(line.value(), format);
+            if (parts.size() <= format->timeFieldIndex || !checkFormat(parts, format))
+                continue;
+
+            for (size_t i = 0; i < selected.size(); ++i)
+            {
+                if (!found[i] && predicates[selected[i]].second(parts, format))
+                {
+                    found[i] = true;
+                    --left;
+                }
+            }
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+    return found;
+}
+
+QStringList LogIndex::getCompleteTokens(const QString& literal)
+{
+    QStringList tokens;
+    qsizetype start = -1;
+    for (qsizetype i = 0; i <= literal.size(); ++i)
+    {
+        bool tokenChar = i < literal.size() && isTokenChar(literal[i]);
+        if (tokenChar && start < 0)
+        {
+            start = i;
+        }
+        else if (!tokenChar && start >= 0)
+        {
+            if (start > 0 && i < literal.size())
+                tokens << literal.mid(start, i - start).toLower();
+            start = -1;
+        }
+    }
+    return tokens;
+}
+
+LogBlockFilter LogIndex::createBlockFilter(const std::function<std::vector<bool>(const LogIndex&)>& selector, const BlockPredicates& predicates)
+{
+    struct IndexCandidates
+    {
+        std::vector<bool> blocks;
+        PredicateStates states;
+    };
+
+    // The filter is copied into iterators that may run on different threads
+    struct Candidates
+    {
+        std::mutex mutex;
+        std::unordered_map<const LogIndex*, std::shared_ptr<const IndexCandidates>> indexes;
+    };
+
+    auto candidates = std::make_shared<Candidates>();
+    return [selector, predicates, candidates](const LogMetadata& metadata, qint64 pos, bool forward) -> std::optional<qint64> {
+        if (!metadata.index || !metadata.index->isReady())
+            return pos;
+
+        std::shared_ptr<const IndexCandidates> selected;
+        {
+            std::lock_guard lock(candidates->mutex);
+            auto it = candidates->indexes.find(metadata.index.get());
+            if (it == candidates->indexes.end())
+            {
+                auto indexCandidates = std::make_shared<IndexCandidates>();
+                indexCandidates->blocks = selector ? selector(*metadata.index) : std::vector<bool>(metadata.index->getBlockCount(), true);
+                if (!predicates.empty())
+                    indexCandidates->states = metadata.index->getPredicateStates(metadata.filename, predicates);
+                it = candidates->indexes.emplace(metadata.index.get(), std::move(indexCandidates)).first;
+            }
+            selected = it->second;
+        }
+
+        if (predicates.empty())
+            return metadata.index->findNextBlock(selected->blocks, pos, forward);
+
+        const auto& blocks = selected->blocks;
+        return metadata.index->findNextBlock([&](size_t block) {
+            return block < blocks.size() && blocks[block] && metadata.index->checkBlock(metadata, block, predicates, selected->states);
+        }, pos, forward);
+    };
+}
+
+void LogIndex::addTrigrams(const QString& text, std::unordered_set<Trigram>& trigrams)
+{
+    for (qsizetype i = 2; i < text.size(); ++i)
+    {
+        trigrams.insert((static_cast<Trigram>(text[i - 2].unicode()) << 32)
+                        | (static_cast<Trigram>(text[i - 1].unicode()) << 16)
+                        | static_cast<Trigram>(text[i].unicode()));
+    }
+}
+
+void LogIndex::addBlock(qint64 start, std::unordered_set<Trigram>& trigrams)
+{
+    quint32 block = static_cast<quint32>(blockStarts.size());
+    blockStarts.push_back(start);
+
+    for (const auto& trigram : trigrams)
+        postings[trigram].push_back(block);
+    trigrams.clear();
+}
+
+void LogIndex::addTokens(const QString& text)
+{
+    qsizetype start = -1;
+    for (qsizetype i = 0; i <= text.size(); ++i)
+    {
+        bool tokenChar = i < text.size() && isTokenChar(text[i]);
+        if (tokenChar && start < 0)
+        {
+            start = i;
+        }
+        else if (!tokenChar && start >= 0)
+        {
+            addToBloom(text.mid(start, i - start));
+            start = -1;
+        }
+    }
+}
+
+void LogIndex::addToBloom(const QString& item)
+{
+    quint64* bloom = blooms.data() + blooms.size() - BloomWords;
+    quint64 hash = getBloomHash(item);
+    for (int i = 0; i < BloomHashes; ++i)
+    {
+        size_t bit = getBloomBit(hash, i);
+        bloom[bit / 64] |= quint64(1) << (bit % 64);
+    }
+}
+
+bool LogIndex::checkBloom(size_t block, const QString& item) const
+{
+    if (blooms.size() < (block + 1) * BloomWords)
+        return true;
+
+    const quint64* bloom = blooms.data() + block * BloomWords;
+    quint64 hash = getBloomHash(item);
+    for (int i = 0; i < BloomHashes; ++i)
+    {
+        size_t bit = getBloomBit(hash, i);
+        if (!(bloom[bit / 64] & (quint64(1) << (bit % 64))))
+            return false;
+    }
+    return true;
+}
+
+QString LogIndex::getValueKey(const QString& field, const QString& value)
+{
+    return field + QChar(0x1F) + value;
+}
+
+bool LogIndex::isTokenChar(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == '_';
+}
+
+quint64 LogIndex::getBloomHash(const QString& item)
+{
+    quint64 hash = 14695981039346656037ULL;
+    for (QChar ch : item)
+    {
+        hash ^= ch.unicode();
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+size_t LogIndex::getBloomBit(quint64 hash, int index)
+{
+    quint32 h1 = static_cast<quint32>(hash);
+    quint32 h2 = static_cast<quint32>(hash >> 32) | 1;
+    return (h1 + static_cast<quint64>(index) * h2) % BloomBits;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "HeavyHitters.h"
+
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+struct Format;
+struct LogMetadata;
+
+typedef std::function<std::optional<qint64>(const LogMetadata&, qint64, bool)> LogBlockFilter;
+
+class LogIndex
+{
+public:
+    static constexpr qint64 BlockSize = 64 * 1024;
+    static constexpr size_t BloomBits = 32 * 1024;
+
+    typedef std::function<bool(const QStringList&, const std::shared_ptr<Format>&)> EntryPredicate;
+    typedef std::vector<std::pair<QString, EntryPredicate>> BlockPredicates;
+
+    bool isReady() const;
+
+    bool build(const LogMetadata& metadata, const std::atomic<bool>& stop, bool withTrigrams = true);
+    bool load(const QString& path, const QString& source, bool withTrigrams = true);
+    bool save(const QString& path, const QString& source) const;
+
+    size_t getBlockCount() const;
+    qint64 getBlockStart(size_t block) const;
+    bool isFieldIndexed(const QString& field) const;
+    // Values of the open enum fields counted while the index was built, null until it is ready
+    const HeavyHitters* getFrequentValues(const QString& field) const;
+
+    std::vector<bool> findBlocks(const QStringList& literals) const;
+    std::vector<bool> findBlocks(const QString& field, const std::unordered_set<QString>& values) const;
+    std::optional<qint64> findNextBlock(const std::vector<bool>& blocks, qint64 pos, bool forward) const;
+    std::optional<qint64> findNextBlock(const std::function<bool(size_t)>& isCandidate, qint64 pos, bool forward) const;
+
+    // -1 while unknown, 0 when no entry of the block passes the predicate, 1 when one does
+    typedef std::vector<std::atomic<qint8>> BlockStates;
+    typedef std::vector<std::shared_ptr<BlockStates>> PredicateStates;
+
+    // Block results of the predicates, shared by every filter using them while the source is unchanged.
+    // Taken once per filter, checkBlock then reads and fills them without locking.
+    PredicateStates getPredicateStates(const QString& source, const BlockPredicates& predicates) const;
+    bool checkBlock(const LogMetadata& metadata, size_t block, const BlockPredicates& predicates, const PredicateStates& states) const;
+
+    static QStringList getCompleteTokens(const QString& literal);
+    static LogBlockFilter createBlockFilter(const std::function<std::vector<bool>(const LogIndex&)>& selector, const BlockPredicates& predicates = BlockPredicates());
+
+private:
+    typedef quint64 Trigram;
+
+    static void addTrigrams(const QString& text, std::unordered_set<Trigram>& trigrams);
+    void addBlock(qint64 start, std::unordered_set<Trigram>& trigrams);
+
+    void addTokens(const QString& text);
+    void addToBloom(const QString& item);
+    bool checkBloom(size_t block, const QString& item) const;
+
+    static bool isTokenChar(QChar ch);
+    static quint64 getBloomHash(const QString& item);
+    static size_t getBloomBit(quint64 hash, int index);
+
+    static QString getValueKey(const QString& field, const QString& value);
+
+    std::vector<bool> scanBlock(const LogMetadata& metadata, size_t block, const BlockPredicates& predicates, const std::vector<size_t>& selected) const;
+
+private:
+    static constexpr size_t BloomWords = BloomBits / 64;
+    static constexpr int BloomHashes = 4;
+
+    std::atomic<bool> ready = false;
+
+    std::vector<qint64> blockStarts;
+    qint64 indexedEnd = 0;
+
+    bool hasTrigrams = false;
+    std::unordered_map<Trigram, std::vector<quint32>> postings;
+
+    std::unordered_set<QString> indexedFields;
+    std::vector<quint64> blooms;
+    std::unordered_map<QString, HeavyHitters> frequentValues;
+
+    mutable std::mutex predicateMutex;
+    mutable qint64 predicateSourceSize = -1;
+    mutable qint64 predicateSourceTime = -1;
+    mutable std::unordered_map<QString, std::shared_ptr<BlockStates>> predicateBlocks;
+};
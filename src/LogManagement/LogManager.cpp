@@ -1,12 +1,17 @@
 #include "LogManager.h"
 
 #include "LogUtils.h"
+#include "Gzip.h"
+#include "SnapshotLog.h"
 
 #include <quazip/quazipfile.h>
 
 #include <QFile>
+#include <QFileInfo>
+#include <QDir>
 #include <QDebug>
 #include <QBuffer>
+#include <QCryptographicHash>
 
 #include <filesystem>
 
@@ -29,6 +34,10 @@ LogManager::LogManager(const std::vector<QString>& folders, const std::vector<st
             {
                 foundFiles |= scanArchive(scanner, filename, formats);
             }
+            else if (extension == Snapshot::Extension)
+            {
+                foundFiles |= scanSnapshot(scanner, filename);
+            }
             else
             {
                 auto stem = QString::fromStdString(entry.path().stem().string());
@@ -45,6 +54,7 @@ LogManager::LogManager(const std::vector<QString>& folders, const std::vector<st
         throw std::runtime_error("no suitable files found in the specified folders");
 
     logStorage = std::make_shared<LogStorage>(scanner.scan());
+    addSnapshotValues();
 }
 
 LogManager::LogManager(const QString& filename, const std::vector<std::shared_ptr<Format>>& formats)
@@ -57,6 +67,11 @@ LogManager::LogManager(const QString& filename, const std::vector<std::shared_pt
         if (!foundFiles)
             throw std::runtime_error("no suitable files found in the specified archive: " + filename.toStdString());
     }
+    else if (extension == Snapshot::Extension)
+    {
+        if (!scanSnapshot(scanner, filename))
+            throw std::runtime_error("no entries found in the snapshot: " + filename.toStdString());
+    }
     else
     {
         std::filesystem::path path = filename.toStdString();
@@ -66,6 +81,7 @@ LogManager::LogManager(const QString& filename, const std::vector<std::shared_pt
     }
 
     logStorage = std::make_shared<LogStorage>(scanner.scan());
+    addSnapshotValues();
 }
 
 LogManager::LogManager(const QByteArray& data, const QString& filename, const std::vector<std::shared_ptr<Format>>& formats)
@@ -88,6 +104,54 @@ LogManager::LogManager(const QByteArray& data, const QString& filename, const st
     logStorage = std::make_shared<LogStorage>(scanner.scan());
 }
 
+LogManager::~LogManager()
+{
+    stopIndexing = true;
+    if (indexThread.joinable())
+        indexThread.join();
+
+    if (!checkpointFile.isEmpty())
+        checkpoints->save(checkpointFile, logStorage->getFiles());
+}
+
+void LogManager::buildIndexes(const QString& cacheDirectory, bool withTrigrams)
+{
+    if (indexThread.joinable())
+        return;
+
+    indexThread = std::thread([files = logStorage->getFiles(), cacheDirectory, withTrigrams, this]() {
+        for (const auto& metadata : files)
+        {
+            if (stopIndexing)
+                return;
+
+            buildIndex(metadata, cacheDirectory, withTrigrams, stopIndexing);
+        }
+        qDebug() << "Search indexes are ready";
+    });
+}
+
+void LogManager::loadCheckpoints(const QString& cacheDirectory)
+{
+    auto files = logStorage->getFiles();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QStringList filenames;
+    for (const auto& metadata : files)
+    {
+        QFileInfo sourceInfo(metadata.filename);
+        if (!sourceInfo.isAbsolute() || !sourceInfo.isFile())
+            return;
+        filenames.push_back(metadata.filename);
+    }
+    filenames.sort();
+    for (const auto& filename : filenames)
+        hash.addData(filename.toUtf8());
+
+    checkpointFile = QDir(cacheDirectory).filePath(QString::fromLatin1(hash.result().toHex()) + ".ckp");
+    checkpoints->load(checkpointFile, files);
+}
+
 const std::unordered_set<std::shared_ptr<Format>>& LogManager::getFormats() const
 {
     return logStorage->getFormats();
@@ -98,9 +162,9 @@ const std::unordered_set<QString>& LogManager::getModules() const
     return logStorage->getModules();
 }
 
-std::unordered_set<QVariant, VariantHash> LogManager::getEnumList(const QString& field) const
+std::vector<HeavyHitters::Counter> LogManager::getFrequentValues(const QString& field) const
 {
-    return logStorage->getEnumList(field);
+    return logStorage->getFrequentValues(field);
 }
 
 std::chrono::system_clock::time_point LogManager::getMinTime() const
@@ -115,7 +179,7 @@ std::chrono::system_clock::time_point LogManager::getMaxTime() const
 
 Session LogManager::createSession(const std::unordered_set<QString>& modules, const std::chrono::system_clock::time_point& minTime, const std::chrono::system_clock::time_point& maxTime) const
 {
-    return Session(std::make_shared<LogStorage>(logStorage->getNarrowedStorage(modules, minTime, maxTime)));
+    return Session(std::make_shared<LogStorage>(logStorage->getNarrowedStorage(modules, minTime, maxTime)), checkpoints);
 }
 
 bool LogManager::scanPlainFile(DirectoryScanner& scanner, const QString& filename, const QString& stem, const QString& extension, const std::vector<std::shared_ptr<Format>>& formats)
@@ -128,6 +192,9 @@ bool LogManager::scanPlainFile(DirectoryScanner& scanner, const QString& filenam
 
 bool LogManager::scanArchive(DirectoryScanner& scanner, const QString& filename, const std::vector<std::shared_ptr<Format> >& formats)
 {
+    if (filename.endsWith(".gz", Qt::CaseInsensitive))
+        return scanGzipFile(scanner, filename, formats);
+
     QuaZip zip(filename);
     if (!zip.open(QuaZip::mdUnzip))
     {
@@ -175,6 +242,83 @@ bool LogManager::scanArchive(DirectoryScanner& scanner, const QString& filename,
     return foundFiles;
 }
 
+bool LogManager::scanGzipFile(DirectoryScanner& scanner, const QString& filename, const std::vector<std::shared_ptr<Format>>& formats)
+{
+    // A gzip file holds a single log, named like the file without the .gz suffix
+    std::filesystem::path innerPath = filename.chopped(3).toStdString();
+    auto stem = QString::fromStdString(innerPath.stem().string());
+    auto extension = QString::fromStdString(innerPath.extension().string());
+
+    auto fileCreationFunc = [](const QString& filename) {
+        QFile file(filename);
+        if (!file.open(QIODevice::ReadOnly))
+            throw std::runtime_error("cannot open log file: " + file.errorString().toStdString());
+
+        auto buffer = std::make_unique<QBuffer>();
+        buffer->setData(decompressGzip(file.readAll()));
+        return buffer;
+    };
+
+    try
+    {
+        return addFile(scanner, filename, stem, extension, fileCreationFunc, formats);
+    }
+    catch (const std::exception& ex)
+    {
+        qDebug() << "Failed to process gzip file" << filename << "because of error:" << ex.what();
+        return false;
+    }
+}
+
+bool LogManager::scanSnapshot(DirectoryScanner& scanner, const QString& filename)
+{
+    std::shared_ptr<const SnapshotFile> snapshot;
+    try
+    {
+        snapshot = std::make_shared<SnapshotFile>(filename);
+    }
+    catch (const std::exception& ex)
+    {
+        qDebug() << "Failed to open snapshot" << filename << "because of error:" << ex.what();
+        return false;
+    }
+
+    bool foundModules = false;
+    for (const auto& module : snapshot->getModules())
+    {
+        auto log = std::make_shared<SnapshotLog>(snapshot, module);
+        if (log->size() == 0)
+            continue;
+
+        // No search index: the zone maps of the snapshot blocks take its place
+        LogMetadata metadata;
+        metadata.format = log->getFormat();
+        metadata.filename = filename;
+        metadata.snapshot = log;
+        // Every reader goes through metadata.snapshot, the builder only marks the module as present
+        metadata.fileBuilder = [](const QString& filename, const std::shared_ptr<Format>&) -> std::shared_ptr<Log> {
+            throw std::logic_error("snapshot " + filename.toStdString() + " has no line reader");
+        };
+        scanner.addFile(module, std::move(metadata), log->getMinTime(), log->getMaxTime());
+        foundModules = true;
+    }
+
+    snapshots.push_back(snapshot);
+    return foundModules;
+}
+
+void LogManager::addSnapshotValues()
+{
+    for (const auto& snapshot : snapshots)
+    {
+        for (const auto& [field, counters] : snapshot->getFrequentValues())
+        {
+            for (const auto& counter : counters)
+                logStorage->addEnumValue(field, counter.value, counter.count);
+        }
+    }
+}
+
 bool LogManager::addFile(DirectoryScanner& scanner, const QString& filename, const QString& stem, const QString& extension, std::function<std::unique_ptr<QIODevice>(const QString&)> createFileFunc, const std::vector<std::shared_ptr<Format>>& formats)
 {
     QString module = stem;
@@ -222,6 +366,7 @@ bool LogManager::addFile(DirectoryScanner& scanner, const QString& filename, con
         return std::make_shared<Log>(LogManager::createLog(filename, createFileFunc, format));
     };
     metadata.filename = filename;
+    metadata.index = std::make_shared<LogIndex>();
     scanner.addFile(module, std::move(metadata), result->start, result->end);
 
     return true;
@@ -307,3 +452,33 @@ void LogManager::readIntoBuffer(QIODevice& source, QBuffer& targetBuffer)
     targetBuffer.close();
     targetBuffer.setData(data);
 }
+
+void LogManager::buildIndex(const LogMetadata& metadata, const QString& cacheDirectory, bool withTrigrams, const std::atomic<bool>& stop)
+{
+    if (!metadata.index || metadata.index->isReady())
+        return;
+
+    QString indexFile;
+    QFileInfo sourceInfo(metadata.filename);
+    if (!cacheDirectory.isEmpty() && sourceInfo.isAbsolute() && sourceInfo.isFile())
+    {
+        auto key = QCryptographicHash::hash(metadata.filename.toUtf8(), QCryptographicHash::Sha1).toHex();
+        indexFile = QDir(cacheDirectory).filePath(QString::fromLatin1(key) + ".idx");
+        if (metadata.index->load(indexFile, metadata.filename, withTrigrams))
+            return;
+    }
+
+    try
+    {
+        if (!metadata.index->build(metadata, stop, withTrigrams))
+            return;
+    }
+    catch (const std::exception& ex)
+    {
+        qWarning() << "Failed to build search index for" << metadata.filename << ":" << ex.what();
+        return;
+    }
+
+    if (!indexFile.isEmpty())
+        metadata.index->save(indexFile, metadata.filename);
+}
@@ -4,7 +4,9 @@
 #include "Log.h"
 #include "LogStorage.h"
 #include "Session.h"
+#include "CheckpointStore.h"
 #include "DirectoryScanner.h"
+#include "SnapshotLog.h"
 
 #include <QDateTime>
 #include <QBuffer>
@@ -12,6 +14,8 @@
 
 #include <unordered_set>
 #include <memory>
+#include <atomic>
+#include <thread>
 
 
 class LogManager
@@ -20,11 +24,15 @@ public:
     LogManager(const std::vector<QString>& folders, const std::vector<std::shared_ptr<Format>>& formats);
     LogManager(const QString& filename, const std::vector<std::shared_ptr<Format>>& formats);
     LogManager(const QByteArray& data, const QString& filename, const std::vector<std::shared_ptr<Format>>& formats);
+    ~LogManager();
+
+    void buildIndexes(const QString& cacheDirectory, bool withTrigrams);
+    void loadCheckpoints(const QString& cacheDirectory);
 
     const std::unordered_set<std::shared_ptr<Format>>& getFormats() const;
     const std::unordered_set<QString>& getModules() const;
 
-    std::unordered_set<QVariant, VariantHash> getEnumList(const QString& field) const;
+    std::vector<HeavyHitters::Counter> getFrequentValues(const QString& field) const;
 
     std::chrono::system_clock::time_point getMinTime() const;
     std::chrono::system_clock::time_point getMaxTime() const;
@@ -42,6 +50,9 @@ private:
 private:
     bool scanPlainFile(DirectoryScanner& scanner, const QString& filename, const QString& stem, const QString& extension, const std::vector<std::shared_ptr<Format>>& formats);
     bool scanArchive(DirectoryScanner& scanner, const QString& filename, const std::vector<std::shared_ptr<Format>>& formats);
+    bool scanGzipFile(DirectoryScanner& scanner, const QString& filename, const std::vector<std::shared_ptr<Format>>& formats);
+    bool scanSnapshot(DirectoryScanner& scanner, const QString& filename);
+    void addSnapshotValues();
 
     bool addFile(DirectoryScanner& scanner, const QString& filename, const QString& stem, const QString& extension, std::function<std::unique_ptr<QIODevice>(const QString&)> createFileFunc, const std::vector<std::shared_ptr<Format>>& formats);
     std::optional<FileDesc> scanLogFile(const QString& filename, std::function<std::unique_ptr<QIODevice>(const QString&)> createFileFunc, const std::vector<std::shared_ptr<Format>>& formats);
@@ -51,6 +62,14 @@ private:
 
     static void readIntoBuffer(QIODevice& source, QBuffer& targetBuffer);
 
+    static void buildIndex(const LogMetadata& metadata, const QString& cacheDirectory, bool withTrigrams, const std::atomic<bool>& stop);
+
 private:
     std::shared_ptr<LogStorage> logStorage;
+    std::vector<std::shared_ptr<const SnapshotFile>> snapshots;
+    std::shared_ptr<CheckpointStore> checkpoints = std::make_shared<CheckpointStore>();
+    QString checkpointFile;
+
+    std::thread indexThread;
+    std::atomic<bool> stopIndexing = false;
 };
@@ -2,8 +2,11 @@
 
 #include "Format.h"
 #include "Log.h"
+#include "LogIndex.h"
 
 
+class SnapshotLog;
+
 struct LogMetadata
 {
     std::shared_ptr<Format> format;
@@ -11,4 +14,8 @@ struct LogMetadata
 
     typedef std::function<std::shared_ptr<Log>(const QString&, const std::shared_ptr<Format>&)> FileBuilder;
     FileBuilder fileBuilder;
+
+    std::shared_ptr<LogIndex> index;
+    // Set for snapshot modules, their entries are read from columns instead of lines
+    std::shared_ptr<SnapshotLog> snapshot;
 };
@@ -6,6 +6,10 @@
 #include <QDebug>
 #include <QDateTime>
 
+#include <algorithm>
+#include <iterator>
+#include <optional>
+
 
 LogStorage::LogStorage(std::vector<DirectoryScanner::LogFile>&& files) : maxTime(std::chrono::system_clock::time_point::min())
 {
@@ -51,10 +55,27 @@ LogStorage LogStorage::getNarrowedStorage(const std::unordered_set<QString>& mod
         res.usedFormats.insert(format);
     }
 
-    for (const auto& format : res.usedFormats)
     {
-        for (const auto& field : format->fields)
-            res.enumLists[format->name] = getEnumList(field.name);
+        std::lock_guard lock(*enumMutex);
+        for (const auto& format : res.usedFormats)
+        {
+            for (const auto& field : format->fields)
+            {
+                auto it = enumValues.find(field.name);
+                if (it != enumValues.end())
+                    res.enumValues.insert_or_assign(field.name, it->second);
+            }
+        }
+
+        for (const auto& [module, logs] : res.docs)
+        {
+            for (const auto& [time, metadata] : logs)
+            {
+                auto it = parsedValues.find(metadata.filename);
+                if (it != parsedValues.end())
+                    res.parsedValues.insert_or_assign(metadata.filename, it->second);
+            }
+        }
     }
 
     return res;
@@ -70,6 +91,45 @@ const std::unordered_set<QString>& LogStorage::getModules() const
     return modules;
 }
 
+std::shared_ptr<Format> LogStorage::getFormat(const QString& module) const
+{
+    auto it = docs.find(module);
+    if (it == docs.end() || it->second.empty())
+        return nullptr;
+    return it->second.rbegin()->second.format;
+}
+
+std::vector<LogMetadata> LogStorage::getFiles() const
+{
+    std::vector<LogMetadata> res;
+    for (const auto& [module, logs] : docs)
+    {
+        for (const auto& [time, metadata] : logs)
+        {
+            if (metadata.fileBuilder)
+                res.push_back(metadata);
+        }
+    }
+    return res;
+}
+
+std::vector<LogStorage::FileSpan> LogStorage::getFileSpans() const
+{
+    std::vector<FileSpan> res;
+    for (const auto& [module, logs] : docs)
+    {
+        // Latest first, the module end marker comes before every file
+        std::optional<std::chrono::system_clock::time_point> next;
+        for (const auto& [time, metadata] : logs)
+        {
+            if (metadata.fileBuilder && next)
+                res.push_back({ module, metadata, time, next.value() });
+            next = time;
+        }
+    }
+    return res;
+}
+
 const LogStorage::LogMetaEntry& LogStorage::findLog(const QString& module, const std::chrono::system_clock::time_point& time) const
 {
     auto it = docs.find(module);
@@ -140,19 +200,79 @@ const LogStorage::LogMetaEntry& LogStorage::findNextLog(const QString& module, c
     return emptyPair;
 }
 
-void LogStorage::addEnumValue(const QString& field, const QVariant& value)
+void LogStorage::addEnumValue(const QString& field, const QVariant& value, std::uint64_t count)
+{
+    std::lock_guard lock(*enumMutex);
+    enumValues[field].add(value, count);
+}
+
+void LogStorage::addParsedValues(const std::unordered_map<QString, ParsedValues>& files)
 {
-    enumLists[field].emplace(value);
+    std::lock_guard lock(*enumMutex);
+    for (const auto& [filename, values] : files)
+    {
+        if (values.begin > values.end)
+            continue;
+
+        // Every scroll reads the same entries again, a range counted before is not added twice
+        auto& stored = parsedValues[filename];
+        auto it = stored.counted.upper_bound(values.begin);
+        if (it != stored.counted.begin() && std::prev(it)->second >= values.end)
+            continue;
+
+        for (const auto& [field, counts] : values.fields)
+            stored.fields[field].merge(counts.getTop());
+
+        qint64 begin = values.begin;
+        qint64 end = values.end;
+        if (it != stored.counted.begin() && std::prev(it)->second >= begin)
+        {
+            --it;
+            begin = it->first;
+        }
+        while (it != stored.counted.end() && it->first <= end)
+        {
+            end = std::max(end, it->second);
+            it = stored.counted.erase(it);
+        }
+        stored.counted.emplace(begin, end);
+    }
 }
 
-std::unordered_set<QVariant, VariantHash> LogStorage::getEnumList(const QString& field) const
+std::vector<HeavyHitters::Counter> LogStorage::getFrequentValues(const QString& field) const
 {
-    auto it = enumLists.find(field);
-    if (it != enumLists.end())
+    HeavyHitters merged;
+    std::lock_guard lock(*enumMutex);
+    auto it = enumValues.find(field);
+    if (it != enumValues.end())
+        merged.merge(it->second.getTop());
+
+    for (const auto& [module, logs] : docs)
     {
-        return it->second;
+        for (const auto& [time, metadata] : logs)
+        {
+            // A built index has counted the whole file once, until then the entries parsed so far stand in for it.
+            // Fields the index skips, like the ones after an optional field, are only ever counted by parsing.
+            if (metadata.index)
+            {
+                if (auto values = metadata.index->getFrequentValues(field))
+                {
+                    merged.merge(values->getTop());
+                    continue;
+                }
+            }
+
+            auto parsed = parsedValues.find(metadata.filename);
+            if (parsed == parsedValues.end())
+                continue;
+
+            auto values = parsed->second.fields.find(field);
+            if (values != parsed->second.fields.end())
+                merged.merge(values->second.getTop());
+        }
     }
-    return {};
+
+    return merged.getTop();
 }
 
 std::chrono::system_clock::time_point LogStorage::getMinTime() const
@@ -199,3 +319,73 @@ void LogStorage::finalize(const std::unordered_map<QString, std::chrono::system_
         module.second.emplace(endTime, LogMetadata{});
     }
 }
+
+EnumValueCounter::EnumValueCounter(const std::shared_ptr<LogStorage>& logStorage) : logStorage(logStorage)
+{
+}
+
+EnumValueCounter::EnumValueCounter(const EnumValueCounter& other) : logStorage(other.logStorage)
+{
+}
+
+EnumValueCounter::EnumValueCounter(EnumValueCounter&& other) noexcept :
+    logStorage(std::move(other.logStorage)),
+    files(std::move(other.files)),
+    entries(other.entries)
+{
+    other.files.clear();
+    other.entries = 0;
+}
+
+EnumValueCounter& EnumValueCounter::operator=(const EnumValueCounter& other)
+{
+    if (this != &other)
+    {
+        flush();
+        logStorage = other.logStorage;
+    }
+    return *this;
+}
+
+EnumValueCounter& EnumValueCounter::operator=(EnumValueCounter&& other) noexcept
+{
+    if (this != &other)
+    {
+        flush();
+        logStorage = std::move(other.logStorage);
+        files = std::move(other.files);
+        entries = other.entries;
+        other.files.clear();
+        other.entries = 0;
+    }
+    return *this;
+}
+
+EnumValueCounter::~EnumValueCounter()
+{
+    flush();
+}
+
+void EnumValueCounter::add(const QString& filename, qint64 pos, const QString& field, const QVariant& value)
+{
+    auto& values = files[filename];
+    values.begin = std::min(values.begin, pos);
+    values.end = std::max(values.end, pos);
+    values.fields[field].add(value);
+}
+
+void EnumValueCounter::countEntry()
+{
+    if (++entries >= FlushInterval)
+        flush();
+}
+
+void EnumValueCounter::flush()
+{
+    entries = 0;
+    if (files.empty() || !logStorage)
+        return;
+
+    logStorage->addParsedValues(files);
+    files.clear();
+}
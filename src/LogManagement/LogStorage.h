@@ -3,11 +3,16 @@
 #include "Format.h"
 #include "LogMetadata.h"
 #include "DirectoryScanner.h"
+#include "HeavyHitters.h"
 
 #include <QString>
 
 #include <unordered_map>
 #include <chrono>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 
 
 class LogStorage
@@ -15,6 +20,23 @@ class LogStorage
 public:
     typedef std::pair<const std::chrono::system_clock::time_point, LogMetadata> LogMetaEntry;
 
+    struct FileSpan
+    {
+        QString module;
+        LogMetadata metadata;
+        std::chrono::system_clock::time_point start;
+        // Start of the next file of the module, or the end of the module
+        std::chrono::system_clock::time_point end;
+    };
+
+    // Enum values counted while entries of one file were parsed, with the range of entry positions they came from
+    struct ParsedValues
+    {
+        qint64 begin = std::numeric_limits<qint64>::max();
+        qint64 end = -1;
+        std::unordered_map<QString, HeavyHitters> fields;
+    };
+
 public:
     LogStorage(std::vector<DirectoryScanner::LogFile>&& files);
 
@@ -22,13 +44,19 @@ public:
 
     const std::unordered_set<std::shared_ptr<Format>>& getFormats() const;
     const std::unordered_set<QString>& getModules() const;
+    std::shared_ptr<Format> getFormat(const QString& module) const;
+
+    std::vector<LogMetadata> getFiles() const;
+    std::vector<FileSpan> getFileSpans() const;
 
     const LogMetaEntry& findLog(const QString& module, const std::chrono::system_clock::time_point& time) const;
     const LogMetaEntry& findPrevLog(const QString& module, const std::chrono::system_clock::time_point& time) const;
     const LogMetaEntry& findNextLog(const QString& module, const std::chrono::system_clock::time_point& time) const;
 
-    void addEnumValue(const QString& field, const QVariant& value);
-    std::unordered_set<QVariant, VariantHash> getEnumList(const QString& field) const;
+    void addEnumValue(const QString& field, const QVariant& value, std::uint64_t count = 1);
+    // Keyed by filename
+    void addParsedValues(const std::unordered_map<QString, ParsedValues>& files);
+    std::vector<HeavyHitters::Counter> getFrequentValues(const QString& field) const;
 
     void setTimeRange(const std::chrono::system_clock::time_point& minTime, const std::chrono::system_clock::time_point& maxTime);
 
@@ -40,6 +68,13 @@ public:
 private:
     typedef std::unordered_map<QString, std::map<std::chrono::system_clock::time_point, LogMetadata, std::greater<std::chrono::system_clock::time_point>>> LogMap;
 
+    struct FileValues
+    {
+        // Ranges of entry positions counted already, start to last entry
+        std::map<qint64, qint64> counted;
+        std::unordered_map<QString, HeavyHitters> fields;
+    };
+
 private:
     LogStorage() = default;
 
@@ -52,5 +87,35 @@ private:
     std::unordered_set<QString> modules;
     std::chrono::system_clock::time_point minTime;
     std::chrono::system_clock::time_point maxTime;
-    std::unordered_map<QString, std::unordered_set<QVariant, VariantHash>> enumLists;
+    // Values stored in the snapshots
+    std::unordered_map<QString, HeavyHitters> enumValues;
+    // Values counted by the iterators, by filename
+    std::unordered_map<QString, FileValues> parsedValues;
+    std::unique_ptr<std::mutex> enumMutex = std::make_unique<std::mutex>();
+};
+
+// Counts the enum values one iterator parses and hands them to the storage in batches,
+// so parsing an entry takes no lock. A copy starts with no counts, they are handed over once.
+class EnumValueCounter
+{
+public:
+    static constexpr size_t FlushInterval = 4096;
+
+    EnumValueCounter() = default;
+    explicit EnumValueCounter(const std::shared_ptr<LogStorage>& logStorage);
+    EnumValueCounter(const EnumValueCounter& other);
+    EnumValueCounter(EnumValueCounter&& other) noexcept;
+    EnumValueCounter& operator=(const EnumValueCounter& other);
+    EnumValueCounter& operator=(EnumValueCounter&& other) noexcept;
+    ~EnumValueCounter();
+
+    void add(const QString& filename, qint64 pos, const QString& field, const QVariant& value);
+    // Called once per parsed entry, flushes every FlushInterval entries
+    void countEntry();
+    void flush();
+
+private:
+    std::shared_ptr<LogStorage> logStorage;
+    std::unordered_map<QString, LogStorage::ParsedValues> files;
+    size_t entries = 0;
 };
@@ -151,6 +151,19 @@ QStringList splitLine(const QString& line, const std::shared_ptr<Format>& format
     }
 }
 
+bool isEntryHeader(const QString& line, const std::shared_ptr<Format>& format)
+{
+    try
+    {
+        auto parts = splitLine(line, format);
+        return parts.size() > format->timeFieldIndex && checkFormat(parts, format);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
 QVariant getValue(const QString& value, const Format::Field& field, const std::shared_ptr<Format>& format)
 {
     switch (field.type)
@@ -210,7 +223,7 @@ std::chrono::nanoseconds parseFractionToNanos(std::string_view fracPart, int des
     return std::chrono::nanoseconds(value);
 }
 
-std::chrono::system_clock::time_point parseTime(const QString& timeStr, const std::shared_ptr<Format>& format)
+std::optional<std::chrono::system_clock::time_point> tryParseTime(const QString& timeStr, const std::shared_ptr<Format>& format)
 {
     if (!format || format->timeMask.isEmpty())
         throw std::invalid_argument("Invalid format");
@@ -218,7 +231,7 @@ std::chrono::system_clock::time_point parseTime(const QString& timeStr, const st
     std::string input = timeStr.toStdString();
 
     size_t dotPos = input.rfind('.');
-    std::string_view baseStr{ &*input.begin(), (dotPos != std::string_view::npos ? dotPos : input.size()) };
+    std::string_view baseStr{ input.data(), (dotPos != std::string_view::npos ? dotPos : input.size()) };
     std::string_view fracStr = (dotPos != std::string_view::npos ? std::string_view{ input.begin() + dotPos + 1, input.end() } : std::string_view{});
 
     std::chrono::local_time<std::chrono::nanoseconds> ltp;
@@ -226,10 +239,7 @@ std::chrono::system_clock::time_point parseTime(const QString& timeStr, const st
         std::istringstream ss(std::string{ baseStr });
         ss >> std::chrono::parse(format->timeMask.toStdString(), ltp);
         if (!ss)
-        {
-            throw std::runtime_error("Failed to parse time '" + input + "' using mask '" +
-                                     format->timeMask.toStdString() + "'");
-        }
+            return std::nullopt;
     }
 
     if (!fracStr.empty() && format->timeFractionalDigits > 0)
@@ -243,6 +253,51 @@ std::chrono::system_clock::time_point parseTime(const QString& timeStr, const st
     return std::chrono::time_point_cast<std::chrono::system_clock::duration>(tp);
 }
 
+std::chrono::system_clock::time_point parseTime(const QString& timeStr, const std::shared_ptr<Format>& format)
+{
+    auto time = tryParseTime(timeStr, format);
+    if (!time)
+    {
+        throw std::runtime_error("Failed to parse time '" + timeStr.toStdString() + "' using mask '" +
+                                 format->timeMask.toStdString() + "'");
+    }
+    return time.value();
+}
+
+std::optional<std::chrono::system_clock::time_point> readLineTime(const QString& line, const std::shared_ptr<Format>& format)
+{
+    // Without a mask there is no time to read, tryParseTime would throw on every line
+    if (format->timeFieldIndex < 0 || format->timeMask.isEmpty())
+        return std::nullopt;
+
+    if (!format->separator.isEmpty())
+    {
+        qsizetype begin = 0;
+        for (int i = 0; i < format->timeFieldIndex; ++i)
+        {
+            begin = line.indexOf(format->separator, begin);
+            if (begin < 0)
+                return std::nullopt;
+            begin += format->separator.size();
+        }
+
+        qsizetype end = line.indexOf(format->separator, begin);
+        return tryParseTime(QStringView(line).mid(begin, end < 0 ? -1 : end - begin).trimmed().toString(), format);
+    }
+
+    try
+    {
+        auto parts = splitLine(line, format);
+        if (parts.size() <= format->timeFieldIndex)
+            return std::nullopt;
+        return tryParseTime(parts[format->timeFieldIndex], format);
+    }
+    catch (const std::exception&)
+    {
+        return std::nullopt;
+    }
+}
+
 int getEncodingWidth(QStringConverter::Encoding encoding)
 {
     switch (encoding)
@@ -261,6 +316,36 @@ int getEncodingWidth(QStringConverter::Encoding encoding)
     }
 }
 
+int getFieldPartIndex(const std::shared_ptr<Format>& format, const QString& fieldName)
+{
+    for (int i = 0; i < static_cast<int>(format->fields.size()); ++i)
+    {
+        const auto& field = format->fields[i];
+        if (field.name == fieldName)
+            return i;
+
+        if (field.isOptional)
+            return -1;
+    }
+    return -1;
+}
+
+QString getFieldText(const QString& part, const Format::Field& field, const std::shared_ptr<Format>& format)
+{
+    QString text = part;
+    if (field.regex.isValid() && !field.regex.pattern().isEmpty())
+    {
+        QRegularExpressionMatch match = field.regex.match(part);
+        if (!match.hasMatch())
+            return QString();
+        text = match.captured(0);
+    }
+
+    if (field.type == QMetaType::QString || field.type == QMetaType::Int)
+        return text;
+    return getValue(text, field, format).toString();
+}
+
 int findSlash(const QString& filename)
 {
     int slashPos1 = filename.lastIndexOf('/');
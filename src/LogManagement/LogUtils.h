@@ -5,10 +5,18 @@
 #include <QStringList>
 #include <QVariant>
 
+#include <optional>
+
 
 int findSlash(const QString& filename);
 bool checkFormat(const QStringList& parts, const std::shared_ptr<Format>& format);
 QStringList splitLine(const QString& line, const std::shared_ptr<Format>& format);
+bool isEntryHeader(const QString& line, const std::shared_ptr<Format>& format);
 QVariant getValue(const QString& value, const Format::Field& field, const std::shared_ptr<Format>& format);
+std::optional<std::chrono::system_clock::time_point> tryParseTime(const QString& timeStr, const std::shared_ptr<Format>& format);
 std::chrono::system_clock::time_point parseTime(const QString& timeStr, const std::shared_ptr<Format>& format);
+// Time of an entry header line, the line is split only as far as the time field
+std::optional<std::chrono::system_clock::time_point> readLineTime(const QString& line, const std::shared_ptr<Format>& format);
 int getEncodingWidth(QStringConverter::Encoding encoding);
+int getFieldPartIndex(const std::shared_ptr<Format>& format, const QString& fieldName);
+QString getFieldText(const QString& part, const Format::Field& field, const std::shared_ptr<Format>& format);
@@ -5,12 +5,154 @@
 #include <quazip/quazipfile.h>
 
 #include <QFile>
+#include <QFileInfo>
 #include <QDebug>
 
+#include <algorithm>
 #include <filesystem>
 
 
-Session::Session(const std::shared_ptr<LogStorage>& storage) : logStorage(storage)
+namespace
+{
+    bool isRawCopyable(const LogMetadata& metadata)
+    {
+        const auto& format = metadata.format;
+        if (metadata.snapshot || !format->comments.empty() || (format->encoding && format->encoding.value() != QStringConverter::Utf8))
+            return false;
+
+        // Archive members and buffers have no file of their own, compressed files no plain bytes
+        QFileInfo info(metadata.filename);
+        QFile file(metadata.filename);
+        if (!info.isFile() || info.suffix().compare("gz", Qt::CaseInsensitive) == 0 || !file.open(QIODevice::ReadOnly))
+            return false;
+
+        auto bom = file.peek(2);
+        return bom != QByteArray("\xFF\xFE", 2) && bom != QByteArray("\xFE\xFF", 2);
+    }
+
+    // Start of the last index block whose first entry is before time (or not after it when inclusive),
+    // found by reading one entry time per probed block. Entries of a file come in time order, so scanning
+    // from there reaches the first entry past time within about one block.
+    qint64 findScanStart(const LogMetadata& metadata, Log& log, const std::chrono::system_clock::time_point& time, bool inclusive)
+    {
+        const auto& index = metadata.index;
+        if (!index || !index->isReady() || index->getBlockCount() < 2)
+            return 0;
+
+        size_t low = 0;
+        size_t high = index->getBlockCount();
+        while (high - low > 1)
+        {
+            size_t middle = (low + high) / 2;
+            log.seek(index->getBlockStart(middle));
+            auto line = log.nextLine();
+            auto blockTime = line ? readLineTime(line.value(), metadata.format) : std::nullopt;
+
+            // A block without a readable time is treated as later, scanning from further back is always safe
+            if (blockTime && (inclusive ? blockTime.value() <= time : blockTime.value() < time))
+                low = middle;
+            else
+                high = middle;
+        }
+        return index->getBlockStart(low);
+    }
+
+    struct ModuleSpan
+    {
+        std::chrono::system_clock::time_point first;
+        std::chrono::system_clock::time_point last;
+        std::vector<RawByteRange> ranges;
+    };
+
+    // Only the first file and the last one of the range are read, the files between them are taken whole.
+    // With a search index only the blocks holding the two ends are scanned.
+    // No span means the module cannot be copied, an empty one that it has no entries in the range.
+    std::optional<ModuleSpan> findModuleSpan(const LogStorage& logStorage, const QString& module,
+                                             const std::chrono::system_clock::time_point& startTime,
+                                             const std::chrono::system_clock::time_point& endTime)
+    {
+        ModuleSpan span;
+        std::optional<std::chrono::system_clock::time_point> first;
+        std::optional<std::chrono::system_clock::time_point> last;
+
+        const auto* metadata = &logStorage.findLog(module, startTime);
+        while (metadata->second.fileBuilder && metadata->first <= endTime)
+        {
+            if (!isRawCopyable(metadata->second))
+                return std::nullopt;
+
+            const auto& next = logStorage.findNextLog(module, metadata->first);
+            bool lastFile = !next.second.fileBuilder || next.first > endTime;
+
+            qint64 begin = 0;
+            qint64 end = -1;
+            if (!first || lastFile)
+            {
+                begin = -1;
+                auto log = metadata->second.fileBuilder(metadata->second.filename, metadata->second.format);
+                if (!first)
+                    log->seek(findScanStart(metadata->second, *log, startTime, false));
+
+                bool endBlockReached = !lastFile;
+                while (true)
+                {
+                    qint64 pos = log->getFilePosition();
+                    auto line = log->nextLine();
+                    if (!line)
+                        break;
+
+                    auto time = readLineTime(line.value(), metadata->second.format);
+                    if (!time || (!first && time.value() < startTime))
+                        continue;
+
+                    if (time.value() > endTime)
+                    {
+                        end = pos;
+                        break;
+                    }
+
+                    if (begin < 0)
+                        begin = pos;
+                    if (!first)
+                        first = time;
+
+                    if (!lastFile)
+                        break;
+                    last = time;
+
+                    // The entries between the two ends are copied without being read
+                    if (!endBlockReached)
+                    {
+                        endBlockReached = true;
+                        qint64 resume = log->getFilePosition();
+                        log->seek(std::max(resume, findScanStart(metadata->second, *log, endTime, true)));
+                    }
+                }
+            }
+
+            if (begin >= 0 && begin != end)
+                span.ranges.push_back({ metadata->second.filename, begin, end });
+
+            if (end >= 0 || lastFile)
+                break;
+            metadata = &next;
+        }
+
+        if (span.ranges.empty())
+            return span;
+        if (!first || !last)
+            return std::nullopt;
+
+        span.first = first.value();
+        span.last = last.value();
+        return span;
+    }
+}
+
+
+Session::Session(const std::shared_ptr<LogStorage>& storage, const std::shared_ptr<CheckpointStore>& checkpointStore) :
+    logStorage(storage),
+    checkpoints(checkpointStore)
 {}
 
 const std::unordered_set<std::shared_ptr<Format>>& Session::getFormats() const
@@ -23,9 +165,24 @@ const std::unordered_set<QString>& Session::getModules() const
     return logStorage->getModules();
 }
 
-std::unordered_set<QVariant, VariantHash> Session::getEnumList(const QString& field) const
+std::shared_ptr<Format> Session::getFormat(const QString& module) const
+{
+    return logStorage->getFormat(module);
+}
+
+std::vector<HeavyHitters::Counter> Session::getFrequentValues(const QString& field) const
+{
+    return logStorage->getFrequentValues(field);
+}
+
+std::vector<LogMetadata> Session::getFiles() const
 {
-    return logStorage->getEnumList(field);
+    return logStorage->getFiles();
+}
+
+std::vector<LogStorage::FileSpan> Session::getFileSpans() const
+{
+    return logStorage->getFileSpans();
 }
 
 std::chrono::system_clock::time_point Session::getMinTime() const
@@ -37,3 +194,75 @@ std::chrono::system_clock::time_point Session::getMaxTime() const
 {
     return logStorage->getMaxTime();
 }
+
+std::optional<std::vector<RawByteRange>> Session::getRawRanges(const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime) const
+{
+    std::vector<ModuleSpan> spans;
+    for (const auto& module : getModules())
+    {
+        auto span = findModuleSpan(*logStorage, module, startTime, endTime);
+        if (!span)
+            return std::nullopt;
+        if (!span->ranges.empty())
+            spans.push_back(std::move(span.value()));
+    }
+
+    std::sort(spans.begin(), spans.end(), [](const ModuleSpan& lhs, const ModuleSpan& rhs) { return lhs.first < rhs.first; });
+
+    std::vector<RawByteRange> ranges;
+    for (size_t i = 0; i < spans.size(); ++i)
+    {
+        // Entries with equal times in different modules are ordered by the merge, so they count as interleaved
+        if (i > 0 && spans[i].first <= spans[i - 1].last)
+            return std::nullopt;
+        std::move(spans[i].ranges.begin(), spans[i].ranges.end(), std::back_inserter(ranges));
+    }
+    return ranges;
+}
+
+TimestampScanner Session::getTimestampScanner(const QString& module, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime) const
+{
+    return TimestampScanner(logStorage, module, startTime, endTime);
+}
+
+const std::shared_ptr<CheckpointStore>& Session::getCheckpointStore() const
+{
+    return checkpoints;
+}
+
+void Session::addCheckpoint(const MergeHeapCache& checkpoint)
+{
+    if (checkpoints)
+        checkpoints->add(checkpoint);
+}
+
+std::optional<MergeHeapCache> Session::findCheckpoint(const std::chrono::system_clock::time_point& time) const
+{
+    if (!checkpoints)
+        return std::nullopt;
+
+    auto checkpoint = checkpoints->findBefore(time);
+    if (!checkpoint)
+        return std::nullopt;
+
+    // The store is shared by every session of the log manager, so drop the modules this one does not contain.
+    // A module without a position would be treated as exhausted, and one pointing into an earlier file
+    // than the one holding the time is not worth reading forward from.
+    std::vector<HeapItemCache> heap;
+    for (auto& item : checkpoint->heap)
+    {
+        if (!getModules().contains(item.module))
+            continue;
+
+        if (logStorage->findLog(item.module, time).first != item.time)
+            return std::nullopt;
+
+        heap.push_back(std::move(item));
+    }
+
+    if (heap.size() != getModules().size())
+        return std::nullopt;
+
+    checkpoint->heap = std::move(heap);
+    return checkpoint;
+}
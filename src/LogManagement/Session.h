@@ -3,38 +3,83 @@
 #include "Format.h"
 #include "LogStorage.h"
 #include "LogEntryIterator.h"
+#include "CheckpointStore.h"
+#include "TimestampScanner.h"
 
 #include <QDateTime>
 
 #include <unordered_set>
 #include <memory>
+#include <optional>
+
+
+struct RawByteRange
+{
+    QString filename;
+    qint64 begin = 0;
+    // -1 reads to the end of the file
+    qint64 end = -1;
+};
 
 
 class Session
 {
 public:
-    Session(const std::shared_ptr<LogStorage>&);
+    Session(const std::shared_ptr<LogStorage>&, const std::shared_ptr<CheckpointStore>& checkpointStore = nullptr);
 
     const std::unordered_set<std::shared_ptr<Format>>& getFormats() const;
     const std::unordered_set<QString>& getModules() const;
+    std::shared_ptr<Format> getFormat(const QString& module) const;
 
-    std::unordered_set<QVariant, VariantHash> getEnumList(const QString& field) const;
+    std::vector<HeavyHitters::Counter> getFrequentValues(const QString& field) const;
+
+    std::vector<LogMetadata> getFiles() const;
+    std::vector<LogStorage::FileSpan> getFileSpans() const;
 
     std::chrono::system_clock::time_point getMinTime() const;
     std::chrono::system_clock::time_point getMaxTime() const;
 
     template<bool straight = true>
-    LogEntryIterator<straight> getIterator(const std::chrono::system_clock::time_point& startTime = std::chrono::system_clock::time_point(), const std::chrono::system_clock::time_point& endTime = std::chrono::system_clock::time_point::max())
+    LogEntryIterator<straight> getIterator(const std::chrono::system_clock::time_point& startTime = std::chrono::system_clock::time_point(), const std::chrono::system_clock::time_point& endTime = std::chrono::system_clock::time_point::max(), const LogEntryPreFilter& preFilter = LogEntryPreFilter(), const LogBlockFilter& blockFilter = LogBlockFilter(), const LogModuleFilter& moduleFilter = LogModuleFilter())
     {
-        return LogEntryIterator<straight>(logStorage, startTime, endTime);
+        if constexpr (straight)
+        {
+            if (auto checkpoint = findCheckpoint(startTime))
+            {
+                LogEntryIterator<straight> iterator(checkpoint.value(), logStorage, checkpoint->time, endTime, preFilter, blockFilter, moduleFilter);
+                iterator.skipUntil(startTime);
+                return iterator;
+            }
+        }
+
+        return LogEntryIterator<straight>(logStorage, startTime, endTime, preFilter, blockFilter, moduleFilter);
     }
 
+    // Reads a single module, the files of the other modules are never opened
     template<bool straight = true>
-    LogEntryIterator<straight> createIterator(const MergeHeapCache& cache, const std::chrono::system_clock::time_point& startTime = std::chrono::system_clock::time_point(), const std::chrono::system_clock::time_point& endTime = std::chrono::system_clock::time_point::max())
+    LogEntryIterator<straight> getModuleIterator(const QString& module, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime, const LogEntryPreFilter& preFilter = LogEntryPreFilter(), const LogBlockFilter& blockFilter = LogBlockFilter())
     {
-        return LogEntryIterator<straight>(cache, logStorage, startTime, endTime);
+        return getIterator<straight>(startTime, endTime, preFilter, blockFilter, [module](const QString& other) { return other == module; });
     }
 
+    template<bool straight = true>
+    LogEntryIterator<straight> createIterator(const MergeHeapCache& cache, const std::chrono::system_clock::time_point& startTime = std::chrono::system_clock::time_point(), const std::chrono::system_clock::time_point& endTime = std::chrono::system_clock::time_point::max(), const LogEntryPreFilter& preFilter = LogEntryPreFilter(), const LogBlockFilter& blockFilter = LogBlockFilter(), const LogModuleFilter& moduleFilter = LogModuleFilter())
+    {
+        return LogEntryIterator<straight>(cache, logStorage, startTime, endTime, preFilter, blockFilter, moduleFilter);
+    }
+
+    // Source byte ranges holding exactly the entries between startTime and endTime, in time order.
+    // Only available when the modules do not interleave in that range and every file involved
+    // is a plain UTF-8 file without comments, so its bytes can be copied as they are.
+    std::optional<std::vector<RawByteRange>> getRawRanges(const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime) const;
+
+    TimestampScanner getTimestampScanner(const QString& module, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime) const;
+
+    const std::shared_ptr<CheckpointStore>& getCheckpointStore() const;
+    void addCheckpoint(const MergeHeapCache& checkpoint);
+    std::optional<MergeHeapCache> findCheckpoint(const std::chrono::system_clock::time_point& time) const;
+
 private:
     std::shared_ptr<LogStorage> logStorage;
+    std::shared_ptr<CheckpointStore> checkpoints;
 };
@@ -0,0 +1,563 @@
+#include "SnapshotFormat.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+
+namespace
+{
+    void writeStrings(QDataStream& stream, const Snapshot::StringColumn& column)
+    {
+        stream << column.data << static_cast<quint32>(column.offsets.size());
+        for (auto offset : column.offsets)
+            stream << offset;
+    }
+
+    Snapshot::StringColumn readStrings(QDataStream& stream)
+    {
+        Snapshot::StringColumn column;
+        quint32 count = 0;
+        stream >> column.data >> count;
+        column.offsets.resize(count);
+        for (auto& offset : column.offsets)
+            stream >> offset;
+
+        // StringColumn::get reads straight from the offsets, so they must stay inside the data
+        if (stream.status() == QDataStream::Ok && !column.offsets.empty())
+        {
+            if (column.offsets.front() != 0 || !std::is_sorted(column.offsets.begin(), column.offsets.end())
+                || column.offsets.back() > static_cast<quint64>(column.data.size()))
+                throw std::runtime_error("snapshot block is corrupted");
+        }
+        return column;
+    }
+
+    void writePresence(QDataStream& stream, const std::vector<bool>& present)
+    {
+        QByteArray bits((present.size() + 7) / 8, '\0');
+        for (size_t i = 0; i < present.size(); ++i)
+        {
+            if (present[i])
+                bits[i / 8] = static_cast<char>(bits[i / 8] | (1 << (i % 8)));
+        }
+        stream << bits;
+    }
+
+    std::vector<bool> readPresence(QDataStream& stream, size_t rows)
+    {
+        QByteArray bits;
+        stream >> bits;
+        if (static_cast<size_t>(bits.size()) < (rows + 7) / 8)
+            throw std::runtime_error("snapshot block is truncated");
+
+        std::vector<bool> present(rows);
+        for (size_t i = 0; i < rows; ++i)
+            present[i] = bits[i / 8] & (1 << (i % 8));
+        return present;
+    }
+
+    Snapshot::ColumnKind selectKind(const Format::Field& field, const std::vector<const QVariant*>& values, int& type)
+    {
+        type = values.front()->metaType().id();
+        if (field.isEnum)
+            return Snapshot::ColumnKind::Dictionary;
+
+        bool sameType = std::all_of(values.begin(), values.end(), [type](const QVariant* value) { return value->metaType().id() == type; });
+        if (!sameType)
+            return Snapshot::ColumnKind::Variant;
+
+        switch (type)
+        {
+        case QMetaType::Bool:
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+            return Snapshot::ColumnKind::Integer;
+        case QMetaType::Double:
+        case QMetaType::Float:
+            return Snapshot::ColumnKind::Real;
+        case QMetaType::QString:
+            return Snapshot::ColumnKind::String;
+        default:
+            return Snapshot::ColumnKind::Variant;
+        }
+    }
+
+    qint64 toInteger(const QVariant& value)
+    {
+        if (value.metaType().id() == QMetaType::ULongLong)
+            return static_cast<qint64>(value.toULongLong());
+        return value.toLongLong();
+    }
+
+    void writeColumn(QDataStream& stream, const Format::Field& field, const std::vector<const QVariant*>& rows, Snapshot::ZoneMap& zoneMap)
+    {
+        std::vector<const QVariant*> values;
+        std::vector<bool> present(rows.size());
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            present[i] = rows[i] != nullptr;
+            if (rows[i])
+                values.push_back(rows[i]);
+        }
+
+        int type = QMetaType::UnknownType;
+        auto kind = selectKind(field, values, type);
+        stream << field.name << static_cast<quint8>(kind) << static_cast<qint32>(type);
+        writePresence(stream, present);
+
+        std::unordered_set<QString> distinct;
+        for (const auto* value : values)
+        {
+            if (distinct.size() > Snapshot::ZoneMapValues)
+                break;
+            distinct.insert(value->toString());
+        }
+        if (distinct.size() <= Snapshot::ZoneMapValues)
+            zoneMap.values = std::move(distinct);
+
+        switch (kind)
+        {
+        case Snapshot::ColumnKind::Dictionary:
+        {
+            std::unordered_map<QVariant, quint32, VariantHash> codes;
+            std::vector<const QVariant*> dictionary;
+            for (const auto* value : values)
+            {
+                if (codes.emplace(*value, static_cast<quint32>(dictionary.size())).second)
+                    dictionary.push_back(value);
+            }
+
+            stream << static_cast<quint32>(dictionary.size());
+            for (const auto* value : dictionary)
+                stream << *value;
+            for (const auto* row : rows)
+                stream << (row ? codes.at(*row) : quint32(0));
+            break;
+        }
+        case Snapshot::ColumnKind::Integer:
+        {
+            qint64 min = std::numeric_limits<qint64>::max();
+            qint64 max = std::numeric_limits<qint64>::min();
+            for (const auto* row : rows)
+            {
+                qint64 value = row ? toInteger(*row) : 0;
+                stream << value;
+                if (row)
+                {
+                    min = std::min(min, value);
+                    max = std::max(max, value);
+                }
+            }
+            if (type != QMetaType::ULongLong)
+                zoneMap.range.emplace(static_cast<double>(min), static_cast<double>(max));
+            break;
+        }
+        case Snapshot::ColumnKind::Real:
+        {
+            double min = std::numeric_limits<double>::infinity();
+            double max = -std::numeric_limits<double>::infinity();
+            for (const auto* row : rows)
+            {
+                double value = row ? row->toDouble() : 0.0;
+                stream << value;
+                if (row)
+                {
+                    min = std::min(min, value);
+                    max = std::max(max, value);
+                }
+            }
+            if (min <= max)
+                zoneMap.range.emplace(min, max);
+            break;
+        }
+        case Snapshot::ColumnKind::String:
+        {
+            Snapshot::StringColumn strings;
+            for (const auto* row : rows)
+                strings.append(row ? *static_cast<const QString*>(row->constData()) : QString());
+            writeStrings(stream, strings);
+            break;
+        }
+        case Snapshot::ColumnKind::Variant:
+            for (const auto* row : rows)
+                stream << (row ? *row : QVariant());
+            break;
+        }
+    }
+
+    Snapshot::Column readColumn(QDataStream& stream, size_t rows)
+    {
+        Snapshot::Column column;
+        quint8 kind = 0;
+        qint32 type = 0;
+        stream >> column.field >> kind >> type;
+        column.kind = static_cast<Snapshot::ColumnKind>(kind);
+        column.type = type;
+        column.present = readPresence(stream, rows);
+
+        switch (column.kind)
+        {
+        case Snapshot::ColumnKind::Dictionary:
+        {
+            quint32 count = 0;
+            stream >> count;
+            column.dictionary.resize(count);
+            for (auto& value : column.dictionary)
+                stream >> value;
+            column.codes.resize(rows);
+            for (auto& code : column.codes)
+            {
+                stream >> code;
+                if (code >= count)
+                    throw std::runtime_error("snapshot dictionary code is out of range");
+            }
+            break;
+        }
+        case Snapshot::ColumnKind::Integer:
+            column.integers.resize(rows);
+            for (auto& value : column.integers)
+                stream >> value;
+            break;
+        case Snapshot::ColumnKind::Real:
+            column.reals.resize(rows);
+            for (auto& value : column.reals)
+                stream >> value;
+            break;
+        case Snapshot::ColumnKind::String:
+            column.strings = readStrings(stream);
+            if (column.strings.offsets.size() != rows + 1)
+                throw std::runtime_error("snapshot string column is truncated");
+            break;
+        case Snapshot::ColumnKind::Variant:
+            column.variants.resize(rows);
+            for (auto& value : column.variants)
+                stream >> value;
+            break;
+        default:
+            throw std::runtime_error("unknown snapshot column kind");
+        }
+        return column;
+    }
+}
+
+namespace Snapshot
+{
+
+const ZoneMap* BlockInfo::findZoneMap(const QString& field) const
+{
+    auto it = std::find_if(zoneMaps.begin(), zoneMaps.end(), [&field](const ZoneMap& zoneMap) { return zoneMap.field == field; });
+    return it != zoneMaps.end() ? &*it : nullptr;
+}
+
+void StringColumn::append(const QString& value)
+{
+    if (offsets.empty())
+        offsets.push_back(0);
+    data += value.toUtf8();
+    offsets.push_back(static_cast<quint32>(data.size()));
+}
+
+QString StringColumn::get(size_t row) const
+{
+    return QString::fromUtf8(data.constData() + offsets[row], offsets[row + 1] - offsets[row]);
+}
+
+QVariant Column::get(size_t row) const
+{
+    switch (kind)
+    {
+    case ColumnKind::Dictionary:
+        return dictionary[codes[row]];
+    case ColumnKind::Integer:
+        switch (type)
+        {
+        case QMetaType::Bool:
+            return integers[row] != 0;
+        case QMetaType::Int:
+            return static_cast<int>(integers[row]);
+        case QMetaType::UInt:
+            return static_cast<uint>(integers[row]);
+        case QMetaType::ULongLong:
+            return static_cast<qulonglong>(integers[row]);
+        default:
+            return static_cast<qlonglong>(integers[row]);
+        }
+    case ColumnKind::Real:
+        if (type == QMetaType::Float)
+            return static_cast<float>(reals[row]);
+        return reals[row];
+    case ColumnKind::String:
+        return strings.get(row);
+    case ColumnKind::Variant:
+        return variants[row];
+    }
+    return QVariant();
+}
+
+size_t Block::size() const
+{
+    return times.size();
+}
+
+bool Block::contains(qint64 row) const
+{
+    return row >= firstRow && row < firstRow + static_cast<qint64>(times.size());
+}
+
+LogEntry Block::getEntry(qint64 row, const QString& module) const
+{
+    size_t index = row - firstRow;
+
+    LogEntry entry;
+    entry.module = module;
+    entry.time = times[index];
+    entry.line = lines.get(index);
+    entry.additionalLines = additionalLines.get(index);
+    for (const auto& column : columns)
+    {
+        if (column.present[index])
+            entry.values.emplace(column.field, column.get(index));
+    }
+    return entry;
+}
+
+QByteArray encodeBlock(const std::vector<LogEntry>& entries, const Format& format, BlockInfo& info)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    info.rows = static_cast<qint64>(entries.size());
+    info.minTime = std::chrono::system_clock::time_point::max();
+    info.maxTime = std::chrono::system_clock::time_point::min();
+    info.zoneMaps.clear();
+
+    // Timestamps are stored as deltas, which are small and compress well
+    stream << static_cast<quint32>(entries.size());
+    qint64 previous = 0;
+    for (const auto& entry : entries)
+    {
+        qint64 time = toNanoseconds(entry.time);
+        stream << time - previous;
+        previous = time;
+        info.minTime = std::min(info.minTime, entry.time);
+        info.maxTime = std::max(info.maxTime, entry.time);
+    }
+
+    StringColumn lines;
+    StringColumn additionalLines;
+    for (const auto& entry : entries)
+    {
+        lines.append(entry.line);
+        additionalLines.append(entry.additionalLines);
+    }
+    writeStrings(stream, lines);
+    writeStrings(stream, additionalLines);
+
+    std::vector<std::pair<const Format::Field*, std::vector<const QVariant*>>> columns;
+    for (const auto& field : format.fields)
+    {
+        std::vector<const QVariant*> rows(entries.size(), nullptr);
+        bool hasValues = false;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            auto it = entries[i].values.find(field.name);
+            if (it != entries[i].values.end())
+            {
+                rows[i] = &it->second;
+                hasValues = true;
+            }
+        }
+        if (hasValues)
+            columns.emplace_back(&field, std::move(rows));
+    }
+
+    stream << static_cast<quint32>(columns.size());
+    for (const auto& [field, rows] : columns)
+    {
+        ZoneMap zoneMap;
+        zoneMap.field = field->name;
+        writeColumn(stream, *field, rows, zoneMap);
+        if (zoneMap.values || zoneMap.range)
+            info.zoneMaps.push_back(std::move(zoneMap));
+    }
+
+    return data;
+}
+
+Block decodeBlock(const QByteArray& data, qint64 firstRow)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    Block block;
+    block.firstRow = firstRow;
+
+    quint32 rows = 0;
+    stream >> rows;
+    block.times.resize(rows);
+    qint64 time = 0;
+    for (auto& value : block.times)
+    {
+        qint64 delta = 0;
+        stream >> delta;
+        time += delta;
+        value = fromNanoseconds(time);
+    }
+
+    block.lines = readStrings(stream);
+    block.additionalLines = readStrings(stream);
+    if (block.lines.offsets.size() != rows + 1 || block.additionalLines.offsets.size() != rows + 1)
+        throw std::runtime_error("snapshot block is truncated");
+
+    quint32 columnCount = 0;
+    stream >> columnCount;
+    block.columns.reserve(columnCount);
+    for (quint32 i = 0; i < columnCount && stream.status() == QDataStream::Ok; ++i)
+        block.columns.push_back(readColumn(stream, rows));
+
+    if (stream.status() != QDataStream::Ok)
+        throw std::runtime_error("snapshot block is corrupted");
+
+    return block;
+}
+
+void writeFormat(QDataStream& stream, const Format& format)
+{
+    stream << format.name << format.logFileRegex.pattern() << format.extension
+           << format.encoding.has_value() << static_cast<qint32>(format.encoding.value_or(QStringConverter::Utf8))
+           << static_cast<quint32>(format.comments.size());
+
+    for (const auto& comment : format.comments)
+        stream << comment.start << comment.finish.has_value() << comment.finish.value_or(QString());
+
+    stream << format.separator << format.lineRegex.pattern()
+           << static_cast<qint32>(format.lineFormat) << static_cast<qint32>(format.timeFieldIndex)
+           << format.timeMask << static_cast<qint32>(format.timeFractionalDigits)
+           << static_cast<quint32>(format.fields.size());
+
+    for (const auto& field : format.fields)
+    {
+        stream << field.name << field.regex.pattern() << static_cast<qint32>(field.type)
+               << field.isOptional << field.isEnum << QVariantList(field.values.begin(), field.values.end());
+    }
+}
+
+std::shared_ptr<Format> readFormat(QDataStream& stream)
+{
+    auto format = std::make_shared<Format>();
+
+    QString logFileRegex;
+    bool hasEncoding = false;
+    qint32 encoding = 0;
+    quint32 commentCount = 0;
+    stream >> format->name >> logFileRegex >> format->extension >> hasEncoding >> encoding >> commentCount;
+
+    if (!logFileRegex.isEmpty())
+        format->logFileRegex = QRegularExpression(logFileRegex);
+    if (hasEncoding)
+        format->encoding = static_cast<QStringConverter::Encoding>(encoding);
+
+    for (quint32 i = 0; i < commentCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        Format::Comment comment;
+        bool hasFinish = false;
+        QString finish;
+        stream >> comment.start >> hasFinish >> finish;
+        if (hasFinish)
+            comment.finish = finish;
+        format->comments.push_back(std::move(comment));
+    }
+
+    QString lineRegex;
+    qint32 lineFormat = 0, timeFieldIndex = -1, timeFractionalDigits = 0;
+    quint32 fieldCount = 0;
+    stream >> format->separator >> lineRegex
+           >> lineFormat >> timeFieldIndex >> format->timeMask >> timeFractionalDigits >> fieldCount;
+
+    if (!lineRegex.isEmpty())
+        format->lineRegex = QRegularExpression(lineRegex);
+    format->lineFormat = static_cast<Format::LineFormat>(lineFormat);
+    format->timeFieldIndex = timeFieldIndex;
+    format->timeFractionalDigits = timeFractionalDigits;
+
+    for (quint32 i = 0; i < fieldCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        Format::Field field;
+        QString regex;
+        qint32 type = 0;
+        QVariantList values;
+        stream >> field.name >> regex >> type >> field.isOptional >> field.isEnum >> values;
+        field.regex = QRegularExpression(regex);
+        field.type = static_cast<QMetaType::Type>(type);
+        field.values.insert(values.begin(), values.end());
+        format->fields.push_back(std::move(field));
+    }
+
+    return format;
+}
+
+void writeBlockInfo(QDataStream& stream, const BlockInfo& info)
+{
+    stream << info.offset << info.size << info.rows << toNanoseconds(info.minTime) << toNanoseconds(info.maxTime)
+           << static_cast<quint32>(info.zoneMaps.size());
+
+    for (const auto& zoneMap : info.zoneMaps)
+    {
+        stream << zoneMap.field << zoneMap.values.has_value();
+        if (zoneMap.values)
+            stream << QStringList(zoneMap.values->begin(), zoneMap.values->end());
+        stream << zoneMap.range.has_value();
+        if (zoneMap.range)
+            stream << zoneMap.range->first << zoneMap.range->second;
+    }
+}
+
+BlockInfo readBlockInfo(QDataStream& stream)
+{
+    BlockInfo info;
+    qint64 minTime = 0, maxTime = 0;
+    quint32 zoneMapCount = 0;
+    stream >> info.offset >> info.size >> info.rows >> minTime >> maxTime >> zoneMapCount;
+    info.minTime = fromNanoseconds(minTime);
+    info.maxTime = fromNanoseconds(maxTime);
+
+    for (quint32 i = 0; i < zoneMapCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        ZoneMap zoneMap;
+        bool hasValues = false, hasRange = false;
+        stream >> zoneMap.field >> hasValues;
+        if (hasValues)
+        {
+            QStringList values;
+            stream >> values;
+            zoneMap.values.emplace(values.begin(), values.end());
+        }
+        stream >> hasRange;
+        if (hasRange)
+        {
+            double min = 0, max = 0;
+            stream >> min >> max;
+            zoneMap.range.emplace(min, max);
+        }
+        info.zoneMaps.push_back(std::move(zoneMap));
+    }
+
+    return info;
+}
+
+qint64 toNanoseconds(const std::chrono::system_clock::time_point& time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point fromNanoseconds(qint64 value)
+{
+    return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(value)));
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Format.h"
+#include "LogEntry.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QString>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+
+// Binary columnar snapshot of a session (.lgs). The file starts with a magic and a version,
+// followed by zlib-compressed blocks of up to BlockRows entries of a single module and by a
+// footer describing the formats, the blocks of every module with their time ranges and zone
+// maps, and the frequent enum values. The last 12 bytes hold the footer offset and the magic.
+namespace Snapshot
+{
+    inline const QString Extension = QStringLiteral(".lgs");
+
+    constexpr quint32 Magic = 0x4C47534E;
+    constexpr quint32 Version = 2;
+    constexpr size_t BlockRows = 8192;
+    constexpr size_t ZoneMapValues = 32;
+    constexpr qint64 TrailerSize = sizeof(qint64) + sizeof(quint32);
+
+    enum class ColumnKind : quint8
+    {
+        Dictionary,
+        Integer,
+        Real,
+        String,
+        Variant
+    };
+
+    // What a block can be skipped by: the distinct values of a field when there are few of them
+    // and the numeric range of numeric fields. Entries without the field are not accounted for.
+    struct ZoneMap
+    {
+        QString field;
+        std::optional<std::unordered_set<QString>> values;
+        std::optional<std::pair<double, double>> range;
+    };
+
+    struct BlockInfo
+    {
+        qint64 offset = 0;
+        qint64 size = 0;
+        qint64 firstRow = 0;
+        qint64 rows = 0;
+        std::chrono::system_clock::time_point minTime;
+        std::chrono::system_clock::time_point maxTime;
+        std::vector<ZoneMap> zoneMaps;
+
+        const ZoneMap* findZoneMap(const QString& field) const;
+    };
+
+    struct StringColumn
+    {
+        QByteArray data;
+        std::vector<quint32> offsets;
+
+        void append(const QString& value);
+        QString get(size_t row) const;
+    };
+
+    struct Column
+    {
+        QString field;
+        ColumnKind kind = ColumnKind::Variant;
+        int type = QMetaType::UnknownType;
+        std::vector<bool> present;
+
+        std::vector<QVariant> dictionary;
+        std::vector<quint32> codes;
+        std::vector<qint64> integers;
+        std::vector<double> reals;
+        StringColumn strings;
+        std::vector<QVariant> variants;
+
+        QVariant get(size_t row) const;
+    };
+
+    struct Block
+    {
+        qint64 firstRow = 0;
+        std::vector<std::chrono::system_clock::time_point> times;
+        StringColumn lines;
+        StringColumn additionalLines;
+        std::vector<Column> columns;
+
+        size_t size() const;
+        bool contains(qint64 row) const;
+        LogEntry getEntry(qint64 row, const QString& module) const;
+    };
+
+    // Column data of the entries, uncompressed. The zone maps are filled in for info.
+    QByteArray encodeBlock(const std::vector<LogEntry>& entries, const Format& format, BlockInfo& info);
+    Block decodeBlock(const QByteArray& data, qint64 firstRow);
+
+    void writeFormat(QDataStream& stream, const Format& format);
+    std::shared_ptr<Format> readFormat(QDataStream& stream);
+
+    void writeBlockInfo(QDataStream& stream, const BlockInfo& info);
+    BlockInfo readBlockInfo(QDataStream& stream);
+
+    qint64 toNanoseconds(const std::chrono::system_clock::time_point& time);
+    std::chrono::system_clock::time_point fromNanoseconds(qint64 value);
+}
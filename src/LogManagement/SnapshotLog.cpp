@@ -0,0 +1,262 @@
+#include "SnapshotLog.h"
+
+#include <QDataStream>
+
+#include <algorithm>
+#include <stdexcept>
+
+
+SnapshotFile::SnapshotFile(const QString& filename) :
+    filename(filename),
+    file(filename)
+{
+    if (!file.open(QIODevice::ReadOnly))
+        throw std::runtime_error("cannot open snapshot file: " + file.errorString().toStdString());
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (magic != Snapshot::Magic || version != Snapshot::Version || file.size() < Snapshot::TrailerSize)
+        throw std::runtime_error("not a supported snapshot file: " + filename.toStdString());
+
+    qint64 footerOffset = 0;
+    file.seek(file.size() - Snapshot::TrailerSize);
+    stream >> footerOffset >> magic;
+    if (magic != Snapshot::Magic || footerOffset <= 0 || footerOffset > file.size() - Snapshot::TrailerSize)
+        throw std::runtime_error("snapshot file is truncated: " + filename.toStdString());
+
+    file.seek(footerOffset);
+
+    quint32 formatCount = 0;
+    stream >> formatCount;
+    std::vector<std::shared_ptr<Format>> formats;
+    for (quint32 i = 0; i < formatCount && stream.status() == QDataStream::Ok; ++i)
+        formats.push_back(Snapshot::readFormat(stream));
+
+    quint32 moduleCount = 0;
+    stream >> moduleCount;
+    for (quint32 i = 0; i < moduleCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString name;
+        quint32 formatIndex = 0, blockCount = 0;
+        stream >> name >> formatIndex >> blockCount;
+        if (formatIndex >= formats.size())
+            throw std::runtime_error("snapshot file is corrupted: " + filename.toStdString());
+
+        Module module;
+        module.format = formats[formatIndex];
+        qint64 firstRow = 0;
+        for (quint32 j = 0; j < blockCount && stream.status() == QDataStream::Ok; ++j)
+        {
+            auto info = Snapshot::readBlockInfo(stream);
+            info.firstRow = firstRow;
+            firstRow += info.rows;
+            module.blocks.push_back(std::move(info));
+        }
+        modules.insert_or_assign(name, std::move(module));
+    }
+
+    quint32 fieldCount = 0;
+    stream >> fieldCount;
+    for (quint32 i = 0; i < fieldCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString field;
+        quint32 valueCount = 0;
+        stream >> field >> valueCount;
+
+        auto& counters = frequentValues[field];
+        for (quint32 j = 0; j < valueCount && stream.status() == QDataStream::Ok; ++j)
+        {
+            HeavyHitters::Counter counter;
+            quint64 count = 0;
+            stream >> counter.value >> count;
+            counter.count = count;
+            counters.push_back(std::move(counter));
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok)
+        throw std::runtime_error("snapshot file is corrupted: " + filename.toStdString());
+}
+
+const QString& SnapshotFile::getFilename() const
+{
+    return filename;
+}
+
+std::vector<QString> SnapshotFile::getModules() const
+{
+    std::vector<QString> result;
+    for (const auto& [name, module] : modules)
+        result.push_back(name);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::shared_ptr<Format> SnapshotFile::getFormat(const QString& module) const
+{
+    return modules.at(module).format;
+}
+
+const std::vector<Snapshot::BlockInfo>& SnapshotFile::getBlocks(const QString& module) const
+{
+    return modules.at(module).blocks;
+}
+
+const std::unordered_map<QString, std::vector<HeavyHitters::Counter>>& SnapshotFile::getFrequentValues() const
+{
+    return frequentValues;
+}
+
+Snapshot::Block SnapshotFile::readBlock(const Snapshot::BlockInfo& info) const
+{
+    QByteArray compressed;
+    {
+        std::lock_guard lock(mutex);
+        if (!file.seek(info.offset))
+            throw std::runtime_error("cannot read snapshot block: " + file.errorString().toStdString());
+        compressed = file.read(info.size);
+    }
+
+    if (compressed.size() != info.size)
+        throw std::runtime_error("snapshot block is truncated: " + filename.toStdString());
+
+    // Decompressing outside of the lock lets iterators on several threads decode blocks at once
+    auto data = qUncompress(compressed);
+    if (data.isEmpty())
+        throw std::runtime_error("cannot decompress snapshot block: " + filename.toStdString());
+
+    auto block = Snapshot::decodeBlock(data, info.firstRow);
+    if (static_cast<qint64>(block.size()) != info.rows)
+        throw std::runtime_error("snapshot block does not match its description: " + filename.toStdString());
+    return block;
+}
+
+SnapshotLog::SnapshotLog(const std::shared_ptr<const SnapshotFile>& file, const QString& module) :
+    file(file),
+    module(module),
+    format(file->getFormat(module)),
+    blocks(file->getBlocks(module))
+{
+    if (!blocks.empty())
+        rows = blocks.back().firstRow + blocks.back().rows;
+}
+
+const QString& SnapshotLog::getModule() const
+{
+    return module;
+}
+
+const std::shared_ptr<Format>& SnapshotLog::getFormat() const
+{
+    return format;
+}
+
+const std::vector<Snapshot::BlockInfo>& SnapshotLog::getBlocks() const
+{
+    return blocks;
+}
+
+qint64 SnapshotLog::size() const
+{
+    return rows;
+}
+
+std::chrono::system_clock::time_point SnapshotLog::getMinTime() const
+{
+    auto it = std::min_element(blocks.begin(), blocks.end(), [](const auto& l, const auto& r) { return l.minTime < r.minTime; });
+    return it != blocks.end() ? it->minTime : std::chrono::system_clock::time_point();
+}
+
+std::chrono::system_clock::time_point SnapshotLog::getMaxTime() const
+{
+    auto it = std::max_element(blocks.begin(), blocks.end(), [](const auto& l, const auto& r) { return l.maxTime < r.maxTime; });
+    return it != blocks.end() ? it->maxTime : std::chrono::system_clock::time_point();
+}
+
+qint64 SnapshotLog::lowerBound(const std::chrono::system_clock::time_point& time) const
+{
+    return findRow(time, false);
+}
+
+qint64 SnapshotLog::upperBound(const std::chrono::system_clock::time_point& time) const
+{
+    return findRow(time, true);
+}
+
+std::optional<qint64> SnapshotLog::findNextRow(const std::vector<bool>& candidates, qint64 pos, bool forward) const
+{
+    qint64 row = forward ? pos : pos - 1;
+    if (row < 0 || row >= rows)
+        return std::nullopt;
+
+    auto isCandidate = [&candidates](size_t block) {
+        return block >= candidates.size() || candidates[block];
+    };
+
+    size_t block = findBlock(row);
+    if (isCandidate(block))
+        return pos;
+
+    if (forward)
+    {
+        for (++block; block < blocks.size(); ++block)
+        {
+            if (isCandidate(block))
+                return blocks[block].firstRow;
+        }
+    }
+    else
+    {
+        while (block-- > 0)
+        {
+            if (isCandidate(block))
+                return blocks[block].firstRow + blocks[block].rows;
+        }
+    }
+    return std::nullopt;
+}
+
+LogEntry SnapshotLog::getEntry(qint64 row, std::shared_ptr<const Snapshot::Block>& block) const
+{
+    return loadBlock(row, block).getEntry(row, module);
+}
+
+std::chrono::system_clock::time_point SnapshotLog::getTime(qint64 row, std::shared_ptr<const Snapshot::Block>& block) const
+{
+    const auto& data = loadBlock(row, block);
+    return data.times[row - data.firstRow];
+}
+
+size_t SnapshotLog::findBlock(qint64 row) const
+{
+    auto it = std::partition_point(blocks.begin(), blocks.end(), [row](const Snapshot::BlockInfo& info) {
+        return info.firstRow + info.rows <= row;
+    });
+    return std::min<size_t>(it - blocks.begin(), blocks.size() - 1);
+}
+
+const Snapshot::Block& SnapshotLog::loadBlock(qint64 row, std::shared_ptr<const Snapshot::Block>& block) const
+{
+    if (!block || !block->contains(row))
+        block = std::make_shared<const Snapshot::Block>(file->readBlock(blocks[findBlock(row)]));
+    return *block;
+}
+
+qint64 SnapshotLog::findRow(const std::chrono::system_clock::time_point& time, bool after) const
+{
+    // Only the block the time falls into is decoded, the footer locates it
+    auto it = std::partition_point(blocks.begin(), blocks.end(), [&time, after](const Snapshot::BlockInfo& info) {
+        return after ? info.maxTime <= time : info.maxTime < time;
+    });
+    if (it == blocks.end())
+        return rows;
+
+    std::shared_ptr<const Snapshot::Block> block;
+    const auto& data = loadBlock(it->firstRow, block);
+    auto timeIt = after ? std::upper_bound(data.times.begin(), data.times.end(), time)
+                        : std::lower_bound(data.times.begin(), data.times.end(), time);
+    return data.firstRow + (timeIt - data.times.begin());
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "SnapshotFormat.h"
+#include "HeavyHitters.h"
+
+#include <QFile>
+#include <QString>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+
+class SnapshotFile
+{
+public:
+    explicit SnapshotFile(const QString& filename);
+
+    const QString& getFilename() const;
+    std::vector<QString> getModules() const;
+
+    std::shared_ptr<Format> getFormat(const QString& module) const;
+    const std::vector<Snapshot::BlockInfo>& getBlocks(const QString& module) const;
+
+    const std::unordered_map<QString, std::vector<HeavyHitters::Counter>>& getFrequentValues() const;
+
+    Snapshot::Block readBlock(const Snapshot::BlockInfo& info) const;
+
+private:
+    struct Module
+    {
+        std::shared_ptr<Format> format;
+        std::vector<Snapshot::BlockInfo> blocks;
+    };
+
+private:
+    QString filename;
+    std::unordered_map<QString, Module> modules;
+    std::unordered_map<QString, std::vector<HeavyHitters::Counter>> frequentValues;
+
+    mutable std::mutex mutex;
+    mutable QFile file;
+};
+
+// Entries of one module in a snapshot. Rows are addressed the way file positions are for text
+// logs: a position lies between two rows, reading forward returns the row at it and reading
+// backward the one before it.
+class SnapshotLog
+{
+public:
+    SnapshotLog(const std::shared_ptr<const SnapshotFile>& file, const QString& module);
+
+    const QString& getModule() const;
+    const std::shared_ptr<Format>& getFormat() const;
+    const std::vector<Snapshot::BlockInfo>& getBlocks() const;
+
+    qint64 size() const;
+    std::chrono::system_clock::time_point getMinTime() const;
+    std::chrono::system_clock::time_point getMaxTime() const;
+
+    // Position of the first row not earlier than the time / later than the time
+    qint64 lowerBound(const std::chrono::system_clock::time_point& time) const;
+    qint64 upperBound(const std::chrono::system_clock::time_point& time) const;
+
+    std::optional<qint64> findNextRow(const std::vector<bool>& blocks, qint64 pos, bool forward) const;
+
+    // The block holding the row is kept in `block` between calls, sequential reads decode every block once
+    LogEntry getEntry(qint64 row, std::shared_ptr<const Snapshot::Block>& block) const;
+    std::chrono::system_clock::time_point getTime(qint64 row, std::shared_ptr<const Snapshot::Block>& block) const;
+
+private:
+    size_t findBlock(qint64 row) const;
+    const Snapshot::Block& loadBlock(qint64 row, std::shared_ptr<const Snapshot::Block>& block) const;
+    qint64 findRow(const std::chrono::system_clock::time_point& time, bool after) const;
+
+private:
+    std::shared_ptr<const SnapshotFile> file;
+    QString module;
+    std::shared_ptr<Format> format;
+    const std::vector<Snapshot::BlockInfo>& blocks;
+    qint64 rows = 0;
+};
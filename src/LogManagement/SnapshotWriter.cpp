@@ -0,0 +1,130 @@
+#include "SnapshotWriter.h"
+
+#include <QDataStream>
+#include <QDebug>
+
+#include <algorithm>
+
+
+SnapshotWriter::SnapshotWriter(QIODevice& device) :
+    device(device)
+{
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << Snapshot::Magic << Snapshot::Version;
+    write(header);
+}
+
+void SnapshotWriter::addModule(const QString& module, const std::shared_ptr<Format>& format)
+{
+    if (moduleIndexes.contains(module))
+        return;
+
+    auto formatIt = std::find(formats.begin(), formats.end(), format);
+    if (formatIt == formats.end())
+        formatIt = formats.insert(formats.end(), format);
+
+    Module newModule;
+    newModule.name = module;
+    newModule.formatIndex = static_cast<quint32>(formatIt - formats.begin());
+    moduleIndexes.emplace(module, modules.size());
+    modules.push_back(std::move(newModule));
+}
+
+void SnapshotWriter::add(LogEntry entry)
+{
+    auto it = moduleIndexes.find(entry.module);
+    if (it == moduleIndexes.end())
+    {
+        qWarning() << "Snapshot has no module" << entry.module;
+        return;
+    }
+
+    auto& module = modules[it->second];
+    for (const auto& field : formats[module.formatIndex]->fields)
+    {
+        if (!field.isEnum || !field.values.empty())
+            continue;
+
+        auto valueIt = entry.values.find(field.name);
+        if (valueIt != entry.values.end())
+            frequentValues[field.name].add(valueIt->second);
+    }
+
+    module.pending.push_back(std::move(entry));
+    if (module.pending.size() >= Snapshot::BlockRows)
+        flush(module);
+}
+
+bool SnapshotWriter::finish()
+{
+    if (finished)
+        return !failed;
+    finished = true;
+
+    for (auto& module : modules)
+        flush(module);
+
+    QByteArray footer;
+    QDataStream stream(&footer, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    stream << static_cast<quint32>(formats.size());
+    for (const auto& format : formats)
+        Snapshot::writeFormat(stream, *format);
+
+    stream << static_cast<quint32>(modules.size());
+    for (const auto& module : modules)
+    {
+        stream << module.name << module.formatIndex << static_cast<quint32>(module.blocks.size());
+        for (const auto& block : module.blocks)
+            Snapshot::writeBlockInfo(stream, block);
+    }
+
+    stream << static_cast<quint32>(frequentValues.size());
+    for (const auto& [field, values] : frequentValues)
+    {
+        auto top = values.getTop();
+        stream << field << static_cast<quint32>(top.size());
+        for (const auto& counter : top)
+            stream << counter.value << static_cast<quint64>(counter.count);
+    }
+
+    stream << offset << Snapshot::Magic;
+    return write(footer) && !failed;
+}
+
+void SnapshotWriter::flush(Module& module)
+{
+    if (module.pending.empty())
+        return;
+
+    Snapshot::BlockInfo info;
+    auto compressed = qCompress(Snapshot::encodeBlock(module.pending, *formats[module.formatIndex], info));
+    module.pending.clear();
+
+    info.offset = offset;
+    info.size = compressed.size();
+    if (!module.blocks.empty())
+        info.firstRow = module.blocks.back().firstRow + module.blocks.back().rows;
+
+    if (write(compressed))
+        module.blocks.push_back(std::move(info));
+}
+
+bool SnapshotWriter::write(const QByteArray& data)
+{
+    if (failed)
+        return false;
+
+    if (device.write(data) != data.size())
+    {
+        qCritical() << "Failed to write snapshot:" << device.errorString();
+        failed = true;
+        return false;
+    }
+
+    offset += data.size();
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "SnapshotFormat.h"
+#include "HeavyHitters.h"
+
+#include <QIODevice>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+// Writes a snapshot: entries of every module are gathered into blocks of Snapshot::BlockRows,
+// each block is compressed and written as soon as it is full, the footer is written by finish().
+// Entries of a module have to come in time order.
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(QIODevice& device);
+
+    void addModule(const QString& module, const std::shared_ptr<Format>& format);
+    void add(LogEntry entry);
+
+    bool finish();
+
+private:
+    struct Module
+    {
+        QString name;
+        quint32 formatIndex = 0;
+        std::vector<LogEntry> pending;
+        std::vector<Snapshot::BlockInfo> blocks;
+    };
+
+private:
+    void flush(Module& module);
+    bool write(const QByteArray& data);
+
+private:
+    QIODevice& device;
+    qint64 offset = 0;
+    bool failed = false;
+    bool finished = false;
+
+    std::vector<std::shared_ptr<Format>> formats;
+    std::vector<Module> modules;
+    std::unordered_map<QString, size_t> moduleIndexes;
+    std::unordered_map<QString, HeavyHitters> frequentValues;
+};
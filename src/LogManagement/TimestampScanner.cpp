@@ -0,0 +1,114 @@
+#include "TimestampScanner.h"
+
+#include "LogUtils.h"
+
+#include <QDebug>
+
+
+TimestampScanner::TimestampScanner(const std::shared_ptr<LogStorage>& logStorage,
+                                   const QString& module,
+                                   const std::chrono::system_clock::time_point& startTime,
+                                   const std::chrono::system_clock::time_point& endTime) :
+    logStorage(logStorage),
+    module(module),
+    startTime(startTime),
+    endTime(endTime)
+{
+    const auto& first = logStorage->findLog(module, startTime);
+    if (!first.second.fileBuilder)
+        return;
+
+    try
+    {
+        openLog(first);
+        if (snapshot)
+            row = snapshot->lowerBound(startTime);
+    }
+    catch (const std::exception& ex)
+    {
+        qWarning() << "Failed to open" << first.second.filename << ':' << ex.what();
+        openNextLog();
+    }
+}
+
+std::optional<std::chrono::system_clock::time_point> TimestampScanner::next()
+{
+    while (log || snapshot)
+    {
+        if (snapshot)
+        {
+            if (row >= snapshot->size())
+            {
+                if (!openNextLog())
+                    return std::nullopt;
+                continue;
+            }
+
+            auto time = snapshot->getTime(row++, block);
+            if (time < startTime)
+                continue;
+
+            if (time > endTime)
+            {
+                snapshot.reset();
+                return std::nullopt;
+            }
+
+            return time;
+        }
+
+        auto line = log->nextLine();
+        if (!line)
+        {
+            if (!openNextLog())
+                return std::nullopt;
+            continue;
+        }
+
+        auto time = readLineTime(line.value(), metadata->second.format);
+        if (!time || time.value() < startTime)
+            continue;
+
+        if (time.value() > endTime)
+        {
+            log.reset();
+            return std::nullopt;
+        }
+
+        return time;
+    }
+    return std::nullopt;
+}
+
+bool TimestampScanner::openNextLog()
+{
+    log.reset();
+    snapshot.reset();
+
+    while (true)
+    {
+        const auto& next = logStorage->findNextLog(module, metadata->first);
+        if (!next.second.fileBuilder || next.first > endTime)
+            return false;
+
+        try
+        {
+            openLog(next);
+            return true;
+        }
+        catch (const std::exception& ex)
+        {
+            qWarning() << "Failed to open" << next.second.filename << ':' << ex.what();
+        }
+    }
+}
+
+void TimestampScanner::openLog(const LogStorage::LogMetaEntry& next)
+{
+    metadata = &next;
+    snapshot = next.second.snapshot;
+    block.reset();
+    row = 0;
+    if (!snapshot)
+        log = next.second.fileBuilder(next.second.filename, next.second.format);
+}
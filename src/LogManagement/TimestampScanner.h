@@ -0,0 +1,40 @@
+#pragma once
+
+#include "LogStorage.h"
+#include "SnapshotLog.h"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+
+
+// Reads only the timestamps of one module's entries, in file order. Lines are split just far enough
+// to reach the time field and a line whose time does not parse is taken as a continuation line,
+// so fields are neither matched nor converted. Snapshot modules are read from their time column.
+class TimestampScanner
+{
+public:
+    TimestampScanner(const std::shared_ptr<LogStorage>& logStorage,
+                     const QString& module,
+                     const std::chrono::system_clock::time_point& startTime,
+                     const std::chrono::system_clock::time_point& endTime);
+
+    std::optional<std::chrono::system_clock::time_point> next();
+
+private:
+    bool openNextLog();
+    void openLog(const LogStorage::LogMetaEntry& next);
+
+private:
+    std::shared_ptr<LogStorage> logStorage;
+    QString module;
+    std::chrono::system_clock::time_point startTime;
+    std::chrono::system_clock::time_point endTime;
+
+    const LogStorage::LogMetaEntry* metadata = nullptr;
+    std::shared_ptr<Log> log;
+
+    std::shared_ptr<SnapshotLog> snapshot;
+    std::shared_ptr<const Snapshot::Block> block;
+    qint64 row = 0;
+};
@@ -0,0 +1,820 @@
+#include "LogQuery.h"
+
+#include "Utils.h"
+
+#include <QDateTime>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <unordered_set>
+
+
+struct LogQuery::Node
+{
+    virtual ~Node() = default;
+
+    virtual void evaluate(const std::vector<const LogEntry*>& entries, std::vector<char>& result) const = 0;
+    // Single entry path of iterators that check entries one by one, allocates nothing
+    virtual bool matches(const LogEntry& entry) const = 0;
+};
+
+namespace
+{
+
+typedef std::shared_ptr<const LogQuery::Node> NodePtr;
+
+[[noreturn]] void throwError(const QString& message, qsizetype pos)
+{
+    throw std::invalid_argument(QString{ "%1 at position %2" }.arg(message).arg(pos + 1).toStdString());
+}
+
+
+enum class TokenType
+{
+    Word,
+    String,
+    Regex,
+    Operator,
+    LeftParen,
+    RightParen,
+    Comma,
+    End
+};
+
+struct Token
+{
+    TokenType type = TokenType::End;
+    QString text;
+    QString flags;
+    qsizetype pos = 0;
+};
+
+bool isWordChar(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == '_' || ch == '.' || ch == '-' || ch == ':' || ch == '+' || ch == '@';
+}
+
+std::vector<Token> tokenize(const QString& text)
+{
+    std::vector<Token> tokens;
+    qsizetype i = 0;
+    while (i < text.size())
+    {
+        QChar ch = text[i];
+        if (ch.isSpace())
+        {
+            ++i;
+            continue;
+        }
+
+        Token token;
+        token.pos = i;
+
+        if (ch == '(' || ch == ')' || ch == ',')
+        {
+            token.type = ch == '(' ? TokenType::LeftParen : ch == ')' ? TokenType::RightParen : TokenType::Comma;
+            token.text = ch;
+            ++i;
+        }
+        else if (ch == '"' || ch == '\'')
+        {
+            token.type = TokenType::String;
+            ++i;
+            while (i < text.size() && text[i] != ch)
+            {
+                if (text[i] == '\\' && i + 1 < text.size())
+                    ++i;
+                token.text += text[i++];
+            }
+            if (i >= text.size())
+                throwError("Unterminated string", token.pos);
+            ++i;
+        }
+        else if (ch == '/')
+        {
+            token.type = TokenType::Regex;
+            ++i;
+            while (i < text.size() && text[i] != '/')
+            {
+                if (text[i] == '\\' && i + 1 < text.size())
+                {
+                    if (text[i + 1] != '/')
+                        token.text += text[i];
+                    ++i;
+                }
+                token.text += text[i++];
+            }
+            if (i >= text.size())
+                throwError("Unterminated regular expression", token.pos);
+            ++i;
+            while (i < text.size() && text[i].isLetter())
+                token.flags += text[i++];
+        }
+        else if (ch == '=' || ch == '!' || ch == '<' || ch == '>' || ch == '~')
+        {
+            token.type = TokenType::Operator;
+            token.text = ch;
+            ++i;
+            if (i < text.size() && (text[i] == '=' || (ch == '!' && text[i] == '~')))
+                token.text += text[i++];
+            if (token.text == "!")
+                throwError("Unexpected character '!'", token.pos);
+        }
+        else if (isWordChar(ch))
+        {
+            token.type = TokenType::Word;
+            while (i < text.size() && isWordChar(text[i]))
+                token.text += text[i++];
+        }
+        else
+        {
+            throwError(QString{ "Unexpected character '%1'" }.arg(ch), i);
+        }
+
+        tokens.push_back(std::move(token));
+    }
+
+    Token end;
+    end.pos = text.size();
+    tokens.push_back(end);
+    return tokens;
+}
+
+
+enum class Source
+{
+    Field,
+    Module,
+    Time,
+    Line
+};
+
+enum class ValueKind
+{
+    Text,
+    Number,
+    DateTime,
+    Bool
+};
+
+enum class Operation
+{
+    Equal,
+    NotEqual,
+    Less,
+    LessOrEqual,
+    Greater,
+    GreaterOrEqual
+};
+
+struct Operand
+{
+    Source source = Source::Field;
+    QString field;
+    ValueKind kind = ValueKind::Text;
+};
+
+const QVariant* findValue(const LogEntry& entry, const Operand& operand)
+{
+    auto it = entry.values.find(operand.field);
+    return it != entry.values.end() ? &it->second : nullptr;
+}
+
+std::optional<QString> readText(const LogEntry& entry, const Operand& operand)
+{
+    switch (operand.source)
+    {
+    case Source::Module:
+        return entry.module;
+    case Source::Line:
+        return entry.line;
+    case Source::Time:
+        return DateTimeFromChronoSystemClock(entry.time).toString(Qt::ISODateWithMs);
+    default:
+        break;
+    }
+
+    auto value = findValue(entry, operand);
+    if (!value)
+        return std::nullopt;
+    return value->toString();
+}
+
+std::optional<double> readNumber(const LogEntry& entry, const Operand& operand)
+{
+    auto value = findValue(entry, operand);
+    if (!value)
+        return std::nullopt;
+
+    bool ok = false;
+    double number = value->toDouble(&ok);
+    if (!ok)
+        return std::nullopt;
+    return number;
+}
+
+std::optional<std::chrono::system_clock::time_point> readTime(const LogEntry& entry, const Operand& operand)
+{
+    if (operand.source == Source::Time)
+        return entry.time;
+
+    auto value = findValue(entry, operand);
+    if (!value)
+        return std::nullopt;
+
+    QDateTime time = value->toDateTime();
+    if (!time.isValid())
+        return std::nullopt;
+    return ChronoSystemClockFromDateTime(time);
+}
+
+template<typename T>
+bool compare(const T& left, Operation operation, const T& right)
+{
+    switch (operation)
+    {
+    case Operation::Equal:
+        return left == right;
+    case Operation::NotEqual:
+        return left != right;
+    case Operation::Less:
+        return left < right;
+    case Operation::LessOrEqual:
+        return left <= right;
+    case Operation::Greater:
+        return left > right;
+    case Operation::GreaterOrEqual:
+        return left >= right;
+    }
+    return false;
+}
+
+
+class CompareNode : public LogQuery::Node
+{
+public:
+    Operand operand;
+    Operation operation = Operation::Equal;
+
+    QString text;
+    double number = 0;
+    std::chrono::system_clock::time_point time;
+
+    void evaluate(const std::vector<const LogEntry*>& entries, std::vector<char>& result) const override
+    {
+        switch (operand.kind)
+        {
+        case ValueKind::Number:
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                auto value = readNumber(*entries[i], operand);
+                result[i] = value && compare(value.value(), operation, number);
+            }
+            break;
+        case ValueKind::DateTime:
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                auto value = readTime(*entries[i], operand);
+                result[i] = value && compare(value.value(), operation, time);
+            }
+            break;
+        default:
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                auto value = readText(*entries[i], operand);
+                result[i] = value && compare(QString::compare(value.value(), text), operation, 0);
+            }
+            break;
+        }
+    }
+
+    bool matches(const LogEntry& entry) const override
+    {
+        switch (operand.kind)
+        {
+        case ValueKind::Number:
+        {
+            auto value = readNumber(entry, operand);
+            return value && compare(value.value(), operation, number);
+        }
+        case ValueKind::DateTime:
+        {
+            auto value = readTime(entry, operand);
+            return value && compare(value.value(), operation, time);
+        }
+        default:
+        {
+            auto value = readText(entry, operand);
+            return value && compare(QString::compare(value.value(), text), operation, 0);
+        }
+        }
+    }
+};
+
+class InNode : public LogQuery::Node
+{
+public:
+    Operand operand;
+
+    std::unordered_set<QString> texts;
+    std::vector<double> numbers;
+    std::vector<std::chrono::system_clock::time_point> times;
+
+    void evaluate(const std::vector<const LogEntry*>& entries, std::vector<char>& result) const override
+    {
+        switch (operand.kind)
+        {
+        case ValueKind::Number:
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                auto value = readNumber(*entries[i], operand);
+                result[i] = value && std::find(numbers.begin(), numbers.end(), value.value()) != numbers.end();
+            }
+            break;
+        case ValueKind::DateTime:
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                auto value = readTime(*entries[i], operand);
+                result[i] = value && std::find(times.begin(), times.end(), value.value()) != times.end();
+            }
+            break;
+        default:
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                auto value = readText(*entries[i], operand);
+                result[i] = value && texts.contains(value.value());
+            }
+            break;
+        }
+    }
+
+    bool matches(const LogEntry& entry) const override
+    {
+        switch (operand.kind)
+        {
+        case ValueKind::Number:
+        {
+            auto value = readNumber(entry, operand);
+            return value && std::find(numbers.begin(), numbers.end(), value.value()) != numbers.end();
+        }
+        case ValueKind::DateTime:
+        {
+            auto value = readTime(entry, operand);
+            return value && std::find(times.begin(), times.end(), value.value()) != times.end();
+        }
+        default:
+        {
+            auto value = readText(entry, operand);
+            return value && texts.contains(value.value());
+        }
+        }
+    }
+};
+
+class RegexNode : public LogQuery::Node
+{
+public:
+    Operand operand;
+    QRegularExpression regex;
+
+    void evaluate(const std::vector<const LogEntry*>& entries, std::vector<char>& result) const override
+    {
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            auto value = readText(*entries[i], operand);
+            result[i] = value && regex.match(value.value()).hasMatch();
+        }
+    }
+
+    bool matches(const LogEntry& entry) const override
+    {
+        auto value = readText(entry, operand);
+        return value && regex.match(value.value()).hasMatch();
+    }
+};
+
+void evaluateSelected(const LogQuery::Node& node, const std::vector<const LogEntry*>& entries, std::vector<char>& result, char selected)
+{
+    std::vector<size_t> indexes;
+    std::vector<const LogEntry*> subset;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (result[i] == selected)
+        {
+            indexes.push_back(i);
+            subset.push_back(entries[i]);
+        }
+    }
+
+    if (subset.empty())
+        return;
+
+    std::vector<char> subsetResult(subset.size(), 0);
+    node.evaluate(subset, subsetResult);
+    for (size_t i = 0; i < indexes.size(); ++i)
+        result[indexes[i]] = subsetResult[i];
+}
+
+class AndNode : public LogQuery::Node
+{
+public:
+    AndNode(NodePtr left, NodePtr right) : left(std::move(left)), right(std::move(right)) {}
+
+    void evaluate(const std::vector<const LogEntry*>& entries, std::vector<char>& result) const override
+    {
+        left->evaluate(entries, result);
+        evaluateSelected(*right, entries, result, 1);
+    }
+
+    bool matches(const LogEntry& entry) const override
+    {
+        return left->matches(entry) && right->matches(entry);
+    }
+
+private:
+    NodePtr left;
+    NodePtr right;
+};
+
+class OrNode : public LogQuery::Node
+{
+public:
+    OrNode(NodePtr left, NodePtr right) : left(std::move(left)), right(std::move(right)) {}
+
+    void evaluate(const std::vector<const LogEntry*>& entries, std::vector<char>& result) const override
+    {
+        left->evaluate(entries, result);
+        evaluateSelected(*right, entries, result, 0);
+    }
+
+    bool matches(const LogEntry& entry) const override
+    {
+        return left->matches(entry) || right->matches(entry);
+    }
+
+private:
+    NodePtr left;
+    NodePtr right;
+};
+
+class NotNode : public LogQuery::Node
+{
+public:
+    explicit NotNode(NodePtr child) : child(std::move(child)) {}
+
+    void evaluate(const std::vector<const LogEntry*>& entries, std::vector<char>& result) const override
+    {
+        child->evaluate(entries, result);
+        for (auto& value : result)
+            value = !value;
+    }
+
+    bool matches(const LogEntry& entry) const override
+    {
+        return !child->matches(entry);
+    }
+
+private:
+    NodePtr child;
+};
+
+
+class Parser
+{
+public:
+    Parser(const QString& text, const std::vector<Format::Field>& fields) :
+        tokens(tokenize(text)),
+        fields(fields)
+    {}
+
+    NodePtr parse()
+    {
+        if (peek().type == TokenType::End)
+            throwError("Query is empty", 0);
+
+        auto node = parseOr();
+        if (peek().type != TokenType::End)
+            throwError(QString{ "Unexpected '%1'" }.arg(peek().text), peek().pos);
+        return node;
+    }
+
+private:
+    const Token& peek(size_t offset = 0) const
+    {
+        return tokens[std::min(current + offset, tokens.size() - 1)];
+    }
+
+    const Token& take()
+    {
+        const Token& token = peek();
+        if (current < tokens.size() - 1)
+            ++current;
+        return token;
+    }
+
+    const Token& expect(TokenType type, const char* description)
+    {
+        if (peek().type != type)
+            throwError(QString{ "Expected %1" }.arg(description), peek().pos);
+        return take();
+    }
+
+    bool isKeyword(const Token& token, const char* keyword) const
+    {
+        return token.type == TokenType::Word && token.text.compare(keyword, Qt::CaseInsensitive) == 0;
+    }
+
+    NodePtr parseOr()
+    {
+        auto node = parseAnd();
+        while (isKeyword(peek(), "or"))
+        {
+            take();
+            node = std::make_shared<OrNode>(node, parseAnd());
+        }
+        return node;
+    }
+
+    NodePtr parseAnd()
+    {
+        auto node = parseNot();
+        while (isKeyword(peek(), "and"))
+        {
+            take();
+            node = std::make_shared<AndNode>(node, parseNot());
+        }
+        return node;
+    }
+
+    NodePtr parseNot()
+    {
+        if (isKeyword(peek(), "not"))
+        {
+            take();
+            return std::make_shared<NotNode>(parseNot());
+        }
+        return parsePrimary();
+    }
+
+    NodePtr parsePrimary()
+    {
+        if (peek().type == TokenType::LeftParen)
+        {
+            take();
+            auto node = parseOr();
+            expect(TokenType::RightParen, "')'");
+            return node;
+        }
+        return parseComparison();
+    }
+
+    NodePtr parseComparison()
+    {
+        const Token& fieldToken = peek();
+        if (fieldToken.type != TokenType::Word && fieldToken.type != TokenType::String)
+            throwError("Expected field name", fieldToken.pos);
+        take();
+
+        Operand operand = resolveOperand(fieldToken);
+
+        if (isKeyword(peek(), "not") && isKeyword(peek(1), "in"))
+        {
+            take();
+            take();
+            return std::make_shared<NotNode>(parseIn(operand));
+        }
+
+        if (isKeyword(peek(), "in"))
+        {
+            take();
+            return parseIn(operand);
+        }
+
+        const Token& operatorToken = expect(TokenType::Operator, "comparison operator");
+        if (operatorToken.text == "~" || operatorToken.text == "!~")
+        {
+            auto node = parseRegex(operand);
+            if (operatorToken.text == "!~")
+                return std::make_shared<NotNode>(node);
+            return node;
+        }
+
+        auto node = std::make_shared<CompareNode>();
+        node->operand = operand;
+        node->operation = getOperation(operatorToken);
+
+        const Token& valueToken = takeValue();
+        switch (operand.kind)
+        {
+        case ValueKind::Number:
+            node->number = toNumber(valueToken);
+            break;
+        case ValueKind::DateTime:
+            node->time = toTime(valueToken);
+            break;
+        case ValueKind::Bool:
+            if (node->operation != Operation::Equal && node->operation != Operation::NotEqual)
+                throwError("Only '=' and '!=' are supported for boolean fields", operatorToken.pos);
+            node->text = toBool(valueToken) ? "true" : "false";
+            break;
+        default:
+            node->text = valueToken.text;
+            break;
+        }
+        return node;
+    }
+
+    NodePtr parseIn(const Operand& operand)
+    {
+        auto node = std::make_shared<InNode>();
+        node->operand = operand;
+
+        expect(TokenType::LeftParen, "'('");
+        while (true)
+        {
+            const Token& valueToken = takeValue();
+            switch (operand.kind)
+            {
+            case ValueKind::Number:
+                node->numbers.push_back(toNumber(valueToken));
+                break;
+            case ValueKind::DateTime:
+                node->times.push_back(toTime(valueToken));
+                break;
+            case ValueKind::Bool:
+                node->texts.insert(toBool(valueToken) ? "true" : "false");
+                break;
+            default:
+                node->texts.insert(valueToken.text);
+                break;
+            }
+
+            if (peek().type != TokenType::Comma)
+                break;
+            take();
+        }
+        expect(TokenType::RightParen, "')'");
+        return node;
+    }
+
+    NodePtr parseRegex(const Operand& operand)
+    {
+        const Token& patternToken = peek();
+        if (patternToken.type != TokenType::Regex && patternToken.type != TokenType::String && patternToken.type != TokenType::Word)
+            throwError("Expected regular expression", patternToken.pos);
+        take();
+
+        QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption;
+        for (QChar flag : patternToken.flags)
+        {
+            if (flag == 'i')
+                options |= QRegularExpression::CaseInsensitiveOption;
+            else
+                throwError(QString{ "Unknown regular expression flag '%1'" }.arg(flag), patternToken.pos);
+        }
+
+        auto node = std::make_shared<RegexNode>();
+        node->operand = operand;
+        node->regex = QRegularExpression(patternToken.text, options);
+        if (!node->regex.isValid())
+            throwError("Invalid regular expression: " + node->regex.errorString(), patternToken.pos);
+        node->regex.optimize();
+        return node;
+    }
+
+    const Token& takeValue()
+    {
+        const Token& token = peek();
+        if (token.type != TokenType::Word && token.type != TokenType::String)
+            throwError("Expected value", token.pos);
+        return take();
+    }
+
+    Operand resolveOperand(const Token& token) const
+    {
+        Operand operand;
+        operand.field = token.text;
+
+        auto it = std::find_if(fields.begin(), fields.end(), [&token](const Format::Field& field) { return field.name == token.text; });
+        if (it != fields.end())
+        {
+            switch (it->type)
+            {
+            case QMetaType::Int:
+            case QMetaType::UInt:
+            case QMetaType::LongLong:
+            case QMetaType::ULongLong:
+            case QMetaType::Double:
+                operand.kind = ValueKind::Number;
+                break;
+            case QMetaType::QDateTime:
+                operand.kind = ValueKind::DateTime;
+                break;
+            case QMetaType::Bool:
+                operand.kind = ValueKind::Bool;
+                break;
+            default:
+                operand.kind = ValueKind::Text;
+                break;
+            }
+            return operand;
+        }
+
+        if (token.text == "module")
+            operand.source = Source::Module;
+        else if (token.text == "line")
+            operand.source = Source::Line;
+        else if (token.text == "time")
+        {
+            operand.source = Source::Time;
+            operand.kind = ValueKind::DateTime;
+        }
+        else
+            throwError(QString{ "Unknown field '%1'" }.arg(token.text), token.pos);
+
+        return operand;
+    }
+
+    static Operation getOperation(const Token& token)
+    {
+        if (token.text == "=" || token.text == "==")
+            return Operation::Equal;
+        if (token.text == "!=")
+            return Operation::NotEqual;
+        if (token.text == "<")
+            return Operation::Less;
+        if (token.text == "<=")
+            return Operation::LessOrEqual;
+        if (token.text == ">")
+            return Operation::Greater;
+        if (token.text == ">=")
+            return Operation::GreaterOrEqual;
+        throwError(QString{ "Unknown operator '%1'" }.arg(token.text), token.pos);
+    }
+
+    static double toNumber(const Token& token)
+    {
+        bool ok = false;
+        double number = token.text.toDouble(&ok);
+        if (!ok)
+            throwError(QString{ "'%1' is not a number" }.arg(token.text), token.pos);
+        return number;
+    }
+
+    static std::chrono::system_clock::time_point toTime(const Token& token)
+    {
+        QDateTime time = QDateTime::fromString(token.text, Qt::ISODateWithMs);
+        if (!time.isValid())
+            time = QDateTime::fromString(token.text, "yyyy-MM-dd HH:mm:ss.zzz");
+        if (!time.isValid())
+            time = QDateTime::fromString(token.text, "yyyy-MM-dd HH:mm:ss");
+        if (!time.isValid())
+            throwError(QString{ "'%1' is not a date and time" }.arg(token.text), token.pos);
+        return ChronoSystemClockFromDateTime(time);
+    }
+
+    static bool toBool(const Token& token)
+    {
+        static const std::unordered_set<QString> trueValues = { "true", "t", "1", "yes", "y", "on", "enabled" };
+        static const std::unordered_set<QString> falseValues = { "false", "f", "0", "no", "n", "off", "disabled" };
+
+        QString value = token.text.toLower();
+        if (trueValues.contains(value))
+            return true;
+        if (falseValues.contains(value))
+            return false;
+        throwError(QString{ "'%1' is not a boolean" }.arg(token.text), token.pos);
+    }
+
+private:
+    std::vector<Token> tokens;
+    size_t current = 0;
+    const std::vector<Format::Field>& fields;
+};
+
+}
+
+LogQuery::LogQuery(const QString& text, const std::vector<Format::Field>& fields) :
+    text(text),
+    root(Parser(text, fields).parse())
+{}
+
+const QString& LogQuery::getText() const
+{
+    return text;
+}
+
+bool LogQuery::check(const LogEntry& entry) const
+{
+    return root->matches(entry);
+}
+
+std::vector<char> LogQuery::evaluate(const std::vector<const LogEntry*>& entries) const
+{
+    std::vector<char> result(entries.size(), 0);
+    if (!entries.empty())
+        root->evaluate(entries, result);
+    return result;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "LogManagement/Format.h"
+#include "LogManagement/LogEntry.h"
+
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+
+class LogQuery
+{
+public:
+    LogQuery(const QString& text, const std::vector<Format::Field>& fields);
+
+    const QString& getText() const;
+
+    bool check(const LogEntry& entry) const;
+    std::vector<char> evaluate(const std::vector<const LogEntry*>& entries) const;
+
+    struct Node;
+
+private:
+    QString text;
+    std::shared_ptr<const Node> root;
+};
@@ -93,8 +93,14 @@ void FilterHeader::updateEditors()
             }
         }
 
+        QStringList texts;
+        QVariantList data;
         for (const auto& val : values)
-            cb->addItem(val.toString(), val);
+        {
+            texts << val.toString();
+            data << val;
+        }
+        cb->setItems(texts, data);
     }
 
     QT_SLOT_END
@@ -233,7 +239,7 @@ void FilterHeader::adjustLastColumn()
         setSectionResizeMode(model()->columnCount() - 1, QHeaderView::ResizeMode::Stretch);
 }
 
-MultiSelectComboBox* FilterHeader::createComboBoxEditor(int i, const std::unordered_set<QVariant, VariantHash>& values, LogFilterModel* proxyModel)
+MultiSelectComboBox* FilterHeader::createComboBoxEditor(int i, const std::vector<QVariant>& values, LogFilterModel* proxyModel)
 {
     auto comboBox = new MultiSelectComboBox(this);
     comboBox->setPlaceholderText(tr("Filter"));
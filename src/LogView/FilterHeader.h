@@ -40,7 +40,7 @@ private:
     void setupEditors();
     void adjustLastColumn();
 
-    MultiSelectComboBox* createComboBoxEditor(int section, const std::unordered_set<QVariant, VariantHash>& values, LogFilterModel* proxyModel);
+    MultiSelectComboBox* createComboBoxEditor(int section, const std::vector<QVariant>& values, LogFilterModel* proxyModel);
 
 private:
     std::vector<QWidget*> editors;
@@ -1,20 +1,14 @@
 #include "FilteredLogModel.h"
 
+#include <algorithm>
 #include <chrono>
 
 FilteredLogModel::FilteredLogModel(SessionService* sessionService, const LogFilter& filter, QObject* parent) :
     LogModel(sessionService, parent),
     filter(filter)
-{}
-
-void FilteredLogModel::fetchUpMore()
 {
-    LogModel::fetchUpMore(filter);
-}
-
-void FilteredLogModel::fetchDownMore()
-{
-    LogModel::fetchDownMore(filter);
+    shareCheckpoints = false;
+    setIteratorFilter(filter);
 }
 
 const LogFilter& FilteredLogModel::getFilter() const
@@ -25,6 +19,18 @@ const LogFilter& FilteredLogModel::getFilter() const
 void FilteredLogModel::applyFilter(const LogFilter& newFilter)
 {
     filter.apply(newFilter);
+    setIteratorFilter(filter);
     goToTime(std::chrono::system_clock::time_point::min());
 }
 
+void FilteredLogModel::setEstimatedSelectivity(double selectivity)
+{
+    estimatedSelectivity = std::clamp(selectivity, 0.0, 1.0);
+}
+
+qint64 FilteredLogModel::getEstimatedRowCount() const
+{
+    // The base estimate counts every entry of the session range
+    return std::max<qint64>(LogModel::getEstimatedRowCount() * estimatedSelectivity, rowCount());
+}
+
@@ -11,13 +11,15 @@ class FilteredLogModel : public LogModel
 public:
     explicit FilteredLogModel(SessionService* sessionService, const LogFilter& filter, QObject* parent = nullptr);
 
-    void fetchUpMore() override;
-    void fetchDownMore() override;
-
     const LogFilter& getFilter() const;
     void applyFilter(const LogFilter& newFilter);
 
+    // Share of the session entries the filter is expected to pass
+    void setEstimatedSelectivity(double selectivity);
+    qint64 getEstimatedRowCount() const override;
+
 private:
     LogFilter filter;
+    double estimatedSelectivity = 1.0;
 };
 
@@ -4,7 +4,9 @@
 #include "FilteredLogModel.h"
 
 #include <QRegularExpression>
+#include <algorithm>
 #include <chrono>
+#include <latch>
 
 
 LogFilterModel::LogFilterModel(QObject *parent) : QSortFilterProxyModel(parent)
@@ -14,13 +16,6 @@ LogFilterModel::LogFilterModel(QObject *parent) : QSortFilterProxyModel(parent)
 
 void LogFilterModel::setFilterWildcard(int column, const QString& pattern)
 {
-    double before = rowCount();
-    auto it = filterEstimates.find(column);
-    if (before == 0)
-        before = it != filterEstimates.end() ? it->second : 1;
-    else if (it != filterEstimates.end())
-        before *= it->second;
-
     if (pattern.isEmpty())
         columnFilters.erase(column);
     else
@@ -29,26 +24,12 @@ void LogFilterModel::setFilterWildcard(int column, const QString& pattern)
         filter.regex = QRegularExpression{ QRegularExpression::wildcardToRegularExpression(pattern, QRegularExpression::WildcardConversionOption::UnanchoredWildcardConversion) };
     }
 
-    invalidateFilter();
-    double after = rowCount();
-
-    if (pattern.isEmpty())
-        filterEstimates.erase(column);
-    else
-        filterEstimates[column] = after > 0 ? before / after : before;
-
+    refilter();
     updateSourceModel();
 }
 
 void LogFilterModel::setFilterRegularExpression(int column, const QString& pattern)
 {
-    double before = rowCount();
-    auto it = filterEstimates.find(column);
-    if (before == 0)
-        before = it != filterEstimates.end() ? it->second : 1;
-    else if (it != filterEstimates.end())
-        before *= it->second;
-
     if (pattern.isEmpty())
         columnFilters.erase(column);
     else
@@ -57,26 +38,12 @@ void LogFilterModel::setFilterRegularExpression(int column, const QString& patte
         filter.regex = QRegularExpression(pattern);
     }
 
-    invalidateFilter();
-    double after = rowCount();
-
-    if (pattern.isEmpty())
-        filterEstimates.erase(column);
-    else
-        filterEstimates[column] = after > 0 ? before / after : before;
-
+    refilter();
     updateSourceModel();
 }
 
 void LogFilterModel::setVariantList(int column, const QStringList& values)
 {
-    double before = rowCount();
-    auto it = filterEstimates.find(column);
-    if (before == 0)
-        before = it != filterEstimates.end() ? it->second : 1;
-    else if (it != filterEstimates.end())
-        before *= it->second;
-
     if (values.isEmpty())
         variants.erase(column);
     else
@@ -85,14 +52,7 @@ void LogFilterModel::setVariantList(int column, const QStringList& values)
         filter.values = std::unordered_set<QString>{ values.begin(), values.end() };
     }
 
-    invalidateFilter();
-    double after = rowCount();
-
-    if (values.isEmpty())
-        filterEstimates.erase(column);
-    else
-        filterEstimates[column] = after > 0 ? before / after : before;
-
+    refilter();
     updateSourceModel();
 }
 
@@ -111,8 +71,7 @@ void LogFilterModel::setFilterMode(int column, FilterType type)
     if (it == columnFilters.end() && itv == variants.end())
         return;
 
-    filterEstimates.erase(column);
-    invalidateFilter();
+    refilter();
     updateSourceModel();
 }
 
@@ -125,12 +84,47 @@ FilterType LogFilterModel::filterMode(int column) const
     return FilterType::Whitelist;
 }
 
+void LogFilterModel::setQuery(const QString& text)
+{
+    std::shared_ptr<const LogQuery> newQuery;
+    if (!text.trimmed().isEmpty())
+    {
+        if (!baseModel)
+            return;
+
+        try
+        {
+            newQuery = std::make_shared<LogQuery>(text, baseModel->getFields());
+        }
+        catch (const std::exception& e)
+        {
+            emit handleError(QString{ "Invalid query: %1" }.arg(e.what()));
+            return;
+        }
+    }
+
+    query = newQuery;
+
+    refilter();
+    updateSourceModel();
+}
+
 void LogFilterModel::setSourceModel(QAbstractItemModel* model)
 {
     baseModel = qobject_cast<LogModel*>(model);
     filteredModel.reset();
-    filterEstimates.clear();
-    QSortFilterProxyModel::setSourceModel(model);
+    estimator = baseModel ? std::make_unique<SelectivityEstimator>(baseModel->getService()) : nullptr;
+
+    // The first filter may be set before the samples arrive, so its choice of model is revisited then
+    disconnect(samplesConnection);
+    if (baseModel)
+    {
+        samplesConnection = connect(baseModel->getService(), &SessionService::samplesCollected, this, [this]() {
+            if (!filteredModel)
+                updateSourceModel();
+        });
+    }
+    setProxySourceModel(model);
 
     emit sourceModelChanged(model);
 }
@@ -176,7 +170,9 @@ LogFilter LogFilterModel::exportFilter() const
         }
     }
 
-    return LogFilter{ fieldFilters, filterVariants, fields, modules, modulesType };
+    LogFilter filter{ fieldFilters, filterVariants, fields, modules, modulesType };
+    filter.setQuery(query);
+    return filter;
 }
 
 bool LogFilterModel::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
@@ -184,6 +180,15 @@ bool LogFilterModel::filterAcceptsRow(int source_row, const QModelIndex& source_
     if (source_parent.isValid())
         return true;
 
+    if (source_row >= 0 && static_cast<size_t>(source_row) < acceptedRows.size())
+        return acceptedRows[source_row];
+
+    if (auto model = qobject_cast<const LogModel*>(sourceModel()))
+    {
+        const auto& entry = model->getEntry(source_row);
+        return acceptsEntry(entry, rowPredicates) && (!query || query->check(entry));
+    }
+
     for (const auto& filter : columnFilters)
     {
         int column = filter.first;
@@ -233,46 +238,248 @@ void LogFilterModel::updateSourceModel()
         return;
 
     auto filter = exportFilter();
-    double totalRate = 1.0;
-    for (const auto& est : filterEstimates)
-        totalRate *= est.second;
-
-    if (filter.isEmpty() || !baseModel->isFulled() || totalRate <= 1.0)
+    if (filter.isEmpty() || !baseModel->isFulled())
     {
         if (filteredModel)
         {
             filteredModel.reset();
-            QSortFilterProxyModel::setSourceModel(baseModel);
-            invalidateFilter();
+            setProxySourceModel(baseModel);
+            refilter();
             emit sourceModelChanged(baseModel);
         }
         return;
     }
 
-    constexpr double recreateThreshold = 10.0;
-    if (totalRate >= recreateThreshold)
+    if (filteredModel)
     {
-        if (filteredModel)
+        filteredModel->applyFilter(filter);
+        if (estimator)
+            filteredModel->setEstimatedSelectivity(estimator->estimate(filteredModel->getFilter()).selectivity);
+    }
+    else
+    {
+        if (!estimator)
+            return;
+
+        auto estimate = estimator->estimate(filter);
+        if (!SelectivityEstimator::preferFilteredModel(estimate))
+            return;
+
+        filteredModel = std::make_unique<FilteredLogModel>(baseModel->getService(), filter);
+        filteredModel->setEstimatedSelectivity(estimate.selectivity);
+        filteredModel->goToTime(baseModel->getCurrentTime());
+    }
+
+    setProxySourceModel(filteredModel.get());
+    clearFilters();
+    refilter();
+
+    emit sourceModelChanged(filteredModel.get());
+}
+
+void LogFilterModel::setProxySourceModel(QAbstractItemModel* model)
+{
+    for (const auto& connection : cacheConnections)
+        disconnect(connection);
+    cacheConnections.clear();
+    acceptedRows.clear();
+
+    auto logModel = qobject_cast<const LogModel*>(model);
+    rowPredicates = logModel ? createRowPredicates(*logModel) : std::vector<RowPredicate>();
+
+    if (logModel)
+    {
+        // Connected before the proxy's own handlers, which then read the updated cache for the affected rows only
+        auto rebuildCache = [this, logModel]() { acceptedRows = evaluateRows(*logModel, 0, logModel->rowCount()); };
+        cacheConnections.push_back(connect(model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex& parent, int first, int last) {
+            if (!parent.isValid())
+                insertRows(first, last);
+        }));
+        cacheConnections.push_back(connect(model, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex& parent, int first, int last) {
+            if (!parent.isValid())
+                removeRows(first, last);
+        }));
+        cacheConnections.push_back(connect(model, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+            updateRows(topLeft.row(), bottomRight.row());
+        }));
+        cacheConnections.push_back(connect(model, &QAbstractItemModel::rowsMoved, this, rebuildCache));
+        cacheConnections.push_back(connect(model, &QAbstractItemModel::modelReset, this, rebuildCache));
+        cacheConnections.push_back(connect(model, &QAbstractItemModel::layoutChanged, this, rebuildCache));
+    }
+
+    QSortFilterProxyModel::setSourceModel(model);
+}
+
+void LogFilterModel::refilter()
+{
+    auto model = qobject_cast<const LogModel*>(sourceModel());
+    if (!model)
+    {
+        rowPredicates.clear();
+        acceptedRows.clear();
+        invalidateRowsFilter();
+        return;
+    }
+
+    rowPredicates = createRowPredicates(*model);
+    auto rows = evaluateRows(*model, 0, model->rowCount());
+    if (rows == acceptedRows)
+        return;
+
+    // The proxy compares every row with its mapping and only inserts or removes the rows whose state changed
+    acceptedRows = std::move(rows);
+    invalidateRowsFilter();
+}
+
+void LogFilterModel::updateRows(int first, int last)
+{
+    auto model = qobject_cast<const LogModel*>(sourceModel());
+    if (!model || first < 0 || static_cast<size_t>(last) >= acceptedRows.size())
+        return;
+
+    auto rows = evaluateRows(*model, first, last + 1);
+    std::copy(rows.begin(), rows.end(), acceptedRows.begin() + first);
+}
+
+void LogFilterModel::insertRows(int first, int last)
+{
+    auto model = qobject_cast<const LogModel*>(sourceModel());
+    if (!model || static_cast<size_t>(first) > acceptedRows.size() || acceptedRows.size() + (last - first + 1) != static_cast<size_t>(model->rowCount()))
+    {
+        acceptedRows.clear();
+        return;
+    }
+
+    auto rows = evaluateRows(*model, first, last + 1);
+    acceptedRows.insert(acceptedRows.begin() + first, rows.begin(), rows.end());
+}
+
+void LogFilterModel::removeRows(int first, int last)
+{
+    if (static_cast<size_t>(last) >= acceptedRows.size())
+    {
+        acceptedRows.clear();
+        return;
+    }
+
+    acceptedRows.erase(acceptedRows.begin() + first, acceptedRows.begin() + last + 1);
+}
+
+std::vector<char> LogFilterModel::evaluateRows(const LogModel& model, int first, int last) const
+{
+    std::vector<char> rows(last - first, 1);
+
+    if (!rowPredicates.empty())
+    {
+        auto evaluate = [&rows, this, &model, first](int begin, int end) {
+            model.forEachEntry(begin, end, [&rows, this, first](int row, const LogEntry& entry) {
+                rows[row - first] = acceptsEntry(entry, rowPredicates);
+            });
+        };
+
+        int rowCount = last - first;
+        int chunkCount = std::min<int>(rowPool.maxThreadCount() + 1, rowCount / ParallelRowThreshold);
+        if (chunkCount > 1)
         {
-            filteredModel->applyFilter(filter);
+            // The calling thread takes the first chunk and waits for the pool to finish the rest
+            int chunk = (rowCount + chunkCount - 1) / chunkCount;
+            std::latch done((rowCount - 1) / chunk);
+            for (int begin = first + chunk; begin < last; begin += chunk)
+            {
+                rowPool.start([&evaluate, &done, begin, end = std::min(begin + chunk, last)]() {
+                    evaluate(begin, end);
+                    done.count_down();
+                });
+            }
+            evaluate(first, first + chunk);
+            done.wait();
         }
         else
         {
-            filteredModel = std::make_unique<FilteredLogModel>(baseModel->getService(), filter);
-            filteredModel->goToTime(baseModel->getCurrentTime());
+            evaluate(first, last);
         }
+    }
 
-        QSortFilterProxyModel::setSourceModel(filteredModel.get());
-        clearFilters();
-        invalidateFilter();
+    if (query)
+    {
+        std::vector<int> indexes;
+        std::vector<const LogEntry*> batch;
+        model.forEachEntry(first, last, [&rows, &indexes, &batch, first](int row, const LogEntry& entry) {
+            if (!rows[row - first])
+                return;
+            indexes.push_back(row - first);
+            batch.push_back(&entry);
+        });
+
+        auto accepted = query->evaluate(batch);
+        for (size_t i = 0; i < indexes.size(); ++i)
+            rows[indexes[i]] = accepted[i];
     }
 
-    emit sourceModelChanged(filteredModel.get());
+    return rows;
+}
+
+std::vector<LogFilterModel::RowPredicate> LogFilterModel::createRowPredicates(const LogModel& model) const
+{
+    std::vector<RowPredicate> predicates;
+
+    auto resolve = [&model](int column) {
+        RowPredicate predicate;
+        predicate.module = column == static_cast<int>(LogModel::PredefinedColumn::Module);
+        if (auto field = model.getColumnField(column))
+            predicate.field = field->name;
+        return predicate;
+    };
+
+    for (const auto& filter : variants)
+    {
+        auto predicate = resolve(filter.first);
+        predicate.variant = &filter.second;
+        predicates.push_back(std::move(predicate));
+    }
+
+    for (const auto& filter : columnFilters)
+    {
+        if (filter.second.regex.pattern().isEmpty())
+            continue;
+
+        filter.second.regex.optimize();
+        auto predicate = resolve(filter.first);
+        predicate.regex = &filter.second;
+        predicates.push_back(std::move(predicate));
+    }
+
+    return predicates;
+}
+
+bool LogFilterModel::acceptsEntry(const LogEntry& entry, const std::vector<RowPredicate>& predicates)
+{
+    for (const auto& predicate : predicates)
+    {
+        QString text;
+        if (predicate.module)
+        {
+            text = entry.module;
+        }
+        else
+        {
+            auto it = entry.values.find(predicate.field);
+            if (it != entry.values.end())
+                text = it->second.toString();
+        }
+
+        bool match = predicate.regex ? predicate.regex->regex.match(text).hasMatch() : predicate.variant->values.contains(text);
+        FilterType type = predicate.regex ? predicate.regex->type : predicate.variant->type;
+        if (match != (type == FilterType::Whitelist))
+            return false;
+    }
+    return true;
 }
 
 void LogFilterModel::clearFilters()
 {
+    rowPredicates.clear();
     columnFilters.clear();
     variants.clear();
-    filterEstimates.clear();
+    query.reset();
 }
@@ -1,13 +1,16 @@
 #pragma once
 
 #include "LogFilter.h"
+#include "SelectivityEstimator.h"
 
 #include <QSortFilterProxyModel>
 #include <QRegularExpression>
+#include <QThreadPool>
 
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 class LogModel;
 class FilteredLogModel;
@@ -25,6 +28,7 @@ public:
     void setVariantList(int column, const QStringList& values);
     void setFilterMode(int column, FilterType type);
     FilterType filterMode(int column) const;
+    void setQuery(const QString& text);
 
     void setSourceModel(QAbstractItemModel* sourceModel) override;
 
@@ -39,14 +43,40 @@ signals:
     void sourceModelChanged(QAbstractItemModel* model);
 
 private:
+    struct RowPredicate
+    {
+        QString field;
+        bool module = false;
+        const RegexFilter* regex = nullptr;
+        const VariantFilter* variant = nullptr;
+    };
+
+    static constexpr int ParallelRowThreshold = 4096;
+
     void updateSourceModel();
+    void setProxySourceModel(QAbstractItemModel* model);
     void clearFilters();
 
+    void refilter();
+    void updateRows(int first, int last);
+    void insertRows(int first, int last);
+    void removeRows(int first, int last);
+    std::vector<char> evaluateRows(const LogModel& model, int first, int last) const;
+    std::vector<RowPredicate> createRowPredicates(const LogModel& model) const;
+    static bool acceptsEntry(const LogEntry& entry, const std::vector<RowPredicate>& predicates);
+
     std::unordered_map<int, RegexFilter> columnFilters;
     std::unordered_map<int, VariantFilter> variants;
-    std::unordered_map<int, double> filterEstimates;
     std::unordered_map<int, FilterType> filterTypes;
+    std::shared_ptr<const LogQuery> query;
+    std::vector<RowPredicate> rowPredicates;
+    std::vector<char> acceptedRows;
+    std::vector<QMetaObject::Connection> cacheConnections;
+    QMetaObject::Connection samplesConnection;
 
     LogModel* baseModel = nullptr;
     std::unique_ptr<FilteredLogModel> filteredModel;
+    std::unique_ptr<SelectivityEstimator> estimator;
+    // Owned so that the GUI thread waiting on it never queues behind other users of the global pool
+    mutable QThreadPool rowPool;
 };
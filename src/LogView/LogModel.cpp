@@ -5,11 +5,15 @@
 #include "Utils.h"
 #include "ScopeGuard.h"
 #include "../LogManagement/FilteredLogIterator.h"
+#include "../LogManagement/LogUtils.h"
+#include "../LogManagement/SnapshotLog.h"
 
+#include <QFileInfo>
 #include <QFontDatabase>
 #include <QBrush>
 #include <QColor>
 #include <algorithm>
+#include <cmath>
 
 
 LogModel::LogModel(SessionService* sessionService, QObject *parent) :
@@ -18,8 +22,10 @@ LogModel::LogModel(SessionService* sessionService, QObject *parent) :
     startTime(DateTimeFromChronoSystemClock(sessionService->getSession()->getMinTime())),
     endTime(DateTimeFromChronoSystemClock(sessionService->getSession()->getMaxTime())),
     modules(sessionService->getSession()->getModules()),
+    checkpoints(sessionService->getSession()->getCheckpointStore()),
     blockSize(loadBlockSize()),
-    blockCount(loadBlockCount())
+    blockCount(loadBlockCount()),
+    prefetchDepth(loadPrefetchDepth())
 {
     connect(service, &SessionService::iteratorCreated, this, &LogModel::handleIterator);
     connect(service, &SessionService::dataLoaded, this, &LogModel::handleData);
@@ -47,6 +53,30 @@ LogModel::LogModel(SessionService* sessionService, QObject *parent) :
             fields.push_back(field);
         }
     }
+
+    // Only the part of each file inside the session range counts. Compressed files have no byte size
+    // comparable to their entries and are left out, snapshots know their row count.
+    auto session = sessionService->getSession();
+    auto sessionStart = session->getMinTime();
+    auto sessionEnd = session->getMaxTime();
+    for (const auto& file : session->getFileSpans())
+    {
+        auto start = std::max(file.start, sessionStart);
+        auto end = std::min(file.end, sessionEnd);
+        if (end <= start || file.end <= file.start)
+            continue;
+
+        double fraction = std::chrono::duration<double>(end - start) / std::chrono::duration<double>(file.end - file.start);
+        if (file.metadata.snapshot)
+        {
+            sessionRows += static_cast<qint64>(file.metadata.snapshot->size() * fraction);
+            continue;
+        }
+
+        QFileInfo info(file.metadata.filename);
+        if (info.isFile() && info.suffix().compare("gz", Qt::CaseInsensitive) != 0)
+            sessionBytes += static_cast<qint64>(info.size() * fraction);
+    }
 }
 
 void LogModel::goToTime(const QDateTime& time)
@@ -57,23 +87,13 @@ void LogModel::goToTime(const QDateTime& time)
 void LogModel::goToTime(const std::chrono::system_clock::time_point& time)
 {
     if (!logs.empty() &&
-        ((time >= logs.begin()->entry.time && time <= logs.back().entry.time) ||
+        ((time >= logs.front().time && time <= logs.back().time) ||
          (time < ChronoSystemClockFromDateTime(getStartTime()) && reverseIterator && !reverseIterator->hasLogs()) ||
          (time > ChronoSystemClockFromDateTime(getEndTime()) && iterator && !iterator->hasLogs())))
     {
         qDebug() << "LogModel::goToTime: requested time is already in the current range.";
-        QModelIndex index;
-        for (size_t i = 0; i < logs.size(); ++i)
-        {
-            if (logs[i].entry.time >= time)
-            {
-                index = createIndex(i, 0);
-                break;
-            }
-        }
-        if (!index.isValid())
-            index = createIndex(logs.size() - 1, 0);
-        requestedTimeAvailable(index);
+        size_t row = std::min(logs.lowerBound(time), logs.size() - 1);
+        requestedTimeAvailable(createIndex(row, 0));
         return;
     }
 
@@ -85,6 +105,7 @@ void LogModel::goToTime(const std::chrono::system_clock::time_point& time)
     });
 
     logs.clear();
+    skipDataRequests();
     requestedTime = DateTimeFromChronoSystemClock(time);
 
     const MergeHeapCache* upperEntryCache = nullptr;
@@ -137,7 +158,7 @@ void LogModel::goToTime(const std::chrono::system_clock::time_point& time)
         MergeHeapCache newCache{ ChronoSystemClockFromDateTime(getStartTime()) };
         iterator = createIterator<true>(newCache, ChronoSystemClockFromDateTime(startTime), ChronoSystemClockFromDateTime(endTime));
         reverseIterator = createIterator<false>(newCache, ChronoSystemClockFromDateTime(startTime), ChronoSystemClockFromDateTime(endTime));
-        dataRequests[service->requestLogEntries(iterator, blockSize)] = DataRequestType::ReplaceForward;
+        dataRequests[service->requestLogEntries(getRequestIterator(), blockSize)] = DataRequestType::ReplaceForward;
         entryCache.emplace(std::move(newCache));
     }
     else if (time >= ChronoSystemClockFromDateTime(getEndTime()))
@@ -145,7 +166,7 @@ void LogModel::goToTime(const std::chrono::system_clock::time_point& time)
         MergeHeapCache newCache{ ChronoSystemClockFromDateTime(getEndTime()) };
         iterator = createIterator<true>(newCache, ChronoSystemClockFromDateTime(startTime), ChronoSystemClockFromDateTime(endTime));
         reverseIterator = createIterator<false>(newCache, ChronoSystemClockFromDateTime(startTime), ChronoSystemClockFromDateTime(endTime));
-        dataRequests[service->requestLogEntries(reverseIterator, blockSize)] = DataRequestType::ReplaceBackward;
+        dataRequests[service->requestLogEntries(getRequestReverseIterator(), blockSize)] = DataRequestType::ReplaceBackward;
         entryCache.emplace(std::move(newCache));
     }
     else
@@ -161,22 +182,20 @@ std::chrono::system_clock::time_point LogModel::getCurrentTime() const
 
 bool LogModel::canFetchUpMore() const
 {
+    if (prefetchType == DataRequestType::Prepend && !prefetchedBlocks.empty())
+        return true;
     return reverseIterator && reverseIterator->hasLogs();
 }
 
 void LogModel::fetchUpMore()
 {
-    fetchUpMoreImpl(reverseIterator);
-}
-
-void LogModel::fetchUpMore(const LogFilter& filter)
-{
-    auto filteredIterator = std::make_shared<FilteredLogIterator<false>>(reverseIterator, filter);
-    fetchUpMoreImpl(filteredIterator);
+    fetchUpMoreImpl(getRequestReverseIterator());
 }
 
 bool LogModel::canFetchDownMore() const
 {
+    if (prefetchType == DataRequestType::Append && !prefetchedBlocks.empty())
+        return true;
     return iterator && iterator->hasLogs();
 }
 
@@ -185,15 +204,40 @@ bool LogModel::isFulled() const
     return logs.size() >= static_cast<size_t>(blockSize * blockCount);
 }
 
+int LogModel::getBlockSize() const
+{
+    return blockSize;
+}
+
+void LogModel::setScrollVelocity(double rowsPerSecond)
+{
+    scrollVelocity = rowsPerSecond;
+    scrollVelocityTime = std::chrono::steady_clock::now();
+
+    auto direction = getScrollDirection();
+    if (direction != DataRequestType::None && direction != prefetchType)
+        discardPrefetchedBlocks();
+}
+
 void LogModel::fetchDownMore()
 {
-    fetchDownMoreImpl(iterator);
+    fetchDownMoreImpl(getRequestIterator());
 }
 
-void LogModel::fetchDownMore(const LogFilter& filter)
+void LogModel::setIteratorFilter(const LogFilter& filter)
 {
-    auto filteredIterator = std::make_shared<FilteredLogIterator<>>(iterator, filter);
-    fetchDownMoreImpl(filteredIterator);
+    auto compiledFilter = std::make_shared<const CompiledLogFilter>(filter.compile());
+    entryFilter = compiledFilter;
+    preFilter = compiledFilter->createPreFilter();
+    blockFilter = filter.createBlockFilter();
+    moduleFilter = [compiledFilter](const QString& module) { return compiledFilter->acceptsModule(module); };
+
+    skipDataRequests();
+    iterator.reset();
+    reverseIterator.reset();
+    filteredIterator.reset();
+    filteredReverseIterator.reset();
+    entryCache.clear();
 }
 
 const std::vector<Format::Field>& LogModel::getFields() const
@@ -201,16 +245,81 @@ const std::vector<Format::Field>& LogModel::getFields() const
     return fields;
 }
 
-const std::unordered_set<QVariant, VariantHash> LogModel::availableValues(int section) const
+const LogEntry& LogModel::getEntry(int row) const
+{
+    return logs[row];
+}
+
+qint64 LogModel::getEstimatedRowCount() const
+{
+    if (logs.empty() || (sessionBytes <= 0 && sessionRows <= 0) || (!canFetchUpMore() && !canFetchDownMore()))
+        return logs.size();
+
+    constexpr size_t SampleCount = 256;
+    size_t step = std::max<size_t>(1, logs.size() / SampleCount);
+
+    // Entry sizes as they are stored in the files, not in UTF-16 units
+    std::unordered_map<QString, int> encodingWidths;
+    auto getEncodedSize = [this, &encodingWidths](const LogEntry& entry) -> qint64 {
+        auto it = encodingWidths.find(entry.module);
+        if (it == encodingWidths.end())
+        {
+            auto format = service->getSession()->getFormat(entry.module);
+            int width = format && format->encoding ? getEncodingWidth(format->encoding.value()) : 1;
+            bool utf8 = !format || !format->encoding || format->encoding.value() == QStringConverter::Utf8;
+            it = encodingWidths.emplace(entry.module, utf8 ? 0 : width).first;
+        }
+
+        qint64 length = entry.line.size() + entry.additionalLines.size() + 1;
+        if (it->second > 0)
+            return length * it->second;
+        return entry.line.toUtf8().size() + entry.additionalLines.toUtf8().size() + 1;
+    };
+
+    qint64 sampledBytes = 0;
+    size_t sampled = 0;
+    for (size_t i = 0; i < logs.size(); i += step, ++sampled)
+        sampledBytes += getEncodedSize(logs[i]);
+
+    double bytesPerEntry = std::max(1.0, static_cast<double>(sampledBytes) / sampled);
+    return std::max<qint64>(sessionBytes / bytesPerEntry + sessionRows, logs.size());
+}
+
+double LogModel::getTimePosition(const std::chrono::system_clock::time_point& time) const
+{
+    auto start = ChronoSystemClockFromDateTime(startTime);
+    auto end = ChronoSystemClockFromDateTime(endTime);
+    if (end <= start)
+        return 0.0;
+
+    double position = std::chrono::duration<double>(time - start) / std::chrono::duration<double>(end - start);
+    return std::clamp(position, 0.0, 1.0);
+}
+
+std::chrono::system_clock::time_point LogModel::getTimeAtPosition(double position) const
+{
+    auto start = ChronoSystemClockFromDateTime(startTime);
+    auto end = ChronoSystemClockFromDateTime(endTime);
+    auto offset = std::chrono::duration_cast<std::chrono::system_clock::duration>((end - start) * std::clamp(position, 0.0, 1.0));
+    return start + offset;
+}
+
+const Format::Field* LogModel::getColumnField(int column) const
+{
+    if (column < 0 || column >= columnCount() || column == static_cast<int>(PredefinedColumn::Module))
+        return nullptr;
+    return &getField(column);
+}
+
+std::vector<QVariant> LogModel::availableValues(int section) const
 {
     if (section < 0 || section >= columnCount())
         return {};
 
     if (section == static_cast<int>(PredefinedColumn::Module))
     {
-        std::unordered_set<QVariant, VariantHash> res;
-        for (const auto& module : modules)
-            res.emplace(module);
+        std::vector<QVariant> res(modules.begin(), modules.end());
+        std::sort(res.begin(), res.end(), [](const QVariant& lhs, const QVariant& rhs) { return lhs.toString() < rhs.toString(); });
         return res;
     }
 
@@ -218,7 +327,10 @@ const std::unordered_set<QVariant, VariantHash> LogModel::availableValues(int se
     if (!field.isEnum)
         return {};
 
-    return service->getEnumList(field.name);
+    std::vector<QVariant> res;
+    for (auto& counter : service->getFrequentValues(field.name))
+        res.push_back(std::move(counter.value));
+    return res;
 }
 
 QDateTime convertToQDateTime(const std::chrono::system_clock::time_point& timePoint)
@@ -243,7 +355,18 @@ QDateTime LogModel::getFirstEntryTime() const
     if (logs.empty())
         return QDateTime();
 
-    return convertToQDateTime(logs.front().entry.time);
+    return convertToQDateTime(logs.front().time);
+}
+
+MergeHeapCache LogModel::getFirstEntryCache() const
+{
+    if (logs.empty())
+        return MergeHeapCache();
+
+    auto it = entryCache.find({ logs.front().time });
+    if (it == entryCache.end())
+        return MergeHeapCache();
+    return *it;
 }
 
 QDateTime LogModel::getLastEntryTime() const
@@ -251,7 +374,7 @@ QDateTime LogModel::getLastEntryTime() const
     if (logs.empty())
         return QDateTime();
 
-    return convertToQDateTime(logs.back().entry.time);
+    return convertToQDateTime(logs.back().time);
 }
 
 QStringList LogModel::getFieldsName()
@@ -298,7 +421,7 @@ QModelIndex LogModel::index(int row, int column, const QModelIndex& parent) cons
         if (column < 0 || column >= columnCount())
             return QModelIndex();
 
-        return createIndex(row, column, &logs[parent.row()].index);
+        return createIndex(row, column, &logs[parent.row()]);
     }
 
     if (row < 0 || row >= rowCount() || column < 0 || column >= columnCount())
@@ -313,7 +436,7 @@ QModelIndex LogModel::parent(const QModelIndex& index) const
         return QModelIndex();
 
     size_t parentIndex = getParentIndex(index);
-    if (parentIndex >= logs.size() || logs[parentIndex].entry.additionalLines.isEmpty() || index.column() < 0 || index.column() >= columnCount())
+    if (parentIndex >= logs.size() || logs[parentIndex].additionalLines.isEmpty() || index.column() < 0 || index.column() >= columnCount())
         return QModelIndex();
 
     return createIndex(parentIndex, 0);
@@ -332,7 +455,7 @@ int LogModel::rowCount(const QModelIndex& parent) const
             return 0;
         }
 
-        return logs[parent.row()].entry.additionalLines.isEmpty() ? 0 : 1;
+        return logs[parent.row()].additionalLines.isEmpty() ? 0 : 1;
     }
 
     return logs.size();
@@ -354,7 +477,7 @@ bool LogModel::hasChildren(const QModelIndex& parent) const
         }
 
         if (parent.internalPointer() == nullptr)
-            return !logs[parent.row()].entry.additionalLines.isEmpty();
+            return !logs[parent.row()].additionalLines.isEmpty();
         else
             return false;
     }
@@ -378,7 +501,7 @@ QVariant LogModel::data(const QModelIndex& index, int role) const
     case Qt::BackgroundRole:
     {
         const auto& log = index.internalPointer() ? logs[getParentIndex(index)] : logs[index.row()];
-        if (bookmarks.find(log.entry.time) != bookmarks.end())
+        if (bookmarks.find(log.time) != bookmarks.end())
             return QBrush(QColor(Qt::yellow));
         break;
     }
@@ -391,7 +514,7 @@ QVariant LogModel::data(const QModelIndex& index, int role) const
         if (index.internalPointer() != nullptr)
         {
             if (index.column() == columnCount() - 1)
-                return logs[getParentIndex(index)].entry.additionalLines;
+                return logs[getParentIndex(index)].additionalLines;
             else
                 return QVariant();
         }
@@ -400,36 +523,36 @@ QVariant LogModel::data(const QModelIndex& index, int role) const
 
         if (index.column() == static_cast<int>(PredefinedColumn::Module))
         {
-            return log.entry.module;
+            return log.module;
         }
         else
         {
             const auto& field = getField(index.column());
-            auto valueIt = log.entry.values.find(field.name);
-            if (valueIt != log.entry.values.end())
+            auto valueIt = log.values.find(field.name);
+            if (valueIt != log.values.end())
                 return valueIt->second;
         }
         break;
     }
     case static_cast<int>(MetaData::Line):
         if (index.internalPointer() == nullptr)
-            return logs[index.row()].entry.line;
+            return logs[index.row()].line;
         break;
     case static_cast<int>(MetaData::Message):
         if (index.internalPointer() == nullptr)
         {
             const auto& log = logs[index.row()];
             const auto& field = getField(index.column());
-            auto valueIt = log.entry.values.find(field.name);
-            if (valueIt != log.entry.values.end())
-                return valueIt->second.toString() + '\n' + logs[index.row()].entry.additionalLines;
+            auto valueIt = log.values.find(field.name);
+            if (valueIt != log.values.end())
+                return valueIt->second.toString() + '\n' + log.additionalLines;
         }
         break;
     case static_cast<int>(MetaData::Time):
         if (index.internalPointer() == nullptr)
         {
             const auto& log = logs[index.row()];
-            return QVariant::fromValue(log.entry.time);
+            return QVariant::fromValue(log.time);
         }
         break;
     }
@@ -460,18 +583,18 @@ void LogModel::toggleBookmark(const QModelIndex& index)
     if (row >= logs.size())
         return;
 
-    auto& item = logs[row];
-    auto it = bookmarks.find(item.entry.time);
+    const auto& item = logs[row];
+    auto it = bookmarks.find(item.time);
     if (it != bookmarks.end())
         bookmarks.erase(it);
     else
-        bookmarks.emplace(item.entry.time, item.entry);
+        bookmarks.emplace(item.time, item);
 
     auto top = this->index(row, 0);
     auto bottom = this->index(row, columnCount() - 1);
     emit dataChanged(top, bottom, { Qt::BackgroundRole });
 
-    if (!item.entry.additionalLines.isEmpty())
+    if (!item.additionalLines.isEmpty())
     {
         auto childTop = this->index(0, 0, top);
         auto childBottom = this->index(0, columnCount() - 1, top);
@@ -491,7 +614,7 @@ bool LogModel::isBookmarked(const QModelIndex& index) const
     if (row >= logs.size())
         return false;
 
-    return bookmarks.find(logs[row].entry.time) != bookmarks.end();
+    return bookmarks.find(logs[row].time) != bookmarks.end();
 }
 
 void LogModel::clearBookmarks()
@@ -521,10 +644,6 @@ std::vector<LogEntry> LogModel::getBookmarks() const
     result.reserve(bookmarks.size());
     for (const auto& pair : bookmarks)
         result.push_back(pair.second);
-    std::sort(result.begin(), result.end(), [](const LogEntry& a, const LogEntry& b)
-    {
-        return a.time < b.time;
-    });
     return result;
 }
 
@@ -549,7 +668,8 @@ void LogModel::handleIterator(int index, bool isStraight)
             }
 
             reverseIterator = createIterator<false>(newCache, ChronoSystemClockFromDateTime(startTime), ChronoSystemClockFromDateTime(endTime));
-            dataRequests[service->requestLogEntries(iterator, blockSize)] = DataRequestType::ReplaceForward;
+            dataRequests[service->requestLogEntries(getRequestIterator(), blockSize)] = DataRequestType::ReplaceForward;
+            publishCheckpoint(newCache);
 
             entryCache.emplace(std::move(newCache));
         }
@@ -567,7 +687,7 @@ void LogModel::handleIterator(int index, bool isStraight)
             }
 
             iterator = createIterator<true>(newCache, ChronoSystemClockFromDateTime(startTime), ChronoSystemClockFromDateTime(endTime));
-            dataRequests[service->requestLogEntries(reverseIterator, blockSize)] = DataRequestType::ReplaceBackward;
+            dataRequests[service->requestLogEntries(getRequestReverseIterator(), blockSize)] = DataRequestType::ReplaceBackward;
 
             entryCache.emplace(std::move(newCache));
         }
@@ -583,7 +703,22 @@ void LogModel::handleData(int index)
     if (requestType == DataRequestType::None)
         return;
 
+    if (requestType == DataRequestType::Discarded)
+    {
+        service->getResult(index);
+        service->getResultCache(index);
+        return;
+    }
+
+    if (requestType == DataRequestType::Append || requestType == DataRequestType::Prepend)
+    {
+        storePrefetchedBlock(index);
+        applyPrefetchedBlocks();
+        return;
+    }
+
     auto data = service->getResult(index);
+    auto newCache = service->getResultCache(index);
     if (data.empty())
     {
         qDebug() << "LogModel::handleData: no data received for index" << index;
@@ -592,216 +727,341 @@ void LogModel::handleData(int index)
 
     switch(requestType)
     {
-    case DataRequestType::Append:
-        if (logs.size() + data.size() > blockSize * blockCount)
-            startPageSwap();
+    case DataRequestType::ReplaceForward:
+    case DataRequestType::ReplaceBackward:
+    {
+        beginResetModel();
+        logs.clear();
 
-        beginInsertRows(QModelIndex(), logs.size(), logs.size() + data.size() - 1);
-        for (const auto& entry : data)
-        {
-            LogItem item;
-            item.entry = entry;
-            item.index = logs.size();
-            logs.push_back(item);
-        }
-        endInsertRows();
+        if (requestType == DataRequestType::ReplaceForward)
+            logs.append(std::move(data));
+        else
+            logs.prepend(std::move(data));
+        endResetModel();
 
-        if (iterator)
+        if (requestedTime.isValid())
         {
-            auto newCache = iterator->getCache();
-            auto placeIt = entryCache.lower_bound(newCache);
-            if (placeIt == entryCache.end() || placeIt->time != newCache.time)
-            {
-                auto it = entryCache.emplace_hint(placeIt, std::move(newCache));
-                if (it != entryCache.begin())
-                {
-                    --it;
-                    if (it->heap.empty())
-                    {
-                        it = entryCache.erase(it);
-                        auto emptyCacheTime = newCache.time;
-                        ++emptyCacheTime;
-                        entryCache.emplace_hint(placeIt, MergeHeapCache{ emptyCacheTime });
-                    }
-                }
-            }
-            else
-            {
-                --placeIt;
-                if (placeIt->heap.empty())
-                    entryCache.erase(placeIt);
-            }
+            size_t requestedEntry = logs.lowerBound(ChronoSystemClockFromDateTime(requestedTime));
+            if (requestedEntry < logs.size())
+                requestedTimeAvailable(createIndex(requestedEntry, 0));
         }
 
+        if (requestType == DataRequestType::ReplaceForward)
+            publishCheckpoint(newCache);
+        entryCache.emplace(std::move(newCache));
+
         if (logs.size() > blockSize * blockCount)
         {
-            qDebug() << "Logs size exceeds block count limit (" << blockSize * blockCount << ") and will be truncated at the beginning.";
-
-            decltype(entryCache)::iterator cacheIt;
-            if (reverseIterator)
-                cacheIt = entryCache.find({ reverseIterator->getCurrentTime() });
-            else
-                cacheIt = entryCache.begin();
+            qWarning() << "LogModel::handleData: logs size exceeds block count limit (" << blockSize * blockCount << ")";
+        }
+        else if (requestType == DataRequestType::ReplaceForward)
+        {
+            if (reverseIterator && reverseIterator->hasLogs())
+                requestBlock(DataRequestType::Prepend);
+            else if (iterator && iterator->hasLogs())
+                requestBlock(DataRequestType::Append);
+        }
+        else if (requestType == DataRequestType::ReplaceBackward)
+        {
+            if (iterator && iterator->hasLogs())
+                requestBlock(DataRequestType::Append);
+            else if (reverseIterator && reverseIterator->hasLogs())
+                requestBlock(DataRequestType::Prepend);
+        }
+        break;
+    }
 
-            if (cacheIt == entryCache.end())
-                qCritical() << "LogModel::handleData: no cache found for reverse iterator";
-            else if (++cacheIt != entryCache.end())
-                reverseIterator = createIterator<false>(*cacheIt, ChronoSystemClockFromDateTime(startTime), ChronoSystemClockFromDateTime(endTime));
+    default:
+        qWarning() << "LogModel::handleData: unexpected data request type:" << static_cast<int>(requestType);
+        break;
+    }
 
-            beginRemoveRows(QModelIndex(), 0, logs.size() - blockSize * blockCount - 1);
-            logs.erase(logs.begin(), logs.begin() + logs.size() - blockSize * blockCount);
-            for (size_t i = 0; i < logs.size(); ++i)
-                logs[i].index = i;
-            endRemoveRows();
+    QT_SLOT_END
+}
 
-            endPageSwap(logs.size() + data.size() - blockSize * blockCount);
-        }
-        break;
+void LogModel::appendBlock(std::vector<LogEntry> data, MergeHeapCache newCache)
+{
+    size_t dataSize = data.size();
+    if (logs.size() + dataSize > blockSize * blockCount)
+        startPageSwap();
 
-    case DataRequestType::Prepend:
-        if (logs.size() + data.size() > blockSize * blockCount)
-            startPageSwap();
+    beginInsertRows(QModelIndex(), logs.size(), logs.size() + dataSize - 1);
+    logs.append(std::move(data));
+    endInsertRows();
 
-        beginInsertRows(QModelIndex(), 0, data.size() - 1);
-        for (int i = 0; i < data.size(); ++i)
-        {
-            LogItem item;
-            item.entry = data[i];
-            item.index = data.size() - i - 1;
-            logs.push_front(item);
-        }
-        for (size_t i = data.size(); i < logs.size(); ++i)
-            logs[i].index = i;
-        endInsertRows();
+    publishCheckpoint(newCache);
 
-        if (reverseIterator)
+    auto placeIt = entryCache.lower_bound(newCache);
+    if (placeIt == entryCache.end() || placeIt->time != newCache.time)
+    {
+        auto it = entryCache.emplace_hint(placeIt, std::move(newCache));
+        if (it != entryCache.begin())
         {
-            auto newCache = reverseIterator->getCache();
-            auto placeIt = entryCache.lower_bound(newCache);
-            if (placeIt->time != newCache.time)
+            --it;
+            if (it->heap.empty())
             {
-                auto it = entryCache.emplace_hint(placeIt, std::move(newCache));
-                if (placeIt->heap.empty())
-                {
-                    entryCache.erase(placeIt);
-                    auto emptyCacheTime = newCache.time;
-                    --emptyCacheTime;
-                    entryCache.emplace_hint(it, MergeHeapCache{ emptyCacheTime });
-                }
-            }
-            else
-            {
-                ++placeIt;
-                if (placeIt->heap.empty())
-                    entryCache.erase(placeIt);
+                it = entryCache.erase(it);
+                auto emptyCacheTime = newCache.time;
+                ++emptyCacheTime;
+                entryCache.emplace_hint(placeIt, MergeHeapCache{ emptyCacheTime });
             }
         }
+    }
+    else
+    {
+        --placeIt;
+        if (placeIt->heap.empty())
+            entryCache.erase(placeIt);
+    }
 
-        if (logs.size() > blockSize * blockCount)
-        {
-            qDebug() << "Logs size exceeds block count limit (" << blockSize * blockCount << ") and will be truncated at the end.";
+    if (logs.size() > blockSize * blockCount)
+    {
+        qDebug() << "Logs size exceeds block count limit (" << blockSize * blockCount << ") and will be truncated at the beginning.";
 
-            decltype(entryCache)::iterator cacheIt;
-            if (iterator)
-                cacheIt = entryCache.find({ iterator->getCurrentTime() });
-            else
-                cacheIt = entryCache.end();
+        decltype(entryCache)::iterator cacheIt;
+        if (reverseIterator)
+            cacheIt = entryCache.find({ reverseIterator->getCurrentTime() });
+        else
+            cacheIt = entryCache.begin();
 
-            if (cacheIt != entryCache.begin())
-                --cacheIt;
+        if (cacheIt == entryCache.end())
+            qCritical() << "LogModel::handleData: no cache found for reverse iterator";
+        else if (++cacheIt != entryCache.end())
+            reverseIterator = createIterator<false>(*cacheIt, ChronoSystemClockFromDateTime(startTime), ChronoSystemClockFromDateTime(endTime));
 
-            if (cacheIt != entryCache.end())
-                iterator = createIterator<true>(*cacheIt, cacheIt->time, ChronoSystemClockFromDateTime(endTime));
+        beginRemoveRows(QModelIndex(), 0, logs.size() - blockSize * blockCount - 1);
+        logs.removeFront(logs.size() - blockSize * blockCount);
+        endRemoveRows();
 
-            beginRemoveRows(QModelIndex(), blockSize * blockCount, logs.size() - 1);
-            logs.erase(logs.begin() + blockSize * blockCount, logs.end());
-            endRemoveRows();
+        endPageSwap(logs.size() + dataSize - blockSize * blockCount);
+    }
+}
 
-            endPageSwap(blockSize * blockCount - data.size() - logs.size());
-        }
-        break;
+void LogModel::prependBlock(std::vector<LogEntry> data, MergeHeapCache newCache)
+{
+    size_t dataSize = data.size();
+    if (logs.size() + dataSize > blockSize * blockCount)
+        startPageSwap();
 
-    case DataRequestType::ReplaceForward:
-    case DataRequestType::ReplaceBackward:
-    {
-        beginResetModel();
-        logs.clear();
+    beginInsertRows(QModelIndex(), 0, dataSize - 1);
+    logs.prepend(std::move(data));
+    endInsertRows();
 
-        if (requestType == DataRequestType::ReplaceForward)
+    auto placeIt = entryCache.lower_bound(newCache);
+    if (placeIt->time != newCache.time)
+    {
+        auto it = entryCache.emplace_hint(placeIt, std::move(newCache));
+        if (placeIt->heap.empty())
         {
-            for (int i = 0; i < data.size(); ++i)
-            {
-                LogItem item;
-                item.entry = data[i];
-                item.index = logs.size();
-                logs.push_back(item);
-            }
+            entryCache.erase(placeIt);
+            auto emptyCacheTime = newCache.time;
+            --emptyCacheTime;
+            entryCache.emplace_hint(it, MergeHeapCache{ emptyCacheTime });
         }
+    }
+    else
+    {
+        ++placeIt;
+        if (placeIt->heap.empty())
+            entryCache.erase(placeIt);
+    }
+
+    if (logs.size() > blockSize * blockCount)
+    {
+        qDebug() << "Logs size exceeds block count limit (" << blockSize * blockCount << ") and will be truncated at the end.";
+
+        decltype(entryCache)::iterator cacheIt;
+        if (iterator)
+            cacheIt = entryCache.find({ iterator->getCurrentTime() });
         else
-        {
-            for (int i = 0; i < data.size(); ++i)
-            {
-                LogItem item;
-                item.entry = data[i];
-                item.index = data.size() - i - 1;
-                logs.push_front(item);
-            }
-        }
-        endResetModel();
+            cacheIt = entryCache.end();
 
-        if (requestedTime.isValid())
-        {
-            int requestedEntry = -1;
-            for (int i = 0; i < logs.size(); ++i)
-            {
-                std::chrono::system_clock::time_point requestedTimePoint = ChronoSystemClockFromDateTime(requestedTime);
-                if (logs[i].entry.time >= requestedTimePoint)
-                {
-                    requestedEntry = logs[i].index;
-                    break;
-                }
-            }
-            if (requestedEntry != -1)
-                requestedTimeAvailable(createIndex(requestedEntry, 0));
-        }
+        if (cacheIt != entryCache.begin())
+            --cacheIt;
 
-        if (iterator && requestType == DataRequestType::ReplaceForward)
-            entryCache.emplace(iterator->getCache());
-        else if (reverseIterator && requestType == DataRequestType::ReplaceBackward)
-            entryCache.emplace(reverseIterator->getCache());
+        if (cacheIt != entryCache.end())
+            iterator = createIterator<true>(*cacheIt, cacheIt->time, ChronoSystemClockFromDateTime(endTime));
 
-        if (logs.size() > blockSize * blockCount)
+        beginRemoveRows(QModelIndex(), blockSize * blockCount, logs.size() - 1);
+        logs.removeBack(logs.size() - blockSize * blockCount);
+        endRemoveRows();
+
+        endPageSwap(blockSize * blockCount - dataSize - logs.size());
+    }
+}
+
+void LogModel::skipDataRequests()
+{
+    for (auto& request : dataRequests)
+        request.second = DataRequestType::Discarded;
+
+    prefetchedBlocks.clear();
+    prefetchType = DataRequestType::None;
+    blocksToApply = 0;
+}
+
+bool LogModel::beginFetch(DataRequestType type)
+{
+    for (const auto& request : dataRequests)
+    {
+        if (request.second == DataRequestType::ReplaceForward || request.second == DataRequestType::ReplaceBackward)
+            return false;
+    }
+
+    if (prefetchType != type && !prefetchedBlocks.empty())
+    {
+        // Blocks still loading for the other side are only dropped when the user scrolls this way
+        bool loading = std::any_of(prefetchedBlocks.begin(), prefetchedBlocks.end(), [](const PrefetchedBlock& block) { return !block.loaded; });
+        if (loading && getScrollDirection() != type)
+            return false;
+        discardPrefetchedBlocks();
+    }
+
+    prefetchType = type;
+    blocksToApply = 1;
+    applyPrefetchedBlocks();
+    return true;
+}
+
+void LogModel::requestBlock(DataRequestType type)
+{
+    if (prefetchType != type)
+    {
+        discardPrefetchedBlocks();
+        prefetchType = type;
+    }
+
+    if (type == DataRequestType::Append)
+    {
+        if (prefetchedBlocks.empty())
         {
-            qWarning() << "LogModel::handleData: logs size exceeds block count limit (" << blockSize * blockCount << ")";
+            prefetchOrigin = iterator->getCache();
+            enqueueBlock(type, service->requestLogEntries(getRequestIterator(), blockSize), false);
         }
-        else if (requestType == DataRequestType::ReplaceForward)
+        else
         {
-            if (reverseIterator && reverseIterator->hasLogs())
-                dataRequests[service->requestLogEntries(reverseIterator, blockSize)] = DataRequestType::Prepend;
-            else if (iterator && iterator->hasLogs())
-                dataRequests[service->requestLogEntries(iterator, blockSize)] = DataRequestType::Append;
+            enqueueBlock(type, service->requestMoreLogEntries(getRequestIterator(), blockSize), false);
         }
-        else if (requestType == DataRequestType::ReplaceBackward)
+    }
+    else
+    {
+        if (prefetchedBlocks.empty())
         {
-            if (iterator && iterator->hasLogs())
-                dataRequests[service->requestLogEntries(iterator, blockSize)] = DataRequestType::Append;
-            else if (reverseIterator && reverseIterator->hasLogs())
-                dataRequests[service->requestLogEntries(reverseIterator, blockSize)] = DataRequestType::Prepend;
+            prefetchOrigin = reverseIterator->getCache();
+            enqueueBlock(type, service->requestLogEntries(getRequestReverseIterator(), blockSize), false);
+        }
+        else
+        {
+            enqueueBlock(type, service->requestMoreLogEntries(getRequestReverseIterator(), blockSize), false);
         }
-        break;
     }
 
-    default:
-        qWarning() << "LogModel::handleData: unexpected data request type:" << static_cast<int>(requestType);
-        break;
+    blocksToApply = 1;
+}
+
+void LogModel::enqueueBlock(DataRequestType type, int request, bool bounded)
+{
+    dataRequests[request] = type;
+
+    PrefetchedBlock block;
+    block.request = request;
+    block.bounded = bounded;
+    prefetchedBlocks.push_back(std::move(block));
+}
+
+bool LogModel::canPrefetchMore(DataRequestType type) const
+{
+    if (prefetchType != type || prefetchedBlocks.empty() || prefetchedBlocks.size() >= static_cast<size_t>(getPrefetchDepth(type)))
+        return false;
+
+    const auto& last = prefetchedBlocks.back();
+    return !last.bounded && !(last.loaded && last.entries.size() < static_cast<size_t>(blockSize));
+}
+
+int LogModel::getPrefetchDepth(DataRequestType type) const
+{
+    static constexpr double LookaheadSeconds = 2.0;
+
+    if (getScrollDirection() != type)
+        return 1;
+
+    int depth = 1 + static_cast<int>(std::ceil(std::abs(scrollVelocity) * LookaheadSeconds / blockSize));
+    return std::clamp(depth, 1, std::max(1, prefetchDepth));
+}
+
+LogModel::DataRequestType LogModel::getScrollDirection() const
+{
+    static constexpr auto VelocityTimeout = std::chrono::seconds(1);
+
+    if (scrollVelocity == 0 || std::chrono::steady_clock::now() - scrollVelocityTime > VelocityTimeout)
+        return DataRequestType::None;
+    return scrollVelocity > 0 ? DataRequestType::Append : DataRequestType::Prepend;
+}
+
+void LogModel::storePrefetchedBlock(int index)
+{
+    auto block = std::find_if(prefetchedBlocks.begin(), prefetchedBlocks.end(), [index](const PrefetchedBlock& block) { return block.request == index; });
+    if (block == prefetchedBlocks.end())
+    {
+        qWarning() << "LogModel::storePrefetchedBlock: no block found for index" << index;
+        service->getResult(index);
+        service->getResultCache(index);
+        return;
     }
 
-    QT_SLOT_END
+    block->entries = service->getResult(index);
+    block->cache = service->getResultCache(index);
+    block->loaded = true;
+
+    if (block->entries.size() < static_cast<size_t>(blockSize))
+    {
+        // The iterator is exhausted, requests queued after this one come back empty
+        for (auto it = std::next(block); it != prefetchedBlocks.end(); ++it)
+            dataRequests[it->request] = DataRequestType::Discarded;
+        prefetchedBlocks.erase(std::next(block), prefetchedBlocks.end());
+    }
 }
 
-void LogModel::skipDataRequests()
+void LogModel::applyPrefetchedBlocks()
 {
-    dataRequests.clear();
+    while (blocksToApply > 0 && !prefetchedBlocks.empty() && prefetchedBlocks.front().loaded)
+    {
+        auto block = std::move(prefetchedBlocks.front());
+        prefetchedBlocks.pop_front();
+        --blocksToApply;
+
+        prefetchOrigin = block.cache;
+        if (block.entries.empty())
+        {
+            qDebug() << "LogModel::applyPrefetchedBlocks: no data received for index" << block.request;
+            continue;
+        }
+
+        if (prefetchType == DataRequestType::Append)
+            appendBlock(std::move(block.entries), std::move(block.cache));
+        else
+            prependBlock(std::move(block.entries), std::move(block.cache));
+    }
+}
+
+void LogModel::discardPrefetchedBlocks()
+{
+    if (prefetchedBlocks.empty())
+        return;
+
+    for (const auto& block : prefetchedBlocks)
+    {
+        if (!block.loaded)
+            dataRequests[block.request] = DataRequestType::Discarded;
+    }
+    prefetchedBlocks.clear();
+    blocksToApply = 0;
+
+    // The iterator has already read past the dropped blocks, restart it at the edge of the window
+    if (prefetchType == DataRequestType::Append)
+        iterator = createIterator<true>(prefetchOrigin, prefetchOrigin.time, ChronoSystemClockFromDateTime(endTime));
+    else if (prefetchType == DataRequestType::Prepend)
+        reverseIterator = createIterator<false>(prefetchOrigin, ChronoSystemClockFromDateTime(startTime), ChronoSystemClockFromDateTime(endTime));
 }
 
 const Format::Field& LogModel::getField(int section) const
@@ -813,7 +1073,7 @@ const Format::Field& LogModel::getField(int section) const
 
 size_t LogModel::getParentIndex(const QModelIndex& index) const
 {
-    return *reinterpret_cast<size_t*>(index.internalPointer());
+    return logs.rowOf(static_cast<const LogEntry*>(index.internalPointer()));
 }
 
 LogModel::DataRequestType LogModel::handleDataRequest(int index)
@@ -843,6 +1103,30 @@ LogModel::Connection LogModel::detectConnection(const MergeHeapCache& entry) con
     return Connection::None;
 }
 
+const std::shared_ptr<FilteredLogIterator<true>>& LogModel::getRequestIterator()
+{
+    if (!iterator)
+        filteredIterator.reset();
+    else if (!filteredIterator || filteredIterator->getBase() != iterator)
+        filteredIterator = std::make_shared<FilteredLogIterator<true>>(iterator, entryFilter);
+    return filteredIterator;
+}
+
+const std::shared_ptr<FilteredLogIterator<false>>& LogModel::getRequestReverseIterator()
+{
+    if (!reverseIterator)
+        filteredReverseIterator.reset();
+    else if (!filteredReverseIterator || filteredReverseIterator->getBase() != reverseIterator)
+        filteredReverseIterator = std::make_shared<FilteredLogIterator<false>>(reverseIterator, entryFilter);
+    return filteredReverseIterator;
+}
+
+void LogModel::publishCheckpoint(const MergeHeapCache& checkpoint)
+{
+    if (shareCheckpoints && checkpoints)
+        checkpoints->add(checkpoint);
+}
+
 void LogModel::reinitIteratorsWithClosestTime(const MergeHeapCache& newCache, Connection connection)
 {
     switch (connection)
@@ -875,13 +1159,13 @@ void LogModel::reinitIteratorsWithClosestTime(const MergeHeapCache& newCache, Co
 
     if (iterator->hasLogs())
     {
-        dataRequests[service->requestLogEntries(iterator, blockSize)] = DataRequestType::ReplaceForward;
+        dataRequests[service->requestLogEntries(getRequestIterator(), blockSize)] = DataRequestType::ReplaceForward;
         if (reverseIterator->hasLogs())
-            dataRequests[service->requestLogEntries(reverseIterator, blockSize)] = DataRequestType::Prepend;
+            requestBlock(DataRequestType::Prepend);
     }
     else
     {
-        dataRequests[service->requestLogEntries(reverseIterator, blockSize)] = DataRequestType::ReplaceBackward;
+        dataRequests[service->requestLogEntries(getRequestReverseIterator(), blockSize)] = DataRequestType::ReplaceBackward;
     }
 }
 
@@ -910,3 +1194,16 @@ int LogModel::loadBlockCount()
         settings.setValue(LogViewSettings + BlockCountParameter, defaultSize);
     return defaultSize;
 }
+
+int LogModel::loadPrefetchDepth()
+{
+    static const int defaultDepth = 3;
+    static const QString PrefetchDepthParameter = "/prefetchDepth";
+
+    Settings settings;
+    if (settings.contains(LogViewSettings + PrefetchDepthParameter))
+        return settings.value(LogViewSettings + PrefetchDepthParameter, defaultDepth).toInt();
+    else
+        settings.setValue(LogViewSettings + PrefetchDepthParameter, defaultDepth);
+    return defaultDepth;
+}
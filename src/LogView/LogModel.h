@@ -1,12 +1,15 @@
 #pragma once
 
+#include "LogWindow.h"
 #include "services/SessionService.h"
 
 #include <QAbstractTableModel>
 #include <QRegularExpression>
 
+#include <chrono>
 #include <memory>
 #include <deque>
+#include <map>
 #include <set>
 #include <unordered_set>
 #include <unordered_map>
@@ -48,14 +51,33 @@ public:
 
     bool isFulled() const;
 
+    int getBlockSize() const;
+    void setScrollVelocity(double rowsPerSecond);
+
+    virtual qint64 getEstimatedRowCount() const;
+    double getTimePosition(const std::chrono::system_clock::time_point& time) const;
+    std::chrono::system_clock::time_point getTimeAtPosition(double position) const;
+
     const std::vector<Format::Field>& getFields() const;
-    const std::unordered_set<QVariant, VariantHash> availableValues(int section) const;
+    const LogEntry& getEntry(int row) const;
+    const Format::Field* getColumnField(int column) const;
+
+    template<typename Function>
+    void forEachEntry(int first, int last, Function&& function) const
+    {
+        for (int row = first; row < last; ++row)
+            function(row, logs[row]);
+    }
+    // Most frequent values first
+    std::vector<QVariant> availableValues(int section) const;
 
     QDateTime getStartTime() const;
     QDateTime getEndTime() const;
 
     QDateTime getFirstEntryTime() const;
     QDateTime getLastEntryTime() const;
+    // Merge position right before the first loaded entry, empty when the window has no boundary there
+    MergeHeapCache getFirstEntryCache() const;
 
     QStringList getFieldsName();
 
@@ -97,70 +119,99 @@ public slots:
     void handleData(int);
 
 protected:
-    void fetchUpMore(const LogFilter& filter);
-    void fetchDownMore(const LogFilter& filter);
+    // Iterators created after this skip what the filter rejects before parsing, rejected modules are never opened.
+    // Their positions lack those modules, so the positions collected so far are dropped.
+    void setIteratorFilter(const LogFilter& filter);
+
+protected:
+    // Positions of a filtered iterator skip rejected entries, so only unfiltered models may share them with the session
+    bool shareCheckpoints = true;
 
 private:
     template<typename Iterator>
     void fetchUpMoreImpl(const std::shared_ptr<Iterator>& it)
     {
-        if (!dataRequests.empty())
+        if (!beginFetch(DataRequestType::Prepend))
             return;
 
-        if (!it || !it->hasLogs())
+        if (!it)
             return;
 
-        auto cacheIt = entryCache.lower_bound({ it->getCurrentTime() });
-        if (cacheIt != entryCache.begin())
+        if (prefetchedBlocks.empty())
         {
-            --cacheIt;
-            if (cacheIt != entryCache.begin() && cacheIt->heap.empty())
+            if (!it->hasLogs())
+                return;
+
+            auto cacheIt = entryCache.lower_bound({ it->getCurrentTime() });
+            if (cacheIt != entryCache.begin())
+            {
                 --cacheIt;
-        }
-        else
-        {
-            cacheIt = entryCache.end();
+                if (cacheIt != entryCache.begin() && cacheIt->heap.empty())
+                    --cacheIt;
+            }
+            else
+            {
+                cacheIt = entryCache.end();
+            }
+
+            prefetchOrigin = it->getCache();
+            if (cacheIt == entryCache.end())
+                enqueueBlock(DataRequestType::Prepend, service->requestLogEntries(it, blockSize), false);
+            else
+                enqueueBlock(DataRequestType::Prepend, service->requestLogEntries(it, blockSize, cacheIt->time), true);
         }
 
-        if (cacheIt == entryCache.end())
-            dataRequests[service->requestLogEntries(it, blockSize)] = DataRequestType::Prepend;
-        else
-            dataRequests[service->requestLogEntries(it, blockSize, cacheIt->time)] = DataRequestType::Prepend;
+        while (canPrefetchMore(DataRequestType::Prepend))
+            enqueueBlock(DataRequestType::Prepend, service->requestMoreLogEntries(it, blockSize), false);
     }
 
     template<typename Iterator>
     void fetchDownMoreImpl(const std::shared_ptr<Iterator>& it)
     {
-        if (!dataRequests.empty())
+        if (!beginFetch(DataRequestType::Append))
             return;
 
-        if (!it || !it->hasLogs())
+        if (!it)
             return;
 
-        auto cacheIt = entryCache.upper_bound({ it->getCurrentTime() });
-        while (cacheIt != entryCache.end() && cacheIt->heap.empty())
-            ++cacheIt;
+        if (prefetchedBlocks.empty())
+        {
+            if (!it->hasLogs())
+                return;
+
+            auto cacheIt = entryCache.upper_bound({ it->getCurrentTime() });
+            while (cacheIt != entryCache.end() && cacheIt->heap.empty())
+                ++cacheIt;
+
+            prefetchOrigin = it->getCache();
+            if (cacheIt == entryCache.end())
+                enqueueBlock(DataRequestType::Append, service->requestLogEntries(it, blockSize), false);
+            else
+                enqueueBlock(DataRequestType::Append, service->requestLogEntries(it, blockSize, cacheIt->time), true);
+        }
 
-        if (cacheIt == entryCache.end())
-            dataRequests[service->requestLogEntries(it, blockSize)] = DataRequestType::Append;
-        else
-            dataRequests[service->requestLogEntries(it, blockSize, cacheIt->time)] = DataRequestType::Append;
+        while (canPrefetchMore(DataRequestType::Append))
+            enqueueBlock(DataRequestType::Append, service->requestMoreLogEntries(it, blockSize), false);
     }
 
 private:
-    struct LogItem
-    {
-        LogEntry entry;
-        size_t index;
-    };
-
     enum class DataRequestType
     {
         None,
         Append,
         Prepend,
         ReplaceForward,
-        ReplaceBackward
+        ReplaceBackward,
+        Discarded
+    };
+
+    struct PrefetchedBlock
+    {
+        int request;
+        bool bounded = false;
+        bool loaded = false;
+        std::vector<LogEntry> entries;
+        MergeHeapCache cache;
     };
 
     struct MergeHeapCacheComparator
@@ -176,6 +227,19 @@ private:
 private:
     void skipDataRequests();
 
+    bool beginFetch(DataRequestType type);
+    void requestBlock(DataRequestType type);
+    void enqueueBlock(DataRequestType type, int request, bool bounded);
+    bool canPrefetchMore(DataRequestType type) const;
+    int getPrefetchDepth(DataRequestType type) const;
+    DataRequestType getScrollDirection() const;
+    void storePrefetchedBlock(int index);
+    void applyPrefetchedBlocks();
+    void discardPrefetchedBlocks();
+
+    void appendBlock(std::vector<LogEntry> data, MergeHeapCache newCache);
+    void prependBlock(std::vector<LogEntry> data, MergeHeapCache newCache);
+
     const Format::Field& getField(int section) const;
 
     size_t getParentIndex(const QModelIndex& index) const;
@@ -189,17 +253,23 @@ private:
         Down
     };
     Connection detectConnection(const MergeHeapCache& entry) const;
+    void publishCheckpoint(const MergeHeapCache& checkpoint);
+
+    // Requests read through these, so a filtered iterator is made once per iterator and never changed while it loads
+    const std::shared_ptr<FilteredLogIterator<true>>& getRequestIterator();
+    const std::shared_ptr<FilteredLogIterator<false>>& getRequestReverseIterator();
     void reinitIteratorsWithClosestTime(const MergeHeapCache& newCache, Connection connection);
 
     template<bool straight>
     std::shared_ptr<LogEntryIterator<straight>> createIterator(const MergeHeapCache& cache, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime)
     {
-        return std::make_shared<LogEntryIterator<straight>>(service->getSession()->createIterator<straight>(cache, startTime, endTime));
+        return std::make_shared<LogEntryIterator<straight>>(service->getSession()->createIterator<straight>(cache, startTime, endTime, preFilter, blockFilter, moduleFilter));
     }
 
 private:
     static int loadBlockSize();
     static int loadBlockCount();
+    static int loadPrefetchDepth();
 
 private:
     SessionService* service;
@@ -211,20 +281,22 @@ private:
     std::shared_ptr<LogEntryIterator<true>> iterator;
     std::shared_ptr<LogEntryIterator<false>> reverseIterator;
 
+    std::shared_ptr<FilteredLogIterator<true>> filteredIterator;
+    std::shared_ptr<FilteredLogIterator<false>> filteredReverseIterator;
+
+    std::shared_ptr<const CompiledLogFilter> entryFilter;
+    LogEntryPreFilter preFilter;
+    LogBlockFilter blockFilter;
+    LogModuleFilter moduleFilter;
+
     std::unordered_map<int, DataRequestType> dataRequests;
 
     std::vector<Format::Field> fields;
     std::unordered_set<QString> modules;
-    std::deque<LogItem> logs;
+    std::shared_ptr<CheckpointStore> checkpoints;
+    LogWindow logs;
 
-    struct TimePointHash
-    {
-        size_t operator()(const std::chrono::system_clock::time_point& tp) const noexcept
-        {
-            return std::hash<long long>()(tp.time_since_epoch().count());
-        }
-    };
-    std::unordered_map<std::chrono::system_clock::time_point, LogEntry, TimePointHash> bookmarks;
+    std::map<std::chrono::system_clock::time_point, LogEntry> bookmarks;
 
     MergeHeapCacheContainer entryCache;
 
@@ -232,4 +304,16 @@ private:
 
     int blockSize = 2000;
     int blockCount = 4;
+
+    std::deque<PrefetchedBlock> prefetchedBlocks;
+    DataRequestType prefetchType = DataRequestType::None;
+    MergeHeapCache prefetchOrigin;
+    int blocksToApply = 0;
+    int prefetchDepth = 3;
+
+    double scrollVelocity = 0;
+    std::chrono::steady_clock::time_point scrollVelocityTime;
+
+    qint64 sessionBytes = 0;
+    qint64 sessionRows = 0;
 };
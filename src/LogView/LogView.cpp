@@ -3,6 +3,8 @@
 #include "FilterHeader.h"
 #include "LogModel.h"
 #include "LogFilterModel.h"
+#include "LogViewUtils.h"
+#include "Settings.h"
 #include "../Utils.h"
 
 #include <QScrollBar>
@@ -10,9 +12,21 @@
 #include <QMenu>
 #include <QAction>
 #include <QContextMenuEvent>
+#include <QCursor>
+#include <QSignalBlocker>
+#include <QToolTip>
 #include <algorithm>
+#include <cstdlib>
+#include <limits>
 
 
+namespace
+{
+
+const QString VirtualScrollingParameter = "/virtualScrolling";
+
+}
+
 LogView::LogView(QWidget* parent) : QTreeView(parent)
 {
     setHeader(new FilterHeader(Qt::Horizontal, this));
@@ -20,6 +34,9 @@ LogView::LogView(QWidget* parent) : QTreeView(parent)
 
     connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &LogView::checkFetchNeeded);
     connect(verticalScrollBar(), &QScrollBar::rangeChanged, this, &LogView::checkFetchNeeded);
+    connect(verticalScrollBar(), &QScrollBar::actionTriggered, this, &LogView::trackScrollVelocity);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &LogView::updateSessionScrollBar);
+    connect(verticalScrollBar(), &QScrollBar::rangeChanged, this, &LogView::updateSessionScrollBar);
 
     connect(static_cast<FilterHeader*>(header()), &FilterHeader::handleError, this, &LogView::handleError);
 }
@@ -61,6 +78,40 @@ void LogView::setLogModel(QAbstractItemModel* newModel)
     connect(currentLogModel, &LogModel::rowsRemoved, this, &LogView::handleFirstLineRemoving);
 }
 
+void LogView::setSessionScrollBar(QScrollBar* scrollBar)
+{
+    if (sessionScrollBar)
+        disconnect(sessionScrollBar, nullptr, this, nullptr);
+
+    sessionScrollBar = scrollBar;
+    if (sessionScrollBar)
+    {
+        connect(sessionScrollBar, &QScrollBar::actionTriggered, this, &LogView::handleSessionScrollAction);
+        connect(sessionScrollBar, &QScrollBar::sliderReleased, this, &LogView::handleSessionSliderReleased);
+    }
+
+    setVirtualScrolling(loadVirtualScrolling());
+}
+
+void LogView::setVirtualScrolling(bool enabled)
+{
+    virtualScrolling = enabled && sessionScrollBar;
+
+    Settings settings;
+    settings.setValue(LogViewSettings + VirtualScrollingParameter, enabled);
+
+    setVerticalScrollBarPolicy(virtualScrolling ? Qt::ScrollBarAlwaysOff : Qt::ScrollBarAsNeeded);
+    if (sessionScrollBar)
+        sessionScrollBar->setVisible(virtualScrolling);
+
+    updateSessionScrollBar();
+}
+
+bool LogView::isVirtualScrolling() const
+{
+    return virtualScrolling;
+}
+
 void LogView::bookmarkActivated(const std::chrono::system_clock::time_point& time)
 {
     QT_SLOT_BEGIN
@@ -118,6 +169,38 @@ void LogView::checkFetchNeeded()
     QT_SLOT_END
 }
 
+void LogView::trackScrollVelocity(int action)
+{
+    QT_SLOT_BEGIN
+
+    static constexpr qint64 MaxInterval = 500;
+
+    if (!currentLogModel || action == QAbstractSlider::SliderNoAction)
+        return;
+
+    // Only user actions land here, the jumps made while swapping pages do not count as scrolling
+    QScrollBar* sb = verticalScrollBar();
+    double delta = sb->sliderPosition() - sb->value();
+    if (verticalScrollMode() == QAbstractItemView::ScrollPerPixel)
+        delta /= std::max(1, rowHeight(indexAt(QPoint{ 0, 0 })));
+
+    qint64 elapsed = MaxInterval;
+    if (scrollTimer.isValid())
+        elapsed = std::clamp<qint64>(scrollTimer.restart(), 1, MaxInterval);
+    else
+        scrollTimer.start();
+
+    double velocity = delta * 1000.0 / elapsed;
+    if (elapsed >= MaxInterval || velocity * scrollVelocity <= 0)
+        scrollVelocity = velocity;
+    else
+        scrollVelocity = (scrollVelocity + velocity) / 2;
+
+    currentLogModel->setScrollVelocity(scrollVelocity);
+
+    QT_SLOT_END
+}
+
 void LogView::handleFirstDataLoaded()
 {
     QT_SLOT_BEGIN
@@ -232,6 +315,107 @@ void LogView::handleFirstLineAddition(const QModelIndex& parent, int first, int
     QT_SLOT_END
 }
 
+void LogView::updateSessionScrollBar()
+{
+    QT_SLOT_BEGIN
+
+    if (!virtualScrolling || !currentLogModel || !model())
+        return;
+
+    QModelIndex top = indexAt(QPoint{ 0, 0 });
+    int pageRows = std::max(1, viewport()->height() / std::max(1, rowHeight(top)));
+    qint64 totalRows = std::min<qint64>(currentLogModel->getEstimatedRowCount(), std::numeric_limits<int>::max() / 2);
+    int maximum = static_cast<int>(std::max<qint64>(0, totalRows - pageRows));
+
+    auto* proxyModel = qobject_cast<QAbstractProxyModel*>(model());
+    if (proxyModel && top.isValid())
+        top = proxyModel->mapToSource(top);
+    if (top.isValid() && top.parent().isValid())
+        top = top.parent();
+
+    QSignalBlocker blocker(sessionScrollBar);
+    sessionScrollBar->setRange(0, maximum);
+    sessionScrollBar->setPageStep(pageRows);
+    if (top.isValid() && !sessionScrollBar->isSliderDown())
+        sessionScrollBar->setValue(qRound(currentLogModel->getTimePosition(currentLogModel->getEntry(top.row()).time) * maximum));
+
+    QT_SLOT_END
+}
+
+void LogView::handleSessionScrollAction(int action)
+{
+    QT_SLOT_BEGIN
+
+    switch (action)
+    {
+    case QAbstractSlider::SliderSingleStepAdd:
+    case QAbstractSlider::SliderSingleStepSub:
+    case QAbstractSlider::SliderPageStepAdd:
+    case QAbstractSlider::SliderPageStepSub:
+        verticalScrollBar()->triggerAction(static_cast<QAbstractSlider::SliderAction>(action));
+        sessionScrollBar->setSliderPosition(sessionScrollBar->value());
+        break;
+
+    case QAbstractSlider::SliderMove:
+    {
+        int delta = sessionScrollBar->sliderPosition() - sessionScrollBar->value();
+        if (sessionScrollBar->isSliderDown())
+        {
+            if (currentLogModel && sessionScrollBar->maximum() > 0)
+            {
+                auto time = currentLogModel->getTimeAtPosition(static_cast<double>(sessionScrollBar->sliderPosition()) / sessionScrollBar->maximum());
+                QToolTip::showText(QCursor::pos(), DateTimeFromChronoSystemClock(time).toString("yyyy-MM-dd HH:mm:ss.zzz"), sessionScrollBar);
+            }
+        }
+        else if (std::abs(delta) <= sessionScrollBar->pageStep())
+        {
+            verticalScrollBar()->setValue(verticalScrollBar()->value() + delta * verticalScrollBar()->singleStep());
+            sessionScrollBar->setSliderPosition(sessionScrollBar->value());
+        }
+        else
+        {
+            jumpToSessionPosition(sessionScrollBar->sliderPosition());
+        }
+        break;
+    }
+
+    case QAbstractSlider::SliderToMinimum:
+    case QAbstractSlider::SliderToMaximum:
+        jumpToSessionPosition(sessionScrollBar->sliderPosition());
+        break;
+    }
+
+    QT_SLOT_END
+}
+
+void LogView::handleSessionSliderReleased()
+{
+    QT_SLOT_BEGIN
+
+    QToolTip::hideText();
+    jumpToSessionPosition(sessionScrollBar->sliderPosition());
+
+    QT_SLOT_END
+}
+
+void LogView::jumpToSessionPosition(int position)
+{
+    if (!currentLogModel || sessionScrollBar->maximum() <= 0)
+        return;
+
+    currentLogModel->goToTime(currentLogModel->getTimeAtPosition(static_cast<double>(position) / sessionScrollBar->maximum()));
+}
+
+bool LogView::loadVirtualScrolling()
+{
+    Settings settings;
+    if (settings.contains(LogViewSettings + VirtualScrollingParameter))
+        return settings.value(LogViewSettings + VirtualScrollingParameter, false).toBool();
+    else
+        settings.setValue(LogViewSettings + VirtualScrollingParameter, false);
+    return false;
+}
+
 void LogView::scrollContentsBy(int dx, int dy)
 {
     QTreeView::scrollContentsBy(dx, dy);
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <QAbstractItemModel>
+#include <QElapsedTimer>
 #include <QTreeView>
 #include <chrono>
 
 class QContextMenuEvent;
+class QScrollBar;
 
 class LogModel;
 class LogFilterModel;
@@ -19,6 +21,10 @@ public:
 
     void setLogModel(QAbstractItemModel* model);
 
+    void setSessionScrollBar(QScrollBar* scrollBar);
+    void setVirtualScrolling(bool enabled);
+    bool isVirtualScrolling() const;
+
 public slots:
     void bookmarkActivated(const std::chrono::system_clock::time_point& time);
     void requestedItemHandle(const QModelIndex& index);
@@ -28,6 +34,7 @@ signals:
 
 private slots:
     void checkFetchNeeded();
+    void trackScrollVelocity(int action);
     void handleFirstDataLoaded();
     void handleReset();
 
@@ -35,12 +42,26 @@ private slots:
     void handleFirstLineRemoving(const QModelIndex& parent, int first, int last);
     void handleFirstLineAddition(const QModelIndex& parent, int first, int last);
 
+    void updateSessionScrollBar();
+    void handleSessionScrollAction(int action);
+    void handleSessionSliderReleased();
+
 private:
     virtual void scrollContentsBy(int dx, int dy) override;
     void contextMenuEvent(QContextMenuEvent* event) override;
 
+    void jumpToSessionPosition(int position);
+
+    static bool loadVirtualScrolling();
+
 private:
     std::optional<QModelIndex> lastScrollPosition;
     LogModel* currentLogModel = nullptr;
     LogFilterModel* currentProxyModel = nullptr;
+
+    QScrollBar* sessionScrollBar = nullptr;
+    bool virtualScrolling = false;
+
+    QElapsedTimer scrollTimer;
+    double scrollVelocity = 0;
 };
@@ -0,0 +1,151 @@
+#include "LogWindow.h"
+
+#include <algorithm>
+#include <functional>
+
+
+size_t LogWindow::size() const
+{
+    return rows;
+}
+
+bool LogWindow::empty() const
+{
+    return rows == 0;
+}
+
+void LogWindow::clear()
+{
+    blocks.clear();
+    rows = 0;
+}
+
+const LogEntry& LogWindow::operator[](size_t row) const
+{
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), row, [](size_t value, const Block& block) {
+        return value < block.row;
+    });
+    --it;
+    return it->entries[it->first + row - it->row];
+}
+
+const LogEntry& LogWindow::front() const
+{
+    return blocks.front().entries[blocks.front().first];
+}
+
+const LogEntry& LogWindow::back() const
+{
+    return blocks.back().entries.back();
+}
+
+void LogWindow::append(std::vector<LogEntry> entries)
+{
+    if (entries.empty())
+        return;
+
+    Block block;
+    block.row = rows;
+    rows += entries.size();
+    block.entries = std::move(entries);
+    blocks.push_back(std::move(block));
+}
+
+void LogWindow::prepend(std::vector<LogEntry> entries)
+{
+    if (entries.empty())
+        return;
+
+    std::reverse(entries.begin(), entries.end());
+
+    Block block;
+    rows += entries.size();
+    block.entries = std::move(entries);
+    blocks.push_front(std::move(block));
+    updateRows();
+}
+
+void LogWindow::removeFront(size_t count)
+{
+    count = std::min(count, rows);
+    rows -= count;
+
+    while (count > 0)
+    {
+        auto& block = blocks.front();
+        size_t available = block.entries.size() - block.first;
+        if (count >= available)
+        {
+            blocks.pop_front();
+            count -= available;
+            continue;
+        }
+
+        // Entries stay in place so the addresses of the remaining ones do not change, only their data is released
+        for (size_t i = block.first; i < block.first + count; ++i)
+            block.entries[i] = LogEntry();
+        block.first += count;
+        count = 0;
+    }
+
+    updateRows();
+}
+
+void LogWindow::removeBack(size_t count)
+{
+    count = std::min(count, rows);
+    rows -= count;
+
+    while (count > 0)
+    {
+        auto& block = blocks.back();
+        size_t available = block.entries.size() - block.first;
+        if (count >= available)
+        {
+            blocks.pop_back();
+            count -= available;
+            continue;
+        }
+
+        block.entries.erase(block.entries.end() - count, block.entries.end());
+        count = 0;
+    }
+}
+
+size_t LogWindow::rowOf(const LogEntry* entry) const
+{
+    std::less<const LogEntry*> less;
+    for (const auto& block : blocks)
+    {
+        const LogEntry* begin = block.entries.data() + block.first;
+        const LogEntry* end = block.entries.data() + block.entries.size();
+        if (!less(entry, begin) && less(entry, end))
+            return block.row + (entry - begin);
+    }
+    return rows;
+}
+
+size_t LogWindow::lowerBound(const std::chrono::system_clock::time_point& time) const
+{
+    auto blockIt = std::partition_point(blocks.begin(), blocks.end(), [&time](const Block& block) {
+        return block.entries.back().time < time;
+    });
+    if (blockIt == blocks.end())
+        return rows;
+
+    auto begin = blockIt->entries.begin() + blockIt->first;
+    auto entryIt = std::lower_bound(begin, blockIt->entries.end(), time, [](const LogEntry& entry, const std::chrono::system_clock::time_point& value) {
+        return entry.time < value;
+    });
+    return blockIt->row + (entryIt - begin);
+}
+
+void LogWindow::updateRows()
+{
+    size_t row = 0;
+    for (auto& block : blocks)
+    {
+        block.row = row;
+        row += block.entries.size() - block.first;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../LogManagement/LogEntry.h"
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+
+class LogWindow
+{
+public:
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+    const LogEntry& operator[](size_t row) const;
+    const LogEntry& front() const;
+    const LogEntry& back() const;
+
+    void append(std::vector<LogEntry> entries);
+    // Entries are expected newest first, the way a reverse iterator reads them
+    void prepend(std::vector<LogEntry> entries);
+
+    void removeFront(size_t count);
+    void removeBack(size_t count);
+
+    size_t rowOf(const LogEntry* entry) const;
+    size_t lowerBound(const std::chrono::system_clock::time_point& time) const;
+
+private:
+    struct Block
+    {
+        std::vector<LogEntry> entries;
+        size_t first = 0;
+        size_t row = 0;
+    };
+
+    void updateRows();
+
+private:
+    std::deque<Block> blocks;
+    size_t rows = 0;
+};
@@ -3,6 +3,7 @@
 #include <QLineEdit>
 #include <QCheckBox>
 #include <QEvent>
+#include <QSignalBlocker>
 #include <QStyle>
 
 namespace {
@@ -123,6 +124,42 @@ void MultiSelectComboBox::addItems(const QStringList& aTexts)
     }
 }
 
+void MultiSelectComboBox::setItems(const QStringList& aTexts, const QVariantList& aData)
+{
+    if (aTexts == mItems)
+        return;
+
+    // The list is rebuilt in the new order, the selection and the search are kept
+    QStringList selectedTexts = currentText();
+    QVariantList selectedData = mCurrentData;
+    QString search = mSearchBar->text();
+
+    clear();
+
+    auto addChecked = [this, &selectedTexts](const QString& text, const QVariant& data) {
+        if (mItems.contains(text))
+            return;
+
+        addItem(text, data);
+        if (!selectedTexts.contains(text))
+            return;
+
+        auto checkBox = static_cast<QCheckBox*>(mListWidget->itemWidget(mListWidget->item(mListWidget->count() - 1)));
+        QSignalBlocker blocker(checkBox);
+        checkBox->setChecked(true);
+    };
+
+    for (qsizetype i = 0; i < aTexts.size(); ++i)
+        addChecked(aTexts[i], i < aData.size() ? aData[i] : QVariant());
+
+    // Selected values that are no longer among the listed ones stay selectable
+    for (qsizetype i = 0; i < selectedTexts.size(); ++i)
+        addChecked(selectedTexts[i], i < selectedData.size() ? selectedData[i] : QVariant());
+
+    mSearchBar->setText(search);
+    stateChanged(0);
+}
+
 int MultiSelectComboBox::count() const
 {
     int count = mListWidget->count() - 1;// Do not count the search bar
@@ -173,6 +210,7 @@ void MultiSelectComboBox::SetPlaceHolderText(const QString& aPlaceHolderText)
 void MultiSelectComboBox::clear()
 {
     mListWidget->clear();
+    mItems.clear();
     QListWidgetItem* curItem = new QListWidgetItem(mListWidget);
     mSearchBar = new QLineEdit(this);
     mSearchBar->setPlaceholderText("Search..");
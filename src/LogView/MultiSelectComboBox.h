@@ -13,6 +13,7 @@ public:
     MultiSelectComboBox(QWidget* aParent = Q_NULLPTR);
     void addItem(const QString& aText, const QVariant& aUserData = QVariant());
     void addItems(const QStringList& aTexts);
+    void setItems(const QStringList& aTexts, const QVariantList& aData);
     QStringList currentText();
     QVariantList currentData();
     int count() const;
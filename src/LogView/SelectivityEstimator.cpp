@@ -0,0 +1,103 @@
+#include "SelectivityEstimator.h"
+
+#include "services/SessionService.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+
+
+SelectivityEstimator::SelectivityEstimator(SessionService* sessionService) :
+    service(sessionService)
+{
+}
+
+SelectivityEstimator::Estimate SelectivityEstimator::estimate(const LogFilter& filter)
+{
+    auto compiledFilter = filter.compile();
+
+    Estimate result;
+    if (compiledFilter.isEmpty())
+        return result;
+
+    result.hasPreFilter = static_cast<bool>(compiledFilter.createPreFilter());
+    result.blockFraction = estimateBlockFraction(filter);
+
+    // Enum predicates are estimated from the value counts, the samples are only needed for the rest
+    result.selectivity = compiledFilter.takeCountedPredicates([this](const QString& field) {
+        return service->getFrequentValues(field);
+    });
+    if (compiledFilter.isEmpty())
+        return result;
+
+    // Samples are collected once per session, on the first filter that needs them.
+    // Until the service thread has them the rest of the filter is treated as passing everything.
+    service->requestSamples();
+    auto samples = service->getSamples();
+
+    auto accepted = std::count_if(samples.begin(), samples.end(), [&compiledFilter](const LogEntry& entry) {
+        return compiledFilter.check(entry);
+    });
+
+    // Laplace smoothing keeps a filter that matched nothing in the sample from looking free
+    if (static_cast<size_t>(accepted) < samples.size())
+        result.selectivity *= (accepted + 1.0) / (samples.size() + 2.0);
+
+    return result;
+}
+
+bool SelectivityEstimator::preferFilteredModel(const LogFilter& filter)
+{
+    return preferFilteredModel(estimate(filter));
+}
+
+bool SelectivityEstimator::preferFilteredModel(const Estimate& estimate)
+{
+    constexpr double ParseCost = 1.0;
+    constexpr double ScanCost = 0.3;
+    constexpr double SwitchCost = 1.0;
+
+    if (estimate.selectivity >= 1.0)
+        return false;
+
+    // Cost of producing one visible row: the proxy parses every entry and drops the rejected ones,
+    // the filtered iterator skips blocks and rejects raw lines before parsing but has to reload the window
+    double proxyCost = ParseCost / estimate.selectivity;
+    double rejectCost = estimate.hasPreFilter ? ScanCost : ParseCost;
+    double iteratorCost = estimate.blockFraction * rejectCost / estimate.selectivity + ParseCost + SwitchCost;
+    return iteratorCost < proxyCost;
+}
+
+double SelectivityEstimator::estimateBlockFraction(const LogFilter& filter) const
+{
+    auto session = service->getSession();
+    if (!session)
+        return 1.0;
+
+    double totalBlocks = 0;
+    double candidateBlocks = 0;
+    for (const auto& metadata : session->getFiles())
+    {
+        if (metadata.snapshot)
+        {
+            auto blocks = filter.selectBlocks(*metadata.snapshot);
+            totalBlocks += blocks.size();
+            candidateBlocks += std::count(blocks.begin(), blocks.end(), true);
+            continue;
+        }
+
+        if (!metadata.index || !metadata.index->isReady())
+        {
+            double blocks = QFileInfo(metadata.filename).size() / LogIndex::BlockSize + 1;
+            totalBlocks += blocks;
+            candidateBlocks += blocks;
+            continue;
+        }
+
+        auto blocks = filter.selectBlocks(*metadata.index);
+        totalBlocks += blocks.size();
+        candidateBlocks += std::count(blocks.begin(), blocks.end(), true);
+    }
+
+    return totalBlocks > 0 ? candidateBlocks / totalBlocks : 1.0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../LogFilter.h"
+
+#include <vector>
+
+class SessionService;
+
+
+class SelectivityEstimator
+{
+public:
+    struct Estimate
+    {
+        double selectivity = 1.0;
+        double blockFraction = 1.0;
+        bool hasPreFilter = false;
+    };
+
+    explicit SelectivityEstimator(SessionService* sessionService);
+
+    Estimate estimate(const LogFilter& filter);
+    bool preferFilteredModel(const LogFilter& filter);
+
+    static bool preferFilteredModel(const Estimate& estimate);
+
+private:
+    double estimateBlockFraction(const LogFilter& filter) const;
+
+private:
+    SessionService* service;
+};
@@ -10,6 +10,9 @@
 #include "LogView/LogView.h"
 #include "FormatCreation/FormatCreationWizard.h"
 #include "TimelineDialog.h"
+#include "FieldStatisticsDialog.h"
+#include "TemplateDialog.h"
+#include "ScopeGuard.h"
 #include "TimeFrameDialog.h"
 #include "services/SessionService.h"
 #include "services/SearchService.h"
@@ -40,6 +43,9 @@ MainWindow::MainWindow(QWidget *parent) :
 
     setTitleClosed();
 
+    ui->logView->setSessionScrollBar(ui->sessionScrollBar);
+    ui->actionSession_scrollbar->setChecked(ui->logView->isVirtualScrolling());
+
     progressBar = new QProgressBar(this);
     progressBar->setVisible(false);
     progressBar->setMinimum(0);
@@ -67,6 +73,10 @@ MainWindow::MainWindow(QWidget *parent) :
 
     searchController = new SearchController(searchBar->getSearchBar(), ui->logView, this);
     connect(searchController, &SearchController::searchResults, searchResults, &SearchResultsWidget::showResults);
+    connect(searchController, &SearchController::searchResultsStarted, searchResults, &SearchResultsWidget::startResults);
+    connect(searchController, &SearchController::searchResultsAdded, searchResults, &SearchResultsWidget::appendResults);
+    connect(searchController, &SearchController::searchResultsFinished, searchResults, &SearchResultsWidget::finishResults);
+    connect(searchResults, &SearchResultsWidget::moreResultsRequested, searchController, &SearchController::continueGlobalSearch);
 
     loadSettings();
 
@@ -82,6 +92,7 @@ MainWindow::MainWindow(QWidget *parent) :
     auto searchService = app->getSearchService();
     auto exportService = app->getExportService();
     auto timelineService = app->getTimelineService();
+    auto statisticsService = app->getStatisticsService();
 
     connect(this, &MainWindow::openFile, sessionService, &SessionService::openFile);
     connect(this, &MainWindow::openFolder, sessionService, &SessionService::openFolder);
@@ -91,11 +102,13 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(searchService, &SearchService::progressUpdated, this, &MainWindow::handleProgress);
     connect(exportService, &ExportService::progressUpdated, this, &MainWindow::handleProgress);
     connect(timelineService, &TimelineService::progressUpdated, this, &MainWindow::handleProgress);
+    connect(statisticsService, &StatisticsService::progressUpdated, this, &MainWindow::handleProgress);
 
     connect(sessionService, &SessionService::handleError, this, &MainWindow::handleError);
     connect(searchService, &SearchService::handleError, this, &MainWindow::handleError);
     connect(exportService, &ExportService::handleError, this, &MainWindow::handleError);
     connect(timelineService, &TimelineService::handleError, this, &MainWindow::handleError);
+    connect(statisticsService, &StatisticsService::handleError, this, &MainWindow::handleError);
 
     connect(this,
             qOverload<const QString&, const std::chrono::system_clock::time_point&, const std::chrono::system_clock::time_point&>(&MainWindow::exportData),
@@ -118,8 +131,13 @@ MainWindow::MainWindow(QWidget *parent) :
             exportService,
             qOverload<const QString&, QTreeView*>(&ExportService::exportData));
 
-    connect(this, &MainWindow::openTimeline, timelineService, &TimelineService::showTimeline);
-    connect(timelineService, &TimelineService::timelineReady, this, &MainWindow::timelineReady);
+    connect(this, &MainWindow::openTimeline, timelineService, &TimelineService::aggregate);
+    connect(timelineService, &TimelineService::aggregationReady, this, &MainWindow::timelineReady);
+
+    connect(this, &MainWindow::openFieldStatistics, statisticsService, &StatisticsService::calculateFieldStatistics);
+    connect(statisticsService, &StatisticsService::fieldStatisticsReady, this, &MainWindow::fieldStatisticsReady);
+    connect(this, &MainWindow::openTemplates, statisticsService, &StatisticsService::mineTemplates);
+    connect(statisticsService, &StatisticsService::templatesReady, this, &MainWindow::templatesReady);
 
     connect(searchBar->getSearchBar(), &SearchBar::handleError, this, &MainWindow::handleError);
     connect(ui->logView, &LogView::handleError, this, &MainWindow::handleError);
@@ -176,6 +194,7 @@ void MainWindow::on_actionOpen_file_triggered()
     }
 
     filters << tr("Archive files (*.zip)");
+    filters << tr("Log snapshots (*.lgs)");
 
     QString extensionsString = filters.join(";;");
 
@@ -230,7 +249,117 @@ void MainWindow::on_actionTimeline_triggered()
         return;
 
     emit openTimeline(ChronoSystemClockFromDateTime(frameDialog.startDateTime()),
-                      ChronoSystemClockFromDateTime(frameDialog.endDateTime()));
+                      ChronoSystemClockFromDateTime(frameDialog.endDateTime()),
+                      Statistics::AggregationSpec());
+
+    QT_SLOT_END
+}
+
+void MainWindow::on_actionField_statistics_triggered()
+{
+    QT_SLOT_BEGIN
+
+    auto app = qobject_cast<Application*>(QApplication::instance());
+    auto sessionService = app->getSessionService();
+    auto sessionPtr = sessionService->getSession();
+    if (!sessionPtr)
+        return;
+
+    Statistics::FieldStatisticsSpec spec;
+    spec.perModule = true;
+    for (const auto& format : sessionPtr->getFormats())
+    {
+        for (const auto& field : format->fields)
+        {
+            if ((field.type == QMetaType::UInt || field.type == QMetaType::Double) && !spec.fields.contains(field.name))
+                spec.fields << field.name;
+        }
+    }
+
+    if (spec.fields.isEmpty())
+    {
+        QMessageBox::information(this, tr("Field statistics"), tr("The opened formats have no numeric fields"));
+        return;
+    }
+
+    QDateTime start = DateTimeFromChronoSystemClock(sessionPtr->getMinTime());
+    QDateTime end = DateTimeFromChronoSystemClock(sessionPtr->getMaxTime());
+
+    TimeFrameDialog frameDialog(start, end, this);
+    if (frameDialog.exec() != QDialog::Accepted)
+        return;
+
+    emit openFieldStatistics(ChronoSystemClockFromDateTime(frameDialog.startDateTime()),
+                             ChronoSystemClockFromDateTime(frameDialog.endDateTime()),
+                             spec);
+
+    QT_SLOT_END
+}
+
+void MainWindow::on_actionMessage_patterns_triggered()
+{
+    QT_SLOT_BEGIN
+
+    auto app = qobject_cast<Application*>(QApplication::instance());
+    auto sessionService = app->getSessionService();
+    auto sessionPtr = sessionService->getSession();
+    if (!sessionPtr)
+        return;
+
+    QStringList fields;
+    for (const auto& format : sessionPtr->getFormats())
+    {
+        for (const auto& field : format->fields)
+        {
+            if (field.type == QMetaType::QString && !field.isEnum && !fields.contains(field.name))
+                fields << field.name;
+        }
+    }
+
+    // The message is usually the last text field of a line
+    const QString wholeLine = tr("Whole line");
+    fields.prepend(wholeLine);
+
+    bool ok = false;
+    QString field = QInputDialog::getItem(this, tr("Message patterns"), tr("Field:"), fields, fields.size() - 1, false, &ok);
+    if (!ok)
+        return;
+
+    Statistics::TemplateSpec spec;
+    if (field != wholeLine)
+        spec.field = field;
+
+    QDateTime start = DateTimeFromChronoSystemClock(sessionPtr->getMinTime());
+    QDateTime end = DateTimeFromChronoSystemClock(sessionPtr->getMaxTime());
+
+    TimeFrameDialog frameDialog(start, end, this);
+    if (frameDialog.exec() != QDialog::Accepted)
+        return;
+
+    emit openTemplates(ChronoSystemClockFromDateTime(frameDialog.startDateTime()),
+                       ChronoSystemClockFromDateTime(frameDialog.endDateTime()),
+                       spec);
+
+    QT_SLOT_END
+}
+
+void MainWindow::on_actionFilter_by_query_triggered()
+{
+    QT_SLOT_BEGIN
+
+    auto logFilterModel = qobject_cast<LogFilterModel*>(ui->logView->model());
+    if (!logFilterModel)
+        return;
+
+    bool ok = false;
+    QString query = QInputDialog::getText(this, tr("Filter by query"),
+                                          tr("Query (e.g. severity in (ERROR, FATAL) and not module = \"health\"):"),
+                                          QLineEdit::Normal, lastQuery, &ok);
+    if (!ok)
+        return;
+
+    lastQuery = query;
+    logFilterModel->setQuery(query);
 
     QT_SLOT_END
 }
@@ -355,16 +484,21 @@ void MainWindow::on_actionFull_export_triggered()
     if (settingsDialog.exec() != QDialog::Accepted)
         return;
 
-    QString fileName;
-    QString folder;
-    if (settingsDialog.csvFormat())
-        fileName = QFileDialog::getSaveFileName(this, tr("Export Logs"), QDir::currentPath(), tr("CSV Files (*.csv)"));
-    else
-        folder = QFileDialog::getExistingDirectory(this, tr("Export Logs"), QDir::currentPath());
+    QString filter = settingsDialog.csvFormat() ? tr("CSV Files (*.csv)") : tr("Log Files (*.log *.txt)");
+    if (settingsDialog.compress())
+        filter = settingsDialog.csvFormat() ? tr("Compressed CSV Files (*.csv.gz)") : tr("Compressed Log Files (*.gz)");
+    if (!settingsDialog.csvFormat())
+        filter += QStringLiteral(";;") + tr("Log snapshots (*.lgs)");
 
-    if (fileName.isEmpty() && folder.isEmpty())
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Logs"), QDir::currentPath(), filter);
+    if (fileName.isEmpty())
         return;
 
+    // Snapshot blocks are compressed on their own
+    bool snapshot = !settingsDialog.csvFormat() && fileName.endsWith(".lgs", Qt::CaseInsensitive);
+    if (settingsDialog.compress() && !snapshot && !fileName.endsWith(".gz", Qt::CaseInsensitive))
+        fileName += ".gz";
+
     auto logModel = getLogModel();
     if (!logModel)
     {
@@ -386,15 +520,15 @@ void MainWindow::on_actionFull_export_triggered()
             exportDataToTable(fileName,
                               ChronoSystemClockFromDateTime(logModel->getStartTime()),
                               ChronoSystemClockFromDateTime(logModel->getEndTime()),
-                              logModel->getFieldsName());
+                              logModel->getFieldsName(),
+                              logFilterModel->exportFilter());
         }
         else
         {
             exportDataToTable(fileName,
                               ChronoSystemClockFromDateTime(logModel->getStartTime()),
                               ChronoSystemClockFromDateTime(logModel->getEndTime()),
-                              logModel->getFieldsName(),
-                              logFilterModel->exportFilter());
+                              logModel->getFieldsName());
         }
     }
     else
@@ -439,6 +573,15 @@ void MainWindow::on_actionShow_search_bar_triggered(bool checked)
     QT_SLOT_END
 }
 
+void MainWindow::on_actionSession_scrollbar_triggered(bool checked)
+{
+    QT_SLOT_BEGIN
+
+    ui->logView->setVirtualScrolling(checked);
+
+    QT_SLOT_END
+}
+
 void MainWindow::logManagerCreated(const QString& source)
 {
     QT_SLOT_BEGIN
@@ -515,11 +658,59 @@ void MainWindow::logManagerCreated(const QString& source)
     QT_SLOT_END
 }
 
-void MainWindow::timelineReady(std::vector<Statistics::Bucket> data)
+void MainWindow::timelineReady(Statistics::AggregationResult data)
+{
+    QT_SLOT_BEGIN
+
+    if (timelineDialog)
+    {
+        timelineDialog->setData(data);
+        return;
+    }
+
+    auto app = qobject_cast<Application*>(QApplication::instance());
+    auto sessionPtr = app->getSessionService()->getSession();
+    if (!sessionPtr)
+        return;
+
+    QStringList groupFields;
+    QStringList valueFields;
+    for (const auto& format : sessionPtr->getFormats())
+    {
+        for (const auto& field : format->fields)
+        {
+            if (field.isEnum && !groupFields.contains(field.name))
+                groupFields << field.name;
+            if ((field.type == QMetaType::Int || field.type == QMetaType::UInt || field.type == QMetaType::Double) && !valueFields.contains(field.name))
+                valueFields << field.name;
+        }
+    }
+
+    TimelineDialog dialog(data, groupFields, valueFields, this);
+    connect(&dialog, &TimelineDialog::aggregationRequested, this, &MainWindow::openTimeline);
+
+    timelineDialog = &dialog;
+    ScopeGuard dialogGuard([this] { timelineDialog = nullptr; });
+    dialog.exec();
+
+    QT_SLOT_END
+}
+
+void MainWindow::fieldStatisticsReady(Statistics::FieldStatisticsResult result)
+{
+    QT_SLOT_BEGIN
+
+    FieldStatisticsDialog dialog(result, this);
+    dialog.exec();
+
+    QT_SLOT_END
+}
+
+void MainWindow::templatesReady(Statistics::TemplateStatisticsResult result)
 {
     QT_SLOT_BEGIN
 
-    TimelineDialog dialog(std::move(data), this);
+    TemplateDialog dialog(result, this);
     dialog.exec();
 
     QT_SLOT_END
@@ -629,6 +820,9 @@ void MainWindow::setCloseActionEnabled(bool enabled)
 {
     ui->actionClose->setEnabled(enabled);
     ui->actionTimeline->setEnabled(enabled);
+    ui->actionField_statistics->setEnabled(enabled);
+    ui->actionMessage_patterns->setEnabled(enabled);
+    ui->actionFilter_by_query->setEnabled(enabled);
 }
 
 void MainWindow::updateFormatActions(bool enabled)
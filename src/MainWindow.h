@@ -3,7 +3,9 @@
 #include "LogManagement/FormatManager.h"
 #include "LogView/LogModel.h"
 #include "SearchController.h"
-#include "Statistics/LogHistogram.h"
+#include "Statistics/Aggregation.h"
+#include "Statistics/FieldStatistics.h"
+#include "Statistics/TemplateStatistics.h"
 
 #include <QMainWindow>
 #include <QProgressBar>
@@ -16,6 +18,7 @@
 class SearchBarDockWidget;
 class BookmarkTable;
 class SearchResultsWidget;
+class TimelineDialog;
 
 namespace Ui {
 class MainWindow;
@@ -34,6 +37,9 @@ private slots:
     void on_actionOpen_file_triggered();
     void on_actionClose_triggered();
     void on_actionTimeline_triggered();
+    void on_actionField_statistics_triggered();
+    void on_actionMessage_patterns_triggered();
+    void on_actionFilter_by_query_triggered();
     void on_actionAdd_format_triggered();
     void on_actionRemove_format_triggered();
     void on_actionRefresh_format_triggered();
@@ -45,10 +51,13 @@ private slots:
 
     void on_actionShow_bookmarks_triggered();
     void on_actionShow_search_bar_triggered(bool checked);
+    void on_actionSession_scrollbar_triggered(bool checked);
 
     void logManagerCreated(const QString& source);
 
-    void timelineReady(std::vector<Statistics::Bucket> data);
+    void timelineReady(Statistics::AggregationResult data);
+    void fieldStatisticsReady(Statistics::FieldStatisticsResult result);
+    void templatesReady(Statistics::TemplateStatisticsResult result);
 
     void handleProgress(const QString& message, int percent);
 
@@ -67,7 +76,9 @@ signals:
 
     void exportData(const QString& filename, QTreeView* view);
 
-    void openTimeline(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end);
+    void openTimeline(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const Statistics::AggregationSpec& spec);
+    void openFieldStatistics(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const Statistics::FieldStatisticsSpec& spec);
+    void openTemplates(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const Statistics::TemplateSpec& spec);
 
 private:
     void addFormat(const std::string& format);
@@ -97,6 +108,7 @@ private:
     std::vector<QAction*> formatActions;
 
     QStringList selectedFormats;
+    QString lastQuery;
 
     QStringList recentItems;
 
@@ -107,4 +119,5 @@ private:
     SearchBarDockWidget* searchBar = nullptr;
     BookmarkTable* bookmarkTable = nullptr;
     SearchResultsWidget* searchResults = nullptr;
+    TimelineDialog* timelineDialog = nullptr;
 };
@@ -22,7 +22,7 @@ SearchController::SearchController(SearchBar* searchBar, QAbstractItemView* logV
         return;
     }
 
-    auto searchService = app->getSearchService();
+    searchService = app->getSearchService();
     if (!searchService)
     {
         qWarning() << "SearchService is not available, SearchController cannot be initialized.";
@@ -30,8 +30,11 @@ SearchController::SearchController(SearchBar* searchBar, QAbstractItemView* logV
     }
     connect(this, &SearchController::startGlobalSearch, searchService, &SearchService::search);
     connect(this, &SearchController::startGlobalSearchWithFilter, searchService, &SearchService::searchWithFilter);
+    connect(this, &SearchController::startBackwardSearch, searchService, &SearchService::searchBackward);
     connect(searchService, &SearchService::searchFinished, this, &SearchController::handleSearchResult);
-    connect(searchService, &SearchService::searchResults, this, &SearchController::searchResults);
+    connect(this, &SearchController::continueGlobalSearch, searchService, &SearchService::continueSearch);
+    connect(searchService, &SearchService::searchResultsAdded, this, &SearchController::searchResultsAdded);
+    connect(searchService, &SearchService::searchResultsFinished, this, &SearchController::searchResultsFinished);
 }
 
 void SearchController::updateModel()
@@ -101,6 +104,11 @@ void SearchController::searchImpl(const QModelIndex& from, const QString& search
     {
         if (globalSearch)
         {
+            emit searchResultsStarted();
+
+            if (searchService)
+                searchService->setResultLimit(SearchService::loadResultLimit());
+
             auto startTime = ChronoSystemClockFromDateTime(model->getStartTime());
             auto filters = proxyModel->exportFilter();
             if (useFilters && !filters.isEmpty())
@@ -166,9 +174,12 @@ void SearchController::searchImpl(const QModelIndex& from, const QString& search
                 qDebug() << "Starting global search for term:" << searchTerm;
                 currentSearchTerm = searchTerm;
 
-                auto startTime = ChronoSystemClockFromDateTime(backward ? model->getStartTime() : model->getLastEntryTime());
+                auto startTime = ChronoSystemClockFromDateTime(backward ? model->getFirstEntryTime() : model->getLastEntryTime());
                 auto filters = proxyModel->exportFilter();
-                if (useFilters && !filters.isEmpty())
+                auto position = backward ? model->getFirstEntryCache() : MergeHeapCache();
+                if (!position.heap.empty())
+                    startBackwardSearch(position, searchTerm, regexEnabled, column, model->getFieldsName(), useFilters ? filters : LogFilter());
+                else if (useFilters && !filters.isEmpty())
                     startGlobalSearchWithFilter(startTime, searchTerm, regexEnabled, backward, findAll, column, model->getFieldsName(), filters);
                 else
                     startGlobalSearch(startTime, searchTerm, regexEnabled, backward, findAll, column, model->getFieldsName());
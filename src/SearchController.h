@@ -9,6 +9,8 @@
 #include <chrono>
 
 
+class SearchService;
+
 class SearchController : public QObject
 {
     Q_OBJECT
@@ -24,10 +26,16 @@ public:
 signals:
     void startGlobalSearch(const std::chrono::system_clock::time_point& startTime, const QString& searchTerm, bool regexEnabled, bool backward, bool findAll, int column, const QStringList& fields);
     void startGlobalSearchWithFilter(const std::chrono::system_clock::time_point& startTime, const QString& searchTerm, bool regexEnabled, bool backward, bool findAll, int column, const QStringList& fields, const LogFilter& filter);
+    void startBackwardSearch(const MergeHeapCache& position, const QString& searchTerm, bool regexEnabled, int column, const QStringList& fields, const LogFilter& filter);
 
     void handleError(const QString& message);
     void searchResults(const QMap<std::chrono::system_clock::time_point, QString>& results);
 
+    void searchResultsStarted();
+    void searchResultsAdded(const QMap<std::chrono::system_clock::time_point, QString>& results);
+    void searchResultsFinished(bool hasMore);
+    void continueGlobalSearch();
+
 public slots:
     void search(const QString& searchTerm, bool regexEnabled, bool backward, bool useFilters, bool global, bool findAll, int column);
 
@@ -38,5 +46,6 @@ private:
 
 private:
     QAbstractItemView* logView;
+    SearchService* searchService = nullptr;
     QString currentSearchTerm;
 };
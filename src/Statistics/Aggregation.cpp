@@ -0,0 +1,206 @@
+#include "Aggregation.h"
+
+#include "ModuleWorkers.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace Statistics
+{
+namespace
+{
+struct Cell
+{
+    std::int64_t count = 0;
+    double sum = 0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+
+    void add(double value)
+    {
+        ++count;
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    void merge(const Cell& other)
+    {
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    double getValue(AggregationSpec::Function function) const
+    {
+        if (function == AggregationSpec::Function::Count)
+            return static_cast<double>(count);
+        if (count == 0)
+            return 0;
+
+        switch (function)
+        {
+        case AggregationSpec::Function::Min:
+            return min;
+        case AggregationSpec::Function::Max:
+            return max;
+        case AggregationSpec::Function::Sum:
+            return sum;
+        case AggregationSpec::Function::Avg:
+            return sum / count;
+        default:
+            return 0;
+        }
+    }
+};
+
+// Keys are interned per partial aggregate, so the cells of a group are addressed by a small id
+// and the key string is only hashed once per entry
+struct PartialAggregate
+{
+    std::unordered_map<QString, size_t> keyIds;
+    std::vector<QString> keys;
+    std::vector<std::vector<Cell>> cells;
+
+    std::vector<Cell>& getCells(const QString& key, size_t bucketCount)
+    {
+        auto [it, inserted] = keyIds.try_emplace(key, keys.size());
+        if (inserted)
+        {
+            keys.push_back(key);
+            cells.emplace_back(bucketCount);
+        }
+        return cells[it->second];
+    }
+
+    void merge(PartialAggregate& other, size_t bucketCount)
+    {
+        for (size_t i = 0; i < other.keys.size(); ++i)
+        {
+            auto& target = getCells(other.keys[i], bucketCount);
+            for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+                target[bucket].merge(other.cells[i][bucket]);
+        }
+    }
+};
+}
+
+bool AggregationSpec::isPlainCount() const
+{
+    return groupBy.isEmpty() && function == Function::Count;
+}
+
+AggregationResult AggregationResult::fromBuckets(const std::vector<Bucket>& buckets,
+                                                 const std::chrono::system_clock::time_point& end,
+                                                 const AggregationSpec& spec)
+{
+    AggregationResult result;
+    result.spec = spec;
+    result.end = end;
+    if (buckets.empty())
+        return result;
+
+    result.start = buckets.front().start;
+    result.bucketSize = buckets.size() > 1 ? buckets[1].start - buckets[0].start : end - buckets.front().start;
+
+    AggregatedSeries series;
+    for (const auto& bucket : buckets)
+    {
+        result.bucketStarts.push_back(bucket.start);
+        series.values.push_back(bucket.count);
+    }
+    result.series.push_back(std::move(series));
+    return result;
+}
+
+AggregationResult Aggregator::calculate(Session& session,
+                                        const std::chrono::system_clock::time_point& start,
+                                        const std::chrono::system_clock::time_point& end,
+                                        const AggregationSpec& spec)
+{
+    AggregationResult result;
+    result.spec = spec;
+    result.start = start;
+    result.end = end;
+    result.bucketSize = spec.bucketSize > std::chrono::system_clock::duration::zero() ? spec.bucketSize : LogHistogram::suggestBucketSize(start, end);
+
+    auto buckets = LogHistogram::createBuckets(start, end, result.bucketSize);
+    if (buckets.empty())
+        return result;
+    for (const auto& bucket : buckets)
+        result.bucketStarts.push_back(bucket.start);
+
+    bool needsValue = spec.function != AggregationSpec::Function::Count;
+    bool byModule = spec.groupBy == AggregationSpec::ModuleKey;
+
+    const auto& moduleSet = session.getModules();
+    std::vector<QString> modules(moduleSet.begin(), moduleSet.end());
+
+    // Every worker aggregates whole modules into its own partial, the partials are merged at the end
+    std::vector<PartialAggregate> partials(getWorkerCount(modules.size()));
+    forEachModule(modules.size(), partials.size(), [&](size_t module, size_t worker) {
+        auto& partial = partials[worker];
+        auto iterator = session.getModuleIterator(modules[module], start, end);
+
+        while (iterator.hasLogs())
+        {
+            auto entry = iterator.next();
+            if (!entry)
+                break;
+
+            auto index = (entry->time - start) / result.bucketSize;
+            if (index < 0 || static_cast<size_t>(index) >= buckets.size())
+                continue;
+
+            double value = 0;
+            if (needsValue)
+            {
+                auto it = entry->values.find(spec.valueField);
+                if (it == entry->values.end())
+                    continue;
+
+                bool ok = false;
+                value = it->second.toDouble(&ok);
+                if (!ok)
+                    continue;
+            }
+
+            QString key;
+            if (byModule)
+            {
+                key = entry->module;
+            }
+            else if (!spec.groupBy.isEmpty())
+            {
+                auto it = entry->values.find(spec.groupBy);
+                if (it != entry->values.end())
+                    key = it->second.toString();
+            }
+
+            partial.getCells(key, buckets.size())[static_cast<size_t>(index)].add(value);
+        }
+    });
+
+    for (size_t i = 1; i < partials.size(); ++i)
+        partials[0].merge(partials[i], buckets.size());
+
+    auto& merged = partials[0];
+    for (size_t i = 0; i < merged.keys.size(); ++i)
+    {
+        AggregatedSeries series;
+        series.key = merged.keys[i];
+        series.values.reserve(buckets.size());
+        for (const auto& cell : merged.cells[i])
+            series.values.push_back(cell.getValue(spec.function));
+        result.series.push_back(std::move(series));
+    }
+
+    std::sort(result.series.begin(), result.series.end(), [](const AggregatedSeries& lhs, const AggregatedSeries& rhs) {
+        return lhs.key < rhs.key;
+    });
+
+    return result;
+}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "LogHistogram.h"
+
+#include <QString>
+
+#include <chrono>
+#include <vector>
+
+namespace Statistics
+{
+struct AggregationSpec
+{
+    static inline const QString ModuleKey = "__module";
+
+    enum class Function { Count, Min, Max, Sum, Avg };
+
+    // Enum field name, ModuleKey or empty for a single series
+    QString groupBy;
+    Function function = Function::Count;
+    QString valueField;
+    // Zero selects the bucket size from the time range
+    std::chrono::system_clock::duration bucketSize = std::chrono::system_clock::duration::zero();
+
+    bool isPlainCount() const;
+};
+
+struct AggregatedSeries
+{
+    QString key;
+    std::vector<double> values;
+};
+
+struct AggregationResult
+{
+    AggregationSpec spec;
+    std::chrono::system_clock::time_point start;
+    std::chrono::system_clock::time_point end;
+    std::chrono::system_clock::duration bucketSize = std::chrono::system_clock::duration::zero();
+    std::vector<std::chrono::system_clock::time_point> bucketStarts;
+    std::vector<AggregatedSeries> series;
+
+    static AggregationResult fromBuckets(const std::vector<Bucket>& buckets,
+                                         const std::chrono::system_clock::time_point& end,
+                                         const AggregationSpec& spec = AggregationSpec());
+};
+
+class Aggregator
+{
+public:
+    static AggregationResult calculate(Session& session,
+                                       const std::chrono::system_clock::time_point& start,
+                                       const std::chrono::system_clock::time_point& end,
+                                       const AggregationSpec& spec);
+};
+}
+
+Q_DECLARE_METATYPE(Statistics::AggregationSpec)
+Q_DECLARE_METATYPE(Statistics::AggregationResult)
@@ -0,0 +1,109 @@
+#include "FieldStatistics.h"
+#include "ModuleWorkers.h"
+
+#include <map>
+#include <tuple>
+
+namespace Statistics
+{
+void FieldSummary::add(double value)
+{
+    sketch.add(value);
+    histogram.add(value);
+}
+
+void FieldSummary::merge(const FieldSummary& other)
+{
+    sketch.merge(other.sketch);
+    histogram.merge(other.histogram);
+}
+
+std::vector<FieldSummary> FieldStatisticsResult::getTotals() const
+{
+    std::vector<FieldSummary> totals;
+    for (const auto& field : spec.fields)
+    {
+        FieldSummary total;
+        total.field = field;
+        total.bucketStart = start;
+        for (const auto& summary : summaries)
+        {
+            if (summary.field == field)
+                total.merge(summary);
+        }
+        totals.push_back(std::move(total));
+    }
+    return totals;
+}
+
+FieldStatisticsResult FieldStatistics::calculate(Session& session,
+                                                 const std::chrono::system_clock::time_point& start,
+                                                 const std::chrono::system_clock::time_point& end,
+                                                 const FieldStatisticsSpec& spec)
+{
+    FieldStatisticsResult result;
+    result.spec = spec;
+    result.start = start;
+    result.end = end;
+    if (end <= start || spec.fields.isEmpty())
+        return result;
+
+    bool bucketed = spec.bucketSize > std::chrono::system_clock::duration::zero();
+
+    const auto& moduleSet = session.getModules();
+    std::vector<QString> modules(moduleSet.begin(), moduleSet.end());
+
+    // Summaries are keyed by field, module and bucket, each worker fills its own map in one pass over its modules
+    typedef std::map<std::tuple<qsizetype, QString, std::int64_t>, FieldSummary> Partial;
+    std::vector<Partial> partials(getWorkerCount(modules.size()));
+    forEachModule(modules.size(), partials.size(), [&](size_t module, size_t worker) {
+        auto& partial = partials[worker];
+        auto iterator = session.getModuleIterator(modules[module], start, end);
+
+        QString moduleKey = spec.perModule ? modules[module] : QString();
+        while (iterator.hasLogs())
+        {
+            auto entry = iterator.next();
+            if (!entry)
+                break;
+
+            std::int64_t bucket = bucketed ? (entry->time - start) / spec.bucketSize : 0;
+            for (qsizetype i = 0; i < spec.fields.size(); ++i)
+            {
+                auto it = entry->values.find(spec.fields[i]);
+                if (it == entry->values.end())
+                    continue;
+
+                bool ok = false;
+                double value = it->second.toDouble(&ok);
+                if (!ok)
+                    continue;
+
+                auto [summary, inserted] = partial.try_emplace({ i, moduleKey, bucket });
+                if (inserted)
+                {
+                    summary->second.field = spec.fields[i];
+                    summary->second.module = moduleKey;
+                    summary->second.bucketStart = start + (bucketed ? spec.bucketSize * bucket : std::chrono::system_clock::duration::zero());
+                }
+                summary->second.add(value);
+            }
+        }
+    });
+
+    auto& merged = partials.front();
+    for (size_t i = 1; i < partials.size(); ++i)
+    {
+        for (auto& [key, summary] : partials[i])
+        {
+            auto [target, inserted] = merged.try_emplace(key, std::move(summary));
+            if (!inserted)
+                target->second.merge(summary);
+        }
+    }
+
+    for (auto& [key, summary] : merged)
+        result.summaries.push_back(std::move(summary));
+    return result;
+}
+}
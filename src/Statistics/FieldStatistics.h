@@ -0,0 +1,59 @@
+#pragma once
+
+#include "LogManagement/Session.h"
+#include "QuantileSketch.h"
+#include "HdrHistogram.h"
+
+#include <QString>
+#include <QStringList>
+
+#include <chrono>
+#include <vector>
+
+namespace Statistics
+{
+struct FieldStatisticsSpec
+{
+    QStringList fields;
+    bool perModule = false;
+    // Zero keeps the whole range in one bucket
+    std::chrono::system_clock::duration bucketSize = std::chrono::system_clock::duration::zero();
+};
+
+struct FieldSummary
+{
+    QString field;
+    QString module;
+    std::chrono::system_clock::time_point bucketStart;
+
+    QuantileSketch sketch;
+    // Fields are often durations or sizes with fractions, a thousandth keeps sub-unit values apart
+    HdrHistogram histogram{ 7, 0.001 };
+
+    void add(double value);
+    void merge(const FieldSummary& other);
+};
+
+struct FieldStatisticsResult
+{
+    FieldStatisticsSpec spec;
+    std::chrono::system_clock::time_point start;
+    std::chrono::system_clock::time_point end;
+    std::vector<FieldSummary> summaries;
+
+    // One summary per field over all modules and buckets
+    std::vector<FieldSummary> getTotals() const;
+};
+
+class FieldStatistics
+{
+public:
+    static FieldStatisticsResult calculate(Session& session,
+                                           const std::chrono::system_clock::time_point& start,
+                                           const std::chrono::system_clock::time_point& end,
+                                           const FieldStatisticsSpec& spec);
+};
+}
+
+Q_DECLARE_METATYPE(Statistics::FieldStatisticsSpec)
+Q_DECLARE_METATYPE(Statistics::FieldStatisticsResult)
@@ -0,0 +1,141 @@
+#include "HdrHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Statistics
+{
+HdrHistogram::HdrHistogram(int subBucketBits, double lowestTrackableValue) :
+    subBucketBits(std::clamp(subBucketBits, 1, 16)),
+    unit(std::isfinite(lowestTrackableValue) && lowestTrackableValue > 0 ? lowestTrackableValue : 1)
+{}
+
+void HdrHistogram::add(double value, std::uint64_t count)
+{
+    if (!std::isfinite(value) || count == 0)
+        return;
+
+    if (value < 0)
+    {
+        rejected += count;
+        return;
+    }
+
+    size_t index = getIndex(value);
+    if (index >= counts.size())
+        counts.resize(index + 1);
+    counts[index] += count;
+
+    total += count;
+    min = std::min(min, value);
+    max = std::max(max, value);
+}
+
+void HdrHistogram::merge(const HdrHistogram& other)
+{
+    rejected += other.rejected;
+    if (other.total == 0)
+        return;
+
+    if (other.subBucketBits == subBucketBits && other.unit == unit)
+    {
+        if (other.counts.size() > counts.size())
+            counts.resize(other.counts.size());
+        for (size_t i = 0; i < other.counts.size(); ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        return;
+    }
+
+    for (size_t i = 0; i < other.counts.size(); ++i)
+    {
+        if (other.counts[i])
+            add((other.getLowerBound(i) + other.getUpperBound(i)) / 2, other.counts[i]);
+    }
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+double HdrHistogram::quantile(double q) const
+{
+    if (total == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * total));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t cumulative = 0;
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        cumulative += counts[i];
+        if (cumulative >= rank)
+            return std::clamp((getLowerBound(i) + getUpperBound(i)) / 2, min, max);
+    }
+    return max;
+}
+
+std::uint64_t HdrHistogram::getCount() const
+{
+    return total;
+}
+
+std::uint64_t HdrHistogram::getRejectedCount() const
+{
+    return rejected;
+}
+
+double HdrHistogram::getMin() const
+{
+    return min;
+}
+
+double HdrHistogram::getMax() const
+{
+    return max;
+}
+
+std::vector<HdrHistogram::Bucket> HdrHistogram::getBuckets() const
+{
+    std::vector<Bucket> result;
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        if (counts[i])
+            result.push_back({ getLowerBound(i), getUpperBound(i), counts[i] });
+    }
+    return result;
+}
+
+size_t HdrHistogram::getIndex(double value) const
+{
+    double units = value / unit;
+    if (units < 1)
+        return 0;
+
+    int exponent = 0;
+    double mantissa = std::frexp(units, &exponent);
+    // frexp gives mantissa in [0.5, 1), so the value lies in [2^(exponent - 1), 2^exponent)
+    size_t subBuckets = size_t(1) << subBucketBits;
+    auto subBucket = static_cast<size_t>((mantissa * 2 - 1) * subBuckets);
+    return 1 + static_cast<size_t>(exponent - 1) * subBuckets + std::min(subBucket, subBuckets - 1);
+}
+
+double HdrHistogram::getLowerBound(size_t index) const
+{
+    if (index == 0)
+        return 0;
+
+    size_t subBuckets = size_t(1) << subBucketBits;
+    size_t exponent = (index - 1) / subBuckets;
+    size_t subBucket = (index - 1) % subBuckets;
+    return std::ldexp(1.0 + static_cast<double>(subBucket) / subBuckets, static_cast<int>(exponent)) * unit;
+}
+
+double HdrHistogram::getUpperBound(size_t index) const
+{
+    if (index == 0)
+        return unit;
+    return getLowerBound(index + 1);
+}
+}
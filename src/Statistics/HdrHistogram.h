@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Statistics
+{
+// Log-linear histogram in the manner of HdrHistogram: every power of two is split into
+// the same number of linear sub-buckets, so the relative error of any value is fixed.
+// Values are counted in units of lowestTrackableValue and values below one unit share the first bucket.
+// Negative values cannot be placed and are only counted as rejected.
+class HdrHistogram
+{
+public:
+    explicit HdrHistogram(int subBucketBits = 7, double lowestTrackableValue = 1);
+
+    void add(double value, std::uint64_t count = 1);
+    void merge(const HdrHistogram& other);
+
+    double quantile(double q) const;
+
+    std::uint64_t getCount() const;
+    std::uint64_t getRejectedCount() const;
+    double getMin() const;
+    double getMax() const;
+
+    struct Bucket
+    {
+        double lower = 0;
+        double upper = 0;
+        std::uint64_t count = 0;
+    };
+    std::vector<Bucket> getBuckets() const;
+
+private:
+    size_t getIndex(double value) const;
+    double getLowerBound(size_t index) const;
+    double getUpperBound(size_t index) const;
+
+private:
+    int subBucketBits;
+    double unit;
+    std::vector<std::uint64_t> counts;
+    std::uint64_t total = 0;
+    std::uint64_t rejected = 0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+};
+}
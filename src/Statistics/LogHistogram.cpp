@@ -1,12 +1,12 @@
 #include "LogHistogram.h"
+#include "ModuleWorkers.h"
 #include <algorithm>
 #include <cstdint>
 namespace Statistics
 {
-std::vector<Bucket> LogHistogram::calculate(Session& session,
-                                            const std::chrono::system_clock::time_point& start,
-                                            const std::chrono::system_clock::time_point& end,
-                                            const std::chrono::system_clock::duration& bucketSize)
+std::vector<Bucket> LogHistogram::createBuckets(const std::chrono::system_clock::time_point& start,
+                                                const std::chrono::system_clock::time_point& end,
+                                                const std::chrono::system_clock::duration& bucketSize)
 {
     std::vector<Bucket> result;
     if (end <= start || bucketSize <= std::chrono::system_clock::duration::zero())
@@ -20,15 +20,38 @@ std::vector<Bucket> LogHistogram::calculate(Session& session,
     for (std::size_t i = 0; i < result.size(); ++i)
         result[i].start = start + bucketSize * i;
 
-    auto iterator = session.getIterator<>(start, end);
-    while (iterator.hasLogs())
+    return result;
+}
+
+std::vector<Bucket> LogHistogram::calculate(Session& session,
+                                            const std::chrono::system_clock::time_point& start,
+                                            const std::chrono::system_clock::time_point& end,
+                                            const std::chrono::system_clock::duration& bucketSize)
+{
+    auto result = createBuckets(start, end, bucketSize);
+    if (result.empty())
+        return result;
+
+    // Counts commute, so every module is scanned on its own without merging them by time
+    const auto& moduleSet = session.getModules();
+    std::vector<QString> modules(moduleSet.begin(), moduleSet.end());
+
+    std::vector<std::vector<int>> counts(getWorkerCount(modules.size()), std::vector<int>(result.size()));
+    forEachModule(modules.size(), counts.size(), [&session, &modules, &counts, &start, &end, &bucketSize](size_t module, size_t worker) {
+        auto& workerCounts = counts[worker];
+        auto scanner = session.getTimestampScanner(modules[module], start, end);
+        while (auto time = scanner.next())
+        {
+            auto index = (time.value() - start) / bucketSize;
+            if (index >= 0 && static_cast<std::size_t>(index) < workerCounts.size())
+                ++workerCounts[static_cast<std::size_t>(index)];
+        }
+    });
+
+    for (const auto& threadCounts : counts)
     {
-        auto entry = iterator.next();
-        if (!entry)
-            break;
-        auto index = (entry->time - start) / bucketSize;
-        if (index >= 0 && static_cast<std::size_t>(index) < result.size())
-            ++result[static_cast<std::size_t>(index)].count;
+        for (std::size_t i = 0; i < result.size(); ++i)
+            result[i].count += threadCounts[i];
     }
 
     return result;
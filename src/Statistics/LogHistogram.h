@@ -16,6 +16,10 @@ struct Bucket
 class LogHistogram
 {
 public:
+    static std::vector<Bucket> createBuckets(const std::chrono::system_clock::time_point& start,
+                                             const std::chrono::system_clock::time_point& end,
+                                             const std::chrono::system_clock::duration& bucketSize);
+
     static std::vector<Bucket> calculate(Session& session,
                                          const std::chrono::system_clock::time_point& start,
                                          const std::chrono::system_clock::time_point& end,
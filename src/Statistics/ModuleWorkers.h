@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Statistics
+{
+inline size_t getWorkerCount(size_t moduleCount)
+{
+    return std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), moduleCount));
+}
+
+// Hands the modules out one at a time to workerCount threads, the calling thread being the first of them.
+// task(module, worker) may keep per-worker state indexed by worker without locking.
+// The first exception thrown by a task stops handing out modules and is rethrown here once every thread is joined.
+template<typename Task>
+void forEachModule(size_t moduleCount, size_t workerCount, const Task& task)
+{
+    std::atomic<size_t> nextModule = 0;
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto work = [&task, &nextModule, &error, &errorMutex, moduleCount](size_t worker) {
+        try
+        {
+            for (size_t i = nextModule++; i < moduleCount; i = nextModule++)
+                task(i, worker);
+        }
+        catch (...)
+        {
+            nextModule = moduleCount;
+            std::lock_guard lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t worker = 1; worker < workerCount; ++worker)
+        threads.emplace_back(work, worker);
+    work(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+}
@@ -0,0 +1,132 @@
+#include "QuantileSketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace Statistics
+{
+QuantileSketch::QuantileSketch(double compression) :
+    compression(std::max(compression, 20.0))
+{}
+
+void QuantileSketch::add(double value, double weight)
+{
+    if (std::isnan(value) || weight <= 0)
+        return;
+
+    buffer.push_back({ value, weight });
+    count += weight;
+    min = std::min(min, value);
+    max = std::max(max, value);
+
+    if (buffer.size() >= static_cast<size_t>(compression) * 8)
+        compress();
+}
+
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+    other.compress();
+    if (other.centroids.empty())
+        return;
+
+    buffer.insert(buffer.end(), other.centroids.begin(), other.centroids.end());
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    compress();
+}
+
+double QuantileSketch::quantile(double q) const
+{
+    compress();
+    if (centroids.empty())
+        return std::numeric_limits<double>::quiet_NaN();
+
+    q = std::clamp(q, 0.0, 1.0);
+    if (centroids.size() == 1)
+        return centroids.front().mean;
+
+    double rank = q * count;
+    if (rank < centroids.front().weight / 2)
+        return min + (centroids.front().mean - min) * rank / (centroids.front().weight / 2);
+
+    // Every centroid is taken to hold half of its weight on each side of its mean,
+    // ranks between two means are interpolated linearly
+    double cumulative = centroids.front().weight / 2;
+    for (size_t i = 1; i < centroids.size(); ++i)
+    {
+        const auto& previous = centroids[i - 1];
+        const auto& current = centroids[i];
+        double step = (previous.weight + current.weight) / 2;
+        if (rank < cumulative + step)
+            return previous.mean + (current.mean - previous.mean) * (rank - cumulative) / step;
+        cumulative += step;
+    }
+
+    const auto& last = centroids.back();
+    double tail = rank - cumulative;
+    return last.mean + (max - last.mean) * std::min(1.0, tail / (last.weight / 2));
+}
+
+double QuantileSketch::getCount() const
+{
+    return count;
+}
+
+double QuantileSketch::getMin() const
+{
+    return min;
+}
+
+double QuantileSketch::getMax() const
+{
+    return max;
+}
+
+size_t QuantileSketch::getCentroidCount() const
+{
+    compress();
+    return centroids.size();
+}
+
+void QuantileSketch::compress() const
+{
+    if (buffer.empty())
+        return;
+
+    buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+    std::sort(buffer.begin(), buffer.end(), [](const Centroid& lhs, const Centroid& rhs) { return lhs.mean < rhs.mean; });
+
+    double total = 0;
+    for (const auto& centroid : buffer)
+        total += centroid.weight;
+
+    // k1 scale function: a centroid may span at most one unit of k, which keeps the tails fine grained
+    auto scale = [this](double q) { return compression / (2 * std::numbers::pi) * std::asin(2 * std::clamp(q, 0.0, 1.0) - 1); };
+
+    centroids.clear();
+    Centroid current = buffer.front();
+    double before = 0;
+    double limit = scale(0) + 1;
+    for (size_t i = 1; i < buffer.size(); ++i)
+    {
+        const auto& next = buffer[i];
+        double merged = current.weight + next.weight;
+        if (scale((before + merged) / total) <= limit)
+        {
+            current.mean += (next.mean - current.mean) * next.weight / merged;
+            current.weight = merged;
+        }
+        else
+        {
+            before += current.weight;
+            limit = scale(before / total) + 1;
+            centroids.push_back(current);
+            current = next;
+        }
+    }
+    centroids.push_back(current);
+    buffer.clear();
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace Statistics
+{
+// Merging t-digest: values are clustered into centroids that are small near the tails and large
+// around the median, so extreme quantiles stay accurate with memory bounded by the compression.
+class QuantileSketch
+{
+public:
+    explicit QuantileSketch(double compression = 200);
+
+    void add(double value, double weight = 1);
+    void merge(const QuantileSketch& other);
+
+    double quantile(double q) const;
+
+    double getCount() const;
+    double getMin() const;
+    double getMax() const;
+    size_t getCentroidCount() const;
+
+private:
+    struct Centroid
+    {
+        double mean = 0;
+        double weight = 0;
+    };
+
+    void compress() const;
+
+private:
+    double compression;
+
+    mutable std::vector<Centroid> centroids;
+    mutable std::vector<Centroid> buffer;
+
+    double count = 0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+};
+}
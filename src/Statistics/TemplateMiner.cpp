@@ -0,0 +1,151 @@
+#include "TemplateMiner.h"
+
+namespace Statistics
+{
+namespace
+{
+bool hasDigits(const QString& token)
+{
+    for (auto ch : token)
+    {
+        if (ch.isDigit())
+            return true;
+    }
+    return false;
+}
+
+QStringList tokenize(const QString& message)
+{
+    QStringList tokens;
+    qsizetype begin = -1;
+    for (qsizetype i = 0; i <= message.size(); ++i)
+    {
+        bool space = i == message.size() || message[i].isSpace();
+        if (space && begin >= 0)
+        {
+            tokens.push_back(message.mid(begin, i - begin));
+            begin = -1;
+        }
+        else if (!space && begin < 0)
+        {
+            begin = i;
+        }
+    }
+    return tokens;
+}
+}
+
+TemplateMiner::TemplateMiner() :
+    TemplateMiner(Settings())
+{}
+
+TemplateMiner::TemplateMiner(const Settings& settings) :
+    settings(settings)
+{
+    templates.push_back({ QStringList{ Wildcard }, 0 });
+}
+
+int TemplateMiner::add(const QString& message, std::int64_t count)
+{
+    auto tokens = tokenize(message);
+
+    Node* leaf = findLeaf(tokens);
+
+    int bestId = -1;
+    double bestSimilarity = -1;
+    int bestWildcards = -1;
+    for (int id : leaf->templates)
+    {
+        int wildcards = 0;
+        double similarity = getSimilarity(templates[id].tokens, tokens, wildcards);
+        if (similarity > bestSimilarity || (similarity == bestSimilarity && wildcards > bestWildcards))
+        {
+            bestId = id;
+            bestSimilarity = similarity;
+            bestWildcards = wildcards;
+        }
+    }
+
+    if (bestId >= 0 && bestSimilarity >= settings.similarity)
+    {
+        auto& matched = templates[bestId];
+        for (qsizetype i = 0; i < tokens.size(); ++i)
+        {
+            if (matched.tokens[i] != tokens[i])
+                matched.tokens[i] = Wildcard;
+        }
+        matched.count += count;
+        return bestId;
+    }
+
+    if (templates.size() > settings.maxTemplates)
+    {
+        templates[OverflowId].count += count;
+        return OverflowId;
+    }
+
+    int id = static_cast<int>(templates.size());
+    templates.push_back({ std::move(tokens), count });
+    leaf->templates.push_back(id);
+    return id;
+}
+
+size_t TemplateMiner::size() const
+{
+    return templates.size();
+}
+
+QString TemplateMiner::getTemplate(int id) const
+{
+    return templates[id].tokens.join(' ');
+}
+
+std::int64_t TemplateMiner::getCount(int id) const
+{
+    return templates[id].count;
+}
+
+TemplateMiner::Node* TemplateMiner::findLeaf(const QStringList& tokens)
+{
+    auto& lengthNode = root.children[QString::number(tokens.size())];
+    if (!lengthNode)
+        lengthNode = std::make_unique<Node>();
+
+    Node* node = lengthNode.get();
+    for (int level = 0; level < settings.depth - 2 && level < tokens.size(); ++level)
+    {
+        // Tokens with digits are most likely parameters, routing them would split one template into many leaves
+        const QString& token = hasDigits(tokens[level]) ? Wildcard : tokens[level];
+
+        auto it = node->children.find(token);
+        if (it == node->children.end())
+        {
+            if (node->children.size() >= settings.maxChildren)
+                it = node->children.try_emplace(Wildcard).first;
+            else
+                it = node->children.try_emplace(token).first;
+            if (!it->second)
+                it->second = std::make_unique<Node>();
+        }
+        node = it->second.get();
+    }
+    return node;
+}
+
+double TemplateMiner::getSimilarity(const QStringList& templateTokens, const QStringList& tokens, int& wildcards) const
+{
+    if (tokens.isEmpty())
+        return 1;
+
+    int equal = 0;
+    wildcards = 0;
+    for (qsizetype i = 0; i < tokens.size(); ++i)
+    {
+        if (templateTokens[i] == Wildcard)
+            ++wildcards;
+        else if (templateTokens[i] == tokens[i])
+            ++equal;
+    }
+    return static_cast<double>(equal) / tokens.size();
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Statistics
+{
+// Drain-style template miner. Messages are routed through a fixed-depth tree by token count and
+// their first tokens, then matched against the few templates of the leaf by token similarity.
+// Differing tokens of a matched template become wildcards.
+class TemplateMiner
+{
+public:
+    static inline const QString Wildcard = "<*>";
+    // Receives messages once the template limit is reached
+    static constexpr int OverflowId = 0;
+
+    struct Settings
+    {
+        int depth = 4;
+        double similarity = 0.4;
+        size_t maxChildren = 100;
+        size_t maxTemplates = 5000;
+    };
+
+    TemplateMiner();
+    explicit TemplateMiner(const Settings& settings);
+
+    int add(const QString& message, std::int64_t count = 1);
+
+    size_t size() const;
+    QString getTemplate(int id) const;
+    std::int64_t getCount(int id) const;
+
+private:
+    struct Node
+    {
+        std::unordered_map<QString, std::unique_ptr<Node>> children;
+        std::vector<int> templates;
+    };
+
+    struct Template
+    {
+        QStringList tokens;
+        std::int64_t count = 0;
+    };
+
+    Node* findLeaf(const QStringList& tokens);
+    double getSimilarity(const QStringList& templateTokens, const QStringList& tokens, int& wildcards) const;
+
+private:
+    Settings settings;
+    Node root;
+    std::vector<Template> templates;
+};
+}
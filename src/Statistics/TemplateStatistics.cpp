@@ -0,0 +1,159 @@
+#include "TemplateStatistics.h"
+#include "TemplateMiner.h"
+#include "LogHistogram.h"
+#include "ModuleWorkers.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Statistics
+{
+std::vector<TemplateChange> TemplateStatisticsResult::rankChanges(const std::chrono::system_clock::time_point& baselineStart,
+                                                                  const std::chrono::system_clock::time_point& baselineEnd,
+                                                                  const std::chrono::system_clock::time_point& targetStart,
+                                                                  const std::chrono::system_clock::time_point& targetEnd) const
+{
+    size_t baselineBuckets = 0;
+    size_t targetBuckets = 0;
+    std::vector<std::int8_t> ranges(bucketStarts.size());
+    for (size_t i = 0; i < bucketStarts.size(); ++i)
+    {
+        if (bucketStarts[i] >= baselineStart && bucketStarts[i] < baselineEnd)
+        {
+            ranges[i] = 1;
+            ++baselineBuckets;
+        }
+        else if (bucketStarts[i] >= targetStart && bucketStarts[i] < targetEnd)
+        {
+            ranges[i] = 2;
+            ++targetBuckets;
+        }
+    }
+
+    std::vector<TemplateChange> changes;
+    if (baselineBuckets == 0 || targetBuckets == 0)
+        return changes;
+
+    for (size_t index = 0; index < templates.size(); ++index)
+    {
+        TemplateChange change;
+        change.index = index;
+        for (size_t i = 0; i < ranges.size(); ++i)
+        {
+            if (ranges[i] == 1)
+                change.before += templates[index].counts[i];
+            else if (ranges[i] == 2)
+                change.after += templates[index].counts[i];
+        }
+
+        // Log ratio of the per-bucket rates, smoothed so that templates appearing from nothing still rank finitely
+        double beforeRate = (change.before + 1.0) / baselineBuckets;
+        double afterRate = (change.after + 1.0) / targetBuckets;
+        change.score = std::log2(afterRate / beforeRate);
+        changes.push_back(change);
+    }
+
+    std::sort(changes.begin(), changes.end(), [](const TemplateChange& lhs, const TemplateChange& rhs) {
+        return lhs.score > rhs.score;
+    });
+    return changes;
+}
+
+TemplateStatisticsResult TemplateStatistics::calculate(Session& session,
+                                                       const std::chrono::system_clock::time_point& start,
+                                                       const std::chrono::system_clock::time_point& end,
+                                                       const TemplateSpec& spec)
+{
+    TemplateStatisticsResult result;
+    result.spec = spec;
+    result.start = start;
+    result.end = end;
+    result.bucketSize = spec.bucketSize > std::chrono::system_clock::duration::zero() ? spec.bucketSize : LogHistogram::suggestBucketSize(start, end);
+
+    auto buckets = LogHistogram::createBuckets(start, end, result.bucketSize);
+    if (buckets.empty())
+        return result;
+    for (const auto& bucket : buckets)
+        result.bucketStarts.push_back(bucket.start);
+
+    const auto& moduleSet = session.getModules();
+    std::vector<QString> modules(moduleSet.begin(), moduleSet.end());
+
+    struct Partial
+    {
+        TemplateMiner miner;
+        std::vector<std::vector<std::int64_t>> counts;
+    };
+
+    // Every worker mines its modules with its own miner, the templates are merged into one miner afterwards
+    std::vector<Partial> partials(getWorkerCount(modules.size()));
+    forEachModule(modules.size(), partials.size(), [&](size_t module, size_t worker) {
+        auto& partial = partials[worker];
+        auto iterator = session.getModuleIterator(modules[module], start, end);
+
+        while (iterator.hasLogs())
+        {
+            auto entry = iterator.next();
+            if (!entry)
+                break;
+
+            auto index = (entry->time - start) / result.bucketSize;
+            if (index < 0 || static_cast<size_t>(index) >= buckets.size())
+                continue;
+
+            QString message;
+            if (spec.field.isEmpty())
+            {
+                message = entry->line;
+            }
+            else
+            {
+                auto it = entry->values.find(spec.field);
+                if (it == entry->values.end())
+                    continue;
+                message = it->second.toString();
+            }
+
+            auto id = static_cast<size_t>(partial.miner.add(message));
+            if (id >= partial.counts.size())
+                partial.counts.resize(id + 1, std::vector<std::int64_t>(buckets.size()));
+            ++partial.counts[id][static_cast<size_t>(index)];
+        }
+    });
+
+    TemplateMiner miner;
+    std::vector<std::vector<std::int64_t>> counts;
+    for (const auto& partial : partials)
+    {
+        for (size_t id = 0; id < partial.counts.size(); ++id)
+        {
+            if (partial.miner.getCount(static_cast<int>(id)) == 0)
+                continue;
+
+            auto globalId = static_cast<size_t>(id == TemplateMiner::OverflowId
+                ? TemplateMiner::OverflowId
+                : miner.add(partial.miner.getTemplate(static_cast<int>(id)), partial.miner.getCount(static_cast<int>(id))));
+            if (globalId >= counts.size())
+                counts.resize(globalId + 1, std::vector<std::int64_t>(buckets.size()));
+            for (size_t bucket = 0; bucket < buckets.size(); ++bucket)
+                counts[globalId][bucket] += partial.counts[id][bucket];
+        }
+    }
+
+    for (size_t id = 0; id < counts.size(); ++id)
+    {
+        TemplateSeries series;
+        series.text = miner.getTemplate(static_cast<int>(id));
+        series.counts = std::move(counts[id]);
+        for (auto count : series.counts)
+            series.total += count;
+        if (series.total > 0)
+            result.templates.push_back(std::move(series));
+    }
+
+    std::sort(result.templates.begin(), result.templates.end(), [](const TemplateSeries& lhs, const TemplateSeries& rhs) {
+        return lhs.total > rhs.total;
+    });
+    return result;
+}
+}
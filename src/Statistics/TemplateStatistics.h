@@ -0,0 +1,65 @@
+#pragma once
+
+#include "LogManagement/Session.h"
+
+#include <QString>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Statistics
+{
+struct TemplateSpec
+{
+    // Field holding the message, empty mines the whole line
+    QString field;
+    // Zero selects the bucket size from the time range
+    std::chrono::system_clock::duration bucketSize = std::chrono::system_clock::duration::zero();
+};
+
+struct TemplateSeries
+{
+    QString text;
+    std::int64_t total = 0;
+    std::vector<std::int64_t> counts;
+};
+
+struct TemplateChange
+{
+    size_t index = 0;
+    std::int64_t before = 0;
+    std::int64_t after = 0;
+    double score = 0;
+};
+
+struct TemplateStatisticsResult
+{
+    TemplateSpec spec;
+    std::chrono::system_clock::time_point start;
+    std::chrono::system_clock::time_point end;
+    std::chrono::system_clock::duration bucketSize = std::chrono::system_clock::duration::zero();
+    std::vector<std::chrono::system_clock::time_point> bucketStarts;
+    // Sorted by total count, most frequent first
+    std::vector<TemplateSeries> templates;
+
+    // Compares the rate of every template in the buckets starting within [baselineStart, baselineEnd)
+    // to the ones within [targetStart, targetEnd), the biggest growth first
+    std::vector<TemplateChange> rankChanges(const std::chrono::system_clock::time_point& baselineStart,
+                                            const std::chrono::system_clock::time_point& baselineEnd,
+                                            const std::chrono::system_clock::time_point& targetStart,
+                                            const std::chrono::system_clock::time_point& targetEnd) const;
+};
+
+class TemplateStatistics
+{
+public:
+    static TemplateStatisticsResult calculate(Session& session,
+                                              const std::chrono::system_clock::time_point& start,
+                                              const std::chrono::system_clock::time_point& end,
+                                              const TemplateSpec& spec);
+};
+}
+
+Q_DECLARE_METATYPE(Statistics::TemplateSpec)
+Q_DECLARE_METATYPE(Statistics::TemplateStatisticsResult)
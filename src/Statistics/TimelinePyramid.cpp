@@ -0,0 +1,151 @@
+#include "TimelinePyramid.h"
+#include "ModuleWorkers.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+namespace Statistics
+{
+TimelinePyramid::TimelinePyramid(const Session& session)
+{
+    std::vector<TimestampScanner> scanners;
+    for (const auto& module : session.getModules())
+    {
+        modules.push_back(module);
+        scanners.push_back(session.getTimestampScanner(module, session.getMinTime(), session.getMaxTime()));
+    }
+    moduleLevels.resize(modules.size());
+
+    buildThread = std::thread(&TimelinePyramid::build, this, std::move(scanners));
+}
+
+TimelinePyramid::~TimelinePyramid()
+{
+    stop = true;
+    if (buildThread.joinable())
+        buildThread.join();
+}
+
+bool TimelinePyramid::isReady() const
+{
+    return ready;
+}
+
+std::optional<std::vector<Bucket>> TimelinePyramid::query(const std::chrono::system_clock::time_point& start,
+                                                          const std::chrono::system_clock::time_point& end,
+                                                          const std::chrono::system_clock::duration& bucketSize,
+                                                          const std::unordered_set<QString>& selectedModules) const
+{
+    if (!ready)
+        return std::nullopt;
+
+    // A bucket edge inside a second would split a slot, those ranges are left to an exact scan
+    auto second = std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::seconds(1));
+    if (bucketSize % second != std::chrono::system_clock::duration::zero()
+        || start.time_since_epoch() % second != std::chrono::system_clock::duration::zero()
+        || end.time_since_epoch() % second != std::chrono::system_clock::duration::zero())
+        return std::nullopt;
+
+    auto result = LogHistogram::createBuckets(start, end, bucketSize);
+    if (result.empty())
+        return result;
+
+    size_t level = selectLevel(start, end, bucketSize);
+    auto period = std::chrono::duration_cast<std::chrono::system_clock::duration>(LevelPeriods[level]);
+    auto firstIndex = getSlotIndex(start, level);
+
+    for (size_t i = 0; i < modules.size(); ++i)
+    {
+        if (!selectedModules.empty() && !selectedModules.contains(modules[i]))
+            continue;
+
+        const auto& levelSlots = moduleLevels[i][level];
+        auto it = std::lower_bound(levelSlots.begin(), levelSlots.end(), firstIndex, [](const Slot& slot, std::int64_t index) {
+            return slot.index < index;
+        });
+        for (; it != levelSlots.end(); ++it)
+        {
+            auto slotStart = std::chrono::system_clock::time_point(period * it->index);
+            if (slotStart >= end)
+                break;
+
+            auto index = slotStart > start ? static_cast<std::size_t>((slotStart - start) / bucketSize) : 0;
+            if (index < result.size())
+                result[index].count += it->count;
+        }
+    }
+
+    return result;
+}
+
+void TimelinePyramid::addTime(Levels& levels, const std::chrono::system_clock::time_point& time)
+{
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        auto& levelSlots = levels[level];
+        auto index = getSlotIndex(time, level);
+
+        // Times of one module come in order, so a slot is almost always the last one or a new one
+        if (levelSlots.empty() || levelSlots.back().index < index)
+        {
+            levelSlots.push_back({ index, 1 });
+            continue;
+        }
+
+        auto it = std::lower_bound(levelSlots.begin(), levelSlots.end(), index, [](const Slot& slot, std::int64_t value) {
+            return slot.index < value;
+        });
+        if (it->index == index)
+            ++it->count;
+        else
+            levelSlots.insert(it, { index, 1 });
+    }
+}
+
+std::int64_t TimelinePyramid::getSlotIndex(const std::chrono::system_clock::time_point& time, size_t level)
+{
+    auto seconds = std::chrono::floor<std::chrono::seconds>(time.time_since_epoch()).count();
+    auto period = LevelPeriods[level].count();
+    return seconds >= 0 ? seconds / period : (seconds - period + 1) / period;
+}
+
+size_t TimelinePyramid::selectLevel(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const std::chrono::system_clock::duration& bucketSize)
+{
+    // Both edges must fall on the period, a slot cut by either of them would be counted whole
+    for (size_t level = LevelPeriods.size() - 1; level > 0; --level)
+    {
+        auto period = std::chrono::duration_cast<std::chrono::system_clock::duration>(LevelPeriods[level]);
+        if (bucketSize % period == std::chrono::system_clock::duration::zero()
+            && start.time_since_epoch() % period == std::chrono::system_clock::duration::zero()
+            && end.time_since_epoch() % period == std::chrono::system_clock::duration::zero())
+            return level;
+    }
+    return 0;
+}
+
+void TimelinePyramid::build(std::vector<TimestampScanner> scanners)
+{
+    try
+    {
+        forEachModule(scanners.size(), getWorkerCount(scanners.size()), [this, &scanners](size_t module, size_t) {
+            while (!stop)
+            {
+                auto time = scanners[module].next();
+                if (!time)
+                    break;
+                addTime(moduleLevels[module], time.value());
+            }
+        });
+    }
+    catch (const std::exception& ex)
+    {
+        // Queries keep falling back to scanning the files
+        qWarning() << "Failed to build the timeline pyramid:" << ex.what();
+        return;
+    }
+
+    if (!stop)
+        ready = true;
+}
+}
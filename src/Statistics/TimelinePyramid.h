@@ -0,0 +1,63 @@
+#pragma once
+
+#include "LogHistogram.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Statistics
+{
+// Entry counts of a session per module at second, minute, hour and day resolution.
+// The counts are collected once in the background, after that any range over whole seconds
+// is answered exactly from the coarsest level that fits the requested buckets.
+class TimelinePyramid
+{
+public:
+    explicit TimelinePyramid(const Session& session);
+    ~TimelinePyramid();
+
+    TimelinePyramid(const TimelinePyramid&) = delete;
+    TimelinePyramid& operator=(const TimelinePyramid&) = delete;
+
+    bool isReady() const;
+
+    std::optional<std::vector<Bucket>> query(const std::chrono::system_clock::time_point& start,
+                                             const std::chrono::system_clock::time_point& end,
+                                             const std::chrono::system_clock::duration& bucketSize,
+                                             const std::unordered_set<QString>& modules = {}) const;
+
+private:
+    struct Slot
+    {
+        std::int64_t index = 0;
+        int count = 0;
+    };
+
+    static constexpr std::array<std::chrono::seconds, 4> LevelPeriods = {
+        std::chrono::seconds(1), std::chrono::minutes(1), std::chrono::hours(1), std::chrono::days(1)
+    };
+
+    typedef std::array<std::vector<Slot>, LevelPeriods.size()> Levels;
+
+    static std::int64_t getSlotIndex(const std::chrono::system_clock::time_point& time, size_t level);
+    static void addTime(Levels& levels, const std::chrono::system_clock::time_point& time);
+    static size_t selectLevel(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const std::chrono::system_clock::duration& bucketSize);
+
+    void build(std::vector<TimestampScanner> scanners);
+
+private:
+    std::vector<QString> modules;
+    std::vector<Levels> moduleLevels;
+
+    std::atomic<bool> ready = false;
+    std::atomic<bool> stop = false;
+    std::thread buildThread;
+};
+}
@@ -0,0 +1,73 @@
+#include "TemplateDialog.h"
+#include "Utils.h"
+
+#include <QDateTimeEdit>
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+
+TemplateDialog::TemplateDialog(const Statistics::TemplateStatisticsResult& result, QWidget* parent) :
+    QDialog(parent),
+    result(result)
+{
+    setWindowTitle(tr("Message patterns"));
+
+    auto layout = new QVBoxLayout(this);
+    setLayout(layout);
+
+    // Entries before the split are the baseline the later ones are compared to
+    splitEdit = new QDateTimeEdit(this);
+    splitEdit->setDisplayFormat("yyyy-MM-dd HH:mm:ss");
+    splitEdit->setDateTimeRange(DateTimeFromChronoSystemClock(result.start), DateTimeFromChronoSystemClock(result.end));
+    splitEdit->setDateTime(DateTimeFromChronoSystemClock(result.start + (result.end - result.start) / 2));
+
+    auto formLayout = new QFormLayout();
+    formLayout->addRow(tr("Compare from:"), splitEdit);
+    layout->addLayout(formLayout);
+
+    table = new QTableWidget(this);
+    table->setColumnCount(5);
+    table->setHorizontalHeaderLabels({ tr("Pattern"), tr("Total"), tr("Before"), tr("After"), tr("Change") });
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->verticalHeader()->setVisible(false);
+    table->horizontalHeader()->setStretchLastSection(false);
+    layout->addWidget(table);
+
+    connect(splitEdit, &QDateTimeEdit::dateTimeChanged, this, &TemplateDialog::updateRanking);
+
+    updateRanking();
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    resize(900, 500);
+}
+
+void TemplateDialog::updateRanking()
+{
+    auto split = ChronoSystemClockFromDateTime(splitEdit->dateTime());
+    auto changes = result.rankChanges(result.start, split, split, result.end);
+
+    table->setRowCount(0);
+    if (changes.empty())
+    {
+        // Without two ranges to compare the patterns are only listed by frequency
+        for (size_t index = 0; index < result.templates.size(); ++index)
+            changes.push_back({ index, 0, result.templates[index].total, 0 });
+    }
+
+    table->setRowCount(static_cast<int>(changes.size()));
+    for (int row = 0; row < table->rowCount(); ++row)
+    {
+        const auto& change = changes[row];
+        const auto& series = result.templates[change.index];
+
+        table->setItem(row, 0, new QTableWidgetItem(series.text));
+        table->setItem(row, 1, new QTableWidgetItem(QString::number(series.total)));
+        table->setItem(row, 2, new QTableWidgetItem(QString::number(change.before)));
+        table->setItem(row, 3, new QTableWidgetItem(QString::number(change.after)));
+        table->setItem(row, 4, new QTableWidgetItem(QString::number(change.score, 'f', 2)));
+    }
+
+    table->resizeColumnsToContents();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QDialog>
+
+#include "Statistics/TemplateStatistics.h"
+
+class QDateTimeEdit;
+class QTableWidget;
+
+class TemplateDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit TemplateDialog(const Statistics::TemplateStatisticsResult& result, QWidget* parent = nullptr);
+
+private:
+    void updateRanking();
+
+private:
+    Statistics::TemplateStatisticsResult result;
+    QDateTimeEdit* splitEdit = nullptr;
+    QTableWidget* table = nullptr;
+};
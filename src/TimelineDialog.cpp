@@ -7,34 +7,109 @@
 #include <QtCharts/QBarSet>
 #include <QtCharts/QChart>
 #include <QtCharts/QChartView>
+#include <QtCharts/QStackedBarSeries>
 #include <QtCharts/QValueAxis>
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QSignalBlocker>
 #include <QVBoxLayout>
 
 
-TimelineDialog::TimelineDialog(const std::vector<Statistics::Bucket>& data, QWidget* parent) : QDialog(parent)
+TimelineDialog::TimelineDialog(const Statistics::AggregationResult& data, const QStringList& groupFields, const QStringList& valueFields, QWidget* parent) : QDialog(parent)
 {
     auto layout = new QVBoxLayout(this);
     setLayout(layout);
 
-    populateChart(data);
+    auto controls = new QHBoxLayout();
+
+    groupByBox = new QComboBox(this);
+    groupByBox->addItem(tr("None"), QString());
+    groupByBox->addItem(tr("Module"), Statistics::AggregationSpec::ModuleKey);
+    for (const auto& field : groupFields)
+        groupByBox->addItem(field, field);
+    controls->addWidget(new QLabel(tr("Group by"), this));
+    controls->addWidget(groupByBox);
+
+    functionBox = new QComboBox(this);
+    functionBox->addItem(tr("Count"), static_cast<int>(Statistics::AggregationSpec::Function::Count));
+    functionBox->addItem(tr("Min"), static_cast<int>(Statistics::AggregationSpec::Function::Min));
+    functionBox->addItem(tr("Max"), static_cast<int>(Statistics::AggregationSpec::Function::Max));
+    functionBox->addItem(tr("Sum"), static_cast<int>(Statistics::AggregationSpec::Function::Sum));
+    functionBox->addItem(tr("Average"), static_cast<int>(Statistics::AggregationSpec::Function::Avg));
+    functionBox->setEnabled(!valueFields.isEmpty());
+    controls->addWidget(functionBox);
+
+    valueFieldBox = new QComboBox(this);
+    valueFieldBox->addItems(valueFields);
+    controls->addWidget(valueFieldBox);
+    controls->addStretch();
+
+    backButton = new QPushButton(tr("Back"), this);
+    backButton->setEnabled(false);
+    controls->addWidget(backButton);
+    layout->addLayout(controls);
+
+    chartView = new QChartView(this);
+    chartView->setRenderHint(QPainter::Antialiasing);
+    layout->addWidget(chartView);
+
+    connect(groupByBox, &QComboBox::currentIndexChanged, this, &TimelineDialog::requestAggregation);
+    connect(functionBox, &QComboBox::currentIndexChanged, this, &TimelineDialog::requestAggregation);
+    connect(valueFieldBox, &QComboBox::currentIndexChanged, this, &TimelineDialog::requestAggregation);
+    connect(backButton, &QPushButton::clicked, this, &TimelineDialog::goBack);
+
+    current = data;
+    populateChart(current);
 }
 
-void TimelineDialog::populateChart(const std::vector<Statistics::Bucket>& data)
+void TimelineDialog::setData(const Statistics::AggregationResult& data)
 {
-    auto series = new QBarSeries(this);
-    auto set = new QBarSet(tr("Messages"));
+    history.push_back(std::move(current));
+    backButton->setEnabled(true);
+
+    current = data;
+    populateChart(current);
+}
+
+void TimelineDialog::populateChart(const Statistics::AggregationResult& data)
+{
+    updateControls(data.spec);
+
+    QString timeFormat = "HH:mm";
+    if (data.bucketSize < std::chrono::minutes(1))
+        timeFormat = "HH:mm:ss";
+    else if (data.bucketSize >= std::chrono::days(1))
+        timeFormat = "yyyy-MM-dd";
+
     QStringList categories;
-    for (const auto& bucket : data)
+    for (const auto& start : data.bucketStarts)
+        categories << DateTimeFromChronoSystemClock(start).toString(timeFormat);
+
+    // Counts and sums add up across groups, other functions are shown side by side
+    bool stacked = data.spec.function == Statistics::AggregationSpec::Function::Count || data.spec.function == Statistics::AggregationSpec::Function::Sum;
+    QAbstractBarSeries* series = stacked ? static_cast<QAbstractBarSeries*>(new QStackedBarSeries()) : new QBarSeries();
+    for (const auto& values : data.series)
     {
-        *set << bucket.count;
-        categories << DateTimeFromChronoSystemClock(bucket.start).toString("HH:mm");
+        QString label = values.key;
+        if (data.spec.groupBy.isEmpty())
+            label = data.spec.function == Statistics::AggregationSpec::Function::Count ? tr("Messages") : data.spec.valueField;
+        else if (label.isEmpty())
+            label = tr("(none)");
+
+        auto set = new QBarSet(label);
+        for (double value : values.values)
+            *set << value;
+        series->append(set);
+        connect(set, &QBarSet::clicked, this, &TimelineDialog::drillDown);
     }
-    series->append(set);
 
     auto chart = new QChart();
     chart->addSeries(series);
     chart->setTitle(tr("Timeline"));
     chart->setAnimationOptions(QChart::SeriesAnimations);
+    chart->legend()->setVisible(!data.spec.groupBy.isEmpty());
 
     auto axisX = new QBarCategoryAxis();
     axisX->append(categories);
@@ -45,10 +120,57 @@ void TimelineDialog::populateChart(const std::vector<Statistics::Bucket>& data)
     chart->addAxis(axisY, Qt::AlignLeft);
     series->attachAxis(axisY);
 
-    auto chartView = new QChartView(chart, this);
-    chartView->setRenderHint(QPainter::Antialiasing);
+    auto oldChart = chartView->chart();
+    chartView->setChart(chart);
+    delete oldChart;
+}
+
+void TimelineDialog::updateControls(const Statistics::AggregationSpec& spec)
+{
+    QSignalBlocker groupByBlocker(groupByBox);
+    QSignalBlocker functionBlocker(functionBox);
+    QSignalBlocker valueFieldBlocker(valueFieldBox);
+
+    groupByBox->setCurrentIndex(std::max(0, groupByBox->findData(spec.groupBy)));
+    functionBox->setCurrentIndex(std::max(0, functionBox->findData(static_cast<int>(spec.function))));
+    if (!spec.valueField.isEmpty())
+        valueFieldBox->setCurrentText(spec.valueField);
+    valueFieldBox->setEnabled(spec.function != Statistics::AggregationSpec::Function::Count);
+}
+
+Statistics::AggregationSpec TimelineDialog::getSpec() const
+{
+    Statistics::AggregationSpec spec;
+    spec.groupBy = groupByBox->currentData().toString();
+    spec.function = static_cast<Statistics::AggregationSpec::Function>(functionBox->currentData().toInt());
+    spec.valueField = valueFieldBox->currentText();
+    if (spec.valueField.isEmpty())
+        spec.function = Statistics::AggregationSpec::Function::Count;
+    return spec;
+}
 
-    if (layout())
-        layout()->addWidget(chartView);
+void TimelineDialog::requestAggregation()
+{
+    valueFieldBox->setEnabled(functionBox->currentData().toInt() != static_cast<int>(Statistics::AggregationSpec::Function::Count));
+    emit aggregationRequested(current.start, current.end, getSpec());
+}
+
+void TimelineDialog::drillDown(int index)
+{
+    if (index < 0 || static_cast<size_t>(index) >= current.bucketStarts.size() || current.bucketSize <= std::chrono::seconds(1))
+        return;
+
+    auto start = current.bucketStarts[index];
+    emit aggregationRequested(start, std::min(start + current.bucketSize, current.end), getSpec());
 }
 
+void TimelineDialog::goBack()
+{
+    if (history.empty())
+        return;
+
+    current = std::move(history.back());
+    history.pop_back();
+    backButton->setEnabled(!history.empty());
+    populateChart(current);
+}
@@ -3,15 +3,39 @@
 #include <QDialog>
 #include <vector>
 
-#include "Statistics/LogHistogram.h"
+#include "Statistics/Aggregation.h"
+
+class QChartView;
+class QComboBox;
+class QPushButton;
 
 class TimelineDialog : public QDialog
 {
     Q_OBJECT
 public:
-    explicit TimelineDialog(const std::vector<Statistics::Bucket>& data, QWidget* parent = nullptr);
+    explicit TimelineDialog(const Statistics::AggregationResult& data, const QStringList& groupFields, const QStringList& valueFields, QWidget* parent = nullptr);
+
+    void setData(const Statistics::AggregationResult& data);
+
+signals:
+    void aggregationRequested(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const Statistics::AggregationSpec& spec);
 
 private:
-    void populateChart(const std::vector<Statistics::Bucket>& data);
-};
+    void populateChart(const Statistics::AggregationResult& data);
+    void updateControls(const Statistics::AggregationSpec& spec);
+    Statistics::AggregationSpec getSpec() const;
 
+    void requestAggregation();
+    void drillDown(int index);
+    void goBack();
+
+private:
+    QChartView* chartView = nullptr;
+    QComboBox* groupByBox = nullptr;
+    QComboBox* functionBox = nullptr;
+    QComboBox* valueFieldBox = nullptr;
+    QPushButton* backButton = nullptr;
+
+    Statistics::AggregationResult current;
+    std::vector<Statistics::AggregationResult> history;
+};
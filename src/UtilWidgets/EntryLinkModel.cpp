@@ -33,3 +33,32 @@ QVariant EntryLinkModel::data(const QModelIndex& index, int role) const
 
     return QVariant();
 }
+
+void EntryLinkModel::addEntries(const QMap<std::chrono::system_clock::time_point, QString>& newEntries)
+{
+    if (newEntries.isEmpty())
+        return;
+
+    if (entries.empty() || entries.rbegin()->first < newEntries.firstKey())
+    {
+        int first = static_cast<int>(entries.size());
+        beginInsertRows(QModelIndex(), first, first + newEntries.size() - 1);
+        entries.reserve(entries.size() + newEntries.size());
+        for (auto it = newEntries.begin(); it != newEntries.end(); ++it)
+            entries.emplace_hint(entries.end(), it.key(), it.value());
+        endInsertRows();
+        return;
+    }
+
+    for (auto it = newEntries.begin(); it != newEntries.end(); ++it)
+    {
+        auto pos = entries.lower_bound(it.key());
+        if (pos != entries.end() && pos->first == it.key())
+            continue;
+
+        int row = static_cast<int>(entries.index_of(pos));
+        beginInsertRows(QModelIndex(), row, row);
+        entries.emplace_hint(pos, it.key(), it.value());
+        endInsertRows();
+    }
+}
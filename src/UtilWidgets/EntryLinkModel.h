@@ -23,6 +23,8 @@ public:
 
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
 
+    void addEntries(const QMap<std::chrono::system_clock::time_point, QString>& newEntries);
+
 private:
     boost::container::flat_map<std::chrono::system_clock::time_point, QString> entries;
 };
@@ -5,29 +5,46 @@
 
 #include <QListView>
 #include <QHideEvent>
+#include <QPushButton>
+#include <QVBoxLayout>
 
 
 SearchResultsWidget::SearchResultsWidget(QWidget* parent) :
     QDockWidget(parent)
 {
-    mResults = new EntryLinkView(this);
+    auto container = new QWidget(this);
+    auto layout = new QVBoxLayout(container);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    mResults = new EntryLinkView(container);
 
     QSizePolicy sizePolicy(QSizePolicy::Policy::Expanding, QSizePolicy::Policy::Expanding);
     sizePolicy.setHorizontalStretch(1);
     sizePolicy.setVerticalStretch(1);
     mResults->setSizePolicy(sizePolicy);
 
-    setWidget(mResults);
+    layout->addWidget(mResults);
+
+    mLoadMore = new QPushButton(tr("Load more results"), container);
+    mLoadMore->hide();
+    layout->addWidget(mLoadMore);
+
+    setWidget(container);
     hide();
 
     setAllowedAreas(Qt::DockWidgetArea::TopDockWidgetArea | Qt::DockWidgetArea::BottomDockWidgetArea);
 
     connect(mResults, &EntryLinkView::entryActivated, this, &SearchResultsWidget::selectedResult);
+    connect(mLoadMore, &QPushButton::clicked, this, [this]() {
+        mLoadMore->setEnabled(false);
+        emit moreResultsRequested();
+    });
 }
 
 void SearchResultsWidget::clearResults()
 {
     mResults->setModel(nullptr);
+    mLoadMore->hide();
 }
 
 void SearchResultsWidget::showResults(const QMap<std::chrono::system_clock::time_point, QString>& results)
@@ -48,6 +65,51 @@ void SearchResultsWidget::showResults(const QMap<std::chrono::system_clock::time
     QT_SLOT_END
 }
 
+void SearchResultsWidget::startResults()
+{
+    QT_SLOT_BEGIN
+
+    mLoadMore->hide();
+    resetModel(new EntryLinkModel({}, this));
+
+    QT_SLOT_END
+}
+
+void SearchResultsWidget::appendResults(const QMap<std::chrono::system_clock::time_point, QString>& results)
+{
+    QT_SLOT_BEGIN
+
+    auto model = qobject_cast<EntryLinkModel*>(mResults->model());
+    if (!model)
+    {
+        model = new EntryLinkModel({}, this);
+        resetModel(model);
+    }
+
+    model->addEntries(results);
+    if (model->rowCount() > 0)
+        show();
+
+    QT_SLOT_END
+}
+
+void SearchResultsWidget::finishResults(bool hasMore)
+{
+    QT_SLOT_BEGIN
+
+    auto model = mResults->model();
+    if (!model || model->rowCount() == 0)
+    {
+        hide();
+        return;
+    }
+
+    mLoadMore->setVisible(hasMore);
+    mLoadMore->setEnabled(true);
+
+    QT_SLOT_END
+}
+
 void SearchResultsWidget::hideEvent(QHideEvent* event)
 {
     QDockWidget::hideEvent(event);
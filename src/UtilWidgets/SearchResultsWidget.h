@@ -7,6 +7,7 @@
 
 
 class QListView;
+class QPushButton;
 class EntryLinkModel;
 
 class SearchResultsWidget : public QDockWidget
@@ -22,10 +23,15 @@ public:
 signals:
     void selectedResult(const std::chrono::system_clock::time_point& result);
     void handleError(const QString& msg);
+    void moreResultsRequested();
 
 public slots:
     void showResults(const QMap<std::chrono::system_clock::time_point, QString>& results);
 
+    void startResults();
+    void appendResults(const QMap<std::chrono::system_clock::time_point, QString>& results);
+    void finishResults(bool hasMore);
+
 private:
     void hideEvent(QHideEvent* event) override;
 
@@ -33,4 +39,5 @@ private:
 
 private:
     EntryLinkView* mResults = nullptr;
+    QPushButton* mLoadMore = nullptr;
 };
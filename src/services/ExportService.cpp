@@ -2,7 +2,25 @@
 #include "SessionService.h"
 #include "Utils.h"
 #include "LogView/LogModel.h"
+#include "LogManagement/SnapshotWriter.h"
 
+#include <QFileInfo>
+
+#include <algorithm>
+
+
+namespace
+{
+    ExportWriter::Compression getCompression(const QString& filename)
+    {
+        return filename.endsWith(QStringLiteral(".gz"), Qt::CaseInsensitive) ? ExportWriter::Compression::Gzip : ExportWriter::Compression::None;
+    }
+
+    bool isSnapshot(const QString& filename)
+    {
+        return filename.endsWith(Snapshot::Extension, Qt::CaseInsensitive);
+    }
+}
 
 ExportService::ExportService(SessionService* sessionService, QObject* parent) :
     QObject(parent),
@@ -15,10 +33,18 @@ void ExportService::exportData(const QString& filename, const std::chrono::syste
 
     emit progressUpdated(QStringLiteral("Exporting data to %1 ...").arg(filename), 0);
 
-    exportDataToFile(filename, startTime, endTime, [](QFile& file, const LogEntry& entry) {
-        file.write(entry.line.toUtf8());
-        file.write("\n");
-    });
+    // Source files are copied as they are, so the fast path cannot produce snapshots or compressed output
+    if (isSnapshot(filename))
+    {
+        exportSnapshot(filename, startTime, endTime, CompiledLogFilter());
+    }
+    else if (getCompression(filename) != ExportWriter::Compression::None || !copyRawRanges(filename, startTime, endTime))
+    {
+        exportDataToFile(filename, startTime, endTime, CompiledLogFilter(), [](QString& out, const LogEntry& entry) {
+            out += entry.line;
+            out += '\n';
+        });
+    }
 
     emit progressUpdated(QStringLiteral("Export finished"), 100);
 
@@ -31,13 +57,17 @@ void ExportService::exportData(const QString& filename, const std::chrono::syste
 
     emit progressUpdated(QStringLiteral("Exporting data to %1 ...").arg(filename), 0);
 
-    exportDataToFile(filename, startTime, endTime, [&fields, &filter](QFile& file, const LogEntry& entry) {
-        if (!filter.check(entry))
-            return;
-
-        file.write(entry.line.toUtf8());
-        file.write("\n");
-    });
+    if (isSnapshot(filename))
+    {
+        exportSnapshot(filename, startTime, endTime, filter.compile());
+    }
+    else
+    {
+        exportDataToFile(filename, startTime, endTime, filter.compile(), [](QString& out, const LogEntry& entry) {
+            out += entry.line;
+            out += '\n';
+        });
+    }
 
     emit progressUpdated(QStringLiteral("Export finished"), 100);
 
@@ -50,25 +80,25 @@ void ExportService::exportDataToTable(const QString& filename, const std::chrono
 
     emit progressUpdated(QStringLiteral("Exporting data to %1 ...").arg(filename), 0);
 
-    exportDataToFile(filename, startTime, endTime, [&fields](QFile& file, const LogEntry& entry) {
+    exportDataToFile(filename, startTime, endTime, CompiledLogFilter(), [&fields](QString& out, const LogEntry& entry) {
         for (int i = 0; i < fields.size(); ++i)
         {
             const auto& field = fields[i];
             auto value = entry.values.find(field);
             if (value != entry.values.end())
-                file.write(value->second.toString().toUtf8());
+                out += value->second.toString();
             else if (i == static_cast<int>(LogModel::PredefinedColumn::Module))
-                file.write(entry.module.toUtf8());
-            file.write(";");
+                out += entry.module;
+            out += ';';
         }
 
         if (!entry.additionalLines.isEmpty())
         {
-            file.write("\n");
-            file.write(entry.additionalLines.toUtf8());
+            out += '\n';
+            out += entry.additionalLines;
         }
 
-        file.write("\n");
+        out += '\n';
     }, fields);
 
     emit progressUpdated(QStringLiteral("Export finished"), 100);
@@ -82,28 +112,25 @@ void ExportService::exportDataToTable(const QString& filename, const std::chrono
 
     emit progressUpdated(QStringLiteral("Exporting data to %1 ...").arg(filename), 0);
 
-    exportDataToFile(filename, startTime, endTime, [&fields, &filter](QFile& file, const LogEntry& entry) {
-        if (!filter.check(entry))
-            return;
-
+    exportDataToFile(filename, startTime, endTime, filter.compile(), [&fields](QString& out, const LogEntry& entry) {
         for (int i = 0; i < fields.size(); ++i)
         {
             const auto& field = fields[i];
             auto value = entry.values.find(field);
             if (value != entry.values.end())
-                file.write(value->second.toString().toUtf8());
+                out += value->second.toString();
             else if (i == static_cast<int>(LogModel::PredefinedColumn::Module))
-                file.write(entry.module.toUtf8());
-            file.write(";");
+                out += entry.module;
+            out += ';';
         }
 
         if (!entry.additionalLines.isEmpty())
         {
-            file.write("\n");
-            file.write(entry.additionalLines.toUtf8());
+            out += '\n';
+            out += entry.additionalLines;
         }
 
-        file.write("\n");
+        out += '\n';
     }, fields);
 
     emit progressUpdated(QStringLiteral("Export finished"), 100);
@@ -181,46 +208,192 @@ void ExportService::exportData(const QString& filename, QTreeView* view)
     QT_SLOT_END
 }
 
-void ExportService::exportDataToFile(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime,
-                                     const std::function<void (QFile&, const LogEntry&)>& writeFunction,
-                                     const std::function<void (QFile& file)>& prefix)
+bool ExportService::copyRawRanges(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime)
 {
     auto session = sessionService->getSession();
-    if (!session)
+    if (!session || startTime > endTime)
+        return false;
+
+    auto ranges = session->getRawRanges(startTime, endTime);
+    if (!ranges)
+        return false;
+
+    // The bytes are copied as they are, so no text mode conversion
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Unbuffered))
     {
-        qCritical() << "Session is not initialized.";
+        qCritical() << "Failed to open file for writing:" << file.errorString();
+        return true;
+    }
+
+    qint64 total = 0;
+    for (auto& range : ranges.value())
+    {
+        if (range.end < 0)
+            range.end = QFileInfo(range.filename).size();
+        total += range.end - range.begin;
+    }
+
+    QByteArray buffer;
+    qint64 copied = 0;
+    int lastPercent = 0;
+    for (const auto& range : ranges.value())
+    {
+        QFile source(range.filename);
+        if (!source.open(QIODevice::ReadOnly))
+        {
+            qCritical() << "Failed to open" << range.filename << ":" << source.errorString();
+            return true;
+        }
+
+        qint64 begin = range.begin;
+        if (begin == 0 && source.peek(3) == QByteArray("\xEF\xBB\xBF", 3))
+            begin = 3;
+        source.seek(begin);
+
+        char lastChar = '\n';
+        for (qint64 left = range.end - begin; left > 0;)
+        {
+            buffer = source.read(std::min<qint64>(left, ExportWriter::WriteSize));
+            if (buffer.isEmpty())
+                break;
+            if (file.write(buffer) != buffer.size())
+            {
+                qCritical() << "Failed to write export data:" << file.errorString();
+                return true;
+            }
+
+            lastChar = buffer.back();
+            left -= buffer.size();
+            copied += buffer.size();
+
+            int percent = total ? static_cast<int>(100LL * copied / total) : 0;
+            if (percent != lastPercent)
+            {
+                emit progressUpdated(QStringLiteral("Exporting data to %1 ...").arg(filename), percent);
+                lastPercent = percent;
+            }
+        }
+
+        // The next range starts on a line of its own even if a file does not end with a line break
+        if (lastChar != '\n')
+            file.write("\n");
+    }
+
+    return true;
+}
+
+void ExportService::exportDataToFile(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime,
+                                     const CompiledLogFilter& filter,
+                                     const ExportWriter::FormatFunction& formatFunction,
+                                     const QString& prefix)
+{
+    auto compression = getCompression(filename);
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Unbuffered;
+    if (compression == ExportWriter::Compression::None)
+        mode |= QIODevice::Text;
+
+    // Writes come in large blocks from the export writer, QFile buffering would only add a copy
+    QFile file(filename);
+    if (!file.open(mode))
+    {
+        qCritical() << "Failed to open file for writing:" << file.errorString();
         return;
     }
 
-    if (startTime > endTime)
+    ExportWriter writer(file, formatFunction, ExportWriter::getDefaultFormatterCount(), compression);
+    writer.push(prefix);
+
+    bool exported = exportRange(filename, startTime, endTime, filter, [&writer](std::vector<LogEntry> batch) {
+        writer.push(std::move(batch));
+    });
+
+    if (!writer.finish() && exported)
+        qCritical() << "Failed to export data to" << filename;
+}
+
+void ExportService::exportSnapshot(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime, const CompiledLogFilter& filter)
+{
+    auto session = sessionService->getSession();
+    if (!session)
     {
-        qCritical() << "Invalid time range for export.";
+        qCritical() << "Session is not initialized.";
         return;
     }
 
     QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    if (!file.open(QIODevice::WriteOnly))
     {
         qCritical() << "Failed to open file for writing:" << file.errorString();
         return;
     }
 
-    if (prefix)
-        prefix(file);
+    SnapshotWriter writer(file);
+    for (const auto& module : session->getModules())
+    {
+        if (filter.acceptsModule(module))
+            writer.addModule(module, session->getFormat(module));
+    }
+
+    bool exported = exportRange(filename, startTime, endTime, filter, [&writer](std::vector<LogEntry> batch) {
+        for (auto& entry : batch)
+            writer.add(std::move(entry));
+    });
+
+    if (!writer.finish() && exported)
+        qCritical() << "Failed to export data to" << filename;
+}
+
+bool ExportService::exportRange(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime,
+                                const CompiledLogFilter& filter,
+                                const std::function<void (std::vector<LogEntry>)>& consume)
+{
+    auto session = sessionService->getSession();
+    if (!session)
+    {
+        qCritical() << "Session is not initialized.";
+        return false;
+    }
+
+    if (startTime > endTime)
+    {
+        qCritical() << "Invalid time range for export.";
+        return false;
+    }
 
     auto totalMs = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
 
-    auto iterator = session->getIterator(startTime, endTime);
+    auto preFilter = filter.createPreFilter();
+    const auto& modules = session->getModules();
+    bool shareCheckpoints = !preFilter && std::all_of(modules.begin(), modules.end(), [&filter](const QString& module) { return filter.acceptsModule(module); });
+
+    auto iterator = session->getIterator(startTime, endTime, preFilter, LogBlockFilter(), [&filter](const QString& module) { return filter.acceptsModule(module); });
+
     int lastPercent = 0;
+    size_t batchCount = 0;
     while (iterator.hasLogs())
     {
-        auto entry = iterator.next();
-        if (!entry)
+        if (shareCheckpoints && batchCount++ % CheckpointInterval == 0)
+            session->addCheckpoint(iterator.getCache());
+
+        std::vector<LogEntry> batch;
+        batch.reserve(BatchSize);
+        while (batch.size() < BatchSize && iterator.hasLogs())
+        {
+            auto entry = iterator.next();
+            if (!entry)
+                break;
+            batch.push_back(std::move(entry.value()));
+        }
+
+        if (batch.empty())
             break;
 
-        writeFunction(file, entry.value());
+        auto batchEnd = batch.back().time;
+        filter.filter(batch);
+        consume(std::move(batch));
 
-        auto curMs = std::chrono::duration_cast<std::chrono::milliseconds>(entry->time - startTime).count();
+        auto curMs = std::chrono::duration_cast<std::chrono::milliseconds>(batchEnd - startTime).count();
         int percent = totalMs ? static_cast<int>(100LL * curMs / totalMs) : 0;
         if (percent != lastPercent && percent <= 100)
         {
@@ -231,18 +404,20 @@ void ExportService::exportDataToFile(const QString& filename, const std::chrono:
 
     if (lastPercent < 100)
         emit progressUpdated(QStringLiteral("Exporting data to %1 ...").arg(filename), 100);
+    return true;
 }
 
 void ExportService::exportDataToFile(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime,
-                                     const std::function<void (QFile&, const LogEntry&)>& writeFunction, const QStringList& fields)
+                                     const CompiledLogFilter& filter,
+                                     const ExportWriter::FormatFunction& formatFunction, const QStringList& fields)
 {
-    exportDataToFile(filename, startTime, endTime, writeFunction,
-                     [&fields](QFile& file) {
-                         for (const auto& field : fields)
-                         {
-                             file.write(field.toUtf8());
-                             file.write(";");
-                         }
-                         file.write("\n");
-                     });
+    QString header;
+    for (const auto& field : fields)
+    {
+        header += field;
+        header += ';';
+    }
+    header += '\n';
+
+    exportDataToFile(filename, startTime, endTime, filter, formatFunction, header);
 }
@@ -2,10 +2,12 @@
 
 #include "LogManagement/Session.h"
 #include "LogFilter.h"
+#include "ExportWriter.h"
 #include <QObject>
 #include <QFile>
 #include <QTreeView>
 #include <chrono>
+#include <functional>
 
 class SessionService;
 
@@ -27,11 +29,25 @@ signals:
     void handleError(const QString& message);
 
 private:
+    static constexpr size_t BatchSize = 1024;
+    static constexpr size_t CheckpointInterval = 16;
+
+    // False when the range cannot be copied from the source files byte for byte
+    bool copyRawRanges(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime);
+
     void exportDataToFile(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime,
-                          const std::function<void (QFile&, const LogEntry&)>& writeFunction,
-                          const std::function<void (QFile& file)>& prefix = std::function<void (QFile& file)>{});
+                          const CompiledLogFilter& filter,
+                          const ExportWriter::FormatFunction& formatFunction,
+                          const QString& prefix = QString());
     void exportDataToFile(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime,
-                          const std::function<void (QFile&, const LogEntry&)>& writeFunction, const QStringList& fields);
+                          const CompiledLogFilter& filter,
+                          const ExportWriter::FormatFunction& formatFunction, const QStringList& fields);
+    void exportSnapshot(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime, const CompiledLogFilter& filter);
+
+    // Reads the range in batches, filters them and reports progress, false when nothing could be read
+    bool exportRange(const QString& filename, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime,
+                     const CompiledLogFilter& filter,
+                     const std::function<void (std::vector<LogEntry>)>& consume);
 
 private:
     SessionService* sessionService;
@@ -0,0 +1,179 @@
+#include "ExportWriter.h"
+
+#include "LogManagement/Gzip.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <stdexcept>
+
+
+ExportWriter::ExportWriter(QIODevice& device, FormatFunction format, size_t formatterCount, Compression compression) :
+    device(device),
+    formatFunction(std::move(format)),
+    compression(compression),
+    maxPending(std::max<size_t>(formatterCount, 1) * 2)
+{
+    for (size_t i = 0; i < std::max<size_t>(formatterCount, 1); ++i)
+        formatters.emplace_back(&ExportWriter::format, this);
+    writer = std::thread(&ExportWriter::write, this);
+}
+
+ExportWriter::~ExportWriter()
+{
+    join();
+}
+
+void ExportWriter::push(std::vector<LogEntry> batch)
+{
+    if (batch.empty())
+        return;
+
+    Job job;
+    job.entries = std::move(batch);
+    addJob(std::move(job));
+}
+
+void ExportWriter::push(QString text)
+{
+    if (text.isEmpty())
+        return;
+
+    Job job;
+    job.text = std::move(text);
+    addJob(std::move(job));
+}
+
+bool ExportWriter::finish()
+{
+    join();
+    if (error)
+        std::rethrow_exception(error);
+    return !failed;
+}
+
+void ExportWriter::join()
+{
+    {
+        std::lock_guard lock(mutex);
+        if (finishing)
+            return;
+        finishing = true;
+    }
+    jobAdded.notify_all();
+    bufferReady.notify_all();
+
+    for (auto& formatter : formatters)
+        formatter.join();
+    writer.join();
+}
+
+size_t ExportWriter::getDefaultFormatterCount()
+{
+    // The iterating and the writing threads keep two cores busy on their own
+    size_t cores = std::thread::hardware_concurrency();
+    return cores > 3 ? cores - 2 : 1;
+}
+
+void ExportWriter::addJob(Job job)
+{
+    {
+        std::unique_lock lock(mutex);
+        slotFreed.wait(lock, [this] { return pending < maxPending; });
+        if (error)
+            std::rethrow_exception(error);
+        // Nothing pushed after a failed write would reach the device, so the caller stops here
+        if (failed)
+            throw std::runtime_error("failed to write export data");
+        job.index = pushed++;
+        jobs.push_back(std::move(job));
+        ++pending;
+    }
+    jobAdded.notify_one();
+}
+
+void ExportWriter::format()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock lock(mutex);
+            jobAdded.wait(lock, [this] { return !jobs.empty() || finishing; });
+            if (jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        QByteArray buffer;
+        std::exception_ptr jobError;
+        try
+        {
+            // One conversion per batch instead of one per field
+            QString text = std::move(job.text);
+            for (const auto& entry : job.entries)
+                formatFunction(text, entry);
+            buffer = text.toUtf8();
+            if (compression == Compression::Gzip)
+                buffer = compressGzip(buffer);
+        }
+        catch (...)
+        {
+            // The batch is left empty so the writer still gets past it, the output is broken anyway
+            jobError = std::current_exception();
+            failed = true;
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            if (jobError && !error)
+                error = jobError;
+            buffers.emplace(job.index, std::move(buffer));
+        }
+        bufferReady.notify_one();
+    }
+}
+
+void ExportWriter::write()
+{
+    QByteArray output;
+    output.reserve(WriteSize + BlockSize);
+
+    for (size_t next = 0;; ++next)
+    {
+        QByteArray buffer;
+        {
+            std::unique_lock lock(mutex);
+            bufferReady.wait(lock, [this, next] { return buffers.contains(next) || (finishing && next == pushed); });
+            auto it = buffers.find(next);
+            if (it == buffers.end())
+                break;
+            buffer = std::move(it->second);
+            buffers.erase(it);
+            --pending;
+        }
+        slotFreed.notify_one();
+
+        output.append(buffer);
+        if (output.size() >= WriteSize)
+            writeBlocks(output, false);
+    }
+
+    writeBlocks(output, true);
+}
+
+void ExportWriter::writeBlocks(QByteArray& output, bool all)
+{
+    qsizetype size = all ? output.size() : output.size() / BlockSize * BlockSize;
+    if (size == 0)
+        return;
+
+    // After a failure the remaining batches are still drained so that push never blocks forever
+    if (!failed && device.write(output.constData(), size) != size)
+    {
+        qCritical() << "Failed to write export data:" << device.errorString();
+        failed = true;
+    }
+    output.remove(0, size);
+}
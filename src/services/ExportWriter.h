@@ -0,0 +1,88 @@
+#pragma once
+
+#include "LogManagement/LogEntry.h"
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Export pipeline: pushed batches are rendered to UTF-8 by a pool of formatter threads
+// and appended to the device in push order by a single writer thread in large blocks.
+// With compression every batch becomes an independent gzip member, so deflate runs on
+// the formatter threads as well.
+class ExportWriter
+{
+public:
+    typedef std::function<void (QString&, const LogEntry&)> FormatFunction;
+
+    enum class Compression
+    {
+        None,
+        Gzip
+    };
+
+    static constexpr qsizetype BlockSize = 64 * 1024;
+    static constexpr qsizetype WriteSize = 64 * BlockSize;
+
+    ExportWriter(QIODevice& device, FormatFunction format, size_t formatterCount = getDefaultFormatterCount(), Compression compression = Compression::None);
+    ~ExportWriter();
+
+    ExportWriter(const ExportWriter&) = delete;
+    ExportWriter& operator=(const ExportWriter&) = delete;
+
+    // Blocks while too many batches are waiting to be formatted or written.
+    // Rethrows what a formatter thread has thrown so far, throws once a write has failed.
+    void push(std::vector<LogEntry> batch);
+    void push(QString text);
+    // Waits until every pushed batch is written, false if the device failed.
+    // Rethrows what a formatter thread has thrown.
+    bool finish();
+
+    static size_t getDefaultFormatterCount();
+
+private:
+    struct Job
+    {
+        size_t index = 0;
+        QString text;
+        std::vector<LogEntry> entries;
+    };
+
+    void addJob(Job job);
+    void join();
+    void format();
+    void write();
+    void writeBlocks(QByteArray& output, bool all);
+
+private:
+    QIODevice& device;
+    FormatFunction formatFunction;
+    Compression compression;
+    size_t maxPending;
+
+    std::mutex mutex;
+    std::condition_variable jobAdded;
+    std::condition_variable bufferReady;
+    std::condition_variable slotFreed;
+    std::deque<Job> jobs;
+    std::map<size_t, QByteArray> buffers;
+    size_t pushed = 0;
+    size_t pending = 0;
+    bool finishing = false;
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+
+    std::vector<std::thread> formatters;
+    std::thread writer;
+};
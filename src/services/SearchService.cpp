@@ -1,16 +1,55 @@
 #include "SearchService.h"
 #include "SessionService.h"
-#include "SearchController.h"
+#include "LogView/LogModel.h"
+#include "Settings.h"
 #include "Utils.h"
 
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <unordered_map>
+
+
 SearchService::SearchService(SessionService* sessionService, QObject* parent)
-    : QObject(parent), sessionService(sessionService)
-{}
+    : QObject(parent), sessionService(sessionService), resultLimit(loadResultLimit())
+{
+    qRegisterMetaType<MergeHeapCache>("MergeHeapCache");
+}
+
+void SearchService::setResultLimit(int limit)
+{
+    resultLimit = limit;
+}
 
 void SearchService::search(const std::chrono::system_clock::time_point& time, const QString& searchTerm, bool regexEnabled, bool backward, bool findAll, int column, const QStringList& fields)
 {
     QT_SLOT_BEGIN
 
+    searchImpl(time, searchTerm, regexEnabled, backward, findAll, column, fields, LogFilter{});
+
+    QT_SLOT_END
+}
+
+void SearchService::searchWithFilter(const std::chrono::system_clock::time_point& time, const QString& searchTerm, bool regexEnabled, bool backward, bool findAll, int column, const QStringList& fields, const LogFilter& filter)
+{
+    QT_SLOT_BEGIN
+
+    searchImpl(time, searchTerm, regexEnabled, backward, findAll, column, fields, filter);
+
+    QT_SLOT_END
+}
+
+void SearchService::searchBackward(const MergeHeapCache& position, const QString& searchTerm, bool regexEnabled, int column, const QStringList& fields, const LogFilter& filter)
+{
+    QT_SLOT_BEGIN
+
+    searchImpl(position.time, searchTerm, regexEnabled, true, false, column, fields, filter, position);
+
+    QT_SLOT_END
+}
+
+void SearchService::searchImpl(const std::chrono::system_clock::time_point& time, const QString& searchTerm, bool regexEnabled, bool backward, bool findAll, int column, const QStringList& fields, const LogFilter& filter, const MergeHeapCache& position)
+{
     emit progressUpdated(QStringLiteral("Searching for '%1' ...").arg(searchTerm), 0);
 
     auto session = sessionService->getSession();
@@ -26,13 +65,101 @@ void SearchService::search(const std::chrono::system_clock::time_point& time, co
         return;
     }
 
-    auto startTime = time;
-    auto endTime = session->getMaxTime();
-    auto totalMs = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-    auto iterator = LogEntryIterator<>(session->getIterator<true>(startTime, endTime));
+    pendingSearch.reset();
+
+    auto matcher = createMatcher(searchTerm, regexEnabled);
+    auto compiledFilter = filter.compile();
+    auto preFilter = createPreFilter(*session.get(), matcher, column, fields, compiledFilter);
+    auto blockFilter = createBlockFilter(*session.get(), searchTerm, regexEnabled, column, fields);
+    LogModuleFilter moduleFilter = [compiledFilter](const QString& module) { return compiledFilter.acceptsModule(module); };
+
+    if (findAll)
+    {
+        PendingSearch search{ searchTerm, regexEnabled, column, fields, std::move(compiledFilter), session->getMaxTime(), MergeHeapCache() };
+        auto iterator = session->getIterator<true>(time, search.endTime, preFilter, blockFilter, moduleFilter);
+        collectResults(iterator, time, std::move(search), matcher);
+    }
+    else if (backward && !position.heap.empty())
+    {
+        auto iterator = session->createIterator<false>(position, session->getMinTime(), position.time, preFilter, blockFilter, moduleFilter);
+        findFirst(iterator, time, session->getMinTime(), searchTerm, column, fields, matcher, compiledFilter, true);
+    }
+    else if (backward)
+    {
+        auto iterator = session->getIterator<false>(session->getMinTime(), time, preFilter, blockFilter, moduleFilter);
+        findFirst(iterator, time, session->getMinTime(), searchTerm, column, fields, matcher, compiledFilter);
+    }
+    else
+    {
+        auto iterator = session->getIterator<true>(time, session->getMaxTime(), preFilter, blockFilter, moduleFilter);
+        findFirst(iterator, time, session->getMaxTime(), searchTerm, column, fields, matcher, compiledFilter);
+    }
+}
+
+void SearchService::continueSearch()
+{
+    QT_SLOT_BEGIN
+
+    if (!pendingSearch)
+        return;
+
+    auto session = sessionService->getSession();
+    if (!session)
+    {
+        qCritical() << "Session is not initialized.";
+        return;
+    }
+
+    PendingSearch search = std::move(pendingSearch.value());
+    pendingSearch.reset();
+
+    emit progressUpdated(QStringLiteral("Searching for '%1' ...").arg(search.searchTerm), 0);
+
+    // The held match was the last entry of the session
+    if (search.cache.heap.empty())
+    {
+        QMap<std::chrono::system_clock::time_point, QString> batch;
+        if (search.nextResult)
+            batch.insert(search.nextResult->first, search.nextResult->second);
+        emit searchResultsAdded(batch);
+        emit progressUpdated(QStringLiteral("Search finished"), 100);
+        emit searchResultsFinished(false);
+        return;
+    }
+
+    auto matcher = createMatcher(search.searchTerm, search.regexEnabled);
+    auto startTime = search.cache.time;
+    auto iterator = session->createIterator<true>(search.cache, startTime, search.endTime,
+                                                  createPreFilter(*session.get(), matcher, search.column, search.fields, search.filter),
+                                                  createBlockFilter(*session.get(), search.searchTerm, search.regexEnabled, search.column, search.fields),
+                                                  [filter = search.filter](const QString& module) { return filter.acceptsModule(module); });
+    collectResults(iterator, startTime, std::move(search), matcher);
+
+    QT_SLOT_END
+}
+
+void SearchService::collectResults(LogEntryIterator<true>& iterator, const std::chrono::system_clock::time_point& startTime, PendingSearch&& search, const Matcher& matcher)
+{
+    static const int BatchSize = 500;
+    static const qint64 BatchInterval = 200;
+
+    const int limit = resultLimit;
+    auto totalMs = std::chrono::duration_cast<std::chrono::milliseconds>(search.endTime - startTime).count();
     int lastPercent = 0;
-    QMap<std::chrono::system_clock::time_point, QString> foundEntries;
-    while(iterator.hasLogs())
+    int found = 0;
+
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+
+    QMap<std::chrono::system_clock::time_point, QString> batch;
+    if (search.nextResult)
+    {
+        batch.insert(search.nextResult->first, search.nextResult->second);
+        search.nextResult.reset();
+        ++found;
+    }
+
+    while (iterator.hasLogs())
     {
         auto entry = iterator.next();
         if (!entry)
@@ -42,99 +169,230 @@ void SearchService::search(const std::chrono::system_clock::time_point& time, co
         int percent = totalMs ? static_cast<int>(100LL * curMs / totalMs) : 0;
         if (percent != lastPercent && percent <= 100)
         {
-            emit progressUpdated(QStringLiteral("Searching for '%1' ...").arg(searchTerm), percent);
+            emit progressUpdated(QStringLiteral("Searching for '%1' ...").arg(search.searchTerm), percent);
             lastPercent = percent;
         }
 
-        bool specificColumn = column >= 0 && column < entry->line.size();
-        bool lastColumn = specificColumn && column == fields.size() - 1;
-        QString textToSearch = (specificColumn ? entry->values[fields[column]].toString() : (lastColumn ? entry->values[fields[column]].toString() + entry->additionalLines : entry->line));
+        if (!matcher(getSearchText(entry.value(), search.column, search.fields)))
+            continue;
 
-        if (SearchController::checkEntry(entry->line, searchTerm, regexEnabled))
+        if (!search.filter.check(entry.value()))
+            continue;
+
+        // More results are reported only once the next match is known to exist, it is held for continueSearch
+        if (limit > 0 && found >= limit)
         {
-            if (findAll)
-            {
-                foundEntries.insert(entry->time, entry->line);
-            }
-            else
-            {
-                emit searchFinished(searchTerm, entry->time);
-                emit progressUpdated(QStringLiteral("Search finished"), 100);
-                return;
-            }
+            search.nextResult.emplace(entry->time, entry->line);
+            search.cache = iterator.getCache();
+            pendingSearch = std::move(search);
+            break;
+        }
+
+        batch.insert(entry->time, entry->line);
+        ++found;
+
+        if (batch.size() >= BatchSize || batchTimer.elapsed() >= BatchInterval)
+        {
+            emit searchResultsAdded(batch);
+            batch.clear();
+            batchTimer.restart();
         }
     }
 
+    if (!batch.isEmpty())
+        emit searchResultsAdded(batch);
+
     emit progressUpdated(QStringLiteral("Search finished"), 100);
+    emit searchResultsFinished(pendingSearch.has_value());
+}
 
-    if (findAll)
-        emit searchResults(foundEntries);
+int SearchService::loadResultLimit()
+{
+    static const int defaultLimit = 10000;
+    static const QString ResultLimitParameter = "search/resultLimit";
 
-    QT_SLOT_END
+    Settings settings;
+    if (!settings.contains(ResultLimitParameter))
+        settings.setValue(ResultLimitParameter, defaultLimit);
+    return settings.value(ResultLimitParameter, defaultLimit).toInt();
 }
 
-void SearchService::searchWithFilter(const std::chrono::system_clock::time_point& time, const QString& searchTerm, bool regexEnabled, bool backward, bool findAll, int column, const QStringList& fields, const LogFilter& filter)
+SearchService::Matcher SearchService::createMatcher(const QString& searchTerm, bool regexEnabled)
 {
-    QT_SLOT_BEGIN
+    if (regexEnabled)
+    {
+        QRegularExpression regex(searchTerm, QRegularExpression::CaseInsensitiveOption);
+        regex.optimize();
+        return [regex](const QString& text) {
+            return regex.match(text).hasMatch();
+        };
+    }
 
-    emit progressUpdated(QStringLiteral("Searching for '%1' ...").arg(searchTerm), 0);
+    return [searchTerm](const QString& text) {
+        return text.contains(searchTerm);
+    };
+}
 
-    auto session = sessionService->getSession();
-    if (!session)
+LogEntryPreFilter SearchService::createPreFilter(const Session& session, const Matcher& matcher, int column, const QStringList& fields)
+{
+    if (column < 0 || column >= fields.size())
     {
-        qCritical() << "Session is not initialized.";
-        return;
+        return [matcher](const RawLogEntry& entry, const std::shared_ptr<Format>&) {
+            return matcher(entry.line);
+        };
     }
 
-    if (searchTerm.isEmpty())
+    if (column == static_cast<int>(LogModel::PredefinedColumn::Module))
     {
-        qWarning() << "Search term is empty.";
-        return;
+        return [matcher](const RawLogEntry& entry, const std::shared_ptr<Format>&) {
+            return matcher(entry.module);
+        };
     }
 
-    auto startTimeF = time;
-    auto endTimeF = session->getMaxTime();
-    auto totalMsF = std::chrono::duration_cast<std::chrono::milliseconds>(endTimeF - startTimeF).count();
-    auto iterator = LogEntryIterator<>(session->getIterator<true>(startTimeF, endTimeF));
-    int lastPercentF = 0;
-    QMap<std::chrono::system_clock::time_point, QString> foundEntries;
-    while(iterator.hasLogs())
-    {
-        auto entry = iterator.next();
-        if (!entry)
-            break;
+    std::unordered_map<const Format*, int> partIndexes;
+    for (const auto& format : session.getFormats())
+        partIndexes.emplace(format.get(), getFieldPartIndex(format, fields[column]));
+
+    bool lastColumn = column == fields.size() - 1;
+    return [matcher, partIndexes, lastColumn](const RawLogEntry& entry, const std::shared_ptr<Format>& format) {
+        auto it = partIndexes.find(format.get());
+        if (it == partIndexes.end() || it->second < 0 || it->second >= entry.parts.size())
+            return true;
+
+        QString text = getFieldText(entry.parts[it->second], format->fields[it->second], format);
+        if (lastColumn && !entry.additionalLines.isEmpty())
+            text += '\n' + entry.additionalLines;
+        return matcher(text);
+    };
+}
+
+LogEntryPreFilter SearchService::createPreFilter(const Session& session, const Matcher& matcher, int column, const QStringList& fields, const CompiledLogFilter& filter)
+{
+    auto searchFilter = createPreFilter(session, matcher, column, fields);
+    auto valueFilter = filter.createPreFilter();
+    if (!valueFilter)
+        return searchFilter;
 
-        auto curMsF = std::chrono::duration_cast<std::chrono::milliseconds>(entry->time - startTimeF).count();
-        int percentF = totalMsF ? static_cast<int>(100LL * curMsF / totalMsF) : 0;
-        if (percentF != lastPercentF && percentF <= 100)
+    return [searchFilter, valueFilter](const RawLogEntry& entry, const std::shared_ptr<Format>& format) {
+        return valueFilter(entry, format) && searchFilter(entry, format);
+    };
+}
+
+LogBlockFilter SearchService::createBlockFilter(const Session& session, const QString& searchTerm, bool regexEnabled, int column, const QStringList& fields)
+{
+    // The index holds the text of the lines, so it cannot rule out blocks for text that is not in them as it is
+    if (column == static_cast<int>(LogModel::PredefinedColumn::Module))
+        return LogBlockFilter();
+
+    if (column >= 0 && column < fields.size())
+    {
+        for (const auto& format : session.getFormats())
         {
-            emit progressUpdated(QStringLiteral("Searching for '%1' ...").arg(searchTerm), percentF);
-            lastPercentF = percentF;
+            auto field = std::find_if(format->fields.begin(), format->fields.end(), [&fields, column](const Format::Field& field) {
+                return field.name == fields[column];
+            });
+            if (field != format->fields.end() && field->type != QMetaType::QString && field->type != QMetaType::Int)
+                return LogBlockFilter();
         }
+    }
+
+    QStringList literals = regexEnabled ? extractLiterals(searchTerm) : QStringList{ searchTerm };
+    if (literals.isEmpty())
+        return LogBlockFilter();
+
+    return LogIndex::createBlockFilter([literals](const LogIndex& index) {
+        return index.findBlocks(literals);
+    });
+}
 
-        bool specificColumn = column >= 0 && column < entry->line.size();
-        bool lastColumn = specificColumn && column == fields.size() - 1;
-        QString textToSearch = (specificColumn ? entry->values[fields[column]].toString() : (lastColumn ? entry->values[fields[column]].toString() + entry->additionalLines : entry->line));
+QStringList SearchService::extractLiterals(const QString& pattern)
+{
+    QStringList literals;
+    QString current;
+    int depth = 0;
+
+    auto flush = [&literals, &current]() {
+        if (current.size() >= 3)
+            literals << current;
+        current.clear();
+    };
+
+    for (qsizetype i = 0; i < pattern.size(); ++i)
+    {
+        QChar ch = pattern[i];
+        QChar next = i + 1 < pattern.size() ? pattern[i + 1] : QChar();
+        bool optional = next == '?' || next == '*' || next == '{';
+
+        if (ch == '|')
+            return {};
 
-        if (SearchController::checkEntry(entry->line, searchTerm, regexEnabled) && filter.check(entry.value()))
+        if (ch == '\\')
         {
-            if (findAll)
+            if (next.isLetterOrNumber())
             {
-                foundEntries.insert(entry->time, entry->line);
-            }
-            else
-            {
-                emit searchFinished(searchTerm, entry->time);
-                emit progressUpdated(QStringLiteral("Search finished"), 100);
-                return;
+                flush();
+                ++i;
+                continue;
             }
+
+            ch = next;
+            ++i;
+            next = i + 1 < pattern.size() ? pattern[i + 1] : QChar();
+            optional = next == '?' || next == '*' || next == '{';
+        }
+        else if (ch == '[' || ch == '{')
+        {
+            flush();
+            QChar closing = ch == '[' ? ']' : '}';
+            while (i < pattern.size() && pattern[i] != closing)
+                i += pattern[i] == '\\' ? 2 : 1;
+            continue;
+        }
+        else if (ch == '(')
+        {
+            flush();
+            ++depth;
+            continue;
+        }
+        else if (ch == ')')
+        {
+            flush();
+            --depth;
+            continue;
+        }
+        else if (QStringLiteral(".^$?*+").contains(ch))
+        {
+            flush();
+            continue;
+        }
+
+        if (optional || depth > 0)
+        {
+            flush();
+            continue;
         }
+
+        current += ch;
     }
+    flush();
 
-    emit progressUpdated(QStringLiteral("Search finished"), 100);
+    return literals;
+}
 
-    if (findAll)
-        emit searchResults(foundEntries);
+QString SearchService::getSearchText(const LogEntry& entry, int column, const QStringList& fields)
+{
+    if (column < 0 || column >= fields.size())
+        return entry.line;
 
-    QT_SLOT_END
+    if (column == static_cast<int>(LogModel::PredefinedColumn::Module))
+        return entry.module;
+
+    QString text;
+    auto valueIt = entry.values.find(fields[column]);
+    if (valueIt != entry.values.end())
+        text = valueIt->second.toString();
+
+    if (column == fields.size() - 1 && !entry.additionalLines.isEmpty())
+        text += '\n' + entry.additionalLines;
+    return text;
 }
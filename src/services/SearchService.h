@@ -5,7 +5,10 @@
 #include "ThreadSafePtr.h"
 
 #include <QObject>
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <optional>
 
 
 class SessionService;
@@ -17,16 +20,94 @@ class SearchService : public QObject
 public:
     explicit SearchService(SessionService* sessionService, QObject* parent = nullptr);
 
+    // Settings are read on the GUI thread, the limit is handed over before each search
+    static int loadResultLimit();
+    void setResultLimit(int limit);
+
 public slots:
+    void continueSearch();
+
     void search(const std::chrono::system_clock::time_point& time, const QString& searchTerm, bool regexEnabled, bool backward, bool findAll, int column, const QStringList& fields);
     void searchWithFilter(const std::chrono::system_clock::time_point& time, const QString& searchTerm, bool regexEnabled, bool backward, bool findAll, int column, const QStringList& fields, const LogFilter& filter);
+    // Finds the previous match before a merge position, so entries sharing the timestamp of the position are not skipped
+    void searchBackward(const MergeHeapCache& position, const QString& searchTerm, bool regexEnabled, int column, const QStringList& fields, const LogFilter& filter);
 
 signals:
     void progressUpdated(const QString& message, int percent);
     void searchFinished(const QString& searchTerm, const std::chrono::system_clock::time_point& entryTime);
-    void searchResults(const QMap<std::chrono::system_clock::time_point, QString>& results);
+    void searchResultsAdded(const QMap<std::chrono::system_clock::time_point, QString>& results);
+    void searchResultsFinished(bool hasMore);
     void handleError(const QString& message);
 
+private:
+    typedef std::function<bool(const QString&)> Matcher;
+
+    void searchImpl(const std::chrono::system_clock::time_point& time, const QString& searchTerm, bool regexEnabled, bool backward, bool findAll, int column, const QStringList& fields, const LogFilter& filter, const MergeHeapCache& position = MergeHeapCache());
+
+    struct PendingSearch
+    {
+        QString searchTerm;
+        bool regexEnabled = false;
+        int column = -1;
+        QStringList fields;
+        CompiledLogFilter filter;
+        std::chrono::system_clock::time_point endTime;
+        MergeHeapCache cache;
+        std::optional<std::pair<std::chrono::system_clock::time_point, QString>> nextResult;
+    };
+
+    void collectResults(LogEntryIterator<true>& iterator, const std::chrono::system_clock::time_point& startTime, PendingSearch&& search, const Matcher& matcher);
+
+    template<bool straight>
+    void findFirst(LogEntryIterator<straight>& iterator, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime, const QString& searchTerm, int column, const QStringList& fields, const Matcher& matcher, const CompiledLogFilter& filter, bool includeStart = false)
+    {
+        auto totalMs = std::chrono::abs(std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime)).count();
+        int lastPercent = 0;
+        while (iterator.hasLogs())
+        {
+            auto entry = iterator.next();
+            if (!entry)
+                break;
+
+            auto curMs = std::chrono::abs(std::chrono::duration_cast<std::chrono::milliseconds>(entry->time - startTime)).count();
+            int percent = totalMs ? static_cast<int>(100LL * curMs / totalMs) : 0;
+            if (percent != lastPercent && percent <= 100)
+            {
+                emit progressUpdated(QStringLiteral("Searching for '%1' ...").arg(searchTerm), percent);
+                lastPercent = percent;
+            }
+
+            if constexpr (!straight)
+            {
+                if (!includeStart && entry->time >= startTime)
+                    continue;
+            }
+
+            if (!matcher(getSearchText(entry.value(), column, fields)))
+                continue;
+
+            if (!filter.check(entry.value()))
+                continue;
+
+            emit searchFinished(searchTerm, entry->time);
+            break;
+        }
+
+        emit progressUpdated(QStringLiteral("Search finished"), 100);
+    }
+
+    static Matcher createMatcher(const QString& searchTerm, bool regexEnabled);
+    static LogEntryPreFilter createPreFilter(const Session& session, const Matcher& matcher, int column, const QStringList& fields);
+    static LogEntryPreFilter createPreFilter(const Session& session, const Matcher& matcher, int column, const QStringList& fields, const CompiledLogFilter& filter);
+    static LogBlockFilter createBlockFilter(const Session& session, const QString& searchTerm, bool regexEnabled, int column, const QStringList& fields);
+    static QStringList extractLiterals(const QString& pattern);
+    static QString getSearchText(const LogEntry& entry, int column, const QStringList& fields);
+
 private:
     SessionService* sessionService;
+
+    std::optional<PendingSearch> pendingSearch;
+    std::atomic<int> resultLimit;
 };
+
+Q_DECLARE_METATYPE(MergeHeapCache)
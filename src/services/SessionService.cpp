@@ -1,19 +1,28 @@
 #include "SessionService.h"
 #include "Application.h"
+#include "Settings.h"
 #include "Utils.h"
 
+#include <QFileInfo>
 #include <QMetaType>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <set>
 
 SessionService::SessionService(QObject* parent)
     : QObject(parent),
       iterators(ThreadSafePtr<std::map<int, std::shared_ptr<LogEntryIterator<>>>>::DefaultConstructor{}),
       reverseIterators(ThreadSafePtr<std::map<int, std::shared_ptr<LogEntryIterator<false>>>>::DefaultConstructor{}),
-      dataRequestResults(ThreadSafePtr<std::map<int, std::vector<LogEntry>>>::DefaultConstructor{})
+      dataRequestResults(ThreadSafePtr<std::map<int, std::vector<LogEntry>>>::DefaultConstructor{}),
+      dataRequestCaches(ThreadSafePtr<std::map<int, MergeHeapCache>>::DefaultConstructor{}),
+      samples(ThreadSafePtr<std::vector<LogEntry>>::DefaultConstructor{})
 {
     qRegisterMetaType<SessionService::DataRequest>("SessionService::DataRequest");
     connect(this, &SessionService::iteratorRequested, this, &SessionService::handleIteratorRequest, Qt::QueuedConnection);
     connect(this, &SessionService::reverseIteratorRequested, this, &SessionService::handleReverseIteratorRequest, Qt::QueuedConnection);
     connect(this, &SessionService::logEntriesRequested, this, &SessionService::handleDataRequest, Qt::QueuedConnection);
+    connect(this, &SessionService::samplesRequested, this, &SessionService::handleSampleRequest, Qt::QueuedConnection);
 }
 
 const ThreadSafePtr<LogManager>& SessionService::getLogManager() const
@@ -26,13 +35,13 @@ const ThreadSafePtr<Session>& SessionService::getSession() const
     return session;
 }
 
-std::unordered_set<QVariant, VariantHash> SessionService::getEnumList(const QString& field) const
+std::vector<HeavyHitters::Counter> SessionService::getFrequentValues(const QString& field) const
 {
     auto sessionPtr = getSession();
     if (!sessionPtr)
         return {};
     auto sessionLocker = sessionPtr.getLocker();
-    return sessionLocker->getEnumList(field);
+    return sessionLocker->getFrequentValues(field);
 }
 
 void SessionService::createSession(const std::unordered_set<QString>& modules,
@@ -43,6 +52,9 @@ void SessionService::createSession(const std::unordered_set<QString>& modules,
         throw std::runtime_error("LogManager is not initialized.");
 
     session = logManager->createSession(modules, minTime, maxTime);
+    samples->clear();
+    samplingStarted = false;
+    emit sessionCreated();
 }
 
 void SessionService::openFile(const QString& file, const QStringList& formats)
@@ -53,6 +65,7 @@ void SessionService::openFile(const QString& file, const QStringList& formats)
 
     auto newLogManager = std::make_shared<LogManager>(file, getFormats(formats));
     logManager = newLogManager;
+    startIndexing(*newLogManager);
     emit logManagerCreated(file);
 
     emit progressUpdated(QStringLiteral("File %1 opened").arg(file), 100);
@@ -68,6 +81,7 @@ void SessionService::openBuffer(const QByteArray& data, const QString& filename,
 
     auto newLogManager = std::make_shared<LogManager>(data, filename, getFormats(formats));
     logManager = newLogManager;
+    startIndexing(*newLogManager);
     emit logManagerCreated(filename);
 
     emit progressUpdated(QStringLiteral("Buffer %1 opened").arg(filename), 100);
@@ -83,6 +97,7 @@ void SessionService::openFolder(const QString& logDirectory, const QStringList&
 
     auto newLogManager = std::make_shared<LogManager>(std::vector<QString>{logDirectory}, getFormats(formats));
     logManager = newLogManager;
+    startIndexing(*newLogManager);
     emit logManagerCreated(logDirectory);
 
     emit progressUpdated(QStringLiteral("Folder %1 opened").arg(logDirectory), 100);
@@ -159,6 +174,33 @@ std::vector<LogEntry> SessionService::getResult(int index)
     return {};
 }
 
+MergeHeapCache SessionService::getResultCache(int index)
+{
+    auto lockedDataRequestCaches = dataRequestCaches.getLocker();
+    auto it = lockedDataRequestCaches->find(index);
+    if (it != lockedDataRequestCaches->end())
+    {
+        auto res = std::move(it->second);
+        lockedDataRequestCaches->erase(it);
+        return res;
+    }
+    return {};
+}
+
+void SessionService::requestSamples()
+{
+    if (!session || samplingStarted.exchange(true))
+        return;
+
+    emit samplesRequested();
+}
+
+std::vector<LogEntry> SessionService::getSamples() const
+{
+    auto lockedSamples = samples.getLocker();
+    return *lockedSamples;
+}
+
 void SessionService::handleIteratorRequest(int index,
                                            const std::chrono::system_clock::time_point& startTime,
                                            const std::chrono::system_clock::time_point& endTime)
@@ -233,12 +275,137 @@ void SessionService::handleDataRequest(const DataRequest& request)
         }
     }
 
+    static auto cacheVisitor = [](const auto& iterator) -> MergeHeapCache {
+        return iterator->getCache();
+    };
+    dataRequestCaches->insert_or_assign(request.index, std::visit(cacheVisitor, request.iterator));
+
+    // The view keeps its iterators between requests, the values of the entries shown go to the pickers now
+    static auto flushVisitor = [](const auto& iterator) {
+        iterator->flushEnumValues();
+    };
+    std::visit(flushVisitor, request.iterator);
+
     dataLoaded(request.index);
     emit progressUpdated(QStringLiteral("Data loaded"), 100);
 
     QT_SLOT_END
 }
 
+void SessionService::handleSampleRequest()
+{
+    QT_SLOT_BEGIN
+
+    if (!session)
+        return;
+
+    struct SampleFile
+    {
+        LogStorage::FileSpan span;
+        // Part of the file inside the session, as fractions of the file
+        double begin = 0;
+        double end = 1;
+        double weight = 0;
+    };
+
+    // Points are spread by bytes, a file taking half of the session gets half of them
+    auto minTime = session->getMinTime();
+    auto maxTime = session->getMaxTime();
+    std::vector<SampleFile> files;
+    double totalWeight = 0;
+    for (auto& span : session->getFileSpans())
+    {
+        auto start = std::max(span.start, minTime);
+        auto end = std::min(span.end, maxTime);
+        if (end <= start || span.end <= span.start)
+            continue;
+
+        std::chrono::duration<double> duration = span.end - span.start;
+        SampleFile file;
+        file.begin = std::chrono::duration<double>(start - span.start) / duration;
+        file.end = std::chrono::duration<double>(end - span.start) / duration;
+        file.weight = std::max<double>(QFileInfo(span.metadata.filename).size(), 1) * (file.end - file.begin);
+        totalWeight += file.weight;
+        file.span = std::move(span);
+        files.push_back(std::move(file));
+    }
+
+    std::set<std::pair<QString, qint64>> positions;
+    std::vector<LogEntry> result;
+    for (int i = 0; i < SamplePoints && !files.empty(); ++i)
+    {
+        double target = totalWeight * (i + 0.5) / SamplePoints;
+        auto file = files.begin();
+        while (std::next(file) != files.end() && target > file->weight)
+        {
+            target -= file->weight;
+            ++file;
+        }
+
+        double fraction = file->begin + (file->end - file->begin) * std::clamp(target / file->weight, 0.0, 1.0);
+        auto pos = findSamplePosition(file->span.metadata, fraction);
+        if (!pos || !positions.emplace(file->span.metadata.filename, pos.value()).second)
+            continue;
+
+        const auto& module = file->span.module;
+        MergeHeapCache cache;
+        cache.time = file->span.start;
+        cache.heap.push_back({ module, file->span.start, static_cast<int>(pos.value()) });
+        auto iterator = session->createIterator<true>(cache, minTime, maxTime, {}, {}, [&module](const QString& name) { return name == module; });
+        for (int j = 0; j < EntriesPerPoint && iterator.hasLogs(); ++j)
+        {
+            auto entry = iterator.next();
+            if (!entry)
+                break;
+            if (entry->time >= minTime)
+                result.push_back(std::move(entry.value()));
+        }
+    }
+
+    *samples.getLocker() = std::move(result);
+    emit samplesCollected();
+
+    QT_SLOT_END
+}
+
+std::optional<qint64> SessionService::findSamplePosition(const LogMetadata& metadata, double fraction)
+{
+    if (metadata.snapshot)
+        return static_cast<qint64>(metadata.snapshot->size() * fraction);
+
+    // Index blocks start at entry headers, so no line has to be read to find one
+    if (metadata.index && metadata.index->isReady() && metadata.index->getBlockCount() > 0)
+    {
+        auto blockCount = metadata.index->getBlockCount();
+        return metadata.index->getBlockStart(std::min(static_cast<size_t>(blockCount * fraction), blockCount - 1));
+    }
+
+    // Without an index a compressed file can only be entered at the start
+    if (QFileInfo(metadata.filename).suffix().compare("gz", Qt::CaseInsensitive) == 0)
+        return 0;
+
+    auto log = metadata.fileBuilder(metadata.filename, metadata.format);
+    log->goToEnd();
+    qint64 pos = static_cast<qint64>(log->getFilePosition() * fraction);
+    if (pos == 0)
+        return 0;
+
+    // The line the position falls in is skipped, then continuation lines until the next header
+    log->seek(pos);
+    if (!log->nextLine())
+        return std::nullopt;
+
+    while (true)
+    {
+        qint64 lineStart = log->getFilePosition();
+        auto line = log->nextLine();
+        if (!line)
+            return std::nullopt;
+        if (isEntryHeader(line.value(), metadata.format))
+            return lineStart;
+    }
+}
+
 std::vector<std::shared_ptr<Format>> SessionService::getFormats(const QStringList& formats)
 {
     auto formatList = static_cast<Application*>(qApp)->getFormatManager().getFormats();
@@ -247,3 +414,26 @@ std::vector<std::shared_ptr<Format>> SessionService::getFormats(const QStringLis
         res.push_back(formatList.at(formatName.toStdString()));
     return res;
 }
+
+void SessionService::startIndexing(LogManager& manager)
+{
+    static const QString SearchIndexParameter = "search/useIndex";
+    static const QString TrigramIndexParameter = "search/trigramIndex";
+    static const QString PersistCheckpointsParameter = "session/persistCheckpoints";
+
+    Settings settings;
+    if (!settings.contains(PersistCheckpointsParameter))
+        settings.setValue(PersistCheckpointsParameter, false);
+
+    if (settings.value(PersistCheckpointsParameter, false).toBool())
+        manager.loadCheckpoints(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/checkpoints");
+
+    // Bloom filters cost about 4 KiB per 64 KiB block and are built by default, trigram postings grow with the text and stay opt-in
+    if (!settings.contains(SearchIndexParameter))
+        settings.setValue(SearchIndexParameter, true);
+    if (!settings.contains(TrigramIndexParameter))
+        settings.setValue(TrigramIndexParameter, false);
+
+    if (settings.value(SearchIndexParameter, true).toBool())
+        manager.buildIndexes(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/index", settings.value(TrigramIndexParameter, false).toBool());
+}
@@ -12,6 +12,7 @@
 #include <QTreeView>
 #include <QByteArray>
 
+#include <atomic>
 #include <map>
 #include <vector>
 #include <memory>
@@ -47,7 +48,7 @@ public:
     const ThreadSafePtr<LogManager>& getLogManager() const;
     const ThreadSafePtr<Session>& getSession() const;
 
-    std::unordered_set<QVariant, VariantHash> getEnumList(const QString& field) const;
+    std::vector<HeavyHitters::Counter> getFrequentValues(const QString& field) const;
 
     void createSession(const std::unordered_set<QString>& modules,
                        const std::chrono::system_clock::time_point& minTime,
@@ -76,17 +77,6 @@ public:
         return index;
     }
 
-    template<typename Iterator>
-    int requestLogEntries(const std::shared_ptr<Iterator>& iterator, int entryCount, const LogFilter& filter)
-    {
-        if (!logManager || !iterator || entryCount <= 0 || !iterator->hasLogs())
-            throw std::runtime_error("Invalid log entry request parameters.");
-
-        int index = nextRequestIndex++;
-        emit logEntriesRequested(DataRequest(index, std::make_shared<FilteredLogIterator<Iterator::IsStraight>>(iterator, filter), entryCount));
-        return index;
-    }
-
     template<typename Iterator>
     int requestLogEntries(const std::shared_ptr<Iterator>& iterator, int entryCount, const std::chrono::system_clock::time_point& until)
     {
@@ -99,20 +89,28 @@ public:
     }
 
     template<typename Iterator>
-    int requestLogEntries(const std::shared_ptr<Iterator>& iterator, int entryCount, const std::chrono::system_clock::time_point& until, const LogFilter& filter)
+    int requestMoreLogEntries(const std::shared_ptr<Iterator>& iterator, int entryCount)
     {
-        if (!logManager || !iterator || entryCount <= 0 || !iterator->hasLogs())
+        // The iterator may still be busy with an earlier request, so its state is not checked here
+        if (!logManager || !iterator || entryCount <= 0)
             throw std::runtime_error("Invalid log entry request parameters.");
 
         int index = nextRequestIndex++;
-        emit logEntriesRequested(DataRequest(index, std::make_shared<FilteredLogIterator<Iterator::IsStraight>>(iterator, filter), entryCount, until));
+        emit logEntriesRequested(DataRequest(index, iterator, entryCount));
         return index;
     }
 
     std::vector<LogEntry> getResult(int index);
+    MergeHeapCache getResultCache(int index);
+
+    // Entries read at points spread over the bytes of the session files, collected on the service thread
+    // once per session, when the first filter needs them
+    void requestSamples();
+    std::vector<LogEntry> getSamples() const;
 
 signals:
     void logManagerCreated(const QString& source);
+    void sessionCreated();
     void iteratorCreated(int, bool isStraight);
     void dataLoaded(int);
 
@@ -122,16 +120,27 @@ signals:
     void iteratorRequested(int index, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime);
     void reverseIteratorRequested(int index, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime);
     void logEntriesRequested(const DataRequest& request);
+    void samplesRequested();
+    void samplesCollected();
 
 private slots:
     void handleIteratorRequest(int index, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime);
     void handleReverseIteratorRequest(int index, const std::chrono::system_clock::time_point& startTime, const std::chrono::system_clock::time_point& endTime);
     void handleDataRequest(const DataRequest& request);
+    void handleSampleRequest();
 
 private:
     std::vector<std::shared_ptr<Format>> getFormats(const QStringList& formats);
 
+    static void startIndexing(LogManager& manager);
+    // Where to start reading samples at the given fraction of a file: a row of a snapshot,
+    // an index block start or the first entry header after that fraction of the bytes
+    static std::optional<qint64> findSamplePosition(const LogMetadata& metadata, double fraction);
+
 private:
+    static constexpr int SamplePoints = 16;
+    static constexpr int EntriesPerPoint = 32;
+
     ThreadSafePtr<LogManager> logManager;
     ThreadSafePtr<Session> session;
 
@@ -140,6 +149,10 @@ private:
     ThreadSafePtr<std::map<int, std::shared_ptr<LogEntryIterator<false>>>> reverseIterators;
 
     ThreadSafePtr<std::map<int, std::vector<LogEntry>>> dataRequestResults;
+    ThreadSafePtr<std::map<int, MergeHeapCache>> dataRequestCaches;
+
+    std::atomic<bool> samplingStarted = false;
+    ThreadSafePtr<std::vector<LogEntry>> samples;
 };
 
 Q_DECLARE_METATYPE(SessionService::DataRequest)
@@ -0,0 +1,53 @@
+#include "StatisticsService.h"
+#include "SessionService.h"
+#include "../Utils.h"
+#include <QMetaType>
+
+#include <utility>
+
+StatisticsService::StatisticsService(SessionService* sessionService, QObject* parent) : QObject(parent), sessionService(sessionService)
+{
+    qRegisterMetaType<Statistics::FieldStatisticsSpec>("Statistics::FieldStatisticsSpec");
+    qRegisterMetaType<Statistics::FieldStatisticsResult>("Statistics::FieldStatisticsResult");
+    qRegisterMetaType<Statistics::TemplateSpec>("Statistics::TemplateSpec");
+    qRegisterMetaType<Statistics::TemplateStatisticsResult>("Statistics::TemplateStatisticsResult");
+}
+
+void StatisticsService::calculateFieldStatistics(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const Statistics::FieldStatisticsSpec& spec)
+{
+    QT_SLOT_BEGIN
+
+    emit progressUpdated(QStringLiteral("Calculating field statistics..."), 0);
+
+    auto sessionPtr = sessionService->getSession();
+    if (!sessionPtr)
+        return;
+
+    auto result = Statistics::FieldStatistics::calculate(*sessionPtr.get(), start, end, spec);
+
+    emit progressUpdated(QStringLiteral("Field statistics ready"), 100);
+
+    emit fieldStatisticsReady(std::move(result));
+
+    QT_SLOT_END
+}
+
+
+void StatisticsService::mineTemplates(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const Statistics::TemplateSpec& spec)
+{
+    QT_SLOT_BEGIN
+
+    emit progressUpdated(QStringLiteral("Mining message patterns..."), 0);
+
+    auto sessionPtr = sessionService->getSession();
+    if (!sessionPtr)
+        return;
+
+    auto result = Statistics::TemplateStatistics::calculate(*sessionPtr.get(), start, end, spec);
+
+    emit progressUpdated(QStringLiteral("Message patterns ready"), 100);
+
+    emit templatesReady(std::move(result));
+
+    QT_SLOT_END
+}
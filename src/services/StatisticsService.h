@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QObject>
+#include <chrono>
+#include "Statistics/FieldStatistics.h"
+#include "Statistics/TemplateStatistics.h"
+
+class SessionService;
+
+class StatisticsService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StatisticsService(SessionService* sessionService, QObject* parent = nullptr);
+
+signals:
+    void fieldStatisticsReady(Statistics::FieldStatisticsResult result);
+    void templatesReady(Statistics::TemplateStatisticsResult result);
+    void progressUpdated(const QString& message, int progress);
+    void handleError(const QString& message);
+
+public slots:
+    void calculateFieldStatistics(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const Statistics::FieldStatisticsSpec& spec);
+    void mineTemplates(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end, const Statistics::TemplateSpec& spec);
+
+private:
+    SessionService* sessionService;
+};
@@ -4,15 +4,20 @@
 #include <QMetaType>
 
 #include <chrono>
+#include <optional>
 #include <utility>
 
 TimelineService::TimelineService(SessionService* sessionService, QObject* parent) : QObject(parent), sessionService(sessionService)
 {
     qRegisterMetaType<Statistics::Bucket>("Statistics::Bucket");
     qRegisterMetaType<std::vector<Statistics::Bucket>>("std::vector<Statistics::Bucket>");
+    qRegisterMetaType<Statistics::AggregationSpec>("Statistics::AggregationSpec");
+    qRegisterMetaType<Statistics::AggregationResult>("Statistics::AggregationResult");
+
+    connect(sessionService, &SessionService::sessionCreated, this, &TimelineService::resetPyramid);
 }
 
-void TimelineService::showTimeline(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end)
+void TimelineService::showTimeline(std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end)
 {
     QT_SLOT_BEGIN
 
@@ -23,7 +28,8 @@ void TimelineService::showTimeline(const std::chrono::system_clock::time_point&
         return;
 
     auto bucketSize = Statistics::LogHistogram::suggestBucketSize(start, end);
-    auto data = Statistics::LogHistogram::calculate(*sessionPtr.get(), start, end, bucketSize);
+    alignToSeconds(start, end, bucketSize);
+    auto data = countEntries(*sessionPtr.get(), start, end, bucketSize);
 
     emit progressUpdated(QStringLiteral("Timeline ready"), 100);
 
@@ -32,3 +38,61 @@ void TimelineService::showTimeline(const std::chrono::system_clock::time_point&
     QT_SLOT_END
 }
 
+void TimelineService::aggregate(std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end, const Statistics::AggregationSpec& spec)
+{
+    QT_SLOT_BEGIN
+
+    emit progressUpdated(QStringLiteral("Preparing timeline..."), 0);
+
+    auto sessionPtr = sessionService->getSession();
+    if (!sessionPtr)
+        return;
+
+    Statistics::AggregationResult result;
+    if (spec.isPlainCount())
+    {
+        auto bucketSize = spec.bucketSize > std::chrono::system_clock::duration::zero() ? spec.bucketSize : Statistics::LogHistogram::suggestBucketSize(start, end);
+        alignToSeconds(start, end, bucketSize);
+        result = Statistics::AggregationResult::fromBuckets(countEntries(*sessionPtr.get(), start, end, bucketSize), end, spec);
+    }
+    else
+    {
+        result = Statistics::Aggregator::calculate(*sessionPtr.get(), start, end, spec);
+    }
+
+    emit progressUpdated(QStringLiteral("Timeline ready"), 100);
+
+    emit aggregationReady(std::move(result));
+
+    QT_SLOT_END
+}
+
+// The pyramid counts whole seconds. A range over whole-second buckets is widened to whole seconds, so every
+// bucket covers whole slots and its count is exact whether it comes from the pyramid or from a scan.
+void TimelineService::alignToSeconds(std::chrono::system_clock::time_point& start, std::chrono::system_clock::time_point& end, const std::chrono::system_clock::duration& bucketSize)
+{
+    if (bucketSize <= std::chrono::system_clock::duration::zero() || bucketSize % std::chrono::seconds(1) != std::chrono::system_clock::duration::zero())
+        return;
+
+    start = std::chrono::floor<std::chrono::seconds>(start);
+    end = std::chrono::ceil<std::chrono::seconds>(end);
+}
+
+std::vector<Statistics::Bucket> TimelineService::countEntries(Session& session,
+                                                              const std::chrono::system_clock::time_point& start,
+                                                              const std::chrono::system_clock::time_point& end,
+                                                              const std::chrono::system_clock::duration& bucketSize)
+{
+    // Built on the first query, sessions that never show a timeline do not pay for the scan
+    if (!pyramid)
+        pyramid = std::make_unique<Statistics::TimelinePyramid>(session);
+
+    if (auto data = pyramid->query(start, end, bucketSize))
+        return std::move(data.value());
+    return Statistics::LogHistogram::calculate(session, start, end, bucketSize);
+}
+
+void TimelineService::resetPyramid()
+{
+    pyramid.reset();
+}
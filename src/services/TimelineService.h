@@ -4,6 +4,10 @@
 #include <vector>
 #include <chrono>
 #include "Statistics/LogHistogram.h"
+#include "Statistics/TimelinePyramid.h"
+#include "Statistics/Aggregation.h"
+
+#include <memory>
 
 class SessionService;
 class QWidget;
@@ -17,13 +21,27 @@ public:
 
 signals:
     void timelineReady(std::vector<Statistics::Bucket> data);
+    void aggregationReady(Statistics::AggregationResult result);
     void progressUpdated(const QString& message, int progress);
     void handleError(const QString& message);
 
 public slots:
-    void showTimeline(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end);
+    void showTimeline(std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end);
+    void aggregate(std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end, const Statistics::AggregationSpec& spec);
+
+private slots:
+    void resetPyramid();
+
+private:
+    static void alignToSeconds(std::chrono::system_clock::time_point& start, std::chrono::system_clock::time_point& end, const std::chrono::system_clock::duration& bucketSize);
+
+    std::vector<Statistics::Bucket> countEntries(Session& session,
+                                                 const std::chrono::system_clock::time_point& start,
+                                                 const std::chrono::system_clock::time_point& end,
+                                                 const std::chrono::system_clock::duration& bucketSize);
 
 private:
     SessionService* sessionService;
+    std::unique_ptr<Statistics::TimelinePyramid> pyramid;
 };
 
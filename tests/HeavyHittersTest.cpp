@@ -0,0 +1,76 @@
+#include <QtTest/QtTest>
+
+#include "LogManagement/HeavyHitters.h"
+
+class HeavyHittersTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testHeavyHitters();
+    void testMerge();
+};
+
+void HeavyHittersTest::testHeavyHitters()
+{
+    HeavyHitters exact(8);
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int j = 0; j <= i; ++j)
+            exact.add(QString("value%1").arg(i));
+    }
+
+    auto top = exact.getTop();
+    QCOMPARE(top.size(), size_t(4));
+    QCOMPARE(top[0].value.toString(), QString("value3"));
+    QCOMPARE(top[0].count, std::uint64_t(4));
+    QCOMPARE(top[0].error, std::uint64_t(0));
+    QCOMPARE(top[3].value.toString(), QString("value0"));
+    QCOMPARE(exact.getTop(2).size(), size_t(2));
+
+    // Frequent values survive a long tail of unique ones in bounded memory
+    HeavyHitters bounded(32);
+    for (int i = 0; i < 10000; ++i)
+    {
+        bounded.add(QString("user%1").arg(i));
+        if (i % 10 == 0)
+            bounded.add(QString("frequent"));
+        if (i % 20 == 0)
+            bounded.add(QString("common"));
+    }
+
+    QCOMPARE(bounded.size(), size_t(32));
+    QCOMPARE(bounded.getTotal(), std::uint64_t(10000 + 1000 + 500));
+    top = bounded.getTop(2);
+    QCOMPARE(top[0].value.toString(), QString("frequent"));
+    QCOMPARE(top[1].value.toString(), QString("common"));
+    QVERIFY(top[0].count >= 1000);
+    QVERIFY(top[0].count - top[0].error <= 1000);
+}
+
+void HeavyHittersTest::testMerge()
+{
+    HeavyHitters first(16);
+    HeavyHitters second(16);
+    for (int i = 0; i < 1000; ++i)
+    {
+        (i % 2 ? first : second).add(QString("rare%1").arg(i));
+        if (i % 4 == 0)
+            first.add(QString("frequent"));
+        if (i % 5 == 0)
+            second.add(QString("frequent"));
+    }
+
+    HeavyHitters merged(16);
+    merged.merge(first.getTop());
+    merged.merge(second.getTop());
+
+    QCOMPARE(merged.getTotal(), first.getTotal() + second.getTotal());
+    auto top = merged.getTop(1);
+    QCOMPARE(top[0].value.toString(), QString("frequent"));
+    QVERIFY(top[0].count >= 450);
+    QVERIFY(top[0].count - top[0].error <= 450);
+}
+
+QTEST_APPLESS_MAIN(HeavyHittersTest)
+#include "HeavyHittersTest.moc"
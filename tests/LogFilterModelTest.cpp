@@ -9,6 +9,7 @@
 #include "LogView/LogFilterModel.h"
 #include "LogView/LogModel.h"
 #include "LogView/FilteredLogModel.h"
+#include "LogView/SelectivityEstimator.h"
 #include "Settings.h"
 #include "LogView/LogViewUtils.h"
 
@@ -25,6 +26,10 @@ private slots:
     void testFilterWildcard();
     void testVariantList();
     void testFilteredModelCreated();
+    void testBatchFilter();
+    void testSelectivityEstimate();
+    void testCompiledFilter();
+    void testQuery();
 
 private:
     QString getModule(int);
@@ -80,6 +85,7 @@ void LogFilterModelTest::initTestCase()
         f.name = QString::number(i);
         f.regex = QRegularExpression(".*");
         f.type = QMetaType::QString;
+        f.isEnum = i == 4;
         format->fields.push_back(f);
     }
     app->getFormatManager().addFormat(format);
@@ -97,6 +103,11 @@ void LogFilterModelTest::initTestCase()
 
     QSignalSpy dataSpy(model, &QAbstractItemModel::rowsInserted);
     QVERIFY(dataSpy.wait(10 * 1000));
+
+    QSignalSpy samplesSpy(sessionService, &SessionService::samplesCollected);
+    sessionService->requestSamples();
+    QVERIFY(samplesSpy.wait(10 * 1000));
+    QVERIFY(!sessionService->getSamples().empty());
 }
 
 void LogFilterModelTest::testFilterWildcard()
@@ -142,6 +153,10 @@ void LogFilterModelTest::testVariantList()
     LogEntry badEntry; badEntry.values.emplace("field1", QStringLiteral("modB"));
     QVERIFY(filter.check(okEntry));
     QVERIFY(!filter.check(badEntry));
+
+    auto compiled = filter.compile();
+    QVERIFY(compiled.check(okEntry));
+    QVERIFY(!compiled.check(badEntry));
 }
 
 void LogFilterModelTest::testFilteredModelCreated()
@@ -160,6 +175,164 @@ void LogFilterModelTest::testFilteredModelCreated()
     QCOMPARE(filterModel.rowCount(), entryCount * 2);
 }
 
+void LogFilterModelTest::testBatchFilter()
+{
+    LogFilterModel filterModel;
+    filterModel.setSourceModel(model);
+
+    int expected = 0;
+    for (int i = 0; i < model->rowCount(); ++i)
+    {
+        if (model->data(model->index(i, 2)).toString() != "modA")
+            ++expected;
+    }
+
+    filterModel.setFilterMode(2, FilterType::Blacklist);
+    filterModel.setVariantList(2, QStringList() << "modA");
+    QCOMPARE(filterModel.sourceModel(), model);
+    QCOMPARE(filterModel.rowCount(), expected);
+    for (int i = 0; i < filterModel.rowCount(); ++i)
+        QVERIFY(filterModel.data(filterModel.index(i, 2)).toString() != "modA");
+
+    filterModel.setFilterWildcard(6, "msg*");
+    QCOMPARE(filterModel.rowCount(), expected);
+
+    filterModel.setVariantList(2, QStringList());
+    QCOMPARE(filterModel.rowCount(), model->rowCount());
+}
+
+void LogFilterModelTest::testSelectivityEstimate()
+{
+    SelectivityEstimator estimator(sessionService);
+
+    std::unordered_map<int, VariantFilter> variants;
+    variants[0] = VariantFilter{ { "modA" }, FilterType::Whitelist };
+    LogFilter selective({}, variants, QStringList{ "1" }, {});
+
+    auto estimate = estimator.estimate(selective);
+    QVERIFY(estimate.selectivity > 0.05 && estimate.selectivity < 0.2);
+    QVERIFY(estimate.hasPreFilter);
+    QVERIFY(SelectivityEstimator::preferFilteredModel(estimate));
+
+    variants[0].type = FilterType::Blacklist;
+    LogFilter broad({}, variants, QStringList{ "1" }, {});
+    estimate = estimator.estimate(broad);
+    QVERIFY(estimate.selectivity > 0.8);
+    QVERIFY(!estimator.preferFilteredModel(broad));
+
+    // The level is an enum field, its predicates are estimated from the values counted while reading
+    std::unordered_map<int, VariantFilter> levels;
+    levels[0] = VariantFilter{ { "error" }, FilterType::Whitelist };
+    estimate = estimator.estimate(LogFilter({}, levels, QStringList{ "4" }, {}));
+    QVERIFY(estimate.selectivity < 0.1);
+
+    levels[0].type = FilterType::Blacklist;
+    estimate = estimator.estimate(LogFilter({}, levels, QStringList{ "4" }, {}));
+    QCOMPARE(estimate.selectivity, 1.0);
+
+    QVERIFY(!SelectivityEstimator::preferFilteredModel(SelectivityEstimator::Estimate{}));
+}
+
+void LogFilterModelTest::testCompiledFilter()
+{
+    std::unordered_map<int, RegexFilter> columnFilters;
+    columnFilters[1] = RegexFilter{ QRegularExpression("^msg[0-4]$"), FilterType::Whitelist };
+    std::unordered_map<int, VariantFilter> variants;
+    variants[0] = VariantFilter{ { "modA", "modB" }, FilterType::Whitelist };
+    variants[2] = VariantFilter{ { "error" }, FilterType::Blacklist };
+    LogFilter filter(columnFilters, variants, QStringList{ "field1", "message", "level" }, { "main" });
+
+    auto compiled = filter.compile();
+    QVERIFY(!compiled.isEmpty());
+    QVERIFY(LogFilter().compile().isEmpty());
+
+    for (int i = 0; i < entryCount; ++i)
+    {
+        LogEntry entry;
+        entry.module = i % 3 ? "main" : "other";
+        entry.values.emplace("field1", getModule(i));
+        entry.values.emplace("message", entryTemplate.arg(i));
+        entry.values.emplace("level", i % 2 ? QStringLiteral("info") : QStringLiteral("error"));
+        QCOMPARE(compiled.check(entry), filter.check(entry));
+    }
+
+    QVERIFY(compiled.acceptsModule("main"));
+    QVERIFY(!compiled.acceptsModule("other"));
+
+    auto format = std::make_shared<Format>();
+    for (const auto& name : { "field1", "message", "level" })
+    {
+        Format::Field field;
+        field.name = name;
+        field.regex = QRegularExpression(".*");
+        field.type = QMetaType::QString;
+        format->fields.push_back(field);
+    }
+
+    auto preFilter = compiled.createPreFilter();
+    QVERIFY(preFilter);
+
+    RawLogEntry raw;
+    raw.parts = QStringList{ "modA", "msg1", "error" };
+    QVERIFY(preFilter(raw, format));
+    raw.parts = QStringList{ "modC", "msg1", "info" };
+    QVERIFY(!preFilter(raw, format));
+    raw.parts = QStringList{ "modB", "msg7", "info" };
+    QVERIFY(!preFilter(raw, format));
+}
+
+void LogFilterModelTest::testQuery()
+{
+    std::vector<Format::Field> fields;
+    for (const auto& [name, type] : { std::pair{ "severity", QMetaType::QString }, std::pair{ "latency_ms", QMetaType::Int }, std::pair{ "message", QMetaType::QString } })
+    {
+        Format::Field field;
+        field.name = name;
+        field.type = type;
+        fields.push_back(field);
+    }
+
+    LogQuery query(R"(severity in (ERROR, FATAL) and (latency_ms > 500 or message ~ /timeout/i) and not module = "health")", fields);
+
+    auto createEntry = [](const QString& module, const QString& severity, int latency, const QString& message) {
+        LogEntry entry;
+        entry.module = module;
+        entry.values.emplace("severity", severity);
+        entry.values.emplace("latency_ms", latency);
+        entry.values.emplace("message", message);
+        return entry;
+    };
+
+    std::vector<LogEntry> entries{
+        createEntry("api", "ERROR", 900, "failed"),
+        createEntry("api", "ERROR", 100, "Connection Timeout"),
+        createEntry("api", "ERROR", 100, "failed"),
+        createEntry("api", "INFO", 900, "slow"),
+        createEntry("health", "FATAL", 900, "failed"),
+        createEntry("db", "FATAL", 80, "timeout"),
+    };
+
+    std::vector<const LogEntry*> batch;
+    for (const auto& entry : entries)
+        batch.push_back(&entry);
+
+    std::vector<char> expected{ 1, 1, 0, 0, 0, 1 };
+    QCOMPARE(query.evaluate(batch), expected);
+    for (size_t i = 0; i < entries.size(); ++i)
+        QCOMPARE(query.check(entries[i]), static_cast<bool>(expected[i]));
+
+    LogFilter filter;
+    filter.setQuery(std::make_shared<LogQuery>("latency_ms <= 100 and severity != 'INFO'", fields));
+    auto compiled = filter.compile();
+    QVERIFY(!compiled.isEmpty());
+    compiled.filter(entries);
+    QCOMPARE(entries.size(), size_t(3));
+
+    QVERIFY_THROWS_EXCEPTION(std::invalid_argument, LogQuery("latency_ms > fast", fields));
+    QVERIFY_THROWS_EXCEPTION(std::invalid_argument, LogQuery("unknown = 1", fields));
+    QVERIFY_THROWS_EXCEPTION(std::invalid_argument, LogQuery("(severity = ERROR", fields));
+}
+
 QString LogFilterModelTest::getModule(int i)
 {
     switch (i % 10)
@@ -1,6 +1,13 @@
 #include <QtTest/QtTest>
 
 #include "Statistics/LogHistogram.h"
+#include "Statistics/QuantileSketch.h"
+#include "Statistics/HdrHistogram.h"
+#include "Statistics/TemplateMiner.h"
+#include "Statistics/TemplateStatistics.h"
+
+#include <algorithm>
+#include <random>
 
 using namespace std::chrono;
 
@@ -10,6 +17,10 @@ class LogHistogramTest : public QObject
 
 private slots:
     void testSuggestBucketSize();
+    void testQuantileSketch();
+    void testHdrHistogram();
+    void testTemplateMiner();
+    void testTemplateRanking();
 };
 
 void LogHistogramTest::testSuggestBucketSize()
@@ -24,6 +35,119 @@ void LogHistogramTest::testSuggestBucketSize()
     QCOMPARE(bucket2, seconds(1));
 }
 
+void LogHistogramTest::testQuantileSketch()
+{
+    std::mt19937 random(1);
+    std::exponential_distribution<double> distribution(0.01);
+
+    std::vector<double> values;
+    Statistics::QuantileSketch first;
+    Statistics::QuantileSketch second;
+    for (int i = 0; i < 100000; ++i)
+    {
+        values.push_back(distribution(random));
+        (i % 2 ? first : second).add(values.back());
+    }
+    first.merge(second);
+    std::sort(values.begin(), values.end());
+
+    QCOMPARE(first.getCount(), 100000.0);
+    QCOMPARE(first.quantile(0), values.front());
+    QCOMPARE(first.quantile(1), values.back());
+    QVERIFY(first.getCentroidCount() < 500);
+    for (double q : { 0.5, 0.9, 0.99, 0.999 })
+    {
+        double exact = values[static_cast<size_t>(q * values.size())];
+        QVERIFY2(std::abs(first.quantile(q) - exact) < exact * 0.03, qPrintable(QString::number(q)));
+    }
+}
+
+void LogHistogramTest::testHdrHistogram()
+{
+    Statistics::HdrHistogram first;
+    Statistics::HdrHistogram second;
+    for (int i = 1; i <= 1000; ++i)
+        (i % 2 ? first : second).add(i);
+    first.merge(second);
+
+    QCOMPARE(first.getCount(), std::uint64_t(1000));
+    QCOMPARE(first.getMin(), 1.0);
+    QCOMPARE(first.getMax(), 1000.0);
+    for (double q : { 0.5, 0.9, 0.99 })
+        QVERIFY(std::abs(first.quantile(q) - q * 1000) <= q * 1000 * 0.01);
+
+    std::uint64_t total = 0;
+    for (const auto& bucket : first.getBuckets())
+        total += bucket.count;
+    QCOMPARE(total, std::uint64_t(1000));
+
+    // Sub-unit values get their own buckets once the unit is small enough, negative ones are only counted
+    Statistics::HdrHistogram fractions(7, 0.001);
+    fractions.add(0.25);
+    fractions.add(0.5);
+    fractions.add(-1);
+    QCOMPARE(fractions.getCount(), std::uint64_t(2));
+    QCOMPARE(fractions.getRejectedCount(), std::uint64_t(1));
+    QVERIFY(std::abs(fractions.quantile(0.5) - 0.25) <= 0.25 * 0.01);
+    QVERIFY(std::abs(fractions.quantile(1) - 0.5) <= 0.5 * 0.01);
+}
+
+void LogHistogramTest::testTemplateMiner()
+{
+    Statistics::TemplateMiner miner;
+    int first = miner.add("user 17 logged in from host-a");
+    int second = miner.add("user 42 logged in from host-b");
+    int other = miner.add("connection closed by peer");
+    int third = miner.add("user 7 logged in from host-c");
+
+    QCOMPARE(second, first);
+    QCOMPARE(third, first);
+    QVERIFY(other != first);
+    QCOMPARE(miner.getTemplate(first), QString("user <*> logged in from <*>"));
+    QCOMPARE(miner.getCount(first), std::int64_t(3));
+    QCOMPARE(miner.getTemplate(other), QString("connection closed by peer"));
+
+    // Merging a mined template keeps matching messages on the same id
+    Statistics::TemplateMiner merged;
+    int mergedId = merged.add(miner.getTemplate(first), miner.getCount(first));
+    QCOMPARE(merged.add("user 99 logged in from host-d"), mergedId);
+    QCOMPARE(merged.getCount(mergedId), std::int64_t(4));
+
+    Statistics::TemplateMiner::Settings settings;
+    settings.maxTemplates = 2;
+    Statistics::TemplateMiner bounded(settings);
+    bounded.add("alpha");
+    bounded.add("beta");
+    QCOMPARE(bounded.add("gamma"), Statistics::TemplateMiner::OverflowId);
+    QCOMPARE(bounded.size(), size_t(3));
+}
+
+void LogHistogramTest::testTemplateRanking()
+{
+    Statistics::TemplateStatisticsResult result;
+    result.start = system_clock::time_point{};
+    result.end = result.start + minutes(4);
+    result.bucketSize = minutes(1);
+    for (int i = 0; i < 4; ++i)
+        result.bucketStarts.push_back(result.start + minutes(i));
+    result.templates.push_back({ "steady", 40, { 10, 10, 10, 10 } });
+    result.templates.push_back({ "spike", 22, { 1, 1, 10, 10 } });
+    result.templates.push_back({ "gone", 10, { 5, 5, 0, 0 } });
+
+    auto split = result.start + minutes(2);
+    auto changes = result.rankChanges(result.start, split, split, result.end);
+    QCOMPARE(changes.size(), size_t(3));
+    QCOMPARE(changes[0].index, size_t(1));
+    QCOMPARE(changes[0].before, std::int64_t(2));
+    QCOMPARE(changes[0].after, std::int64_t(20));
+    QCOMPARE(changes[1].index, size_t(0));
+    QCOMPARE(changes[1].score, 0.0);
+    QCOMPARE(changes[2].index, size_t(2));
+    QVERIFY(changes[2].score < 0);
+
+    QVERIFY(result.rankChanges(result.start, result.start, split, result.end).empty());
+}
+
 QTEST_APPLESS_MAIN(LogHistogramTest)
 #include "LogHistogramTest.moc"
 
@@ -0,0 +1,254 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <memory>
+
+#include "Application.h"
+#include "LogManagement/LogIndex.h"
+#include "LogManagement/CheckpointStore.h"
+#include "LogManagement/LogMetadata.h"
+#include "LogManagement/LogUtils.h"
+
+class LogIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testBlocks();
+    void testNextBlock();
+    void testPersistence();
+    void testBloomFilters();
+    void testPredicateBlocks();
+    void testCheckpointStore();
+
+private:
+    LogMetadata createMetadata(const QString& filename)
+    {
+        LogMetadata meta;
+        meta.format = format;
+        meta.filename = filename;
+        meta.fileBuilder = [](const QString& filename, const std::shared_ptr<Format>& format) {
+            return std::make_shared<Log>(std::make_unique<QFile>(filename), format->encoding, std::shared_ptr<std::vector<Format::Comment>>(format, &format->comments));
+        };
+        return meta;
+    }
+
+private:
+    QTemporaryDir tempDir;
+    QString logFile;
+    std::shared_ptr<Format> format;
+    std::atomic<bool> stop = false;
+};
+
+void LogIndexTest::initTestCase()
+{
+    format = std::make_shared<Format>();
+    format->name = "TestFormat";
+    format->extension = ".csv";
+    format->separator = ";";
+    format->timeFieldIndex = 0;
+    format->timeMask = "%F %H:%M:%S";
+    format->timeFractionalDigits = 3;
+    for (int i = 0; i < 3; ++i)
+    {
+        Format::Field f;
+        f.name = QString::number(i);
+        f.regex = QRegularExpression(".*");
+        f.type = QMetaType::QString;
+        f.isEnum = i == 1;
+        format->fields.push_back(f);
+    }
+
+    logFile = tempDir.filePath("test.csv");
+    QFile file(logFile);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QTextStream out(&file);
+    for (int i = 0; i < 5000; ++i)
+        out << "2023-01-01 00:00:00.000;info;regular message number " << i << "\n";
+    out << "2023-01-01 00:00:01.000;error;uniqueterm\n";
+}
+
+void LogIndexTest::testBlocks()
+{
+    LogIndex index;
+    QVERIFY(!index.isReady());
+    QVERIFY(index.build(createMetadata(logFile), stop));
+    QVERIFY(index.isReady());
+    QVERIFY(index.getBlockCount() > 1);
+
+    auto blocks = index.findBlocks({ "UniqueTerm" });
+    QCOMPARE(std::count(blocks.begin(), blocks.end(), true), std::ptrdiff_t(1));
+    QVERIFY(blocks.back());
+
+    blocks = index.findBlocks({ "regular", "message" });
+    QCOMPARE(std::count(blocks.begin(), blocks.end(), true), static_cast<std::ptrdiff_t>(blocks.size()));
+
+    blocks = index.findBlocks({ "absentterm" });
+    QCOMPARE(std::count(blocks.begin(), blocks.end(), true), std::ptrdiff_t(0));
+}
+
+void LogIndexTest::testNextBlock()
+{
+    LogIndex index;
+    QVERIFY(index.build(createMetadata(logFile), stop));
+
+    qint64 fileSize = QFileInfo(logFile).size();
+
+    auto blocks = index.findBlocks({ "uniqueterm" });
+    auto pos = index.findNextBlock(blocks, 0, true);
+    QVERIFY(pos);
+    QVERIFY(pos.value() > 0);
+
+    auto log = createMetadata(logFile).fileBuilder(logFile, format);
+    log->seek(pos.value());
+    auto line = log->nextLine();
+    QVERIFY(line);
+    QVERIFY(isEntryHeader(line.value(), format));
+
+    QCOMPARE(index.findNextBlock(blocks, fileSize, false), std::optional<qint64>(fileSize));
+
+    blocks = index.findBlocks({ "absentterm" });
+    QCOMPARE(index.findNextBlock(blocks, 0, true), std::optional<qint64>(fileSize));
+    QVERIFY(!index.findNextBlock(blocks, fileSize, false));
+}
+
+void LogIndexTest::testPersistence()
+{
+    LogIndex index;
+    QVERIFY(index.build(createMetadata(logFile), stop));
+
+    QString indexFile = tempDir.filePath("index/test.idx");
+    QVERIFY(index.save(indexFile, logFile));
+
+    LogIndex loaded;
+    QVERIFY(loaded.load(indexFile, logFile));
+    QVERIFY(loaded.isReady());
+    QCOMPARE(loaded.getBlockCount(), index.getBlockCount());
+    QCOMPARE(loaded.findBlocks({ "uniqueterm" }), index.findBlocks({ "uniqueterm" }));
+
+    auto values = loaded.getFrequentValues("1");
+    QVERIFY(values);
+    auto top = values->getTop();
+    QCOMPARE(top.size(), size_t(2));
+    QCOMPARE(top[0].value.toString(), QString("info"));
+    QCOMPARE(top[0].count, std::uint64_t(5000));
+    QCOMPARE(top[1].value.toString(), QString("error"));
+    QVERIFY(!loaded.getFrequentValues("2"));
+
+    LogIndex other;
+    QVERIFY(!other.load(indexFile, tempDir.filePath("other.csv")));
+}
+
+void LogIndexTest::testBloomFilters()
+{
+    LogIndex index;
+    QVERIFY(index.build(createMetadata(logFile), stop, false));
+    QVERIFY(index.isFieldIndexed("1"));
+    QVERIFY(!index.isFieldIndexed("2"));
+
+    QCOMPARE(LogIndex::getCompleteTokens("partial;Error;words"), QStringList{ "error" });
+
+    auto blocks = index.findBlocks({ ";error;" });
+    QCOMPARE(std::count(blocks.begin(), blocks.end(), true), std::ptrdiff_t(1));
+    QVERIFY(blocks.back());
+
+    blocks = index.findBlocks("1", { "error" });
+    QCOMPARE(std::count(blocks.begin(), blocks.end(), true), std::ptrdiff_t(1));
+    QVERIFY(blocks.back());
+
+    blocks = index.findBlocks("1", { "warning", "info" });
+    QCOMPARE(std::count(blocks.begin(), blocks.end(), true), static_cast<std::ptrdiff_t>(blocks.size()));
+
+    blocks = index.findBlocks("2", { "warning" });
+    QCOMPARE(std::count(blocks.begin(), blocks.end(), true), static_cast<std::ptrdiff_t>(blocks.size()));
+}
+
+void LogIndexTest::testPredicateBlocks()
+{
+    LogIndex index;
+    auto metadata = createMetadata(logFile);
+    QVERIFY(index.build(metadata, stop, false));
+
+    int evaluated = 0;
+    LogIndex::BlockPredicates predicates{ { "level=error", [&evaluated](const QStringList& parts, const std::shared_ptr<Format>&) {
+        ++evaluated;
+        return parts[1] == "error";
+    } } };
+
+    auto states = index.getPredicateStates(logFile, predicates);
+    std::vector<bool> blocks;
+    for (size_t i = 0; i < index.getBlockCount(); ++i)
+        blocks.push_back(index.checkBlock(metadata, i, predicates, states));
+    QCOMPARE(std::count(blocks.begin(), blocks.end(), true), std::ptrdiff_t(1));
+    QVERIFY(blocks.back());
+    QVERIFY(evaluated > 0);
+
+    evaluated = 0;
+    LogIndex::BlockPredicates refined = predicates;
+    refined.emplace_back("message=uniqueterm", [&evaluated](const QStringList& parts, const std::shared_ptr<Format>&) {
+        ++evaluated;
+        return parts[2] == "uniqueterm";
+    });
+
+    // Known results are shared with the new filter, only the unknown predicate reads the last block
+    auto refinedStates = index.getPredicateStates(logFile, refined);
+    for (size_t i = 0; i + 1 < index.getBlockCount(); ++i)
+        QVERIFY(!index.checkBlock(metadata, i, refined, refinedStates));
+    QCOMPARE(evaluated, 0);
+
+    QVERIFY(index.checkBlock(metadata, index.getBlockCount() - 1, refined, refinedStates));
+    QVERIFY(evaluated > 0);
+}
+
+void LogIndexTest::testCheckpointStore()
+{
+    auto base = std::chrono::system_clock::time_point(std::chrono::seconds(1672531200));
+
+    CheckpointStore store;
+    store.add(MergeHeapCache{ base });
+    QCOMPARE(store.size(), size_t(0));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        MergeHeapCache checkpoint{ base + std::chrono::seconds(i * 10) };
+        checkpoint.heap.push_back({ "test", base, i * 100 });
+        store.add(checkpoint);
+    }
+    QCOMPARE(store.size(), size_t(3));
+
+    QVERIFY(!store.findBefore(base - std::chrono::seconds(1)));
+    auto found = store.findBefore(base + std::chrono::seconds(15));
+    QVERIFY(found);
+    QCOMPARE(found->heap.front().pos, 100);
+
+    std::vector<LogMetadata> files{ createMetadata(logFile) };
+    QString path = tempDir.filePath("checkpoints/test.ckp");
+    QVERIFY(store.save(path, files));
+
+    CheckpointStore loaded;
+    QVERIFY(loaded.load(path, files));
+    QCOMPARE(loaded.size(), size_t(3));
+    found = loaded.findBefore(base + std::chrono::seconds(25));
+    QVERIFY(found);
+    QVERIFY(found->time == base + std::chrono::seconds(20));
+    QCOMPARE(found->heap.front().module, QString("test"));
+    QCOMPARE(found->heap.front().pos, 200);
+
+    QFile file(logFile);
+    QVERIFY(file.open(QIODevice::Append));
+    file.write("2023-01-01 00:00:02.000;info;appended\n");
+    file.close();
+
+    CheckpointStore stale;
+    QVERIFY(!stale.load(path, files));
+    QCOMPARE(stale.size(), size_t(0));
+}
+
+int main(int argc, char** argv)
+{
+    Application app(argc, argv);
+    LogIndexTest tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "LogIndexTest.moc"
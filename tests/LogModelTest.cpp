@@ -9,6 +9,8 @@
 #include "LogView/LogViewUtils.h"
 #include "Settings.h"
 
+#include <algorithm>
+
 static std::chrono::system_clock::time_point toTimePoint(const QDateTime &dt)
 {
     return std::chrono::system_clock::time_point{ std::chrono::milliseconds{ dt.toMSecsSinceEpoch() } };
@@ -23,9 +25,13 @@ private slots:
 
     void testInitialLoad();
     void testAvailableModules();
+    void testParsedEnumValues();
     void testHeaderData();
     void testLoadMultipleBlocks();
     void testFetchDownMore();
+    void testPrefetch();
+    void testTimePositions();
+    void testLogWindow();
 
 private:
     Application *app = nullptr;
@@ -78,6 +84,7 @@ void LogModelTest::initTestCase()
         f.name = QString::number(i);
         f.regex = QRegularExpression(".*");
         f.type = QMetaType::QString;
+        f.isEnum = i == 4;
         format->fields.push_back(f);
     }
     app->getFormatManager().addFormat(format);
@@ -115,7 +122,22 @@ void LogModelTest::testAvailableModules()
     LogModel model(sessionService);
     auto modules = model.availableValues(
         static_cast<int>(LogModel::PredefinedColumn::Module));
-    QVERIFY(modules.find(QString("test")) != modules.end());
+    QVERIFY(std::find(modules.begin(), modules.end(), QVariant(QString("test"))) != modules.end());
+}
+
+void LogModelTest::testParsedEnumValues()
+{
+    // No index is built for the buffer, the level values come from the entries the view has read
+    LogModel model(sessionService);
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    model.goToTime(firstTime);
+
+    resetSpy.wait(10 * 1000);
+    QVERIFY(!resetSpy.empty());
+
+    auto levels = model.availableValues(5);
+    QCOMPARE(levels.size(), 1);
+    QCOMPARE(levels.front().toString(), QStringLiteral("info"));
 }
 
 void LogModelTest::testHeaderData()
@@ -230,6 +252,100 @@ void LogModelTest::testFetchDownMore()
     }
 }
 
+void LogModelTest::testPrefetch()
+{
+    LogModel model(sessionService);
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+
+    model.goToTime(firstTime);
+
+    resetSpy.wait(10 * 1000);
+    QVERIFY(!resetSpy.empty());
+    QTRY_COMPARE(model.rowCount(), blockSize * 2);
+
+    QSignalSpy insertSpy(&model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy loadedSpy(sessionService, &SessionService::dataLoaded);
+
+    model.setScrollVelocity(blockSize * 10.0);
+    model.fetchDownMore();
+
+    QTRY_COMPARE(insertSpy.count(), 1);
+    QTRY_VERIFY(loadedSpy.count() >= 2);
+    QCOMPARE(insertSpy.count(), 1);
+    QCOMPARE(model.data(model.index(model.rowCount() - 1, 6)).toString(), entryTemplate.arg(blockSize * 3 - 1));
+
+    model.setScrollVelocity(-blockSize * 10.0);
+    model.setScrollVelocity(blockSize * 10.0);
+    model.fetchDownMore();
+
+    QTRY_COMPARE(insertSpy.count(), 2);
+    QCOMPARE(model.rowCount(), blockSize * 2);
+    QCOMPARE(model.data(model.index(model.rowCount() - 1, 6)).toString(), entryTemplate.arg(entryCount - 1));
+}
+
+void LogModelTest::testTimePositions()
+{
+    LogModel model(sessionService);
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    model.goToTime(firstTime);
+    resetSpy.wait(10 * 1000);
+    QVERIFY(!resetSpy.empty());
+
+    QVERIFY(model.getEstimatedRowCount() >= model.rowCount());
+
+    QCOMPARE(model.getTimePosition(toTimePoint(firstTime)), 0.0);
+    QCOMPARE(model.getTimePosition(toTimePoint(lastTime)), 1.0);
+    QCOMPARE(model.getTimePosition(toTimePoint(lastTime.addSecs(10))), 1.0);
+
+    auto middle = model.getTimeAtPosition(0.5);
+    QCOMPARE(middle, toTimePoint(firstTime) + (toTimePoint(lastTime) - toTimePoint(firstTime)) / 2);
+    QVERIFY(qAbs(model.getTimePosition(middle) - 0.5) < 1e-6);
+    QCOMPARE(model.getTimeAtPosition(0.0), toTimePoint(firstTime));
+}
+
+void LogModelTest::testLogWindow()
+{
+    auto makeEntries = [](int first, int last) {
+        std::vector<LogEntry> entries;
+        for (int i = first; i < last; ++i)
+        {
+            LogEntry entry;
+            entry.time = std::chrono::system_clock::time_point{ std::chrono::seconds{ i } };
+            entry.line = QString::number(i);
+            entries.push_back(entry);
+        }
+        return entries;
+    };
+
+    LogWindow window;
+    window.append(makeEntries(10, 20));
+    window.append(makeEntries(20, 30));
+
+    auto reversed = makeEntries(0, 10);
+    std::reverse(reversed.begin(), reversed.end());
+    window.prepend(std::move(reversed));
+
+    QCOMPARE(window.size(), size_t(30));
+    for (size_t row = 0; row < window.size(); ++row)
+        QCOMPARE(window[row].line, QString::number(row));
+
+    const LogEntry* tracked = &window[25];
+    QCOMPARE(window.lowerBound(std::chrono::system_clock::time_point{ std::chrono::seconds{ 17 } }), size_t(17));
+    QCOMPARE(window.lowerBound(std::chrono::system_clock::time_point{ std::chrono::seconds{ 40 } }), window.size());
+
+    window.removeFront(5);
+    window.removeBack(2);
+    QCOMPARE(window.size(), size_t(23));
+    QCOMPARE(window.front().line, QString("5"));
+    QCOMPARE(window.back().line, QString("27"));
+    QCOMPARE(window.rowOf(tracked), size_t(20));
+    QCOMPARE(window.lowerBound(std::chrono::system_clock::time_point{ std::chrono::seconds{ 17 } }), size_t(12));
+
+    window.removeFront(10);
+    QCOMPARE(window.rowOf(tracked), size_t(10));
+    QCOMPARE(window[0].line, QString("15"));
+}
+
 int main(int argc, char **argv)
 {
     Application app(argc, argv);
@@ -8,6 +8,15 @@
 #include "services/SessionService.h"
 #include "services/SearchService.h"
 #include "services/ExportService.h"
+#include "services/ExportWriter.h"
+#include "LogManagement/Gzip.h"
+#include "LogFilter.h"
+#include "Settings.h"
+#include "Statistics/LogHistogram.h"
+#include "Statistics/TimelinePyramid.h"
+#include "Statistics/Aggregation.h"
+#include "Statistics/FieldStatistics.h"
+#include "Statistics/TemplateStatistics.h"
 
 
 static std::chrono::system_clock::time_point toTimePoint(const QDateTime &dt)
@@ -24,7 +33,19 @@ private slots:
     void cleanupTestCase();
     void testSessionService();
     void testSearchService();
+    void testColumnSearch();
+    void testBackwardSearch();
+    void testStreamingSearch();
     void testExportService();
+    void testExportWriter();
+    void testRawExport();
+    void testCompressedExport();
+    void testSnapshot();
+    void testHistogram();
+    void testTimelinePyramid();
+    void testAggregation();
+    void testFieldStatistics();
+    void testTemplateStatistics();
 
 private:
     Application* app;
@@ -115,6 +136,86 @@ void ServiceTests::testSearchService()
     QCOMPARE(args.at(0).toString(), QString("searchterm"));
 }
 
+void ServiceTests::testColumnSearch()
+{
+    QSignalSpy spy(searchService, &SearchService::searchFinished);
+    QVERIFY2(spy.isValid(), "QSignalSpy: failed to connect to SearchService::searchFinished");
+
+    const QStringList fields{ "0", "__module", "1", "2", "3", "4", "5" };
+
+    searchService->search(toTimePoint(firstTime), "mod", false, false, false, 6, fields);
+    QVERIFY(spy.isEmpty());
+
+    searchService->search(toTimePoint(firstTime), "searchterm", false, false, false, 6, fields);
+    QCOMPARE(spy.size(), 1);
+
+    QList<QVariant> args = spy.takeFirst();
+    QCOMPARE(args.at(1).value<std::chrono::system_clock::time_point>(), toTimePoint(secondTime));
+}
+
+void ServiceTests::testBackwardSearch()
+{
+    QSignalSpy spy(searchService, &SearchService::searchFinished);
+    QVERIFY2(spy.isValid(), "QSignalSpy: failed to connect to SearchService::searchFinished");
+
+    searchService->search(toTimePoint(secondTime), "searchterm", false, true, false, -1, QStringList{});
+    QVERIFY(spy.isEmpty());
+
+    searchService->search(toTimePoint(secondTime), "hello", false, true, false, -1, QStringList{});
+    QCOMPARE(spy.size(), 1);
+
+    QList<QVariant> args = spy.takeFirst();
+    QCOMPARE(args.at(1).value<std::chrono::system_clock::time_point>(), toTimePoint(firstTime));
+
+    // From a merge position the search starts right before the entry at it, whatever its timestamp
+    auto iterator = sessionService->getSession()->getIterator(toTimePoint(firstTime), toTimePoint(secondTime));
+    QVERIFY(iterator.next());
+    auto position = iterator.getCache();
+    QVERIFY(position.time == toTimePoint(secondTime));
+
+    searchService->searchBackward(position, "searchterm", false, -1, QStringList{}, LogFilter{});
+    QVERIFY(spy.isEmpty());
+
+    searchService->searchBackward(position, "hello", false, -1, QStringList{}, LogFilter{});
+    QCOMPARE(spy.size(), 1);
+    QCOMPARE(spy.takeFirst().at(1).value<std::chrono::system_clock::time_point>(), toTimePoint(firstTime));
+}
+
+void ServiceTests::testStreamingSearch()
+{
+    QSignalSpy addedSpy(searchService, &SearchService::searchResultsAdded);
+    QSignalSpy finishedSpy(searchService, &SearchService::searchResultsFinished);
+    QVERIFY(addedSpy.isValid());
+    QVERIFY(finishedSpy.isValid());
+
+    searchService->setResultLimit(1);
+    auto guard = qScopeGuard([this]() { searchService->setResultLimit(SearchService::loadResultLimit()); });
+
+    searchService->search(toTimePoint(firstTime), "mod", false, false, true, -1, QStringList{});
+    QCOMPARE(addedSpy.size(), 1);
+    QCOMPARE(finishedSpy.size(), 1);
+    QVERIFY(finishedSpy.takeFirst().at(0).toBool());
+
+    auto results = addedSpy.takeFirst().at(0).value<QMap<std::chrono::system_clock::time_point, QString>>();
+    QCOMPARE(results.size(), 1);
+    QCOMPARE(results.firstKey(), toTimePoint(firstTime));
+
+    searchService->continueSearch();
+    QCOMPARE(addedSpy.size(), 1);
+    QCOMPARE(finishedSpy.size(), 1);
+    QVERIFY(!finishedSpy.takeFirst().at(0).toBool());
+
+    results = addedSpy.takeFirst().at(0).value<QMap<std::chrono::system_clock::time_point, QString>>();
+    QCOMPARE(results.size(), 1);
+    QCOMPARE(results.firstKey(), toTimePoint(secondTime));
+
+    // Reaching the limit with the last match does not report more results
+    searchService->search(toTimePoint(firstTime), "searchterm", false, false, true, -1, QStringList{});
+    QCOMPARE(addedSpy.size(), 1);
+    QCOMPARE(finishedSpy.size(), 1);
+    QVERIFY(!finishedSpy.takeFirst().at(0).toBool());
+}
+
 void ServiceTests::testExportService()
 {
     QString outFile = tempDir->filePath("export.csv");
@@ -125,6 +226,378 @@ void ServiceTests::testExportService()
     QVERIFY(content.contains("searchterm"));
 }
 
+void ServiceTests::testExportWriter()
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    const QString padding(1000, 'x');
+    {
+        ExportWriter writer(buffer, [&padding](QString& out, const LogEntry& entry) {
+            out += entry.line;
+            out += padding;
+            out += '\n';
+        }, 4);
+
+        for (int i = 0; i < 100; ++i)
+        {
+            std::vector<LogEntry> batch(50);
+            for (int j = 0; j < 50; ++j)
+                batch[j].line = QString::number(i * 50 + j);
+            writer.push(std::move(batch));
+        }
+        QVERIFY(writer.finish());
+    }
+
+    auto lines = data.split('\n');
+    QCOMPARE(lines.size(), qsizetype(5001));
+    for (int i = 0; i < 5000; ++i)
+        QCOMPARE(lines[i], QString::number(i).toUtf8() + padding.toUtf8());
+
+    // A formatter thread that throws fails the export on the pushing thread instead of terminating
+    ExportWriter failingWriter(buffer, [](QString&, const LogEntry&) {
+        throw std::runtime_error("format failed");
+    }, 2);
+    failingWriter.push(std::vector<LogEntry>(1));
+    QVERIFY_THROWS_EXCEPTION(std::runtime_error, failingWriter.finish());
+
+    // After a failed write the next push stops the export
+    QBuffer readOnly;
+    QVERIFY(readOnly.open(QIODevice::ReadOnly));
+    ExportWriter stoppedWriter(readOnly, [](QString&, const LogEntry&) {}, 1);
+    const QString block(ExportWriter::WriteSize, 'x');
+    bool stopped = false;
+    for (int i = 0; i < 100 && !stopped; ++i)
+    {
+        try
+        {
+            stoppedWriter.push(block);
+            QTest::qWait(10);
+        }
+        catch (const std::runtime_error&)
+        {
+            stopped = true;
+        }
+    }
+    QVERIFY(stopped);
+    QVERIFY(!stoppedWriter.finish());
+}
+
+void ServiceTests::testRawExport()
+{
+    QTemporaryDir logDir;
+    auto writeLog = [&logDir](const QString& name, const QByteArray& content) {
+        QFile file(logDir.filePath(name));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(content);
+    };
+    writeLog("alpha.csv", "2023-01-01 00:00:00.000;1;1;alpha;info;first\n"
+                          "continued line\n"
+                          "2023-01-01 00:01:00.000;1;1;alpha;info;second\n");
+    writeLog("beta.csv", "2023-01-01 00:02:00.000;1;1;beta;info;third\n"
+                         "2023-01-01 00:03:00.000;1;1;beta;info;fourth");
+
+    SessionService rawSessionService;
+    ExportService rawExportService(&rawSessionService);
+    rawSessionService.openFolder(logDir.path(), QStringList() << "TestFormat");
+    auto logManager = rawSessionService.getLogManager();
+    QVERIFY(logManager);
+    rawSessionService.createSession(logManager->getModules(), logManager->getMinTime(), logManager->getMaxTime());
+
+    auto start = toTimePoint(firstTime) + std::chrono::seconds(30);
+    auto end = toTimePoint(firstTime) + std::chrono::minutes(2);
+    auto ranges = rawSessionService.getSession()->getRawRanges(start, end);
+    QVERIFY(ranges);
+    QCOMPARE(ranges->size(), size_t(2));
+
+    QString outFile = tempDir->filePath("raw.csv");
+    rawExportService.exportData(outFile, start, end);
+    QFile file(outFile);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("2023-01-01 00:01:00.000;1;1;alpha;info;second\n"
+                                        "2023-01-01 00:02:00.000;1;1;beta;info;third\n"));
+
+    // Overlapping modules have to go through the merge
+    writeLog("gamma.csv", "2023-01-01 00:01:30.000;1;1;gamma;info;interleaved\n");
+    rawSessionService.openFolder(logDir.path(), QStringList() << "TestFormat");
+    logManager = rawSessionService.getLogManager();
+    rawSessionService.createSession(logManager->getModules(), logManager->getMinTime(), logManager->getMaxTime());
+    QVERIFY(!rawSessionService.getSession()->getRawRanges(start, end));
+}
+
+void ServiceTests::testCompressedExport()
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    {
+        ExportWriter writer(buffer, [](QString& out, const LogEntry& entry) {
+            out += entry.line;
+            out += '\n';
+        }, 4, ExportWriter::Compression::Gzip);
+
+        writer.push(QStringLiteral("header\n"));
+        for (int i = 0; i < 20; ++i)
+        {
+            std::vector<LogEntry> batch(100);
+            for (int j = 0; j < 100; ++j)
+                batch[j].line = QString::number(i * 100 + j);
+            writer.push(std::move(batch));
+        }
+        QVERIFY(writer.finish());
+    }
+
+    auto lines = decompressGzip(data).split('\n');
+    QCOMPARE(lines.size(), qsizetype(2002));
+    QCOMPARE(lines[0], QByteArray("header"));
+    for (int i = 0; i < 2000; ++i)
+        QCOMPARE(lines[i + 1], QString::number(i).toUtf8());
+
+    // The exported file has to open like any other log
+    QString outFile = tempDir->filePath("compressed.csv.gz");
+    exportService->exportData(outFile, toTimePoint(firstTime), toTimePoint(secondTime));
+
+    SessionService compressedSessionService;
+    compressedSessionService.openFile(outFile, QStringList() << "TestFormat");
+    auto logManager = compressedSessionService.getLogManager();
+    QVERIFY(logManager);
+    QCOMPARE(logManager->getModules().size(), size_t(1));
+    QVERIFY(logManager->getMinTime() == toTimePoint(firstTime));
+    QVERIFY(logManager->getMaxTime() == toTimePoint(secondTime));
+
+    compressedSessionService.createSession(logManager->getModules(), logManager->getMinTime(), logManager->getMaxTime());
+    auto iterator = compressedSessionService.getSession()->getIterator(toTimePoint(firstTime), toTimePoint(secondTime));
+    QStringList messages;
+    while (iterator.hasLogs())
+    {
+        auto entry = iterator.next();
+        if (!entry)
+            break;
+        messages.push_back(entry->line.section(';', 5));
+    }
+    QCOMPARE(messages, QStringList() << "hello" << "searchterm");
+}
+
+void ServiceTests::testSnapshot()
+{
+    QString outFile = tempDir->filePath("session.lgs");
+    exportService->exportData(outFile, toTimePoint(firstTime), toTimePoint(secondTime));
+
+    SessionService snapshotSessionService;
+    snapshotSessionService.openFile(outFile, QStringList());
+    auto logManager = snapshotSessionService.getLogManager();
+    QVERIFY(logManager);
+    QCOMPARE(logManager->getModules().size(), size_t(1));
+    QVERIFY(logManager->getMinTime() == toTimePoint(firstTime));
+    QVERIFY(logManager->getMaxTime() == toTimePoint(secondTime));
+
+    snapshotSessionService.createSession(logManager->getModules(), logManager->getMinTime(), logManager->getMaxTime());
+    auto session = snapshotSessionService.getSession();
+    QVERIFY(session);
+
+    auto iterator = session->getIterator(toTimePoint(firstTime), toTimePoint(secondTime));
+    QStringList messages;
+    while (iterator.hasLogs())
+    {
+        auto entry = iterator.next();
+        if (!entry)
+            break;
+        QCOMPARE(entry->line.section(';', 5), entry->values.at("5").toString());
+        messages.push_back(entry->values.at("5").toString());
+    }
+    QCOMPARE(messages, QStringList() << "hello" << "searchterm");
+
+    auto reverseIterator = session->getIterator<false>(toTimePoint(firstTime), toTimePoint(secondTime));
+    messages.clear();
+    while (reverseIterator.hasLogs())
+    {
+        auto entry = reverseIterator.next();
+        if (!entry)
+            break;
+        messages.push_back(entry->values.at("5").toString());
+    }
+    QCOMPARE(messages, QStringList() << "searchterm" << "hello");
+
+    auto buckets = Statistics::LogHistogram::calculate(*session.get(), toTimePoint(firstTime), toTimePoint(secondTime) + std::chrono::seconds(30), std::chrono::seconds(30));
+    QCOMPARE(buckets.size(), size_t(3));
+    QCOMPARE(buckets[0].count, 1);
+    QCOMPARE(buckets[1].count, 0);
+    QCOMPARE(buckets[2].count, 1);
+
+    // The zone maps skip blocks that hold none of the requested values
+    auto files = session->getFiles();
+    QCOMPARE(files.size(), size_t(1));
+    QVERIFY(files[0].snapshot);
+
+    QStringList fields{ "0", "1", "2", "3", "4", "5" };
+    std::unordered_map<int, VariantFilter> variants;
+    variants[5] = VariantFilter{ { "searchterm" }, FilterType::Whitelist };
+    LogFilter matchingFilter({}, variants, fields, {});
+    QCOMPARE(matchingFilter.selectBlocks(*files[0].snapshot), std::vector<bool>{ true });
+
+    variants[5] = VariantFilter{ { "missing" }, FilterType::Whitelist };
+    LogFilter missingFilter({}, variants, fields, {});
+    QCOMPARE(missingFilter.selectBlocks(*files[0].snapshot), std::vector<bool>{ false });
+
+    auto filteredIterator = session->getIterator(toTimePoint(firstTime), toTimePoint(secondTime), LogEntryPreFilter(), missingFilter.createBlockFilter());
+    QVERIFY(!filteredIterator.hasLogs() || !filteredIterator.next());
+
+    // The format keeps what reading the original files needed
+    Format format = *files[0].format;
+    format.logFileRegex = QRegularExpression("app_.*\\.log");
+    format.encoding = QStringConverter::Utf16LE;
+    format.comments = { { "#", std::nullopt }, { "/*", QString("*/") } };
+
+    QByteArray formatData;
+    {
+        QDataStream stream(&formatData, QIODevice::WriteOnly);
+        Snapshot::writeFormat(stream, format);
+    }
+    QDataStream stream(formatData);
+    auto restored = Snapshot::readFormat(stream);
+    QCOMPARE(restored->logFileRegex.pattern(), format.logFileRegex.pattern());
+    QVERIFY(restored->encoding == QStringConverter::Utf16LE);
+    QCOMPARE(restored->comments.size(), size_t(2));
+    QCOMPARE(restored->comments[0].start, QString("#"));
+    QVERIFY(!restored->comments[0].finish);
+    QCOMPARE(restored->comments[1].finish.value_or(QString()), QString("*/"));
+    QCOMPARE(restored->fields.size(), format.fields.size());
+
+    // A string offset past the end of its data is reported instead of read
+    LogEntry entry;
+    entry.line = "MARKER";
+    Snapshot::BlockInfo info;
+    auto blockData = Snapshot::encodeBlock({ entry }, format, info);
+    QCOMPARE(Snapshot::decodeBlock(blockData, 0).lines.get(0), QString("MARKER"));
+
+    int lineEnd = blockData.indexOf("MARKER") + 6 + 2 * sizeof(quint32);
+    blockData[lineEnd + 2] = '\x7f';
+    QVERIFY_THROWS_EXCEPTION(std::runtime_error, Snapshot::decodeBlock(blockData, 0));
+}
+
+void ServiceTests::testHistogram()
+{
+    auto session = sessionService->getSession();
+    QVERIFY(session);
+
+    auto buckets = Statistics::LogHistogram::calculate(*session.get(), toTimePoint(firstTime), toTimePoint(secondTime) + std::chrono::seconds(30), std::chrono::seconds(30));
+    QCOMPARE(buckets.size(), size_t(3));
+    QCOMPARE(buckets[0].count, 1);
+    QCOMPARE(buckets[1].count, 0);
+    QCOMPARE(buckets[2].count, 1);
+}
+
+void ServiceTests::testTimelinePyramid()
+{
+    auto session = sessionService->getSession();
+    QVERIFY(session);
+
+    Statistics::TimelinePyramid pyramid(*session.get());
+    QTRY_VERIFY(pyramid.isReady());
+
+    auto start = toTimePoint(firstTime);
+    auto end = toTimePoint(secondTime) + std::chrono::seconds(30);
+    for (auto bucketSize : { std::chrono::seconds(1), std::chrono::seconds(30), std::chrono::seconds(60) })
+    {
+        auto buckets = pyramid.query(start, end, bucketSize);
+        QVERIFY(buckets);
+
+        auto expected = Statistics::LogHistogram::calculate(*session.get(), start, end, bucketSize);
+        QCOMPARE(buckets->size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+            QCOMPARE(buckets->at(i).count, expected[i].count);
+    }
+
+    auto moduleBuckets = pyramid.query(start, end, std::chrono::seconds(30), { "unknown" });
+    QVERIFY(moduleBuckets);
+    QCOMPARE(moduleBuckets->front().count, 0);
+
+    // Edges inside a second cannot be counted exactly from the slots
+    QVERIFY(!pyramid.query(start + std::chrono::milliseconds(500), end, std::chrono::seconds(30)));
+    QVERIFY(!pyramid.query(start, end, std::chrono::milliseconds(1500)));
+
+    // An end inside the hour slot must not take the entry after it
+    auto shortEnd = start + std::chrono::seconds(30);
+    auto hourBuckets = pyramid.query(start, shortEnd, std::chrono::hours(1));
+    QVERIFY(hourBuckets);
+    auto expected = Statistics::LogHistogram::calculate(*session.get(), start, shortEnd, std::chrono::hours(1));
+    QCOMPARE(hourBuckets->size(), expected.size());
+    QCOMPARE(hourBuckets->front().count, 1);
+    QCOMPARE(hourBuckets->front().count, expected.front().count);
+}
+
+void ServiceTests::testAggregation()
+{
+    auto session = sessionService->getSession();
+    QVERIFY(session);
+
+    auto start = toTimePoint(firstTime);
+    auto end = toTimePoint(secondTime) + std::chrono::seconds(30);
+
+    Statistics::AggregationSpec spec;
+    spec.groupBy = "4";
+    spec.bucketSize = std::chrono::seconds(30);
+    auto counts = Statistics::Aggregator::calculate(*session.get(), start, end, spec);
+    QCOMPARE(counts.bucketStarts.size(), size_t(3));
+    QCOMPARE(counts.series.size(), size_t(1));
+    QCOMPARE(counts.series.front().key, QString("info"));
+    QCOMPARE(counts.series.front().values, std::vector<double>({ 1, 0, 1 }));
+
+    spec.groupBy = Statistics::AggregationSpec::ModuleKey;
+    spec.function = Statistics::AggregationSpec::Function::Sum;
+    spec.valueField = "1";
+    spec.bucketSize = std::chrono::minutes(2);
+    auto sums = Statistics::Aggregator::calculate(*session.get(), start, end, spec);
+    QCOMPARE(sums.series.size(), session->getModules().size());
+    QCOMPARE(sums.series.front().values, std::vector<double>({ 2 }));
+}
+
+void ServiceTests::testFieldStatistics()
+{
+    auto session = sessionService->getSession();
+    QVERIFY(session);
+
+    Statistics::FieldStatisticsSpec spec;
+    spec.fields << "1" << "5";
+    spec.perModule = true;
+    spec.bucketSize = std::chrono::seconds(30);
+    auto result = Statistics::FieldStatistics::calculate(*session.get(), toTimePoint(firstTime), toTimePoint(secondTime) + std::chrono::seconds(1), spec);
+
+    QCOMPARE(result.summaries.size(), size_t(2));
+    QVERIFY(result.summaries[0].bucketStart < result.summaries[1].bucketStart);
+
+    auto totals = result.getTotals();
+    QCOMPARE(totals.size(), size_t(2));
+    QCOMPARE(totals[0].histogram.getCount(), std::uint64_t(2));
+    QCOMPARE(totals[0].sketch.quantile(0.5), 1.0);
+    QCOMPARE(totals[1].histogram.getCount(), std::uint64_t(0));
+}
+
+void ServiceTests::testTemplateStatistics()
+{
+    auto session = sessionService->getSession();
+    QVERIFY(session);
+
+    Statistics::TemplateSpec spec;
+    spec.field = "5";
+    spec.bucketSize = std::chrono::seconds(30);
+    auto start = toTimePoint(firstTime);
+    auto end = toTimePoint(secondTime) + std::chrono::seconds(1);
+    auto result = Statistics::TemplateStatistics::calculate(*session.get(), start, end, spec);
+
+    QCOMPARE(result.bucketStarts.size(), size_t(3));
+    QCOMPARE(result.templates.size(), size_t(2));
+    QCOMPARE(result.templates[0].total + result.templates[1].total, std::int64_t(2));
+
+    auto split = start + std::chrono::seconds(30);
+    auto changes = result.rankChanges(start, split, split, end);
+    QCOMPARE(changes.size(), size_t(2));
+    QCOMPARE(result.templates[changes.front().index].text, QString("searchterm"));
+    QCOMPARE(result.templates[changes.back().index].text, QString("hello"));
+}
+
 int main(int argc, char** argv)
 {
     Application app(argc, argv);